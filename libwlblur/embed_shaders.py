@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# wlblur - Compositor-agnostic blur for Wayland
+# Copyright (C) 2025 mecattaf
+# SPDX-License-Identifier: MIT
+#
+# embed_shaders.py - Compile GLSL files into the library as constant data
+#
+# Usage: embed_shaders.py OUTPUT.c SHADER...
+#
+# Each shader becomes one string in wlblur_embedded_shaders[], looked up by
+# file name. #include directives are left in place and resolved when the
+# shader is loaded, so a WLBLUR_SHADER_PATH override sees the same source.
+
+import os
+import sys
+
+
+def c_string(data):
+    """Quote bytes as C string literals, one per source line."""
+    lines = []
+    for line in data.splitlines(keepends=True):
+        out = []
+        for byte in line:
+            char = chr(byte)
+            if char == '\\':
+                out.append('\\\\')
+            elif char == '"':
+                out.append('\\"')
+            elif char == '\n':
+                out.append('\\n')
+            elif char == '\t':
+                out.append('\\t')
+            elif 0x20 <= byte < 0x7f:
+                out.append(char)
+            else:
+                out.append('\\%03o' % byte)
+        lines.append('\t\t"' + ''.join(out) + '"')
+    return '\n'.join(lines) if lines else '\t\t""'
+
+
+def main():
+    if len(sys.argv) < 3:
+        sys.exit('usage: embed_shaders.py OUTPUT.c SHADER...')
+
+    entries = []
+    for path in sys.argv[2:]:
+        with open(path, 'rb') as f:
+            entries.append((os.path.basename(path), f.read()))
+
+    with open(sys.argv[1], 'w') as out:
+        out.write('/* Generated by embed_shaders.py, do not edit */\n\n')
+        out.write('#include "private/internal.h"\n\n')
+        out.write('const struct wlblur_embedded_shader '
+                  'wlblur_embedded_shaders[] = {\n')
+        for name, data in entries:
+            out.write('\t{ "%s",\n%s },\n' % (name, c_string(data)))
+        out.write('};\n\n')
+        out.write('const int wlblur_num_embedded_shaders = %d;\n'
+                  % len(entries))
+
+
+if __name__ == '__main__':
+    main()
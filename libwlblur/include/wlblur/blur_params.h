@@ -23,7 +23,8 @@
  * Determines which blur algorithm to use for rendering.
  *
  * m-3 (v1.0): Only WLBLUR_ALGO_KAWASE is supported
- * m-9 (v2.0): gaussian, box, bokeh will be added
+ * m-9 (v2.0): gaussian, box, bokeh and iir, each behind the
+ *             blur-algorithms build option
  *
  * Note: Including this enum in m-3 prevents breaking config format
  * changes when adding new algorithms in future versions.
@@ -42,40 +43,61 @@ enum wlblur_algorithm {
     WLBLUR_ALGO_KAWASE = 0,
 
     /**
-     * Gaussian blur (coming in m-9)
+     * Gaussian blur
      *
-     * Highest quality, mathematically perfect Gaussian distribution.
-     * Uses separable 2D convolution (horizontal + vertical passes).
+     * True Gaussian distribution with sigma taken from num_passes and
+     * radius (see wlblur_blur_computed.sigma).
+     * Uses separable 2D convolution (horizontal + vertical passes) with
+     * linear-sampling weights, at reduced resolution for large sigma.
      *
-     * Performance: ~1.8ms @ 1080p (sigma=10, kernel=21)
+     * Performance: cheapest option for small blurs (tooltips, menus)
      * Quality: Perfect Gaussian, no artifacts
-     * Supported: m-9+ (v2.0+)
+     * Supported: built when 'gaussian' is in the blur-algorithms option
      */
     WLBLUR_ALGO_GAUSSIAN = 1,
 
     /**
-     * Box blur (coming in m-9)
+     * Box blur
      *
-     * Fastest algorithm, lower quality.
-     * Uses simple averaging filter.
+     * Predictable cost, lower quality.
+     * Averages a box read from a GPU summed-area table, so the cost does
+     * not depend on radius. box_iterations > 1 approximates a Gaussian.
      *
-     * Performance: ~0.6ms @ 1080p (2 iterations)
+     * Performance: constant in radius, linear in box_iterations
      * Quality: Acceptable for low-end hardware
-     * Supported: m-9+ (v2.0+)
+     * Supported: built when 'box' is in the blur-algorithms option
      */
     WLBLUR_ALGO_BOX = 2,
 
     /**
-     * Bokeh blur (coming in m-9)
+     * Bokeh blur
      *
      * Artistic depth-of-field effect.
-     * Simulates camera lens bokeh with customizable shape.
-     *
-     * Performance: ~2.5ms @ 1080p (radius=12)
-     * Quality: Artistic, decorative
-     * Supported: m-9+ (v2.0+)
+     * Simulates a camera lens with a hexagonal aperture: bright spots
+     * become flat hexagons instead of soft blobs. The hexagon has the same
+     * sigma as the other algorithms (circumradius sqrt(24/5) × sigma) and
+     * is built from four skewed line blurs at quarter resolution.
+     *
+     * Performance: see bench_kawase; roughly constant above sigma≈30
+     * Quality: Artistic, decorative (lock screens, overviews)
+     * Supported: built when 'bokeh' is in the blur-algorithms option
      */
     WLBLUR_ALGO_BOKEH = 3,
+
+    /**
+     * Recursive Gaussian blur
+     *
+     * Gaussian for very large radii (full-screen overviews).
+     * A third-order recursive filter (Young-van Vliet) runs along every
+     * row and column in compute shaders, so the cost does not depend on
+     * sigma. Beyond sigma 16 it filters a block-averaged input.
+     *
+     * Performance: constant in radius, two dispatches
+     * Quality: High (close to gaussian), slightly soft for sigma < 3
+     * Supported: built when 'iir' is in the blur-algorithms option;
+     *            needs GLES 3.1
+     */
+    WLBLUR_ALGO_IIR = 4,
 };
 
 /**
@@ -92,7 +114,7 @@ struct wlblur_blur_params {
      * Default: WLBLUR_ALGO_KAWASE
      *
      * m-3 (v1.0): Only WLBLUR_ALGO_KAWASE is accepted
-     * m-9 (v2.0): All algorithms will be supported
+     * m-9 (v2.0): All algorithms are supported when built
      *
      * Note: This field is included in m-3 to avoid config format
      * breaking changes when new algorithms are added in m-9.
@@ -280,6 +302,25 @@ struct wlblur_blur_params {
     float tint_g;
     float tint_b;
     float tint_a;
+
+    /* === Algorithm-Specific Parameters === */
+    /* New fields go last: wlblurd requests embed this struct */
+
+    /**
+     * Box blur iterations (WLBLUR_ALGO_BOX only)
+     *
+     * Range: 0-4
+     * Default: 1
+     *
+     * The box sizes are chosen so the result has the same sigma as the
+     * other algorithms (see wlblur_blur_computed.sigma). Cost is constant
+     * in radius and linear in iterations.
+     *
+     * Values:
+     *   0 or 1: Single box (cheapest, box-shaped falloff)
+     *   3: Close to a Gaussian
+     */
+    int box_iterations;
 };
 
 /**
@@ -308,12 +349,33 @@ struct wlblur_blur_computed {
      * Compositors must expand damage regions by this amount to prevent
      * artifacts at edges of blurred regions.
      *
-     * Typically: damage_expand = blur_size
+     * This is the larger of blur_size and the real sampling footprint of
+     * the downsample/upsample chain (tap offsets plus bilinear texels at
+     * each level), so it is always safe to use for damage tracking.
+     *
+     * Examples:
+     *   passes=1, radius=5  → damage_expand=20 (blur_size dominates)
+     *   passes=3, radius=5  → damage_expand=111 (footprint dominates)
      *
      * Rationale: Blur kernel needs access to pixels outside the damaged
      * region to avoid edge artifacts.
      */
     int damage_expand;
+
+    /**
+     * Standard deviation of the equivalent Gaussian (pixels)
+     *
+     * Fitted to the measured edge response of the Kawase chain:
+     *   sigma² = Σ_{i<num_passes} 0.834 × ((radius + i) × 2^i)² + 0.85 × 4^i
+     *
+     * Non-Kawase algorithms derive their kernel from this, so switching
+     * algorithm keeps the same blur strength for the same passes/radius.
+     *
+     * Examples:
+     *   passes=1, radius=2 → sigma≈2.0
+     *   passes=3, radius=5 → sigma≈28.5
+     */
+    float sigma;
 };
 
 /**
@@ -334,6 +396,7 @@ enum wlblur_preset {
  * Uses SceneFX-style defaults (balanced quality/performance):
  *   num_passes = 3
  *   radius = 5.0
+ *   box_iterations = 1
  *   brightness = 0.9
  *   contrast = 0.9
  *   saturation = 1.1
@@ -356,8 +419,10 @@ struct wlblur_blur_params wlblur_params_from_preset(enum wlblur_preset preset);
  * Validate parameter ranges
  *
  * Checks that all parameters are within valid ranges:
+ *   algorithm: a wlblur_algorithm value
  *   num_passes: 1-8
  *   radius: 1.0-20.0
+ *   box_iterations: 0-4
  *   brightness, contrast, saturation: 0.0-2.0
  *   noise: 0.0-0.1
  *   vibrancy: 0.0-2.0
@@ -372,9 +437,11 @@ bool wlblur_params_validate(const struct wlblur_blur_params *params);
 /**
  * Compute derived parameters
  *
- * Calculates blur_size and damage_expand from core parameters.
+ * Calculates blur_size, damage_expand and sigma from core parameters.
  *
  * Formula: blur_size = 2^(num_passes+1) × radius
+ *          damage_expand = max(blur_size, sampling footprint of the
+ *                              selected algorithm)
  *
  * @param params Input parameters
  * @return Computed values struct
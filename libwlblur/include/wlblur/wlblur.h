@@ -49,6 +49,18 @@ enum wlblur_error {
 	WLBLUR_ERROR_INVALID_PARAMS,     // Parameter validation failed
 	WLBLUR_ERROR_GL_ERROR,           // OpenGL error occurred
 	WLBLUR_ERROR_OUT_OF_MEMORY,      // Memory allocation failed
+	WLBLUR_ERROR_BUSY,               // Every output buffer is in use
+};
+
+/**
+ * Storage precision of Kawase pyramid levels
+ *
+ * The pyramid is bandwidth-bound, so 16-bit levels are roughly twice as
+ * fast to read and write. The exported output is always 8-bit RGBA.
+ */
+enum wlblur_precision {
+	WLBLUR_PRECISION_AUTO = 0,  // Pick from the input's DRM format (default)
+	WLBLUR_PRECISION_FULL,      // Always 8-bit RGBA
 };
 
 /* === Context Management === */
@@ -86,8 +98,72 @@ struct wlblur_context* wlblur_context_create(void);
  */
 void wlblur_context_destroy(struct wlblur_context *ctx);
 
+/**
+ * Set the storage precision of Kawase pyramid levels
+ *
+ * WLBLUR_PRECISION_AUTO (the default) stores levels of XRGB8888 and
+ * XBGR8888 input as RGB565, since the alpha channel is unused, and keeps
+ * more than 8 bits for 10-bit and half-float input when the GPU can
+ * render to float formats. Other input uses 8-bit RGBA, and so does
+ * every input on software rasterizers, where format conversion costs
+ * more than the bandwidth saved.
+ *
+ * WLBLUR_PRECISION_FULL always uses 8-bit RGBA, avoiding the banding
+ * 5/6-bit levels can show in smooth gradients with noise = 0.
+ *
+ * @param ctx Blur context
+ * @param precision New precision, applied from the next blur
+ */
+void wlblur_context_set_precision(
+	struct wlblur_context *ctx,
+	enum wlblur_precision precision
+);
+
+/**
+ * Set the GPU memory budget of the context's framebuffer pool
+ *
+ * Idle intermediate framebuffers are freed, least recently used first,
+ * while the pool holds more than this many bytes. Framebuffers in use
+ * by a blur are never freed, so a single large blur may exceed it.
+ *
+ * @param ctx Blur context
+ * @param bytes Budget in bytes, 0 to keep nothing idle
+ */
+void wlblur_context_set_memory_budget(struct wlblur_context *ctx,
+                                      uint64_t bytes);
+
+/**
+ * Start compiling the shaders a set of parameters needs
+ *
+ * Shaders are otherwise compiled on first use: a context only builds the
+ * algorithms and shader variants its blurs ask for. Calling this for
+ * every configured preset at startup moves that work off the first
+ * frames. Where the driver supports GL_KHR_parallel_shader_compile the
+ * optional variants compile in the background; blurs never wait for
+ * them, rendering with the generic shaders until they are ready.
+ *
+ * @param ctx Blur context
+ * @param params Parameters that will be blurred with
+ * @return false if params are invalid or their algorithm is unavailable
+ */
+bool wlblur_context_prepare(
+	struct wlblur_context *ctx,
+	const struct wlblur_blur_params *params
+);
+
 /* === Blur Operations === */
 
+/**
+ * Rectangle in buffer pixel coordinates (damage, source regions)
+ *
+ * (x1, y1) is the top-left corner, (x2, y2) the exclusive bottom-right
+ * corner, matching the wire format in docs/api/ipc-protocol.md.
+ */
+struct wlblur_rect {
+	int32_t x1, y1;
+	int32_t x2, y2;
+};
+
 /**
  * Apply blur to DMA-BUF texture
  *
@@ -134,6 +210,524 @@ bool wlblur_apply_blur(
 	struct wlblur_dmabuf_attribs *output_attribs
 );
 
+/**
+ * Apply blur to one rectangle of a DMA-BUF texture
+ *
+ * Blurs only what the source rectangle needs: the downsample pyramid is
+ * built over the rectangle grown by wlblur_params_compute().damage_expand
+ * (clipped to the input), so a small window over a large backdrop costs
+ * in proportion to the window. The result matches the same rectangle of
+ * a full-frame wlblur_apply_blur(), except for the noise pattern.
+ *
+ * The output buffer has the size of the source rectangle after clipping
+ * to the input.
+ *
+ * @param ctx Blur context
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Blur parameters
+ * @param source Area to blur, in input pixels; NULL or empty for the
+ *               whole input
+ * @param output_attribs Output DMA-BUF attributes (filled by function)
+ *
+ * @return true on success, false on failure (check wlblur_get_error());
+ *         a source outside the input fails with WLBLUR_ERROR_INVALID_PARAMS
+ *
+ * Ownership: same as wlblur_apply_blur()
+ */
+bool wlblur_apply_blur_region(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	struct wlblur_dmabuf_attribs *output_attribs
+);
+
+/**
+ * Apply blur to several rectangles of one DMA-BUF texture
+ *
+ * Equivalent to one wlblur_apply_blur_region() per rectangle, but the
+ * input is imported and cropped once and the blur runs once over the
+ * union of the rectangles' crops. Kawase renders every pass only around
+ * the rectangles, so the cost follows the covered area, not the number
+ * of rectangles; other algorithms blur the whole union crop.
+ *
+ * @param ctx Blur context
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Blur parameters, shared by every rectangle
+ * @param sources Areas to blur, in input pixels (empty: whole input)
+ * @param num_sources Number of rectangles
+ * @param outputs One output per rectangle (filled by function), each the
+ *                size of its clipped rectangle
+ *
+ * @return true on success, false on failure (check wlblur_get_error());
+ *         on failure no output FDs are left open
+ *
+ * Ownership: same as wlblur_apply_blur(), for every output
+ */
+bool wlblur_apply_blur_regions(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *sources,
+	int num_sources,
+	struct wlblur_dmabuf_attribs *outputs
+);
+
+/**
+ * Maximum parameter sets per wlblur_apply_blur_multi() call
+ */
+#define WLBLUR_MAX_PARAM_SETS 8
+
+/**
+ * Apply several blurs (e.g. presets) to one DMA-BUF texture
+ *
+ * Equivalent to one wlblur_apply_blur_region() per parameter set, but the
+ * input is imported and cropped once, and Kawase sets share their work:
+ * sets with the same radius share one downsample pyramid as deep as
+ * their largest pass count, sets that also share the pass count share
+ * the upsample chain, and only the post-processing runs per set. N
+ * presets of one radius cost about one pyramid plus N upsample chains.
+ * Other algorithms blur once per set.
+ *
+ * @param ctx Blur context
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Parameter sets
+ * @param num_params Number of sets, at most WLBLUR_MAX_PARAM_SETS
+ * @param source Area to blur, in input pixels; NULL or empty for the
+ *               whole input
+ * @param outputs One output per set (filled by function), each the size
+ *                of the clipped source
+ *
+ * @return true on success, false on failure (check wlblur_get_error());
+ *         on failure no output FDs are left open
+ *
+ * Ownership: same as wlblur_apply_blur(), for every output
+ */
+bool wlblur_apply_blur_multi(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	int num_params,
+	const struct wlblur_rect *source,
+	struct wlblur_dmabuf_attribs *outputs
+);
+
+/* === Damage-Aware Blur === */
+
+/**
+ * Maximum number of damage rectangles processed individually
+ *
+ * Longer damage lists are merged into their bounding box.
+ */
+#define WLBLUR_MAX_DAMAGE_RECTS 16
+
+/**
+ * Opaque retained blur state
+ *
+ * Holds every pyramid level and the post-processed output of the last
+ * render so later frames can patch only the damaged part. One node per
+ * blurred surface; must be destroyed before its context.
+ */
+struct wlblur_node;
+
+/**
+ * Create retained blur state
+ *
+ * GPU resources are allocated on the first render, or up front by
+ * wlblur_node_reserve().
+ *
+ * @param ctx Blur context the node renders with
+ * @return Node handle or NULL on failure
+ */
+struct wlblur_node* wlblur_node_create(struct wlblur_context *ctx);
+
+/**
+ * Destroy retained blur state
+ *
+ * @param node Node to destroy (NULL-safe)
+ */
+void wlblur_node_destroy(struct wlblur_node *node);
+
+/**
+ * Allocate a node's pyramid and output for whole-buffer renders
+ *
+ * Sizes the retained chain for input of this size and DRM format, so
+ * later renders with these params allocate nothing. A render with a
+ * different size, format, pass count or source rectangle reallocates
+ * it. Algorithms other than Kawase keep no chain; for them this only
+ * validates params.
+ *
+ * @param node Retained state created with wlblur_node_create()
+ * @param width Input width
+ * @param height Input height
+ * @param format Input DRM format (DRM_FORMAT_*), picks the pyramid format
+ * @param params Blur parameters the node will render with
+ * @return true on success, false on failure (check wlblur_get_error())
+ */
+bool wlblur_node_reserve(
+	struct wlblur_node *node,
+	int width,
+	int height,
+	uint32_t format,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Apply blur, re-rendering only what changed since the node's last frame
+ *
+ * Each damage rectangle marks input pixels that changed. It is expanded
+ * by wlblur_params_compute().damage_expand and every pyramid level is
+ * re-rendered only inside the scaled, scissored expansion; everything
+ * else is kept from the previous frame.
+ *
+ * A full re-blur happens when num_damage is 0, on the first render, or
+ * when the input size or any blur parameter changed.
+ *
+ * The output is the node's retained texture, updated in place, so the
+ * exported buffer always holds the complete blurred image.
+ *
+ * With a source rectangle the node retains only its crop, as in
+ * wlblur_apply_blur_region(); moving the rectangle forces a full re-blur.
+ *
+ * @param ctx Blur context
+ * @param node Retained state created with wlblur_node_create()
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Blur parameters
+ * @param source Area to blur, in input pixels; NULL or empty for the
+ *               whole input
+ * @param damage Changed input rectangles (may be NULL if num_damage is 0)
+ * @param num_damage Number of damage rectangles
+ * @param output_attribs Output DMA-BUF attributes (filled by function)
+ *
+ * @return true on success, false on failure (check wlblur_get_error())
+ *
+ * Ownership: same as wlblur_apply_blur()
+ */
+bool wlblur_apply_blur_damage(
+	struct wlblur_context *ctx,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	struct wlblur_dmabuf_attribs *output_attribs
+);
+
+/* === Imported Buffers === */
+
+/**
+ * Opaque buffer imported once
+ *
+ * Every blur call otherwise imports its input DMA-BUF and deletes the
+ * texture afterwards. A compositor blurring the same few swapchain
+ * buffers can import each once and pass its attributes instead. Buffers
+ * can also be blurred into, see wlblur_apply_blur_to().
+ */
+struct wlblur_buffer;
+
+/**
+ * Import an input DMA-BUF and keep its texture
+ *
+ * @param ctx Blur context
+ * @param attribs DMA-BUF attributes (caller keeps ownership of the FDs)
+ * @return Buffer handle or NULL on failure (check wlblur_get_error())
+ */
+struct wlblur_buffer* wlblur_buffer_import(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs
+);
+
+/**
+ * Attributes of an imported buffer
+ *
+ * Pass them as input_attribs to any blur call (or to
+ * wlblur_read_pixels()) to sample the kept texture without importing
+ * again. Their FDs are -1. Valid until the buffer is destroyed.
+ *
+ * @param buffer Imported buffer
+ * @return Buffer attributes, or NULL if buffer is NULL
+ */
+const struct wlblur_dmabuf_attribs* wlblur_buffer_get_attribs(
+	const struct wlblur_buffer *buffer
+);
+
+/**
+ * Destroy an imported buffer
+ *
+ * Buffers still alive when their context is destroyed are freed with it.
+ *
+ * @param buffer Buffer to destroy (NULL-safe)
+ */
+void wlblur_buffer_destroy(struct wlblur_buffer *buffer);
+
+/**
+ * Apply blur into an imported buffer
+ *
+ * Renders like wlblur_apply_blur_damage() (or wlblur_apply_blur_region()
+ * when node is NULL) and writes the result into output instead of
+ * exporting a new buffer. The caller allocates output, e.g. with a
+ * modifier it samples fastest, and imports it with
+ * wlblur_buffer_import(); its format must be renderable.
+ *
+ * Without a node, a Kawase blur renders its last pass straight into
+ * output. A node's retained result, and other algorithms, are copied in.
+ *
+ * @param ctx Blur context
+ * @param node Retained state, or NULL
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Blur parameters
+ * @param source Area to blur; NULL or empty for the whole input
+ * @param damage Changed input rectangles (node only, may be NULL)
+ * @param num_damage Number of damage rectangles
+ * @param output Buffer to render into, the size of the blurred area and
+ *               not the input
+ * @param output_attribs Set to output's attributes (FDs -1)
+ *
+ * @return true on success, false on failure (check wlblur_get_error())
+ */
+bool wlblur_apply_blur_to(
+	struct wlblur_context *ctx,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	struct wlblur_buffer *output,
+	struct wlblur_dmabuf_attribs *output_attribs
+);
+
+/**
+ * Import cache counters
+ *
+ * Inputs not passed as imported buffers go through a small per-context
+ * cache keyed by dma-buf identity (inode, offsets, strides, format and
+ * modifier), so a compositor reusing a handful of buffers imports each
+ * once even with fresh FDs. Entries are dropped least recently used
+ * first, or once they go unused for a while.
+ *
+ * An entry holds a reference to its dma-buf, so a buffer the compositor
+ * freed stays allocated until its entry is dropped; the cache never
+ * notices the buffer going away.
+ */
+struct wlblur_import_stats {
+	uint64_t hits;       /* Inputs served from the cache */
+	uint64_t misses;     /* Inputs imported */
+	uint64_t evictions;  /* Imports dropped */
+	int entries;         /* Imports currently cached */
+};
+
+/**
+ * Get the context's import cache counters
+ *
+ * @param ctx Blur context
+ * @param stats Filled with the counters
+ */
+void wlblur_get_import_stats(
+	struct wlblur_context *ctx,
+	struct wlblur_import_stats *stats
+);
+
+/**
+ * Drop every cached import and its dma-buf reference
+ *
+ * Idle entries are only dropped by later blur calls. Call this when the
+ * context goes idle, or after freeing buffers it has blurred, so their
+ * memory is released. The next blur of a dropped buffer imports it again.
+ *
+ * @param ctx Blur context
+ */
+void wlblur_import_cache_flush(struct wlblur_context *ctx);
+
+/* === Output Ring === */
+
+/**
+ * Maximum depth of an output ring
+ */
+#define WLBLUR_MAX_RING_DEPTH 4
+
+/**
+ * Opaque ring of output buffers
+ *
+ * Every other blur call exports a fresh DMA-BUF. A ring instead keeps a
+ * few output textures, each exported once: steady-state frames reuse a
+ * buffer the caller already holds, with no EGLImage or new FDs. One ring
+ * per blurred surface; must be destroyed before its context.
+ */
+struct wlblur_output_ring;
+
+/**
+ * Create an output ring
+ *
+ * Buffers are allocated lazily, at the size of the first output placed
+ * in them. 2 covers a compositor reading one frame while the next is
+ * blurred; 3 also covers a frame queued for scanout.
+ *
+ * @param ctx Blur context the ring renders with
+ * @param depth Number of buffers, 1 to WLBLUR_MAX_RING_DEPTH
+ * @return Ring handle or NULL on failure
+ */
+struct wlblur_output_ring* wlblur_output_ring_create(
+	struct wlblur_context *ctx,
+	int depth
+);
+
+/**
+ * Destroy an output ring
+ *
+ * Buffers already exported stay valid for their holders.
+ *
+ * @param ring Ring to destroy (NULL-safe)
+ */
+void wlblur_output_ring_destroy(struct wlblur_output_ring *ring);
+
+/**
+ * Apply blur into a free buffer of an output ring
+ *
+ * Renders like wlblur_apply_blur_damage() (or wlblur_apply_blur_region()
+ * when node is NULL), then copies the result into a free ring buffer of
+ * the output size and marks it in use.
+ *
+ * output_attribs always describes the buffer. Its FDs are only set when
+ * the buffer at *index is new (first use, or reallocated for a new
+ * size); the caller then owns them and replaces whatever it held for
+ * that index. Otherwise the FDs are -1 and the caller reuses its import.
+ *
+ * @param ctx Blur context
+ * @param ring Output ring created with this context
+ * @param node Retained state, or NULL
+ * @param input_attribs Input DMA-BUF attributes (from compositor)
+ * @param params Blur parameters
+ * @param source Area to blur; NULL or empty for the whole input
+ * @param damage Changed input rectangles (node only, may be NULL)
+ * @param num_damage Number of damage rectangles
+ * @param index Set to the ring buffer holding the result
+ * @param output_attribs Output buffer attributes (filled by function)
+ *
+ * @return true on success, false on failure (check wlblur_get_error();
+ *         WLBLUR_ERROR_BUSY when no buffer was released)
+ */
+bool wlblur_apply_blur_ring(
+	struct wlblur_context *ctx,
+	struct wlblur_output_ring *ring,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	int *index,
+	struct wlblur_dmabuf_attribs *output_attribs
+);
+
+/**
+ * Return a ring buffer once the caller no longer reads it
+ *
+ * @param ring Output ring
+ * @param index Buffer index from wlblur_apply_blur_ring(); out of range
+ *              and already-free indices are ignored
+ */
+void wlblur_output_ring_release(struct wlblur_output_ring *ring, int index);
+
+/* === Pixel Transfer === */
+
+/**
+ * Read a DMA-BUF back into CPU memory
+ *
+ * For persisting blurred results (e.g. a static wallpaper) across
+ * restarts. This stalls until the GPU is done with the buffer, so keep
+ * it off per-frame paths.
+ *
+ * Pixels are tightly packed RGBA8, rows in GL texture order; pass them
+ * unchanged to wlblur_upload_pixels() to recreate the buffer.
+ *
+ * @param ctx Blur context
+ * @param attribs Buffer to read (caller retains FD ownership)
+ * @param pixels Destination, width * height * 4 bytes
+ *
+ * @return true on success, false on failure (check wlblur_get_error())
+ */
+bool wlblur_read_pixels(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs,
+	void *pixels
+);
+
+/**
+ * Upload CPU pixels into a new exported DMA-BUF
+ *
+ * @param ctx Blur context
+ * @param pixels Tightly packed RGBA8, as from wlblur_read_pixels()
+ * @param width Image width
+ * @param height Image height
+ * @param output_attribs Output DMA-BUF attributes (filled by function)
+ *
+ * @return true on success, false on failure (check wlblur_get_error())
+ *
+ * Ownership: same as wlblur_apply_blur()
+ */
+bool wlblur_upload_pixels(
+	struct wlblur_context *ctx,
+	const void *pixels,
+	int width,
+	int height,
+	struct wlblur_dmabuf_attribs *output_attribs
+);
+
+/* === Explicit Synchronization === */
+
+/**
+ * Kind of fence file descriptor
+ *
+ * Both kinds become readable (POLLIN) once signalled. Only sync files
+ * can be imported into EGL/Vulkan for a GPU-side wait.
+ */
+enum wlblur_fence_type {
+	WLBLUR_FENCE_NONE = 0,
+	WLBLUR_FENCE_SYNC_FILE = 1,  /* sync_file (EGL_ANDROID_native_fence_sync) */
+	WLBLUR_FENCE_EVENTFD = 2,    /* eventfd signalled by libwlblur */
+};
+
+/**
+ * Make the next blur wait for an acquire fence
+ *
+ * Use when the input buffer is still being rendered. Sync files become
+ * a GPU-side wait where the driver supports it; otherwise the calling
+ * thread polls the fence, for at most one second.
+ *
+ * @param ctx Blur context
+ * @param fence_fd Fence FD (ownership transferred); -1 is a no-op
+ * @param type Kind of fence
+ *
+ * @return true on success, false on timeout or error
+ */
+bool wlblur_wait_fence(
+	struct wlblur_context *ctx,
+	int fence_fd,
+	enum wlblur_fence_type type
+);
+
+/**
+ * Create a release fence for all blurs submitted so far
+ *
+ * Blur calls return once the GPU work is queued. With a release fence
+ * the caller can hand the output on and keep working, and wait on the
+ * fence only where it reads the buffer.
+ *
+ * Sync file where the driver supports EGL_ANDROID_native_fence_sync,
+ * otherwise an eventfd signalled from a libwlblur thread.
+ *
+ * @param ctx Blur context
+ * @param type Set to the kind of FD returned
+ *
+ * @return Fence FD (caller owns) or -1 on failure
+ */
+int wlblur_create_fence(
+	struct wlblur_context *ctx,
+	enum wlblur_fence_type *type
+);
+
 /* === Error Handling === */
 
 /**
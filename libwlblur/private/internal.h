@@ -13,9 +13,10 @@
 #include "wlblur/blur_params.h"
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
-#include <GLES3/gl3.h>
+#include <GLES3/gl31.h>
 #include <GLES2/gl2ext.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * EGL context for offscreen rendering
@@ -27,6 +28,13 @@ struct wlblur_egl_context {
 	bool has_dmabuf_import;
 	bool has_dmabuf_export;
 	bool has_surfaceless;
+	bool has_fence_sync;    /* EGL_KHR_fence_sync */
+	bool has_wait_sync;     /* EGL_KHR_wait_sync: GPU-side waits */
+	bool has_native_fence;  /* EGL_ANDROID_native_fence_sync */
+	bool has_parallel_compile;  /* GL_KHR_parallel_shader_compile */
+
+	/* Signals eventfds for fences without sync_file support (lazy) */
+	struct wlblur_fence_worker *fence_worker;
 
 	/* Extension function pointers */
 	PFNEGLCREATEIMAGEKHRPROC eglCreateImageKHR;
@@ -34,6 +42,11 @@ struct wlblur_egl_context {
 	PFNEGLEXPORTDMABUFIMAGEMESAPROC eglExportDMABUFImageMESA;
 	PFNEGLEXPORTDMABUFIMAGEQUERYMESAPROC eglExportDMABUFImageQueryMESA;
 	PFNGLEGLIMAGETARGETTEXTURE2DOESPROC glEGLImageTargetTexture2DOES;
+	PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR;
+	PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR;
+	PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR;
+	PFNEGLWAITSYNCKHRPROC eglWaitSyncKHR;
+	PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 };
 
 /**
@@ -51,6 +64,114 @@ void wlblur_egl_destroy(struct wlblur_egl_context *ctx);
  */
 bool wlblur_egl_make_current(struct wlblur_egl_context *ctx);
 
+/**
+ * Imported input textures
+ */
+
+/**
+ * Inputs kept imported per context; a compositor cycles through a few
+ */
+#define WLBLUR_IMPORT_CACHE_SIZE 8
+
+/**
+ * Milliseconds an entry may go unused before a lookup drops it
+ */
+#define WLBLUR_IMPORT_CACHE_MAX_IDLE_MS 1000
+
+struct wlblur_import_cache;
+
+/**
+ * Create an empty import cache
+ *
+ * @return Cache or NULL on allocation failure
+ */
+struct wlblur_import_cache* wlblur_import_cache_create(void);
+
+/**
+ * Delete every cached texture and free the cache (context current)
+ */
+void wlblur_import_cache_destroy(struct wlblur_import_cache *cache);
+
+/**
+ * Texture of an input DMA-BUF, imported on first use (context current)
+ *
+ * Buffers are identified by their planes' dma-buf inodes plus layout,
+ * so the same buffer sent with new FDs still hits.
+ *
+ * @param cache Import cache
+ * @param egl EGL context
+ * @param attribs Input attributes (caller keeps the FDs)
+ * @return Texture owned by the cache, or 0 on failure
+ */
+GLuint wlblur_import_cache_get(
+	struct wlblur_import_cache *cache,
+	struct wlblur_egl_context *egl,
+	const struct wlblur_dmabuf_attribs *attribs
+);
+
+/**
+ * Delete every cached texture (context current)
+ */
+void wlblur_import_cache_clear(struct wlblur_import_cache *cache);
+
+/**
+ * Copy the cache counters
+ */
+void wlblur_import_cache_get_stats(
+	const struct wlblur_import_cache *cache,
+	struct wlblur_import_stats *stats
+);
+
+/**
+ * Explicit synchronization
+ */
+
+/**
+ * Longest CPU-side wait for a fence that the GPU cannot wait on
+ */
+#define WLBLUR_FENCE_TIMEOUT_MS 1000
+
+/**
+ * Create a fence for all GL work submitted so far (context current)
+ *
+ * Exports a sync_file when native is set and the driver supports
+ * EGL_ANDROID_native_fence_sync. Otherwise creates an EGL_KHR_fence_sync
+ * fence and returns an eventfd that the context's fence worker signals
+ * once it completes.
+ *
+ * @param ctx EGL context
+ * @param native Whether a sync_file may be used
+ * @param type Set to the kind of FD returned
+ * @return Fence FD (caller owns) or -1 on failure
+ */
+int wlblur_fence_export(
+	struct wlblur_egl_context *ctx,
+	bool native,
+	enum wlblur_fence_type *type
+);
+
+/**
+ * Make later GL work wait for a fence (context current)
+ *
+ * Sync files become a GPU-side wait where supported; everything else is
+ * polled on the CPU for up to WLBLUR_FENCE_TIMEOUT_MS.
+ *
+ * @param ctx EGL context
+ * @param fence_fd Fence FD (consumed)
+ * @param type Kind of fence
+ * @return true once the wait is queued or done, false on timeout or error
+ */
+bool wlblur_fence_wait(
+	struct wlblur_egl_context *ctx,
+	int fence_fd,
+	enum wlblur_fence_type type
+);
+
+/**
+ * Stop the fence worker after signalling every pending fence
+ */
+void wlblur_fence_worker_destroy(struct wlblur_fence_worker *worker);
+
 /**
  * Shader program management
  */
@@ -58,11 +179,18 @@ struct wlblur_shader_program {
 	GLuint program;
 	GLuint vertex_shader;
 	GLuint fragment_shader;
+	GLuint compute_shader;   /* Compute programs only (GLES 3.1) */
+
+	/* Compiled and linked, but status and uniforms not queried yet */
+	bool pending;
+	uint64_t cache_key;      /* Stored to the program cache once complete */
 
 	/* Uniform locations */
 	GLint u_tex;
 	GLint u_halfpixel;
 	GLint u_radius;
+	GLint u_src_scale;       /* Source area, see wlblur_shader_set_source() */
+	GLint u_src_max;
 
 	/* Post-processing uniforms */
 	GLint u_brightness;
@@ -98,6 +226,110 @@ struct wlblur_shader_program* wlblur_shader_load_from_source(
 	const char *fragment_source
 );
 
+/**
+ * Load compute shader from source string (GLES 3.1)
+ *
+ * @param compute_source Compute shader source
+ * @return Shader program or NULL on failure
+ */
+struct wlblur_shader_program* wlblur_shader_load_compute_from_source(
+	const char *compute_source
+);
+
+/**
+ * Shader variant compiled on first request
+ *
+ * A variant is a shader file built with extra #define lines. Nothing is
+ * compiled until it is requested; with GL_KHR_parallel_shader_compile the
+ * driver compiles it on its own threads while callers keep rendering with
+ * the generic program.
+ */
+struct wlblur_shader_variant {
+	const char *name;     /* Shader file, e.g. "blur_finish.frag.glsl" */
+	const char *defines;  /* Lines inserted after #version, or NULL */
+	struct wlblur_shader_program *program;  /* NULL until requested */
+	bool failed;          /* Did not build: never retried */
+};
+
+/**
+ * Start compiling a variant (no-op once requested)
+ */
+void wlblur_shader_variant_request(struct wlblur_shader_variant *variant);
+
+/**
+ * Program of a variant, requesting it first if needed
+ *
+ * Without wait this never blocks on a parallel compile: while the driver
+ * is still compiling it returns NULL. Drivers without
+ * GL_KHR_parallel_shader_compile finish the compile here.
+ *
+ * @return Program, or NULL while compiling or if the variant failed
+ */
+struct wlblur_shader_program* wlblur_shader_variant_get(
+	struct wlblur_egl_context *egl_ctx,
+	struct wlblur_shader_variant *variant,
+	bool wait
+);
+
+/**
+ * Destroy a variant's program; it may be requested again afterwards
+ */
+void wlblur_shader_variant_reset(struct wlblur_shader_variant *variant);
+
+/**
+ * On-disk cache of linked program binaries
+ *
+ * Files live in $XDG_CACHE_HOME/wlblur (default ~/.cache/wlblur), one per
+ * program, named by a hash of the driver's vendor, renderer and version
+ * strings and the program's sources. WLBLUR_SHADER_CACHE=0 disables it.
+ */
+
+/**
+ * Cache key of a program built from sources (context current)
+ *
+ * @return Key, or 0 if the driver has no program binary formats
+ */
+uint64_t wlblur_program_cache_key(const char *const *sources, int num_sources);
+
+/**
+ * Program linked from the cached binary for key
+ *
+ * @return Program, or 0 on a miss or when the driver rejects the binary
+ */
+GLuint wlblur_program_cache_load(uint64_t key);
+
+/**
+ * Save a linked program's binary under key (no-op for key 0)
+ */
+void wlblur_program_cache_store(uint64_t key, GLuint program);
+
+/**
+ * Shader file compiled into the library
+ *
+ * The table is generated at build time from libwlblur/shaders/ by
+ * embed_shaders.py (shaders_embedded.c).
+ */
+struct wlblur_embedded_shader {
+	const char *name;    /* File name, e.g. "kawase_downsample.frag.glsl" */
+	const char *source;
+};
+
+extern const struct wlblur_embedded_shader wlblur_embedded_shaders[];
+extern const int wlblur_num_embedded_shaders;
+
+/**
+ * Source of a shader file by name
+ *
+ * Uses the copy in WLBLUR_SHADER_PATH when set and present there (for
+ * development), otherwise the embedded copy, so no filesystem access is
+ * needed. Lines of the form #include "common.glsl" are replaced by that
+ * file's source, looked up the same way.
+ *
+ * @param name Shader file name, e.g. "kawase_downsample.frag.glsl"
+ * @return Source string (caller frees) or NULL if not found
+ */
+char* wlblur_shader_read_source(const char *name);
+
 /**
  * Destroy shader program
  */
@@ -108,15 +340,36 @@ void wlblur_shader_destroy(struct wlblur_shader_program *shader);
  */
 bool wlblur_shader_use(struct wlblur_shader_program *shader);
 
+struct wlblur_fbo;
+
+/**
+ * Set the source area uniforms of the shader in use
+ *
+ * Shaders that sample size-class FBOs read the source through src_scale
+ * (area in use over storage size) and clamp at src_max (its last texel
+ * centre). NULL stands for a texture used whole. No-op for shaders
+ * without these uniforms.
+ */
+void wlblur_shader_set_source(
+	const struct wlblur_shader_program *shader,
+	const struct wlblur_fbo *source
+);
+
 /**
  * Framebuffer object for render-to-texture
  */
 struct wlblur_fbo {
 	GLuint fbo;
 	GLuint texture;
-	int width;
+	int width;       /* Area in use, at the texture's origin */
 	int height;
+	int alloc_width; /* Size of the texture, >= the area in use */
+	int alloc_height;
+	GLenum format;   /* Sized internal format of texture */
+	int levels;      /* Mip levels of texture: > 1 for a pyramid atlas */
+	int level;       /* Level rendered into (atlas level views) */
 	bool in_use;
+	uint64_t last_use;  /* Pool clock when last acquired */
 };
 
 /**
@@ -124,6 +377,60 @@ struct wlblur_fbo {
  */
 struct wlblur_fbo* wlblur_fbo_create(int width, int height);
 
+/**
+ * Create framebuffer with a texture of the given sized internal format
+ *
+ * Integer formats (e.g. GL_RGBA32UI) get GL_NEAREST filtering.
+ */
+struct wlblur_fbo* wlblur_fbo_create_format(
+	int width,
+	int height,
+	GLenum internal_format
+);
+
+/**
+ * Create framebuffer with a mip-mapped texture (pyramid atlas)
+ *
+ * Level i is (width, height) >> i. The framebuffer renders into level 0;
+ * use wlblur_fbo_atlas_level() to render into the others.
+ */
+struct wlblur_fbo* wlblur_fbo_create_levels(
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+);
+
+/**
+ * Size class of a dimension: a multiple of 64 or of a sixteenth of the
+ * size, whichever is larger, so a class wastes at most an eighth
+ */
+int wlblur_fbo_size_class(int size);
+
+/**
+ * Create framebuffer with a texture of the size class of width x height
+ *
+ * width x height at the origin is in use. Passes rendering into it set
+ * the viewport to that area; shaders sampling it must read through
+ * wlblur_shader_set_source(). Resize in place within the class by
+ * setting width and height.
+ */
+struct wlblur_fbo* wlblur_fbo_create_class(
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+);
+
+/**
+ * View of one atlas level as an FBO of that level's size
+ *
+ * The view shares the atlas's framebuffer and texture and is not owned
+ * by a pool; binding it attaches its level.
+ */
+struct wlblur_fbo wlblur_fbo_atlas_level(const struct wlblur_fbo *atlas,
+                                         int level);
+
 /**
  * Destroy framebuffer
  */
@@ -141,12 +448,24 @@ void wlblur_fbo_unbind(void);
 
 /**
  * Framebuffer pool for reuse (optimization)
+ *
+ * Keeps idle FBOs of any size within a byte budget, dropping the least
+ * recently used first, and drops FBOs left idle for too long. FBOs in
+ * use are never dropped, so acquiring never fails for lack of room: the
+ * pool goes over budget while a blur needs it and trims on release.
  */
-#define WLBLUR_FBO_POOL_SIZE 16
+#define WLBLUR_FBO_POOL_BUDGET ((size_t)128 << 20)  /* Default, in bytes */
+#define WLBLUR_FBO_POOL_MAX_IDLE 256  /* Acquires an idle FBO survives */
 
 struct wlblur_fbo_pool {
-	struct wlblur_fbo *fbos[WLBLUR_FBO_POOL_SIZE];
+	struct wlblur_fbo **fbos;
 	int count;
+	int capacity;
+	size_t bytes;       /* Texture memory of all pooled FBOs */
+	size_t budget;      /* Texture memory kept once FBOs are released */
+	size_t in_use;      /* Texture memory of FBOs handed out */
+	size_t peak;        /* Highest in_use; reset by setting it to in_use */
+	uint64_t clock;     /* Acquires so far */
 };
 
 /**
@@ -159,6 +478,11 @@ struct wlblur_fbo_pool* wlblur_fbo_pool_create(void);
  */
 void wlblur_fbo_pool_destroy(struct wlblur_fbo_pool *pool);
 
+/**
+ * Set the pool's byte budget, trimming idle FBOs to fit
+ */
+void wlblur_fbo_pool_set_budget(struct wlblur_fbo_pool *pool, size_t bytes);
+
 /**
  * Acquire FBO from pool (creates if needed)
  */
@@ -168,6 +492,48 @@ struct wlblur_fbo* wlblur_fbo_pool_acquire(
 	int height
 );
 
+/**
+ * Acquire FBO of a given sized internal format from pool
+ *
+ * Only FBOs of the same size and format are reused. NULL only when GL
+ * cannot allocate the FBO.
+ */
+struct wlblur_fbo* wlblur_fbo_pool_acquire_format(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format
+);
+
+/**
+ * Acquire a pyramid atlas of a given format and level count from pool
+ *
+ * Only atlases of the same size, format and level count are reused.
+ */
+struct wlblur_fbo* wlblur_fbo_pool_acquire_levels(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+);
+
+/**
+ * Acquire an FBO of the size class of width x height from pool
+ *
+ * Any FBO of the same class, format and level count is reused, so sizes
+ * changing by a few pixels (a window resize) allocate nothing. See
+ * wlblur_fbo_create_class() for how to render into and sample it; not
+ * for textures that are exported.
+ */
+struct wlblur_fbo* wlblur_fbo_pool_acquire_class(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+);
+
 /**
  * Release FBO back to pool
  */
@@ -176,9 +542,187 @@ void wlblur_fbo_pool_release(
 	struct wlblur_fbo *fbo
 );
 
+/**
+ * Release the pool FBO owning a texture (no-op for other textures)
+ */
+void wlblur_fbo_pool_release_texture(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture
+);
+
+/**
+ * Drop the pool FBO owning a texture from the pool and destroy it
+ *
+ * For textures exported as DMA-BUFs: the buffer keeps the storage alive,
+ * and the pool must not hand the texture out again while the client
+ * reads it. No-op for other textures.
+ */
+void wlblur_fbo_pool_detach_texture(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture
+);
+
+/**
+ * Transient render graph
+ *
+ * A blur declares its passes in order, each reading one resource and
+ * writing another, then executes them. Execution computes each resource's
+ * lifetime, from its first write to its last access, gives resources of the
+ * same size, format and level count whose lifetimes do not overlap the
+ * same pooled FBO, and returns each FBO to the pool after its last use.
+ * Peak memory is then what is live at once, not every intermediate.
+ */
+#define WLBLUR_RG_MAX_RESOURCES 24
+#define WLBLUR_RG_MAX_PASSES 32
+#define WLBLUR_RG_INPUT (-1)  /* Resource id of the graph's input texture */
+
+struct wlblur_rg_pass;
+
+/**
+ * Set a pass's uniforms and draw it
+ *
+ * The pass's shader is in use, its target bound with the viewport set
+ * and its source bound to texture unit 0, with its area uniforms set.
+ */
+typedef void (*wlblur_rg_draw_fn)(void *data, const struct wlblur_rg_pass *pass,
+                                  const struct wlblur_fbo *target);
+
+struct wlblur_rg_resource {
+	int width;
+	int height;
+	GLenum format;
+	int levels;       /* > 1 for a pyramid atlas; passes pick a level */
+	int first_use;    /* Passes of the first write and last access, */
+	int last_use;     /* set by execution */
+	int slot;         /* Physical FBO, shared by aliased resources */
+	struct wlblur_fbo *external;  /* Caller's framebuffer, or NULL */
+	int x;            /* Texel of the resource drawn at the external */
+	int y;            /* framebuffer's origin */
+};
+
+struct wlblur_rg_pass {
+	struct wlblur_shader_program *shader;
+	wlblur_rg_draw_fn draw;
+	int source;       /* Resource id or WLBLUR_RG_INPUT */
+	int source_level;
+	int target;
+	int target_level;
+	int arg;          /* Per-pass value for draw (e.g. a level index) */
+};
+
+struct wlblur_render_graph {
+	struct wlblur_fbo_pool *pool;
+	GLuint input;
+	void *data;       /* Passed to every draw */
+	struct wlblur_rg_resource resources[WLBLUR_RG_MAX_RESOURCES];
+	int num_resources;
+	struct wlblur_rg_pass passes[WLBLUR_RG_MAX_PASSES];
+	int num_passes;
+	bool overflow;    /* A declaration did not fit; execution fails */
+	bool size_classes;  /* Allocate all but the output by size class;
+	                     * every shader must sample the source area */
+};
+
+/**
+ * Start an empty graph reading input and drawing with data
+ */
+void wlblur_rg_init(
+	struct wlblur_render_graph *graph,
+	struct wlblur_fbo_pool *pool,
+	GLuint input,
+	void *data
+);
+
+/**
+ * Declare a transient resource
+ *
+ * @return Resource id, or WLBLUR_RG_INPUT if the graph is full
+ */
+int wlblur_rg_resource(
+	struct wlblur_render_graph *graph,
+	int width,
+	int height,
+	GLenum format,
+	int levels
+);
+
+/**
+ * Declare a resource backed by a caller's framebuffer
+ *
+ * Passes into it draw a width x height image with texel (x, y) at the
+ * framebuffer's origin; the framebuffer clips the rest. It is never
+ * pooled or aliased, and execution leaves it to the caller.
+ *
+ * @return Resource id, or WLBLUR_RG_INPUT if the graph is full
+ */
+int wlblur_rg_external(
+	struct wlblur_render_graph *graph,
+	struct wlblur_fbo *fbo,
+	int x,
+	int y,
+	int width,
+	int height
+);
+
+/**
+ * Declare the next pass, reading source and writing target
+ */
+void wlblur_rg_pass(
+	struct wlblur_render_graph *graph,
+	struct wlblur_shader_program *shader,
+	wlblur_rg_draw_fn draw,
+	int source,
+	int source_level,
+	int target,
+	int target_level,
+	int arg
+);
+
+/**
+ * Allocate resources with aliasing and issue the passes in order
+ *
+ * Leaves the default framebuffer bound.
+ *
+ * @param output Resource to keep; every other one goes back to the pool
+ * @return FBO holding output (release with wlblur_fbo_pool_release()
+ *         unless it is external), NULL on failure
+ */
+struct wlblur_fbo* wlblur_rg_execute(
+	struct wlblur_render_graph *graph,
+	int output
+);
+
 /**
  * Kawase blur renderer state
  */
+/**
+ * Storage of the pooled Kawase pyramid
+ */
+enum wlblur_kawase_layout {
+	WLBLUR_KAWASE_LAYOUT_LEVELS,  /* One pooled FBO per level (default) */
+	WLBLUR_KAWASE_LAYOUT_ATLAS,   /* All levels in one mip-mapped texture */
+};
+
+/**
+ * Post-processing a parameter set needs, from most to least work
+ *
+ * Each kind has blur_finish.frag.glsl and kawase_upsample_finish.frag.glsl
+ * variants with the unused terms compiled out.
+ */
+enum wlblur_finish {
+	WLBLUR_FINISH_FULL,   /* Color matrices and noise */
+	WLBLUR_FINISH_COLOR,  /* Color matrices only: noise is 0 */
+	WLBLUR_FINISH_NOISE,  /* Noise only: brightness, contrast, saturation 1 */
+	WLBLUR_FINISH_NONE,   /* Neither: the finish pass is a no-op */
+};
+
+#define WLBLUR_FINISH_COUNT 4
+
+/**
+ * Post-processing kind of params
+ */
+enum wlblur_finish wlblur_finish_pick(const struct wlblur_blur_params *params);
+
 struct wlblur_kawase_renderer {
 	struct wlblur_egl_context *egl_ctx;
 	struct wlblur_fbo_pool *fbo_pool;
@@ -186,7 +730,38 @@ struct wlblur_kawase_renderer {
 	/* Shaders */
 	struct wlblur_shader_program *downsample_shader;
 	struct wlblur_shader_program *upsample_shader;
-	struct wlblur_shader_program *finish_shader;
+	struct wlblur_shader_program *finish_shader;  /* Generic: any params */
+
+	/* Finish pass per enum wlblur_finish, built on first use or by
+	 * wlblur_kawase_prepare(); finish_shader renders until it is ready.
+	 * Unused for WLBLUR_FINISH_FULL, which is finish_shader itself. */
+	struct wlblur_shader_variant finish_variants[WLBLUR_FINISH_COUNT];
+
+	/* Last upsample pass fused with post-processing, per enum
+	 * wlblur_finish, built the same way; blurs use the separate finish
+	 * pass until it is ready. Unused for WLBLUR_FINISH_NONE, where the
+	 * plain upsample writes the output. */
+	struct wlblur_shader_variant upsample_finish[WLBLUR_FINISH_COUNT];
+
+	/* Apply post-processing in the last upsample pass instead of a separate
+	 * full-resolution finish pass, once the fused shader is ready.
+	 * Defaults to true. */
+	bool fuse_finish;
+
+	/* Pyramid of wlblur_kawase_blur() and wlblur_kawase_blur_regions().
+	 * The atlas is one texture and framebuffer instead of one per level;
+	 * retained chains and shared pyramids always use separate levels. */
+	enum wlblur_kawase_layout layout;
+
+	/* Storage of the pyramid levels; the output is always GL_RGBA8.
+	 * GL_RGBA8 by default, see wlblur_kawase_pick_format(). */
+	GLenum intermediate_format;
+
+	/* Float formats are color-renderable (GLES 3.2 or
+	 * EXT_color_buffer_float), or at least RGBA16F
+	 * (EXT_color_buffer_half_float) */
+	bool has_float_targets;
+	bool has_half_float_targets;
 
 	/* Geometry (fullscreen quad) */
 	GLuint vao;
@@ -206,21 +781,598 @@ struct wlblur_kawase_renderer* wlblur_kawase_create(
 void wlblur_kawase_destroy(struct wlblur_kawase_renderer *renderer);
 
 /**
- * Apply Dual Kawase blur to texture
- *
- * @param renderer Blur renderer
- * @param input_texture GL texture to blur
- * @param width Texture width
- * @param height Texture height
- * @param params Blur parameters
- * @return Blurred texture (managed by FBO pool, do not delete)
+ * Start compiling the shader variants params will use (context current)
  */
-GLuint wlblur_kawase_blur(
+void wlblur_kawase_prepare(
 	struct wlblur_kawase_renderer *renderer,
-	GLuint input_texture,
-	int width,
-	int height,
 	const struct wlblur_blur_params *params
 );
 
+/**
+ * Finish program of a post-processing kind (context current)
+ *
+ * The specialized variant once ready, the generic finish_shader until
+ * then. Never waits for a compile.
+ */
+struct wlblur_shader_program* wlblur_kawase_finish_shader(
+	struct wlblur_kawase_renderer *renderer,
+	enum wlblur_finish kind
+);
+
+/**
+ * Pick the pyramid format for an input's DRM format
+ *
+ * 8-bit input without alpha (XRGB8888, XBGR8888) gets GL_RGB565, which
+ * halves the traffic of the bandwidth-bound pyramid. 10-bit and
+ * half-float input gets GL_R11F_G11F_B10F without alpha or GL_RGBA16F
+ * with alpha, so it keeps more than 8 bits; when those formats cannot be
+ * rendered to, and for everything else, GL_RGBA8.
+ */
+GLenum wlblur_kawase_pick_format(
+	const struct wlblur_kawase_renderer *renderer,
+	uint32_t drm_format
+);
+
+/**
+ * Apply Dual Kawase blur to texture
+ *
+ * @param renderer Blur renderer
+ * @param input_texture GL texture to blur
+ * @param width Texture width
+ * @param height Texture height
+ * @param params Blur parameters
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_kawase_blur(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Apply Dual Kawase blur and write the result into a caller's framebuffer
+ *
+ * The last pass renders into target instead of a pooled texture, with
+ * texel (x, y) of the width x height result at its origin, so storing
+ * a part of the blur costs no copy.
+ *
+ * @return true on success
+ */
+bool wlblur_kawase_blur_into(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	struct wlblur_fbo *target,
+	int x,
+	int y
+);
+
+/**
+ * Apply Dual Kawase blur only where some rectangles need it
+ *
+ * Every pass is scissored to the rects expanded by the params'
+ * damage_expand, so the cost follows the covered area rather than the
+ * texture size. More than WLBLUR_MAX_DAMAGE_RECTS rects are merged into
+ * their bounding box.
+ *
+ * @param renderer Blur renderer
+ * @param input_texture GL texture to blur
+ * @param width Texture width
+ * @param height Texture height
+ * @param params Blur parameters
+ * @param regions Rects to blur, in texture pixels
+ * @param num_regions Number of rects
+ * @return Blurred texture, valid inside the regions only (managed by FBO
+ *         pool, do not delete)
+ */
+GLuint wlblur_kawase_blur_regions(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *regions,
+	int num_regions
+);
+
+/**
+ * Apply several Dual Kawase blurs of one texture, sharing their pyramid
+ *
+ * Downsample levels depend only on the radius, so parameter sets with
+ * the same radius share one pyramid as deep as the largest pass count,
+ * sets that also share the pass count share the upsample chain, and
+ * only the finish pass runs once per set. N sets with one radius cost
+ * one pyramid plus N upsample chains or finish passes.
+ *
+ * @param renderer Blur renderer
+ * @param input_texture GL texture to blur
+ * @param width Texture width
+ * @param height Texture height
+ * @param params Parameter sets
+ * @param count Number of sets, at most WLBLUR_MAX_PARAM_SETS
+ * @param outputs Blurred texture per set (managed by FBO pool, do not
+ *                delete)
+ * @return false on failure, with every output released
+ */
+bool wlblur_kawase_blur_shared(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	int count,
+	GLuint *outputs
+);
+
+/**
+ * Retained Kawase pyramid for damage-aware re-blur
+ *
+ * Unlike the pooled path, downsample and upsample levels live in separate
+ * FBOs so every level stays valid between frames and can be patched in
+ * place under a scissor.
+ */
+struct wlblur_kawase_chain {
+	int width;
+	int height;
+	int num_passes;
+	GLenum format;               /* Pyramid levels; output is GL_RGBA8 */
+
+	/* Parameters the retained contents were rendered with */
+	struct wlblur_blur_params params;
+	bool valid;
+
+	/* Levels are size-class FBOs, resized in place while the new size
+	 * stays in their class */
+	struct wlblur_fbo *down[8];  /* down[i]: (width, height) >> (i + 1) */
+	struct wlblur_fbo *up[8];    /* up[0]: full size (two-pass finish only),
+	                              * up[i]: size of down[i - 1] */
+	struct wlblur_fbo *output;   /* Post-processed result, exact size */
+};
+
+/**
+ * Create empty retained chain (FBOs allocated on first render)
+ */
+struct wlblur_kawase_chain* wlblur_kawase_chain_create(void);
+
+/**
+ * Destroy retained chain and its FBOs
+ */
+void wlblur_kawase_chain_destroy(struct wlblur_kawase_chain *chain);
+
+/**
+ * Size a retained chain for params and the renderer's current
+ * intermediate format
+ *
+ * Reallocates only when the size, pass count or format changed, which
+ * invalidates the retained contents. The full-size upsample target is
+ * added when params need a separate finish pass.
+ *
+ * @return false if an FBO could not be allocated (chain left empty)
+ */
+bool wlblur_kawase_chain_reserve(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_kawase_chain *chain,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Apply Dual Kawase blur, re-rendering only damaged regions
+ *
+ * Damage rects are in input pixels and are expanded by the params'
+ * damage_expand before being scaled to each pyramid level. Falls back to
+ * a full render when the chain is empty, the size, params or
+ * intermediate format changed, or num_damage is 0.
+ *
+ * @param renderer Blur renderer
+ * @param chain Retained chain updated in place
+ * @param input_texture GL texture to blur
+ * @param width Texture width
+ * @param height Texture height
+ * @param params Blur parameters
+ * @param damage Changed input rectangles
+ * @param num_damage Number of damage rectangles
+ * @return Blurred texture (owned by chain, do not delete)
+ */
+GLuint wlblur_kawase_blur_damage(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_kawase_chain *chain,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *damage,
+	int num_damage
+);
+
+/**
+ * Compute-shader Kawase backend (GLES 3.1)
+ *
+ * Runs each pyramid level as one dispatch of kawase_pyramid.comp.glsl,
+ * separated by storage barriers. Intermediate levels live in one packed
+ * RGBA8 storage buffer instead of per-level FBOs.
+ */
+#define WLBLUR_COMPUTE_MAX_STAGES 16
+
+struct wlblur_kawase_compute {
+	struct wlblur_kawase_renderer *renderer;  /* Output FBOs come from its pool */
+	struct wlblur_shader_program *shader;
+
+	GLuint pyramid_buffer;      /* Packed RGBA8 pyramid levels */
+	GLsizeiptr pyramid_size;
+
+	/* Stage table uniforms */
+	GLint u_stage;
+	GLint u_stage_src;
+	GLint u_stage_dst;
+	GLint u_stage_tiles;
+	GLint u_stage_radius;
+};
+
+/**
+ * Create compute backend
+ *
+ * @param renderer Fragment renderer whose FBO pool provides output textures
+ * @return Backend or NULL if the context lacks GLES 3.1 or the shader
+ *         fails to compile (callers fall back to the fragment path)
+ */
+struct wlblur_kawase_compute* wlblur_kawase_compute_create(
+	struct wlblur_kawase_renderer *renderer
+);
+
+/**
+ * Destroy compute backend
+ */
+void wlblur_kawase_compute_destroy(struct wlblur_kawase_compute *compute);
+
+/**
+ * Apply Dual Kawase blur with the compute backend
+ *
+ * Same inputs, output and ownership as wlblur_kawase_blur(). Post-processing
+ * is always fused into the last pass.
+ *
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_kawase_compute_blur(
+	struct wlblur_kawase_compute *compute,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Separable Gaussian renderer (WLBLUR_ALGO_GAUSSIAN)
+ *
+ * Horizontal and vertical passes of gaussian.frag.glsl with sigma from
+ * wlblur_params_compute(). Large sigma is blurred at a reduced resolution.
+ */
+#define WLBLUR_GAUSSIAN_MAX_TAPS 16   /* Center + merged pairs, see shader */
+
+struct wlblur_gaussian_renderer {
+	struct wlblur_kawase_renderer *kawase;  /* FBO pool, quad, finish shader */
+	struct wlblur_shader_program *shader;
+
+	/* Kernel uniforms */
+	GLint u_direction;
+	GLint u_num_taps;
+	GLint u_weights;
+	GLint u_offsets;
+	GLint u_apply_finish;
+};
+
+/**
+ * Create Gaussian renderer
+ *
+ * @param kawase Kawase renderer whose FBO pool, quad and finish shader
+ *               are shared
+ * @return Renderer or NULL on failure
+ */
+struct wlblur_gaussian_renderer* wlblur_gaussian_create(
+	struct wlblur_kawase_renderer *kawase
+);
+
+/**
+ * Destroy Gaussian renderer
+ */
+void wlblur_gaussian_destroy(struct wlblur_gaussian_renderer *renderer);
+
+/**
+ * Apply separable Gaussian blur to texture
+ *
+ * Same inputs, output and ownership as wlblur_kawase_blur().
+ *
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_gaussian_blur(
+	struct wlblur_gaussian_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Summed-area table box renderer (WLBLUR_ALGO_BOX)
+ *
+ * Each iteration builds an RGBA32UI summed-area table of its input with
+ * box_sat.frag.glsl and reads four corners per pixel in box_blur.frag.glsl.
+ * Large sigma is blurred on a block-averaged, reduced-size table. The cost
+ * depends on the image size and iteration count, never on the radius.
+ */
+struct wlblur_box_renderer {
+	struct wlblur_kawase_renderer *kawase;  /* FBO pool, quad */
+	struct wlblur_shader_program *sat_shader;
+	struct wlblur_shader_program *box_shader;
+
+	/* Ping-pong summed-area tables, sized to the last table level */
+	struct wlblur_fbo *sat[2];
+
+	/* Prefix-sum uniforms */
+	GLint u_sat_table;
+	GLint u_sat_from_input;
+	GLint u_sat_block;
+	GLint u_sat_stride;
+
+	/* Box uniforms */
+	GLint u_box_table;
+	GLint u_box_radius;
+	GLint u_box_apply_finish;
+};
+
+/**
+ * Create box renderer
+ *
+ * @param kawase Kawase renderer whose FBO pool and quad are shared
+ * @return Renderer or NULL on failure
+ */
+struct wlblur_box_renderer* wlblur_box_create(
+	struct wlblur_kawase_renderer *kawase
+);
+
+/**
+ * Destroy box renderer
+ */
+void wlblur_box_destroy(struct wlblur_box_renderer *renderer);
+
+/**
+ * Apply box blur to texture
+ *
+ * Same inputs, output and ownership as wlblur_kawase_blur(). Runs
+ * params->box_iterations boxes sized to the params' sigma.
+ *
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_box_blur(
+	struct wlblur_box_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Hexagonal bokeh renderer (WLBLUR_ALGO_BOKEH)
+ *
+ * Four skewed line blurs of bokeh.frag.glsl in two passes add up to a
+ * hexagonal aperture. Rendered at quarter resolution, or lower for large
+ * apertures so taps stay a texel apart, then upsampled by the finish pass.
+ */
+#define WLBLUR_BOKEH_MAX_TAPS 32   /* Per line blur */
+
+struct wlblur_bokeh_renderer {
+	struct wlblur_kawase_renderer *kawase;  /* FBO pool, quad, finish shader */
+	struct wlblur_shader_program *shader;
+
+	/* Framebuffer for the split pass, which writes two pooled textures */
+	GLuint split_fbo;
+
+	/* Pass uniforms */
+	GLint u_tex2;
+	GLint u_stage;
+	GLint u_dir0;
+	GLint u_dir1;
+	GLint u_num_taps;
+};
+
+/**
+ * Create bokeh renderer
+ *
+ * @param kawase Kawase renderer whose FBO pool and quad are shared
+ * @return Renderer or NULL on failure
+ */
+struct wlblur_bokeh_renderer* wlblur_bokeh_create(
+	struct wlblur_kawase_renderer *kawase
+);
+
+/**
+ * Destroy bokeh renderer
+ */
+void wlblur_bokeh_destroy(struct wlblur_bokeh_renderer *renderer);
+
+/**
+ * Apply hexagonal bokeh blur to texture
+ *
+ * Same inputs, output and ownership as wlblur_kawase_blur(). The hexagon
+ * has the params' sigma (circumradius sqrt(24/5) × sigma).
+ *
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_bokeh_blur(
+	struct wlblur_bokeh_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Recursive Gaussian renderer (WLBLUR_ALGO_IIR, GLES 3.1)
+ *
+ * Two dispatches of iir_gaussian.comp.glsl run a Young-van Vliet
+ * recursion along every row, then every column, at a cost independent of
+ * sigma. Large sigmas filter a block-averaged input so the recursion stays
+ * within 16 texels; the line buffer replaces per-level FBOs.
+ */
+struct wlblur_iir_renderer {
+	struct wlblur_kawase_renderer *kawase;  /* FBO pool, quad, finish shader */
+	struct wlblur_shader_program *shader;
+
+	GLuint line_buffer;         /* Packed half-float RGBA, one per texel */
+	GLsizeiptr line_buffer_size;
+
+	/* Pass uniforms */
+	GLint u_size;
+	GLint u_block;
+	GLint u_columns;
+	GLint u_gain;
+	GLint u_a;
+	GLint u_boundary;
+	GLint u_apply_finish;
+};
+
+/**
+ * Create recursive Gaussian renderer
+ *
+ * @param kawase Kawase renderer whose FBO pool and quad are shared
+ * @return Renderer or NULL if the context lacks GLES 3.1 or the shader
+ *         fails to compile
+ */
+struct wlblur_iir_renderer* wlblur_iir_create(
+	struct wlblur_kawase_renderer *kawase
+);
+
+/**
+ * Destroy recursive Gaussian renderer
+ */
+void wlblur_iir_destroy(struct wlblur_iir_renderer *renderer);
+
+/**
+ * Apply recursive Gaussian blur to texture
+ *
+ * Same inputs, output and ownership as wlblur_kawase_blur(), with the
+ * params' sigma.
+ *
+ * @return Blurred texture (managed by FBO pool, do not delete)
+ */
+GLuint wlblur_iir_blur(
+	struct wlblur_iir_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+);
+
+/**
+ * Source region of a blur
+ *
+ * Only crop is blurred: the source rectangle grown by the params'
+ * damage_expand, so every output texel sees the same input as in a
+ * full-frame blur, and aligned to the pyramid's coarsest level so the
+ * levels sample the same texel grid.
+ */
+struct wlblur_region {
+	struct wlblur_rect source;  /* Output area, input pixels */
+	struct wlblur_rect crop;    /* Blurred area, input pixels */
+};
+
+/**
+ * Compute the region to blur for a source rectangle
+ *
+ * @param source Output area in input pixels, NULL or empty for the whole
+ *               input; clipped to the input
+ * @param width Input width
+ * @param height Input height
+ * @param params Blur parameters
+ * @param region Filled with the clipped source and its crop
+ * @return false if the clipped source is empty
+ */
+bool wlblur_region_compute(
+	const struct wlblur_rect *source,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	struct wlblur_region *region
+);
+
+/**
+ * Whether a rectangle covers a whole width x height image
+ */
+bool wlblur_rect_is_full(const struct wlblur_rect *rect, int width, int height);
+
+/**
+ * Copy a rectangle of a texture into a pooled RGBA8 FBO of its size
+ *
+ * The texture must be color-renderable (it is attached to a read
+ * framebuffer for glBlitFramebuffer).
+ *
+ * @param pool Pool providing the destination FBO
+ * @param texture Source texture
+ * @param rect Area to copy, in texels of texture
+ * @return FBO holding the copy (release with wlblur_fbo_pool_release()),
+ *         or NULL on failure
+ */
+struct wlblur_fbo* wlblur_region_copy(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture,
+	const struct wlblur_rect *rect
+);
+
+/**
+ * Copy a rectangle of a texture into an FBO of the rectangle's size
+ *
+ * @return true on success, false if the texture is not readable
+ */
+bool wlblur_region_copy_to(
+	GLuint texture,
+	const struct wlblur_rect *rect,
+	struct wlblur_fbo *target
+);
+
+/**
+ * Blur context state (struct wlblur_context of the public API)
+ */
+struct wlblur_buffer;
+
+struct wlblur_context {
+	struct wlblur_egl_context *egl_ctx;
+	struct wlblur_kawase_renderer *kawase;
+	struct wlblur_kawase_compute *compute;  /* NULL: fragment path only */
+	struct wlblur_gaussian_renderer *gaussian;  /* NULL: not built or failed */
+	struct wlblur_box_renderer *box;            /* NULL: not built or failed */
+	struct wlblur_bokeh_renderer *bokeh;        /* NULL: not built or failed */
+	struct wlblur_iir_renderer *iir;    /* NULL: not built or no GLES 3.1 */
+	uint32_t tried;  /* Bit per enum wlblur_algorithm: creation attempted */
+	enum wlblur_precision precision;
+	bool software;  /* Software rasterizer: conversions cost more than bandwidth */
+	struct wlblur_buffer *buffers;  /* Imported inputs, newest first */
+	struct wlblur_import_cache *imports;  /* Other inputs seen recently */
+};
+
+/**
+ * Blur a texture once per parameter set
+ *
+ * Kawase sets share pyramids (wlblur_kawase_blur_shared()); the others
+ * blur one by one. Parameters must be validated and their algorithms
+ * available.
+ *
+ * @param blurred Filled with one pooled texture per set (release with
+ *                wlblur_fbo_pool_release_texture() on ctx->kawase's pool)
+ * @return false on failure, with every texture released and blurred zeroed
+ */
+bool wlblur_context_blur_sets(
+	struct wlblur_context *ctx,
+	GLuint texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	int num_params,
+	GLuint *blurred
+);
+
 #endif /* WLBLUR_INTERNAL_H */
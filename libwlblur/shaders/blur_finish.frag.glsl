@@ -15,6 +15,8 @@
  * - Changed texture2D() to texture() for GLSL 3.0 ES compliance
  * - Preserved mediump/highp precision as-is from original
  * - Added detailed algorithm documentation
+ * - WLBLUR_NO_COLOR / WLBLUR_NO_NOISE defines compile out the color
+ *   matrices / noise for identity parameters (see enum wlblur_finish)
  *
  * SPDX-License-Identifier: MIT
  */
@@ -26,6 +28,12 @@ precision highp float;
 // Blurred texture from previous passes
 uniform sampler2D tex;
 
+// Area of tex in use, at its origin: size-class FBOs are larger than the
+// image they hold. Coordinates scale by src_scale and clamp at src_max,
+// the last texel centre in use; both are (1, 1) for a texture used whole.
+uniform highp vec2 src_scale;
+uniform highp vec2 src_max;
+
 // Brightness adjustment: multiplier for RGB values
 // < 1.0: darker, > 1.0: brighter
 // Range: 0.0 - 2.0
@@ -58,6 +66,11 @@ in vec2 v_texcoord;
 // Output color
 out vec4 fragColor;
 
+// Sample tex over the area in use, clamping like CLAMP_TO_EDGE
+vec4 sampleSource(highp vec2 uv) {
+	return texture(tex, min(uv * src_scale, src_max));
+}
+
 /*
  * Brightness Matrix
  *
@@ -169,9 +182,13 @@ float noiseAmount(vec2 p) {
  * This applies saturation first, then contrast, then brightness.
  */
 void main() {
-	vec4 color = texture(tex, v_texcoord);
+	vec4 color = sampleSource(v_texcoord);
+#ifndef WLBLUR_NO_COLOR
 	// Do *not* transpose the combined matrix when multiplying
 	color = brightnessMatrix() * contrastMatrix() * saturationMatrix() * color;
+#endif
+#ifndef WLBLUR_NO_NOISE
 	color.xyz += noiseAmount(v_texcoord);
+#endif
 	fragColor = color;
 }
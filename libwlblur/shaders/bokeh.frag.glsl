@@ -0,0 +1,78 @@
+/*
+ * Hexagonal Bokeh Shader (skewed separable passes)
+ *
+ * wlblur original (MIT License)
+ *
+ * A hexagon of circumradius R splits into three rhombi meeting at its
+ * center, each spanned by two of the unit vectors a (90°), b (-30°) and
+ * c (210°). Averaging along a line of length R in one direction and then
+ * in another gives exactly one rhombus, so the hexagon takes four line
+ * blurs in two passes instead of a 2D disk kernel:
+ *
+ *   split:    V = line_a(src)          W = (V + line_b(src)) / 2
+ *   combine:  out = (line_b(V) + 2 × line_c(W)) / 3
+ *
+ * line_b(V) is rhombus {a, b}; line_c(W) holds rhombi {a, c} and {b, c}.
+ * W is halved so it fits the RGBA8 target. The split pass writes V and W
+ * to two attachments at once.
+ *
+ * With stage = downsample the shader copies its source at the half-size
+ * target's pixel centers, a 2x2 box reduction for large apertures.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 300 es
+
+precision highp float;
+
+#define STAGE_DOWNSAMPLE 0
+#define STAGE_SPLIT 1
+#define STAGE_COMBINE 2
+
+// Source (split: twice the target size; combine: V)
+uniform sampler2D tex;
+
+// Combine only: W
+uniform sampler2D tex2;
+
+uniform int stage;
+
+// Tap-to-tap steps in uv along the two lines of this pass
+uniform vec2 dir0;
+uniform vec2 dir1;
+
+// Taps per line, spread over [0, R]
+uniform int num_taps;
+
+in vec2 v_texcoord;
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec4 fragColor2;
+
+/*
+ * Average of num_taps samples on the half-line from uv along dir
+ */
+vec4 line(sampler2D t, vec2 uv, vec2 dir) {
+    vec4 sum = vec4(0.0);
+    for (int i = 0; i < num_taps; i++) {
+        sum += texture(t, uv + dir * (float(i) + 0.5));
+    }
+    return sum / float(num_taps);
+}
+
+void main() {
+    vec2 uv = v_texcoord;
+
+    if (stage == STAGE_DOWNSAMPLE) {
+        fragColor = texture(tex, uv);
+        fragColor2 = vec4(0.0);
+    } else if (stage == STAGE_SPLIT) {
+        vec4 v = line(tex, uv, dir0);
+        fragColor = v;
+        fragColor2 = (v + line(tex, uv, dir1)) * 0.5;
+    } else {
+        fragColor = (line(tex, uv, dir0) + 2.0 * line(tex2, uv, dir1)) / 3.0;
+        fragColor2 = vec4(0.0);
+    }
+}
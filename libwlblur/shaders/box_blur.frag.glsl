@@ -0,0 +1,109 @@
+/*
+ * Box Blur Shader (summed-area table lookup)
+ *
+ * wlblur original (MIT License)
+ *
+ * Averages a (2 * box_radius + 1)^2 box with four reads from the inclusive
+ * summed-area table built by box_sat.frag.glsl, so the cost is the same
+ * for any radius. Boxes are clipped at the image edges and divided by
+ * the clipped area.
+ *
+ * With apply_finish, the post-processing of blur_finish.frag.glsl is
+ * applied to the result (last iteration only).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 300 es
+
+precision highp float;
+precision highp int;
+
+// Inclusive summed-area table of the input, in 8-bit units
+uniform highp usampler2D sat;
+
+// Half-width of the box in pixels, per axis
+uniform ivec2 box_radius;
+
+// Post-processing (see blur_finish.frag.glsl), only with apply_finish
+uniform bool apply_finish;
+uniform float brightness;
+uniform float contrast;
+uniform float saturation;
+uniform float noise;
+
+in vec2 v_texcoord;
+
+out vec4 fragColor;
+
+/*
+ * Color matrices, identical to blur_finish.frag.glsl
+ */
+mat4 brightnessMatrix() {
+	float b = brightness - 1.0;
+	return mat4(1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				b, b, b, 1);
+}
+
+mat4 contrastMatrix() {
+	float t = (1.0 - contrast) / 2.0;
+	return mat4(contrast, 0, 0, 0,
+				0, contrast, 0, 0,
+				0, 0, contrast, 0,
+				t, t, t, 1);
+}
+
+mat4 saturationMatrix() {
+	vec3 luminance = vec3(0.3086, 0.6094, 0.0820) * (1.0 - saturation);
+	vec3 red = vec3(luminance.x);
+	red.x += saturation;
+	vec3 green = vec3(luminance.y);
+	green.y += saturation;
+	vec3 blue = vec3(luminance.z);
+	blue.z += saturation;
+	return mat4(red, 0,
+				green, 0,
+				blue, 0,
+				0, 0, 0, 1);
+}
+
+float noiseAmount(vec2 p) {
+	vec3 p3 = fract(vec3(p.xyx) * 1689.1984);
+	p3 += dot(p3, p3.yzx + 33.33);
+	float hash = fract((p3.x + p3.y) * p3.z);
+	return (mod(hash, 1.0) - 0.5) * noise;
+}
+
+// Table entry, with zero for the row/column before the image
+uvec4 entry(ivec2 p) {
+    if (p.x < 0 || p.y < 0) {
+        return uvec4(0u);
+    }
+    return texelFetch(sat, p, 0);
+}
+
+void main() {
+    ivec2 size = textureSize(sat, 0);
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    // Exclusive lower corner, inclusive upper corner
+    ivec2 lo = max(p - box_radius - 1, ivec2(-1));
+    ivec2 hi = min(p + box_radius, size - 1);
+
+    uvec4 sum = entry(hi) - entry(ivec2(lo.x, hi.y)) -
+                entry(ivec2(hi.x, lo.y)) + entry(lo);
+    ivec2 extent = hi - lo;
+    float area = float(extent.x) * float(extent.y);
+
+    vec4 color = vec4(sum) / (255.0 * area);
+
+    if (apply_finish) {
+        // Do *not* transpose the combined matrix when multiplying
+        color = brightnessMatrix() * contrastMatrix() * saturationMatrix() * color;
+        color.xyz += noiseAmount(v_texcoord);
+    }
+
+    fragColor = color;
+}
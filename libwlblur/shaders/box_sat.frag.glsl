@@ -0,0 +1,84 @@
+/*
+ * Summed-Area Table Shader (one prefix-sum pass)
+ *
+ * wlblur original (MIT License)
+ *
+ * Builds an inclusive summed-area table (SAT) one axis at a time with
+ * radix-8 recursive doubling: after the pass with stride s, every texel
+ * holds the sum of the 8 * s texels ending at it along the axis.
+ * ceil(log8(width)) horizontal and ceil(log8(height)) vertical passes give
+ * the full table, e.g. 4 + 4 passes at 1920x1080.
+ *
+ * The first pass (from_input) only converts the RGBA8 input to integers.
+ * When the table is smaller than the input, it averages each block x
+ * block input area with one bilinear fetch per 2x2 texels.
+ *
+ * Sums are stored as unsigned 8-bit units in RGBA32UI. Overflow past 2^32
+ * wraps, which is harmless: box sums are differences of four table
+ * entries, and unsigned modular arithmetic gives the exact result as
+ * long as the box itself sums to less than 2^32 (any box under 16M px).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 300 es
+
+precision highp float;
+precision highp int;
+
+#define RADIX 8
+
+// RGBA8 input, read only by the first pass
+uniform sampler2D tex;
+
+// Table from the previous pass
+uniform highp usampler2D sat;
+
+uniform bool from_input;
+
+// Input texels per table texel along each axis (power of two)
+uniform int block;
+
+// Distance between summed texels: (s, 0) or (0, s)
+uniform ivec2 stride;
+
+out uvec4 fragSum;
+
+vec4 load_block(ivec2 p) {
+    if (block == 1) {
+        return texelFetch(tex, p, 0);
+    }
+
+    // Bilinear fetches at the shared corner of each 2x2 input group
+    vec2 texel = 1.0 / vec2(textureSize(tex, 0));
+    vec2 origin = vec2(p * block);
+    int taps = block / 2;
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < taps; y++) {
+        for (int x = 0; x < taps; x++) {
+            vec2 corner = origin + vec2(float(2 * x + 1), float(2 * y + 1));
+            sum += texture(tex, corner * texel);
+        }
+    }
+    return sum / float(taps * taps);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    if (from_input) {
+        fragSum = uvec4(round(load_block(p) * 255.0));
+        return;
+    }
+
+    // Out-of-range taps read texel 0 and are masked, which keeps the loop
+    // free of data-dependent exits
+    uvec4 sum = uvec4(0u);
+    for (int i = 0; i < RADIX; i++) {
+        ivec2 q = p - stride * i;
+        uvec4 value = texelFetch(sat, max(q, ivec2(0)), 0);
+        sum += all(greaterThanEqual(q, ivec2(0))) ? value : uvec4(0u);
+    }
+
+    fragSum = sum;
+}
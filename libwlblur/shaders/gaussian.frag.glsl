@@ -0,0 +1,104 @@
+/*
+ * Separable Gaussian Shader (one axis, linear sampling)
+ *
+ * wlblur original (MIT License)
+ *
+ * One horizontal or vertical pass of a separable Gaussian. The host
+ * computes the discrete kernel from sigma and merges each pair of
+ * neighbouring taps into one bilinear fetch placed between them, weighted
+ * by their sum. That halves the fetches for the same kernel, e.g. a
+ * 19-tap kernel becomes 1 center + 5 symmetric pairs = 11 fetches.
+ *
+ * The same shader does 2x box downsampling (num_taps = 1, sampling at the
+ * half-size target's pixel centers) and, with apply_finish, the
+ * post-processing of blur_finish.frag.glsl in the last pass.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 300 es
+
+precision highp float;
+
+#define MAX_TAPS 16
+
+// Source texture (same size as the target for blur passes)
+uniform sampler2D tex;
+
+// One source texel along the blur axis, in uv: (1/w, 0) or (0, 1/h)
+uniform vec2 direction;
+
+// Tap 0 is the center; taps 1..num_taps-1 are sampled at +/- offset
+uniform int num_taps;
+uniform float weights[MAX_TAPS];
+uniform float offsets[MAX_TAPS];   // In texels, fractional for merged pairs
+
+// Post-processing (see blur_finish.frag.glsl), only with apply_finish
+uniform bool apply_finish;
+uniform float brightness;
+uniform float contrast;
+uniform float saturation;
+uniform float noise;
+
+in vec2 v_texcoord;
+
+out vec4 fragColor;
+
+/*
+ * Color matrices, identical to blur_finish.frag.glsl
+ */
+mat4 brightnessMatrix() {
+	float b = brightness - 1.0;
+	return mat4(1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				b, b, b, 1);
+}
+
+mat4 contrastMatrix() {
+	float t = (1.0 - contrast) / 2.0;
+	return mat4(contrast, 0, 0, 0,
+				0, contrast, 0, 0,
+				0, 0, contrast, 0,
+				t, t, t, 1);
+}
+
+mat4 saturationMatrix() {
+	vec3 luminance = vec3(0.3086, 0.6094, 0.0820) * (1.0 - saturation);
+	vec3 red = vec3(luminance.x);
+	red.x += saturation;
+	vec3 green = vec3(luminance.y);
+	green.y += saturation;
+	vec3 blue = vec3(luminance.z);
+	blue.z += saturation;
+	return mat4(red, 0,
+				green, 0,
+				blue, 0,
+				0, 0, 0, 1);
+}
+
+float noiseAmount(vec2 p) {
+	vec3 p3 = fract(vec3(p.xyx) * 1689.1984);
+	p3 += dot(p3, p3.yzx + 33.33);
+	float hash = fract((p3.x + p3.y) * p3.z);
+	return (mod(hash, 1.0) - 0.5) * noise;
+}
+
+void main() {
+    vec2 uv = v_texcoord;
+
+    vec4 color = texture(tex, uv) * weights[0];
+    for (int i = 1; i < num_taps; i++) {
+        vec2 offset = direction * offsets[i];
+        color += (texture(tex, uv + offset) + texture(tex, uv - offset)) *
+                 weights[i];
+    }
+
+    if (apply_finish) {
+        // Do *not* transpose the combined matrix when multiplying
+        color = brightnessMatrix() * contrastMatrix() * saturationMatrix() * color;
+        color.xyz += noiseAmount(uv);
+    }
+
+    fragColor = color;
+}
@@ -0,0 +1,193 @@
+/*
+ * Recursive (IIR) Gaussian Compute Shader
+ *
+ * wlblur original (MIT License)
+ *
+ * Young-van Vliet third-order recursive Gaussian ("Recursive implementation
+ * of the Gaussian filter", 1995). Each invocation filters one whole line:
+ * a causal pass left to right, then an anticausal pass right to left,
+ *
+ *   w[n] = gain × x[n] + a.x × w[n-1] + a.y × w[n-2] + a.z × w[n-3]
+ *   y[n] = gain × w[n] + a.x × y[n+1] + a.y × y[n+2] + a.z × y[n+3]
+ *
+ * so the cost per texel is the same for any sigma. The first dispatch
+ * filters rows of the input into the line buffer, the second filters its
+ * columns in place and writes the output image.
+ *
+ * The causal pass starts in the steady state of the edge texel (clamp to
+ * edge). The anticausal pass starts from the state the filter would reach
+ * over a clamped extension past the far edge. That state is linear in the
+ * causal pass's last three outputs; the host computes the matrix
+ * (boundary), as in Triggs and Sdika, "Boundary conditions for
+ * Young-van Vliet recursive filtering", 2006.
+ *
+ * The host keeps sigma at or below 16 texels, where the poles are far
+ * enough from 1 for single precision, by filtering a block-averaged input.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 310 es
+
+precision highp float;
+precision highp int;
+
+#define LINES_PER_GROUP 64
+
+layout(local_size_x = LINES_PER_GROUP) in;
+
+// RGBA8 input, read by the row pass
+uniform highp sampler2D tex;
+
+// Column pass result, at the size of the line buffer
+layout(rgba8, binding = 0) writeonly uniform highp image2D output_image;
+
+// Row-major RGBA as two packed half floats per texel
+layout(std430, binding = 0) buffer Lines {
+    uvec2 texels[];
+} lines;
+
+uniform ivec2 size;      // Line buffer size
+uniform int block;       // Input texels per buffer texel (power of two)
+uniform bool columns;    // false: row pass, true: column pass
+
+// Filter coefficients
+uniform float gain;
+uniform vec3 a;
+uniform mat3 boundary;
+
+// Post-processing (see blur_finish.frag.glsl), column pass only
+uniform bool apply_finish;
+uniform float brightness;
+uniform float contrast;
+uniform float saturation;
+uniform float noise;
+
+/*
+ * Post-processing, identical to blur_finish.frag.glsl
+ */
+mat4 brightnessMatrix() {
+	float b = brightness - 1.0;
+	return mat4(1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				b, b, b, 1);
+}
+
+mat4 contrastMatrix() {
+	float t = (1.0 - contrast) / 2.0;
+	return mat4(contrast, 0, 0, 0,
+				0, contrast, 0, 0,
+				0, 0, contrast, 0,
+				t, t, t, 1);
+}
+
+mat4 saturationMatrix() {
+	vec3 luminance = vec3(0.3086, 0.6094, 0.0820) * (1.0 - saturation);
+	vec3 red = vec3(luminance.x);
+	red.x += saturation;
+	vec3 green = vec3(luminance.y);
+	green.y += saturation;
+	vec3 blue = vec3(luminance.z);
+	blue.z += saturation;
+	return mat4(red, 0,
+				green, 0,
+				blue, 0,
+				0, 0, 0, 1);
+}
+
+float noiseAmount(vec2 p) {
+	vec3 p3 = fract(vec3(p.xyx) * 1689.1984);
+	p3 += dot(p3, p3.yzx + 33.33);
+	float hash = fract((p3.x + p3.y) * p3.z);
+	return (mod(hash, 1.0) - 0.5) * noise;
+}
+
+// Buffer texel i of the current line
+int line_index(int line, int i) {
+    return columns ? i * size.x + line : line * size.x + i;
+}
+
+vec4 load_line(int index) {
+    uvec2 p = lines.texels[index];
+    return vec4(unpackHalf2x16(p.x), unpackHalf2x16(p.y));
+}
+
+void store_line(int index, vec4 color) {
+    lines.texels[index] = uvec2(packHalf2x16(color.xy), packHalf2x16(color.zw));
+}
+
+/*
+ * Causal-pass input: the input texture block-averaged (row pass) or the
+ * row pass's result (column pass)
+ */
+vec4 load_input(int line, int i) {
+    if (columns) {
+        return load_line(line_index(line, i));
+    }
+
+    ivec2 c = ivec2(i, line);
+    if (block == 1) {
+        return texelFetch(tex, c, 0);
+    }
+
+    // One GL_LINEAR fetch between each 2x2 input texels of the block
+    vec2 texel = 1.0 / vec2(textureSize(tex, 0));
+    vec2 origin = vec2(c * block) + 1.0;
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < block; y += 2) {
+        for (int x = 0; x < block; x += 2) {
+            sum += texture(tex, (origin + vec2(x, y)) * texel);
+        }
+    }
+    return sum / float(block * block / 4);
+}
+
+void main() {
+    int line = int(gl_GlobalInvocationID.x);
+    int count = columns ? size.y : size.x;
+    if (line >= (columns ? size.x : size.y)) {
+        return;
+    }
+
+    // === CAUSAL PASS ===
+    vec4 edge = load_input(line, 0);
+    vec4 w1 = edge, w2 = edge, w3 = edge;
+    for (int i = 0; i < count; i++) {
+        edge = load_input(line, i);
+        vec4 w = gain * edge + a.x * w1 + a.y * w2 + a.z * w3;
+        store_line(line_index(line, i), w);
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    // === ANTICAUSAL PASS ===
+    // edge holds the last input texel, w1..w3 the last causal outputs
+    vec4 d1 = w1 - edge, d2 = w2 - edge, d3 = w3 - edge;
+    vec4 y1 = edge + boundary[0][0] * d1 + boundary[1][0] * d2 + boundary[2][0] * d3;
+    vec4 y2 = edge + boundary[0][1] * d1 + boundary[1][1] * d2 + boundary[2][1] * d3;
+    vec4 y3 = edge + boundary[0][2] * d1 + boundary[1][2] * d2 + boundary[2][2] * d3;
+
+    for (int i = count - 1; i >= 0; i--) {
+        int index = line_index(line, i);
+        vec4 y = gain * load_line(index) + a.x * y1 + a.y * y2 + a.z * y3;
+        y3 = y2;
+        y2 = y1;
+        y1 = y;
+
+        if (!columns) {
+            store_line(index, y);
+            continue;
+        }
+
+        ivec2 pos = ivec2(line, i);
+        if (apply_finish) {
+            vec2 uv = (vec2(pos) + 0.5) / vec2(size);
+            // Do *not* transpose the combined matrix when multiplying
+            y = brightnessMatrix() * contrastMatrix() * saturationMatrix() * y;
+            y.xyz += noiseAmount(uv);
+        }
+        imageStore(output_image, pos, y);
+    }
+}
@@ -14,6 +14,8 @@
  * - Added comprehensive uniform documentation
  * - Changed texture2D() to texture() for GLSL 3.0 ES compliance
  * - Added detailed sampling pattern documentation
+ * - Sample at v_texcoord directly (each level has its own half-size FBO,
+ *   SceneFX renders into a shrinking sub-viewport of a full-size buffer)
  *
  * SPDX-License-Identifier: MIT
  */
@@ -37,6 +39,12 @@ uniform float radius;
 // This compensates for texture coordinate rounding
 uniform vec2 halfpixel;
 
+// Area of tex in use, at its origin: size-class FBOs are larger than the
+// image they hold. Coordinates scale by src_scale and clamp at src_max,
+// the last texel centre in use; both are (1, 1) for a texture used whole.
+uniform highp vec2 src_scale;
+uniform highp vec2 src_max;
+
 // Texture coordinates from vertex shader
 // Range: [0.0, 1.0] for both x and y
 in mediump vec2 v_texcoord;
@@ -44,6 +52,11 @@ in mediump vec2 v_texcoord;
 // Output color
 out vec4 fragColor;
 
+// Sample tex over the area in use, clamping like CLAMP_TO_EDGE
+vec4 sampleSource(highp vec2 uv) {
+    return texture(tex, min(uv * src_scale, src_max));
+}
+
 /*
  * Kawase Downsample: 5-tap sampling pattern
  *
@@ -64,22 +77,22 @@ out vec4 fragColor;
  * - Each corner (A,B,C,D): 1.0
  * - Total weight: 8.0
  *
- * The 2x downsampling is achieved by the "uv * 2.0" operation, which
- * effectively reads every other pixel from the source texture.
+ * The 2x downsampling comes from the target FBO being half the size of
+ * the source: v_texcoord spans the whole source, so each output pixel
+ * covers a 2x2 block of source pixels.
  */
 void main() {
-    // Downsample: multiply UV by 2.0 to read every other pixel
-    vec2 uv = v_texcoord * 2.0;
+    vec2 uv = v_texcoord;
 
     // Center sample (weight 4.0)
-    vec4 sum = texture(tex, uv) * 4.0;
+    vec4 sum = sampleSource(uv) * 4.0;
 
     // Four diagonal corner samples (weight 1.0 each)
     // These are offset by (radius * halfpixel) in diagonal directions
-    sum += texture(tex, uv - halfpixel.xy * radius);           // Top-left
-    sum += texture(tex, uv + halfpixel.xy * radius);           // Bottom-right
-    sum += texture(tex, uv + vec2(halfpixel.x, -halfpixel.y) * radius);  // Top-right
-    sum += texture(tex, uv - vec2(halfpixel.x, -halfpixel.y) * radius);  // Bottom-left
+    sum += sampleSource(uv - halfpixel.xy * radius);           // Top-left
+    sum += sampleSource(uv + halfpixel.xy * radius);           // Bottom-right
+    sum += sampleSource(uv + vec2(halfpixel.x, -halfpixel.y) * radius);  // Top-right
+    sum += sampleSource(uv - vec2(halfpixel.x, -halfpixel.y) * radius);  // Bottom-left
 
     // Average with total weight of 8.0
     fragColor = sum / 8.0;
@@ -0,0 +1,232 @@
+/*
+ * Kawase Pyramid Compute Shader
+ *
+ * wlblur original (MIT License)
+ *
+ * Runs one stage of a Dual Kawase blur per dispatch: a downsample level,
+ * an upsample level, or the last upsample fused with post-processing.
+ * The host dispatches the stages in order (downsample 1..N, upsample
+ * N-1..0) with a storage barrier in between. Workgroups never wait on
+ * each other: GPUs guarantee no forward progress between workgroups of
+ * one dispatch, so spinning on another workgroup's result can hang when
+ * that workgroup is not resident. The stage table is uploaded once per
+ * blur; only the stage index changes between dispatches.
+ *
+ * Work is split into 16x16 output tiles, one per workgroup.
+ *
+ * Each workgroup copies the source texels its tile reads (tile footprint
+ * plus tap reach) into shared memory once, then evaluates the Kawase taps
+ * with manual bilinear filtering from there. The host shrinks a stage's
+ * tile below 16x16 when a large radius would overflow the cache, so taps
+ * never read global memory.
+ *
+ * Intermediate levels are stored as packed RGBA8 in one storage buffer.
+ * This is the same precision as the fragment path's RGBA8 FBOs, and one
+ * binding serves every stage without per-level images. Only
+ * the last stage writes to the output image, with brightness, contrast,
+ * saturation and noise applied as in kawase_upsample_finish.frag.glsl.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 310 es
+
+precision highp float;
+precision highp int;
+
+#define TILE 16
+#define CACHE_DIM 60
+#define MAX_STAGES 16
+
+// Stage kinds (stage_src.w)
+#define KIND_DOWN_INPUT 0   // Downsample from the input texture
+#define KIND_DOWN 1         // Downsample from a pyramid level
+#define KIND_UP 2           // Upsample into a pyramid level
+#define KIND_UP_FINISH 3    // Upsample + finish into the output image
+
+layout(local_size_x = TILE, local_size_y = TILE) in;
+
+// Input texture (stage 0 only)
+uniform highp sampler2D tex;
+
+// Post-processed result, full input size
+layout(rgba8, binding = 0) writeonly uniform highp image2D output_image;
+
+// Packed RGBA8 pyramid levels, row-major, one level after another
+layout(std430, binding = 0) buffer Pyramid {
+    uint texels[];
+} pyramid;
+
+// Stage run by this dispatch
+uniform int stage;
+
+uniform ivec4 stage_src[MAX_STAGES];    // offset, width, height, kind
+uniform ivec4 stage_dst[MAX_STAGES];    // offset, width, height, tile size
+uniform ivec2 stage_tiles[MAX_STAGES];  // tile count, tiles_x
+uniform float stage_radius[MAX_STAGES];
+
+// Post-processing (see blur_finish.frag.glsl)
+uniform float brightness;
+uniform float contrast;
+uniform float saturation;
+uniform float noise;
+
+shared uint s_cache[CACHE_DIM * CACHE_DIM];
+
+// Per-invocation copy of the current stage
+int g_stage;
+ivec2 g_src_size;
+ivec2 g_lo;
+
+uint load_source(ivec2 c) {
+    ivec4 src = stage_src[g_stage];
+    if (src.w == KIND_DOWN_INPUT) {
+        return packUnorm4x8(texelFetch(tex, c, 0));
+    }
+    return pyramid.texels[src.x + c.y * src.y + c.x];
+}
+
+vec4 fetch(ivec2 c) {
+    ivec2 l = clamp(c, ivec2(0), g_src_size - 1) - g_lo;
+    return unpackUnorm4x8(s_cache[l.y * CACHE_DIM + l.x]);
+}
+
+// GL_LINEAR + GL_CLAMP_TO_EDGE
+vec4 sample_source(vec2 uv) {
+    vec2 p = uv * vec2(g_src_size) - 0.5;
+    vec2 base = floor(p);
+    vec2 f = p - base;
+    ivec2 i = ivec2(base);
+
+    vec4 a = mix(fetch(i), fetch(i + ivec2(1, 0)), f.x);
+    vec4 b = mix(fetch(i + ivec2(0, 1)), fetch(i + ivec2(1, 1)), f.x);
+    return mix(a, b, f.y);
+}
+
+// kawase_downsample.frag.glsl
+vec4 downsample(vec2 uv, vec2 halfpixel, float radius) {
+    vec4 sum = sample_source(uv) * 4.0;
+    sum += sample_source(uv - halfpixel.xy * radius);
+    sum += sample_source(uv + halfpixel.xy * radius);
+    sum += sample_source(uv + vec2(halfpixel.x, -halfpixel.y) * radius);
+    sum += sample_source(uv - vec2(halfpixel.x, -halfpixel.y) * radius);
+    return sum / 8.0;
+}
+
+// kawase_upsample.frag.glsl
+vec4 upsample(vec2 uv, vec2 halfpixel, float radius) {
+    vec4 sum = sample_source(uv + vec2(-halfpixel.x * 2.0, 0.0) * radius);
+    sum += sample_source(uv + vec2(-halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sample_source(uv + vec2(0.0, halfpixel.y * 2.0) * radius);
+    sum += sample_source(uv + vec2(halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sample_source(uv + vec2(halfpixel.x * 2.0, 0.0) * radius);
+    sum += sample_source(uv + vec2(halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    sum += sample_source(uv + vec2(0.0, -halfpixel.y * 2.0) * radius);
+    sum += sample_source(uv + vec2(-halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    return sum / 12.0;
+}
+
+/*
+ * Post-processing, identical to blur_finish.frag.glsl
+ */
+mat4 brightnessMatrix() {
+	float b = brightness - 1.0;
+	return mat4(1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				b, b, b, 1);
+}
+
+mat4 contrastMatrix() {
+	float t = (1.0 - contrast) / 2.0;
+	return mat4(contrast, 0, 0, 0,
+				0, contrast, 0, 0,
+				0, 0, contrast, 0,
+				t, t, t, 1);
+}
+
+mat4 saturationMatrix() {
+	vec3 luminance = vec3(0.3086, 0.6094, 0.0820) * (1.0 - saturation);
+	vec3 red = vec3(luminance.x);
+	red.x += saturation;
+	vec3 green = vec3(luminance.y);
+	green.y += saturation;
+	vec3 blue = vec3(luminance.z);
+	blue.z += saturation;
+	return mat4(red, 0,
+				green, 0,
+				blue, 0,
+				0, 0, 0, 1);
+}
+
+float noiseAmount(vec2 p) {
+	vec3 p3 = fract(vec3(p.xyx) * 1689.1984);
+	p3 += dot(p3, p3.yzx + 33.33);
+	float hash = fract((p3.x + p3.y) * p3.z);
+	return (mod(hash, 1.0) - 0.5) * noise;
+}
+
+void main() {
+    // The grid may be wider than the stage: extra workgroups idle
+    g_stage = stage;
+    int tile_index = int(gl_WorkGroupID.y * gl_NumWorkGroups.x +
+                         gl_WorkGroupID.x);
+    bool has_tile = tile_index < stage_tiles[g_stage].x;
+
+    ivec4 src = stage_src[g_stage];
+    ivec4 dst = stage_dst[g_stage];
+    float radius = stage_radius[g_stage];
+    int kind = src.w;
+    g_src_size = src.yz;
+
+    ivec2 dst_size = dst.yz;
+    int tile = dst.w;
+    int tiles_x = stage_tiles[g_stage].y;
+    ivec2 origin = ivec2(tile_index % tiles_x, tile_index / tiles_x) * tile;
+    vec2 halfpixel = 0.5 / vec2(dst_size);
+
+    // Source footprint of the tile: taps reach (radius * halfpixel) for
+    // downsample and (2 * radius * halfpixel) for upsample, in uv
+    vec2 scale = vec2(g_src_size) / vec2(dst_size);
+    vec2 reach = radius * halfpixel * vec2(g_src_size) *
+                 (kind >= KIND_UP ? 2.0 : 1.0);
+    ivec2 last = min(origin + tile, dst_size) - 1;
+    g_lo = ivec2(floor((vec2(origin) + 0.5) * scale - 0.5 - reach)) - 1;
+    ivec2 hi = ivec2(floor((vec2(last) + 0.5) * scale - 0.5 + reach)) + 2;
+    g_lo = clamp(g_lo, ivec2(0), g_src_size - 1);
+    hi = clamp(hi, ivec2(0), g_src_size - 1);
+    ivec2 dims = hi - g_lo + 1;
+
+    // Fill the shared-memory cache
+    if (has_tile) {
+        int count = dims.x * dims.y;
+        for (int i = int(gl_LocalInvocationIndex); i < count; i += TILE * TILE) {
+            ivec2 l = ivec2(i % dims.x, i / dims.x);
+            s_cache[l.y * CACHE_DIM + l.x] = load_source(g_lo + l);
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+
+    ivec2 local = ivec2(gl_LocalInvocationID.xy);
+    ivec2 pos = origin + local;
+    if (has_tile && all(lessThan(local, ivec2(tile))) &&
+        all(lessThan(pos, dst_size))) {
+        vec2 uv = (vec2(pos) + 0.5) / vec2(dst_size);
+
+        if (kind <= KIND_DOWN) {
+            vec4 color = downsample(uv, halfpixel, radius);
+            pyramid.texels[dst.x + pos.y * dst.y + pos.x] = packUnorm4x8(color);
+        } else if (kind == KIND_UP) {
+            vec4 color = upsample(uv, halfpixel, radius);
+            pyramid.texels[dst.x + pos.y * dst.y + pos.x] = packUnorm4x8(color);
+        } else {
+            vec4 color = upsample(uv, halfpixel, radius);
+            // Do *not* transpose the combined matrix when multiplying
+            color = brightnessMatrix() * contrastMatrix() *
+                    saturationMatrix() * color;
+            color.xyz += noiseAmount(uv);
+            imageStore(output_image, pos, color);
+        }
+    }
+}
@@ -14,6 +14,8 @@
  * - Added comprehensive uniform documentation
  * - Changed texture2D() to texture() for GLSL 3.0 ES compliance
  * - Added detailed sampling pattern documentation
+ * - Sample at v_texcoord directly (each level has its own FBO, SceneFX
+ *   renders into a growing sub-viewport of a full-size buffer)
  *
  * SPDX-License-Identifier: MIT
  */
@@ -36,6 +38,12 @@ uniform float radius;
 // Used to sample between pixels for smoother results
 uniform vec2 halfpixel;
 
+// Area of tex in use, at its origin: size-class FBOs are larger than the
+// image they hold. Coordinates scale by src_scale and clamp at src_max,
+// the last texel centre in use; both are (1, 1) for a texture used whole.
+uniform highp vec2 src_scale;
+uniform highp vec2 src_max;
+
 // Texture coordinates from vertex shader
 // Range: [0.0, 1.0] for both x and y
 in mediump vec2 v_texcoord;
@@ -43,6 +51,11 @@ in mediump vec2 v_texcoord;
 // Output color
 out vec4 fragColor;
 
+// Sample tex over the area in use, clamping like CLAMP_TO_EDGE
+vec4 sampleSource(highp vec2 uv) {
+    return texture(tex, min(uv * src_scale, src_max));
+}
+
 /*
  * Kawase Upsample: 8-tap sampling pattern
  *
@@ -54,11 +67,12 @@ out vec4 fragColor;
  *
  *     . 1 2 1 .
  *     1 . . . 1
- *     2 . X . 2   X = sample point (v_texcoord / 2.0)
+ *     2 . X . 2   X = sample point (v_texcoord)
  *     1 . . . 1
  *     . 1 2 1 .
  *
- * The 2x upsampling is achieved by the "uv / 2.0" operation.
+ * The 2x upsampling comes from the target FBO being twice the size of
+ * the source texture.
  *
  * Sample positions and weights:
  * - 4 cardinal directions (left, right, up, down): weight 1.0 each
@@ -69,32 +83,31 @@ out vec4 fragColor;
  * symmetric blur kernel.
  */
 void main() {
-    // Upsample: divide UV by 2.0 to read from downsampled texture
-    vec2 uv = v_texcoord / 2.0;
+    vec2 uv = v_texcoord;
 
     // Left cardinal (weight 1.0)
-    vec4 sum = texture(tex, uv + vec2(-halfpixel.x * 2.0, 0.0) * radius);
+    vec4 sum = sampleSource(uv + vec2(-halfpixel.x * 2.0, 0.0) * radius);
 
     // Top-left diagonal (weight 2.0)
-    sum += texture(tex, uv + vec2(-halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(-halfpixel.x, halfpixel.y) * radius) * 2.0;
 
     // Top cardinal (weight 1.0)
-    sum += texture(tex, uv + vec2(0.0, halfpixel.y * 2.0) * radius);
+    sum += sampleSource(uv + vec2(0.0, halfpixel.y * 2.0) * radius);
 
     // Top-right diagonal (weight 2.0)
-    sum += texture(tex, uv + vec2(halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(halfpixel.x, halfpixel.y) * radius) * 2.0;
 
     // Right cardinal (weight 1.0)
-    sum += texture(tex, uv + vec2(halfpixel.x * 2.0, 0.0) * radius);
+    sum += sampleSource(uv + vec2(halfpixel.x * 2.0, 0.0) * radius);
 
     // Bottom-right diagonal (weight 2.0)
-    sum += texture(tex, uv + vec2(halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(halfpixel.x, -halfpixel.y) * radius) * 2.0;
 
     // Bottom cardinal (weight 1.0)
-    sum += texture(tex, uv + vec2(0.0, -halfpixel.y * 2.0) * radius);
+    sum += sampleSource(uv + vec2(0.0, -halfpixel.y * 2.0) * radius);
 
     // Bottom-left diagonal (weight 2.0)
-    sum += texture(tex, uv + vec2(-halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(-halfpixel.x, -halfpixel.y) * radius) * 2.0;
 
     // Average with total weight of 12.0
     fragColor = sum / 12.0;
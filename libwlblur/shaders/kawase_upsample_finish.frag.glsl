@@ -0,0 +1,121 @@
+/*
+ * Kawase Upsample + Finish Shader (fused final pass)
+ *
+ * Combines kawase_upsample.frag.glsl and blur_finish.frag.glsl so the
+ * last upsample writes the post-processed result directly. This saves a
+ * full-resolution write, a full-resolution read and one full-size FBO per
+ * blur compared to running the two passes separately.
+ *
+ * Upsample taps and color matrices are unchanged from the originals
+ * (SceneFX blur2.frag and blur_effects.frag, MIT License):
+ * Copyright (c) 2017, 2018 Drew DeVault
+ * Copyright (c) 2014 Jari Vetoniemi
+ * https://github.com/wlrfx/scenefx
+ *
+ * The only observable difference from the two-pass path is that the
+ * upsampled color is no longer rounded to 8 bits before post-processing.
+ *
+ * WLBLUR_NO_COLOR / WLBLUR_NO_NOISE compile out the color matrices /
+ * noise, as in blur_finish.frag.glsl.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#version 300 es
+
+// highp to match blur_finish.frag.glsl (upsample alone uses mediump)
+precision highp float;
+
+// Downsampled texture from the previous upsample level
+uniform sampler2D tex;
+
+// Sampling radius (see kawase_upsample.frag.glsl)
+uniform float radius;
+
+// Half-pixel offset: vec2(0.5/width, 0.5/height) of the target
+uniform vec2 halfpixel;
+
+// Area of tex in use, at its origin: size-class FBOs are larger than the
+// image they hold. Coordinates scale by src_scale and clamp at src_max,
+// the last texel centre in use; both are (1, 1) for a texture used whole.
+uniform highp vec2 src_scale;
+uniform highp vec2 src_max;
+
+// Post-processing (see blur_finish.frag.glsl)
+uniform float brightness;
+uniform float contrast;
+uniform float saturation;
+uniform float noise;
+
+in vec2 v_texcoord;
+
+out vec4 fragColor;
+
+// Sample tex over the area in use, clamping like CLAMP_TO_EDGE
+vec4 sampleSource(highp vec2 uv) {
+    return texture(tex, min(uv * src_scale, src_max));
+}
+
+/*
+ * Color matrices, identical to blur_finish.frag.glsl
+ */
+mat4 brightnessMatrix() {
+	float b = brightness - 1.0;
+	return mat4(1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				b, b, b, 1);
+}
+
+mat4 contrastMatrix() {
+	float t = (1.0 - contrast) / 2.0;
+	return mat4(contrast, 0, 0, 0,
+				0, contrast, 0, 0,
+				0, 0, contrast, 0,
+				t, t, t, 1);
+}
+
+mat4 saturationMatrix() {
+	vec3 luminance = vec3(0.3086, 0.6094, 0.0820) * (1.0 - saturation);
+	vec3 red = vec3(luminance.x);
+	red.x += saturation;
+	vec3 green = vec3(luminance.y);
+	green.y += saturation;
+	vec3 blue = vec3(luminance.z);
+	blue.z += saturation;
+	return mat4(red, 0,
+				green, 0,
+				blue, 0,
+				0, 0, 0, 1);
+}
+
+float noiseAmount(vec2 p) {
+	vec3 p3 = fract(vec3(p.xyx) * 1689.1984);
+	p3 += dot(p3, p3.yzx + 33.33);
+	float hash = fract((p3.x + p3.y) * p3.z);
+	return (mod(hash, 1.0) - 0.5) * noise;
+}
+
+void main() {
+    vec2 uv = v_texcoord;
+
+    // 8-tap upsample, weights 1 (cardinal) and 2 (diagonal), total 12
+    vec4 sum = sampleSource(uv + vec2(-halfpixel.x * 2.0, 0.0) * radius);
+    sum += sampleSource(uv + vec2(-halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(0.0, halfpixel.y * 2.0) * radius);
+    sum += sampleSource(uv + vec2(halfpixel.x, halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(halfpixel.x * 2.0, 0.0) * radius);
+    sum += sampleSource(uv + vec2(halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    sum += sampleSource(uv + vec2(0.0, -halfpixel.y * 2.0) * radius);
+    sum += sampleSource(uv + vec2(-halfpixel.x, -halfpixel.y) * radius) * 2.0;
+    vec4 color = sum / 12.0;
+
+#ifndef WLBLUR_NO_COLOR
+    // Do *not* transpose the combined matrix when multiplying
+    color = brightnessMatrix() * contrastMatrix() * saturationMatrix() * color;
+#endif
+#ifndef WLBLUR_NO_NOISE
+    color.xyz += noiseAmount(v_texcoord);
+#endif
+    fragColor = color;
+}
@@ -0,0 +1,291 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_bokeh.c - Hexagonal bokeh blur from skewed separable passes
+ */
+
+#include "../private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Must match bokeh.frag.glsl */
+#define STAGE_DOWNSAMPLE 0
+#define STAGE_SPLIT 1
+#define STAGE_COMBINE 2
+
+#define MAX_LEVELS 8
+
+/* Circumradius of the hexagon with the same per-axis variance as a
+ * Gaussian: a regular hexagon has variance 5R²/24 along each axis */
+#define HEXAGON_RADIUS_PER_SIGMA 2.19089023f   /* sqrt(24 / 5) */
+
+/* Unit vectors of the three rhombi: a = 90°, b = -30°, c = 210° */
+static const float dir_a[2] = { 0.0f, 1.0f };
+static const float dir_b[2] = { 0.86602540f, -0.5f };
+static const float dir_c[2] = { -0.86602540f, -0.5f };
+
+/**
+ * Render fullscreen quad
+ */
+static void render_fullscreen_quad(struct wlblur_bokeh_renderer *renderer) {
+	glBindVertexArray(renderer->kawase->vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
+
+/**
+ * Number of 2x reductions to render at (at least 1, quarter resolution)
+ *
+ * Lower levels keep taps at most one texel apart, so a line blur never
+ * skips texels and bright points do not turn into rows of dots.
+ */
+static int pick_level(float radius, int width, int height) {
+	int level = 1;
+	while (level < MAX_LEVELS &&
+	       radius / (float)(1 << level) > WLBLUR_BOKEH_MAX_TAPS &&
+	       (width >> (level + 1)) >= 2 && (height >> (level + 1)) >= 2) {
+		level++;
+	}
+	return level;
+}
+
+/**
+ * Set dir0/dir1 to one tap step along two unit vectors, in uv
+ */
+static void set_directions(struct wlblur_bokeh_renderer *renderer,
+                           const float *dir0, const float *dir1,
+                           float step_u, float step_v) {
+	glUniform2f(renderer->u_dir0, dir0[0] * step_u, dir0[1] * step_v);
+	glUniform2f(renderer->u_dir1, dir1[0] * step_u, dir1[1] * step_v);
+}
+
+struct wlblur_bokeh_renderer* wlblur_bokeh_create(
+	struct wlblur_kawase_renderer *kawase
+) {
+	if (!kawase) {
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(kawase->egl_ctx)) {
+		fprintf(stderr, "[wlblur] Failed to make context current\n");
+		return NULL;
+	}
+
+	struct wlblur_bokeh_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (!renderer) {
+		fprintf(stderr, "[wlblur] Failed to allocate bokeh renderer\n");
+		return NULL;
+	}
+
+	renderer->kawase = kawase;
+
+	char *source = wlblur_shader_read_source("bokeh.frag.glsl");
+	if (!source) {
+		goto error;
+	}
+
+	renderer->shader = wlblur_shader_load_from_source(NULL, source);
+	free(source);
+	if (!renderer->shader) {
+		fprintf(stderr, "[wlblur] Failed to load bokeh shader\n");
+		goto error;
+	}
+
+	GLuint program = renderer->shader->program;
+	renderer->u_tex2 = glGetUniformLocation(program, "tex2");
+	renderer->u_stage = glGetUniformLocation(program, "stage");
+	renderer->u_dir0 = glGetUniformLocation(program, "dir0");
+	renderer->u_dir1 = glGetUniformLocation(program, "dir1");
+	renderer->u_num_taps = glGetUniformLocation(program, "num_taps");
+
+	/* Attachments change per blur; the draw buffers stay */
+	static const GLenum draw_buffers[] = {
+		GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1,
+	};
+	glGenFramebuffers(1, &renderer->split_fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->split_fbo);
+	glDrawBuffers(2, draw_buffers);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	fprintf(stderr, "[wlblur] Bokeh renderer created successfully\n");
+	return renderer;
+
+error:
+	wlblur_bokeh_destroy(renderer);
+	return NULL;
+}
+
+void wlblur_bokeh_destroy(struct wlblur_bokeh_renderer *renderer) {
+	if (!renderer) {
+		return;
+	}
+
+	if (renderer->shader) {
+		wlblur_shader_destroy(renderer->shader);
+	}
+
+	if (renderer->split_fbo) {
+		glDeleteFramebuffers(1, &renderer->split_fbo);
+	}
+
+	free(renderer);
+}
+
+GLuint wlblur_bokeh_blur(
+	struct wlblur_bokeh_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	if (!renderer || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
+	}
+
+	if (!wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
+
+	struct wlblur_fbo_pool *pool = renderer->kawase->fbo_pool;
+	struct wlblur_blur_computed computed = wlblur_params_compute(params);
+	float radius = HEXAGON_RADIUS_PER_SIGMA * computed.sigma;
+
+	int level = pick_level(radius, width, height);
+	int level_width = width >> level;
+	int level_height = height >> level;
+
+	/* Taps at most one level texel apart, spread over the radius */
+	float level_radius = radius / (float)(1 << level);
+	int num_taps = (int)ceilf(level_radius);
+	if (num_taps < 1) num_taps = 1;
+	if (num_taps > WLBLUR_BOKEH_MAX_TAPS) num_taps = WLBLUR_BOKEH_MAX_TAPS;
+	float step = level_radius / num_taps;
+	float step_u = step / level_width;
+	float step_v = step / level_height;
+
+	/* Intermediates: reduced source, V, W, combined */
+	struct wlblur_fbo *fbos[4] = { NULL };
+	struct wlblur_fbo *final_fbo = NULL;
+	GLuint current_tex = input_texture;
+
+	struct wlblur_shader_program *shader = renderer->shader;
+	wlblur_shader_use(shader);
+	glUniform1i(shader->u_tex, 0);
+	glUniform1i(renderer->u_tex2, 1);
+	glUniform1i(renderer->u_num_taps, num_taps);
+	glActiveTexture(GL_TEXTURE0);
+
+	/* === DOWNSAMPLE PASSES === */
+	/* The split pass reads a source at twice its size */
+	glUniform1i(renderer->u_stage, STAGE_DOWNSAMPLE);
+	for (int l = 1; l < level; l++) {
+		struct wlblur_fbo *target = wlblur_fbo_pool_acquire(
+			pool, width >> l, height >> l);
+		if (!target) {
+			goto error;
+		}
+
+		wlblur_fbo_bind(target);
+		glViewport(0, 0, target->width, target->height);
+		glBindTexture(GL_TEXTURE_2D, current_tex);
+		render_fullscreen_quad(renderer);
+
+		/* The previous level is no longer read */
+		if (fbos[0]) {
+			wlblur_fbo_pool_release(pool, fbos[0]);
+		}
+		fbos[0] = target;
+		current_tex = target->texture;
+	}
+
+	/* === SPLIT PASS === */
+	fbos[1] = wlblur_fbo_pool_acquire(pool, level_width, level_height);
+	fbos[2] = wlblur_fbo_pool_acquire(pool, level_width, level_height);
+	if (!fbos[1] || !fbos[2]) {
+		goto error;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, renderer->split_fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, fbos[1]->texture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+	                       GL_TEXTURE_2D, fbos[2]->texture, 0);
+	glViewport(0, 0, level_width, level_height);
+
+	glUniform1i(renderer->u_stage, STAGE_SPLIT);
+	set_directions(renderer, dir_a, dir_b, step_u, step_v);
+	glBindTexture(GL_TEXTURE_2D, current_tex);
+	render_fullscreen_quad(renderer);
+
+	/* Pooled textures must not stay attached once released */
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, 0, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1,
+	                       GL_TEXTURE_2D, 0, 0);
+
+	/* === COMBINE PASS === */
+	fbos[3] = wlblur_fbo_pool_acquire(pool, level_width, level_height);
+	if (!fbos[3]) {
+		goto error;
+	}
+
+	wlblur_fbo_bind(fbos[3]);
+	glUniform1i(renderer->u_stage, STAGE_COMBINE);
+	set_directions(renderer, dir_b, dir_c, step_u, step_v);
+	glBindTexture(GL_TEXTURE_2D, fbos[1]->texture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, fbos[2]->texture);
+	render_fullscreen_quad(renderer);
+
+	/* Don't leave W bound while it may be rendered to */
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	/* === POST-PROCESSING === */
+	/* The finish pass samples with GL_LINEAR, so it also upsamples */
+	final_fbo = wlblur_fbo_pool_acquire(pool, width, height);
+	if (!final_fbo) {
+		goto error;
+	}
+
+	struct wlblur_shader_program *finish = renderer->kawase->finish_shader;
+	wlblur_shader_use(finish);
+	wlblur_fbo_bind(final_fbo);
+	glViewport(0, 0, width, height);
+	glUniform1i(finish->u_tex, 0);
+	wlblur_shader_set_source(finish, fbos[3]);
+	glUniform1f(finish->u_brightness, params->brightness);
+	glUniform1f(finish->u_contrast, params->contrast);
+	glUniform1f(finish->u_saturation, params->saturation);
+	glUniform1f(finish->u_noise, params->noise);
+	glBindTexture(GL_TEXTURE_2D, fbos[3]->texture);
+	render_fullscreen_quad(renderer);
+
+	wlblur_fbo_unbind();
+
+	for (int i = 0; i < 4; i++) {
+		wlblur_fbo_pool_release(pool, fbos[i]);
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during bokeh blur: 0x%x\n", error);
+		wlblur_fbo_pool_release(pool, final_fbo);
+		return 0;
+	}
+
+	return final_fbo->texture;
+
+error:
+	fprintf(stderr, "[wlblur] Failed to acquire FBO for bokeh blur\n");
+	wlblur_fbo_unbind();
+	for (int i = 0; i < 4; i++) {
+		wlblur_fbo_pool_release(pool, fbos[i]);
+	}
+	return 0;
+}
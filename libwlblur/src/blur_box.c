@@ -0,0 +1,372 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_box.c - Box blur via GPU summed-area tables
+ */
+
+#include "../private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Texels summed per prefix-sum pass, must match box_sat.frag.glsl */
+#define SAT_RADIX 8
+
+/* Smallest sigma, in table texels, worth blurring at a reduced size.
+ * Below about 4 texels the boxes get coarse enough to show steps. */
+#define MIN_LEVEL_SIGMA 4.0f
+#define MAX_LEVELS 6
+
+/**
+ * Render fullscreen quad
+ */
+static void render_fullscreen_quad(struct wlblur_box_renderer *renderer) {
+	glBindVertexArray(renderer->kawase->vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
+
+/**
+ * Number of 2x reductions for the summed-area table, and sigma left for
+ * the boxes in table texels
+ *
+ * The block average of the first pass (variance (4^k - 1) / 12) and the
+ * final bilinear upsample (4^k / 6) already blur, so they are subtracted.
+ */
+static int pick_levels(float sigma, int width, int height, float *level_sigma) {
+	int levels = 0;
+	while (levels < MAX_LEVELS &&
+	       sigma / (float)(2 << levels) >= MIN_LEVEL_SIGMA &&
+	       (width >> (levels + 1)) >= 2 && (height >> (levels + 1)) >= 2) {
+		levels++;
+	}
+
+	float scale = (float)(1 << levels);
+	float remaining = sigma * sigma;
+	if (levels > 0) {
+		remaining -= (scale * scale - 1.0f) / 12.0f + scale * scale / 6.0f;
+	}
+	*level_sigma = sqrtf(remaining > 0.25f ? remaining : 0.25f) / scale;
+	return levels;
+}
+
+/**
+ * Box half-widths whose n-fold convolution has the given sigma
+ *
+ * Odd widths w_l and w_l + 2 are mixed so the total variance
+ * sum((w_i² - 1) / 12) is as close to sigma² as integer widths allow
+ * (Kovesi, "Fast Almost-Gaussian Filtering", 2010).
+ */
+static void box_radii(float sigma, int n, int *radii) {
+	float ideal = sqrtf(12.0f * sigma * sigma / n + 1.0f);
+	int lower = (int)floorf(ideal);
+	if (lower % 2 == 0) {
+		lower--;
+	}
+
+	float m = (12.0f * sigma * sigma - n * lower * lower - 4.0f * n * lower -
+	           3.0f * n) / (-4.0f * lower - 4.0f);
+	int num_lower = (int)lroundf(m);
+
+	for (int i = 0; i < n; i++) {
+		int width = i < num_lower ? lower : lower + 2;
+		radii[i] = (width - 1) / 2;
+	}
+}
+
+/**
+ * Set the post-processing uniforms of the currently used shader
+ */
+static void set_finish_uniforms(
+	struct wlblur_shader_program *shader,
+	const struct wlblur_blur_params *params
+) {
+	glUniform1f(shader->u_brightness, params->brightness);
+	glUniform1f(shader->u_contrast, params->contrast);
+	glUniform1f(shader->u_saturation, params->saturation);
+	glUniform1f(shader->u_noise, params->noise);
+}
+
+/**
+ * Ensure both summed-area tables have the given size
+ */
+static bool ensure_tables(struct wlblur_box_renderer *renderer,
+                          int width, int height) {
+	if (renderer->sat[0] && renderer->sat[0]->width == width &&
+	    renderer->sat[0]->height == height) {
+		return true;
+	}
+
+	for (int i = 0; i < 2; i++) {
+		wlblur_fbo_destroy(renderer->sat[i]);
+		renderer->sat[i] = wlblur_fbo_create_format(width, height,
+		                                            GL_RGBA32UI);
+		if (!renderer->sat[i]) {
+			fprintf(stderr, "[wlblur] Failed to allocate summed-area "
+			        "table (%dx%d)\n", width, height);
+			wlblur_fbo_destroy(renderer->sat[0]);
+			renderer->sat[0] = NULL;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Build the summed-area table of source_texture
+ *
+ * @param block Source texels per table texel along each axis
+ * @return Table holding the result (one of renderer->sat)
+ */
+static struct wlblur_fbo* build_table(struct wlblur_box_renderer *renderer,
+                                      GLuint source_texture, int block) {
+	struct wlblur_shader_program *shader = renderer->sat_shader;
+	int width = renderer->sat[0]->width;
+	int height = renderer->sat[0]->height;
+
+	wlblur_shader_use(shader);
+	glUniform1i(shader->u_tex, 0);
+	glUniform1i(renderer->u_sat_table, 1);
+	glUniform1i(renderer->u_sat_block, block);
+	glViewport(0, 0, width, height);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source_texture);
+
+	/* Convert (and block-average) the source into sat[0] */
+	wlblur_fbo_bind(renderer->sat[0]);
+	glUniform1i(renderer->u_sat_from_input, GL_TRUE);
+	render_fullscreen_quad(renderer);
+	glUniform1i(renderer->u_sat_from_input, GL_FALSE);
+
+	int current = 1;
+	for (int axis = 0; axis < 2; axis++) {
+		int size = axis == 0 ? width : height;
+
+		for (int stride = 1; stride < size; stride *= SAT_RADIX) {
+			wlblur_fbo_bind(renderer->sat[current]);
+			glUniform2i(renderer->u_sat_stride,
+			            axis == 0 ? stride : 0, axis == 0 ? 0 : stride);
+
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D,
+			              renderer->sat[1 - current]->texture);
+
+			render_fullscreen_quad(renderer);
+			current = 1 - current;
+		}
+	}
+
+	/* Don't leave the table bound while it may be rendered to */
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	return renderer->sat[1 - current];
+}
+
+struct wlblur_box_renderer* wlblur_box_create(
+	struct wlblur_kawase_renderer *kawase
+) {
+	if (!kawase) {
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(kawase->egl_ctx)) {
+		fprintf(stderr, "[wlblur] Failed to make context current\n");
+		return NULL;
+	}
+
+	struct wlblur_box_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (!renderer) {
+		fprintf(stderr, "[wlblur] Failed to allocate box renderer\n");
+		return NULL;
+	}
+
+	renderer->kawase = kawase;
+
+	char *source = wlblur_shader_read_source("box_sat.frag.glsl");
+	if (!source) {
+		goto error;
+	}
+	renderer->sat_shader = wlblur_shader_load_from_source(NULL, source);
+	free(source);
+	if (!renderer->sat_shader) {
+		fprintf(stderr, "[wlblur] Failed to load summed-area table shader\n");
+		goto error;
+	}
+
+	source = wlblur_shader_read_source("box_blur.frag.glsl");
+	if (!source) {
+		goto error;
+	}
+	renderer->box_shader = wlblur_shader_load_from_source(NULL, source);
+	free(source);
+	if (!renderer->box_shader) {
+		fprintf(stderr, "[wlblur] Failed to load box blur shader\n");
+		goto error;
+	}
+
+	GLuint program = renderer->sat_shader->program;
+	renderer->u_sat_table = glGetUniformLocation(program, "sat");
+	renderer->u_sat_from_input = glGetUniformLocation(program, "from_input");
+	renderer->u_sat_block = glGetUniformLocation(program, "block");
+	renderer->u_sat_stride = glGetUniformLocation(program, "stride");
+
+	program = renderer->box_shader->program;
+	renderer->u_box_table = glGetUniformLocation(program, "sat");
+	renderer->u_box_radius = glGetUniformLocation(program, "box_radius");
+	renderer->u_box_apply_finish = glGetUniformLocation(program, "apply_finish");
+
+	fprintf(stderr, "[wlblur] Box renderer created successfully\n");
+	return renderer;
+
+error:
+	wlblur_box_destroy(renderer);
+	return NULL;
+}
+
+void wlblur_box_destroy(struct wlblur_box_renderer *renderer) {
+	if (!renderer) {
+		return;
+	}
+
+	if (renderer->sat_shader) {
+		wlblur_shader_destroy(renderer->sat_shader);
+	}
+	if (renderer->box_shader) {
+		wlblur_shader_destroy(renderer->box_shader);
+	}
+
+	wlblur_fbo_destroy(renderer->sat[0]);
+	wlblur_fbo_destroy(renderer->sat[1]);
+
+	free(renderer);
+}
+
+GLuint wlblur_box_blur(
+	struct wlblur_box_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	if (!renderer || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
+	}
+
+	if (!wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
+
+	struct wlblur_fbo_pool *pool = renderer->kawase->fbo_pool;
+	struct wlblur_blur_computed computed = wlblur_params_compute(params);
+
+	float sigma;
+	int levels = pick_levels(computed.sigma, width, height, &sigma);
+	int level_width = width >> levels;
+	int level_height = height >> levels;
+
+	if (!ensure_tables(renderer, level_width, level_height)) {
+		return 0;
+	}
+
+	int iterations = params->box_iterations > 1 ? params->box_iterations : 1;
+	int radii[4];
+	box_radii(sigma, iterations, radii);
+
+	/* Box results at table size, ping-ponged between iterations. At full
+	 * size the last box writes the final output itself. */
+	struct wlblur_fbo *boxes[2] = { NULL, NULL };
+	struct wlblur_fbo *final_fbo = NULL;
+	GLuint current_tex = input_texture;
+
+	for (int i = 0; i < iterations; i++) {
+		bool last = i == iterations - 1;
+		struct wlblur_fbo *target;
+
+		if (last && levels == 0) {
+			target = final_fbo = wlblur_fbo_pool_acquire(pool, width, height);
+		} else {
+			if (!boxes[i % 2]) {
+				boxes[i % 2] = wlblur_fbo_pool_acquire(pool, level_width,
+				                                       level_height);
+			}
+			target = boxes[i % 2];
+		}
+		if (!target) {
+			goto error;
+		}
+
+		struct wlblur_fbo *table = build_table(renderer, current_tex,
+		                                       i == 0 ? 1 << levels : 1);
+
+		/* Radii beyond the table only add clipped texels */
+		int radius_x = radii[i] < level_width ? radii[i] : level_width;
+		int radius_y = radii[i] < level_height ? radii[i] : level_height;
+		bool finish = target == final_fbo;
+
+		struct wlblur_shader_program *shader = renderer->box_shader;
+		wlblur_shader_use(shader);
+		wlblur_fbo_bind(target);
+		glViewport(0, 0, target->width, target->height);
+
+		glUniform1i(renderer->u_box_table, 0);
+		glUniform2i(renderer->u_box_radius, radius_x, radius_y);
+		glUniform1i(renderer->u_box_apply_finish, finish);
+		if (finish) {
+			set_finish_uniforms(shader, params);
+		}
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, table->texture);
+		render_fullscreen_quad(renderer);
+
+		current_tex = target->texture;
+	}
+
+	/* === POST-PROCESSING === */
+	if (!final_fbo) {
+		/* The finish pass samples with GL_LINEAR, so it also upsamples */
+		final_fbo = wlblur_fbo_pool_acquire(pool, width, height);
+		if (!final_fbo) {
+			goto error;
+		}
+
+		struct wlblur_shader_program *finish = renderer->kawase->finish_shader;
+		wlblur_shader_use(finish);
+		wlblur_fbo_bind(final_fbo);
+		glViewport(0, 0, width, height);
+		glUniform1i(finish->u_tex, 0);
+		wlblur_shader_set_source(finish, NULL);
+		set_finish_uniforms(finish, params);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, current_tex);
+		render_fullscreen_quad(renderer);
+	}
+
+	wlblur_fbo_unbind();
+	wlblur_fbo_pool_release(pool, boxes[0]);
+	wlblur_fbo_pool_release(pool, boxes[1]);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during box blur: 0x%x\n", error);
+		wlblur_fbo_pool_release(pool, final_fbo);
+		return 0;
+	}
+
+	return final_fbo->texture;
+
+error:
+	fprintf(stderr, "[wlblur] Failed to acquire FBO for box blur\n");
+	wlblur_fbo_unbind();
+	wlblur_fbo_pool_release(pool, boxes[0]);
+	wlblur_fbo_pool_release(pool, boxes[1]);
+	return 0;
+}
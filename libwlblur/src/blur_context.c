@@ -12,15 +12,68 @@
 #include "../private/internal.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 // Thread-local error state
 static __thread enum wlblur_error last_error = WLBLUR_ERROR_NONE;
 
-struct wlblur_context {
-	struct wlblur_egl_context *egl_ctx;
-	struct wlblur_kawase_renderer *kawase;
+struct wlblur_buffer {
+	struct wlblur_context *ctx;
+	struct wlblur_dmabuf_attribs attribs;  // FDs -1: the texture holds it
+	GLuint texture;
+	struct wlblur_fbo target;  // Render target once used as output (lazy)
+	struct wlblur_buffer *next;
 };
 
+struct wlblur_node {
+	struct wlblur_context *ctx;
+	struct wlblur_kawase_chain *chain;
+	int32_t crop_x, crop_y;  // Input position of the chain's crop
+};
+
+struct wlblur_output_slot {
+	struct wlblur_fbo *fbo;                 // NULL: not allocated yet
+	struct wlblur_dmabuf_attribs attribs;   // As first exported, FDs -1
+	bool in_use;                            // Handed out, not released
+};
+
+struct wlblur_output_ring {
+	struct wlblur_context *ctx;
+	int depth;
+	struct wlblur_output_slot slots[WLBLUR_MAX_RING_DEPTH];
+};
+
+/**
+ * Whether the context renders on the CPU (context must be current)
+ */
+static bool is_software_renderer(void) {
+	const char *renderer = (const char *)glGetString(GL_RENDERER);
+	if (!renderer) {
+		return true;
+	}
+
+	return strstr(renderer, "llvmpipe") ||
+	       strstr(renderer, "softpipe") ||
+	       strstr(renderer, "SwiftShader");
+}
+
+/**
+ * Whether to try the compute backend (context must be current)
+ *
+ * WLBLUR_COMPUTE=0/1 forces the choice. Otherwise software rasterizers
+ * stay on the fragment path, which is several times faster there
+ * (tests/bench_kawase.c).
+ */
+static bool use_compute_backend(void) {
+	const char *env = getenv("WLBLUR_COMPUTE");
+	if (env) {
+		return strcmp(env, "0") != 0;
+	}
+
+	return !is_software_renderer();
+}
+
 struct wlblur_context* wlblur_context_create(void) {
 	struct wlblur_context *ctx = calloc(1, sizeof(*ctx));
 	if (!ctx) {
@@ -45,15 +98,40 @@ struct wlblur_context* wlblur_context_create(void) {
 		return NULL;
 	}
 
+	ctx->imports = wlblur_import_cache_create();
+	if (!ctx->imports) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		wlblur_egl_destroy(ctx->egl_ctx);
+		free(ctx);
+		return NULL;
+	}
+
 	// Create Kawase renderer
 	ctx->kawase = wlblur_kawase_create(ctx->egl_ctx);
 	if (!ctx->kawase) {
 		last_error = WLBLUR_ERROR_SHADER_COMPILE;
+		wlblur_import_cache_destroy(ctx->imports);
 		wlblur_egl_destroy(ctx->egl_ctx);
 		free(ctx);
 		return NULL;
 	}
 
+	// Reduced-precision pyramids only pay off where bandwidth is the limit
+	ctx->software = is_software_renderer();
+
+	// WLBLUR_KAWASE_LAYOUT=atlas packs pooled pyramids into one texture
+	const char *layout = getenv("WLBLUR_KAWASE_LAYOUT");
+	if (layout && strcmp(layout, "atlas") == 0) {
+		ctx->kawase->layout = WLBLUR_KAWASE_LAYOUT_ATLAS;
+	}
+
+	// Use the compute backend where the driver supports it
+	if (use_compute_backend()) {
+		ctx->compute = wlblur_kawase_compute_create(ctx->kawase);
+	}
+
+	// Other algorithms compile their shaders on first use or prepare
+
 	last_error = WLBLUR_ERROR_NONE;
 	return ctx;
 }
@@ -61,15 +139,579 @@ struct wlblur_context* wlblur_context_create(void) {
 void wlblur_context_destroy(struct wlblur_context *ctx) {
 	if (!ctx) return;
 
+	wlblur_egl_make_current(ctx->egl_ctx);
+	while (ctx->buffers) {
+		struct wlblur_buffer *buffer = ctx->buffers;
+		ctx->buffers = buffer->next;
+		glDeleteFramebuffers(1, &buffer->target.fbo);
+		glDeleteTextures(1, &buffer->texture);
+		free(buffer);
+	}
+	wlblur_import_cache_destroy(ctx->imports);
+	wlblur_kawase_compute_destroy(ctx->compute);
+	wlblur_gaussian_destroy(ctx->gaussian);
+	wlblur_box_destroy(ctx->box);
+	wlblur_bokeh_destroy(ctx->bokeh);
+	wlblur_iir_destroy(ctx->iir);
 	wlblur_kawase_destroy(ctx->kawase);
 	wlblur_egl_destroy(ctx->egl_ctx);
 	free(ctx);
 }
 
-bool wlblur_apply_blur(
+void wlblur_context_set_precision(
+	struct wlblur_context *ctx,
+	enum wlblur_precision precision
+) {
+	if (!ctx) return;
+	ctx->precision = precision;
+}
+
+void wlblur_context_set_memory_budget(struct wlblur_context *ctx,
+                                      uint64_t bytes) {
+	if (!ctx) return;
+	wlblur_fbo_pool_set_budget(ctx->kawase->fbo_pool,
+	                           bytes > SIZE_MAX ? SIZE_MAX : (size_t)bytes);
+}
+
+/**
+ * Create an algorithm's renderer on first use
+ *
+ * Optional: requests for an algorithm fail without its renderer, and a
+ * failed creation is not retried.
+ */
+static void create_algorithm(
+	struct wlblur_context *ctx,
+	enum wlblur_algorithm algorithm
+) {
+	if ((unsigned)algorithm >= 32 || (ctx->tried & (1u << algorithm))) {
+		return;
+	}
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		return;
+	}
+	ctx->tried |= 1u << algorithm;
+
+	switch (algorithm) {
+#ifdef WLBLUR_HAVE_GAUSSIAN
+	case WLBLUR_ALGO_GAUSSIAN:
+		ctx->gaussian = wlblur_gaussian_create(ctx->kawase);
+		break;
+#endif
+#ifdef WLBLUR_HAVE_BOX
+	case WLBLUR_ALGO_BOX:
+		ctx->box = wlblur_box_create(ctx->kawase);
+		break;
+#endif
+#ifdef WLBLUR_HAVE_BOKEH
+	case WLBLUR_ALGO_BOKEH:
+		ctx->bokeh = wlblur_bokeh_create(ctx->kawase);
+		break;
+#endif
+#ifdef WLBLUR_HAVE_IIR
+	case WLBLUR_ALGO_IIR:
+		ctx->iir = wlblur_iir_create(ctx->kawase);
+		break;
+#endif
+	default:
+		break;
+	}
+}
+
+/**
+ * Whether params->algorithm has a renderer in this context, creating it
+ * on first use
+ */
+static bool algorithm_available(
+	struct wlblur_context *ctx,
+	enum wlblur_algorithm algorithm
+) {
+	create_algorithm(ctx, algorithm);
+
+	switch (algorithm) {
+	case WLBLUR_ALGO_KAWASE:
+		return true;
+	case WLBLUR_ALGO_GAUSSIAN:
+		return ctx->gaussian != NULL;
+	case WLBLUR_ALGO_BOX:
+		return ctx->box != NULL;
+	case WLBLUR_ALGO_BOKEH:
+		return ctx->bokeh != NULL;
+	case WLBLUR_ALGO_IIR:
+		return ctx->iir != NULL;
+	default:
+		return false;
+	}
+}
+
+bool wlblur_context_prepare(
+	struct wlblur_context *ctx,
+	const struct wlblur_blur_params *params
+) {
+	if (!ctx || !params || !wlblur_params_validate(params) ||
+	    !algorithm_available(ctx, params->algorithm)) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return false;
+	}
+
+	// Gaussian finishes reduced levels with Kawase's finish shaders; the
+	// other algorithms were built whole by algorithm_available()
+	if (params->algorithm == WLBLUR_ALGO_KAWASE ||
+	    params->algorithm == WLBLUR_ALGO_GAUSSIAN) {
+		wlblur_kawase_prepare(ctx->kawase, params);
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+/**
+ * Move damage into the node's crop, as the chain sees it
+ *
+ * Returns the number of rects written to local, 0 (full re-blur) when
+ * the crop moved since the node's last render.
+ */
+static int crop_damage(
+	struct wlblur_node *node,
+	const struct wlblur_rect *crop,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	struct wlblur_rect local[WLBLUR_MAX_DAMAGE_RECTS]
+) {
+	bool moved = node->crop_x != crop->x1 || node->crop_y != crop->y1;
+	node->crop_x = crop->x1;
+	node->crop_y = crop->y1;
+	if (moved || num_damage <= 0 || !damage) {
+		return 0;
+	}
+
+	// Same merge the chain would do for long lists
+	int count = num_damage;
+	if (count > WLBLUR_MAX_DAMAGE_RECTS) {
+		local[0] = damage[0];
+		for (int i = 1; i < num_damage; i++) {
+			if (damage[i].x1 < local[0].x1) local[0].x1 = damage[i].x1;
+			if (damage[i].y1 < local[0].y1) local[0].y1 = damage[i].y1;
+			if (damage[i].x2 > local[0].x2) local[0].x2 = damage[i].x2;
+			if (damage[i].y2 > local[0].y2) local[0].y2 = damage[i].y2;
+		}
+		count = 1;
+	} else {
+		for (int i = 0; i < count; i++) {
+			local[i] = damage[i];
+		}
+	}
+
+	for (int i = 0; i < count; i++) {
+		local[i].x1 -= crop->x1;
+		local[i].y1 -= crop->y1;
+		local[i].x2 -= crop->x1;
+		local[i].y2 -= crop->y1;
+	}
+	return count;
+}
+
+/**
+ * Imported buffer whose attributes these are, if any
+ */
+static struct wlblur_buffer* find_buffer(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs
+) {
+	for (struct wlblur_buffer *b = ctx->buffers; b; b = b->next) {
+		if (&b->attribs == attribs) {
+			return b;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Texture of an input: the imported buffer's, or the import cache's
+ *
+ * Either way the texture outlives the call; callers do not delete it.
+ */
+static GLuint input_texture(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs
+) {
+	struct wlblur_buffer *buffer = find_buffer(ctx, attribs);
+	if (buffer) {
+		return buffer->texture;
+	}
+	return wlblur_import_cache_get(ctx->imports, ctx->egl_ctx, attribs);
+}
+
+/**
+ * Kawase pyramid storage for input of a DRM format
+ */
+static GLenum pyramid_format(struct wlblur_context *ctx, uint32_t format) {
+	if (ctx->precision == WLBLUR_PRECISION_FULL || ctx->software) {
+		return GL_RGBA8;
+	}
+	return wlblur_kawase_pick_format(ctx->kawase, format);
+}
+
+/**
+ * Validate, make the context current and import the input
+ *
+ * Also picks the Kawase pyramid format for the input. Validation is
+ * skipped for params a node's chain was already rendered with. Returns
+ * the input texture (not to be deleted), or 0 with last_error set.
+ */
+static GLuint import_input(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	bool validated
+) {
+	// Validate parameters
+	if (!validated && (!wlblur_params_validate(params) ||
+	                   !algorithm_available(ctx, params->algorithm))) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return 0;
+	}
+
+	// Make EGL context current
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return 0;
+	}
+
+	// Import input DMA-BUF, unless already imported
+	GLuint input_tex = input_texture(ctx, input_attribs);
+	if (input_tex == 0) {
+		last_error = WLBLUR_ERROR_DMABUF_IMPORT;
+		return 0;
+	}
+
+	// Pyramid storage for this input (Kawase fragment path only)
+	ctx->kawase->intermediate_format =
+		pyramid_format(ctx, input_attribs->format);
+
+	return input_tex;
+}
+
+/**
+ * Copy the crop out of the input, unless it is the whole input
+ *
+ * The copy is far cheaper than the pyramid levels it saves. Returns the
+ * texture to blur; *crop_fbo is set when it is a pooled copy.
+ */
+static GLuint crop_input(
 	struct wlblur_context *ctx,
+	GLuint input_tex,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_rect *crop,
+	struct wlblur_fbo **crop_fbo
+) {
+	*crop_fbo = NULL;
+	if (wlblur_rect_is_full(crop, (int)input_attribs->width,
+	                        (int)input_attribs->height)) {
+		return input_tex;
+	}
+
+	*crop_fbo = wlblur_region_copy(ctx->kawase->fbo_pool, input_tex, crop);
+	return *crop_fbo ? (*crop_fbo)->texture : 0;
+}
+
+/**
+ * Blur a whole texture through the shared FBO pool
+ */
+static GLuint blur_texture(
+	struct wlblur_context *ctx,
+	GLuint texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	switch (params->algorithm) {
+	case WLBLUR_ALGO_GAUSSIAN:
+		return wlblur_gaussian_blur(ctx->gaussian, texture, width, height,
+		                            params);
+	case WLBLUR_ALGO_BOX:
+		return wlblur_box_blur(ctx->box, texture, width, height, params);
+	case WLBLUR_ALGO_BOKEH:
+		return wlblur_bokeh_blur(ctx->bokeh, texture, width, height, params);
+	case WLBLUR_ALGO_IIR:
+		return wlblur_iir_blur(ctx->iir, texture, width, height, params);
+	default:
+		break;
+	}
+
+	if (ctx->compute) {
+		return wlblur_kawase_compute_blur(ctx->compute, texture, width,
+		                                  height, params);
+	}
+	return wlblur_kawase_blur(ctx->kawase, texture, width, height, params);
+}
+
+/**
+ * Whether the source must be cut out of the blurred crop
+ */
+static bool region_needs_cut(const struct wlblur_region *region) {
+	return memcmp(&region->source, &region->crop,
+	              sizeof(region->source)) != 0;
+}
+
+/**
+ * Output area of a region, relative to its crop
+ */
+static struct wlblur_rect region_local_source(
+	const struct wlblur_region *region
+) {
+	return (struct wlblur_rect){
+		region->source.x1 - region->crop.x1,
+		region->source.y1 - region->crop.y1,
+		region->source.x2 - region->crop.x1,
+		region->source.y2 - region->crop.y1,
+	};
+}
+
+/**
+ * Export the source area of a blurred crop
+ *
+ * Cuts the source out into a pooled FBO when it is smaller than the crop;
+ * once exported, that FBO leaves the pool. An uncut export is the blurred
+ * texture itself, which the caller detaches or keeps.
+ */
+static bool export_source(
+	struct wlblur_context *ctx,
+	GLuint blurred_tex,
+	const struct wlblur_region *region,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	int out_width = region->source.x2 - region->source.x1;
+	int out_height = region->source.y2 - region->source.y1;
+
+	if (region_needs_cut(region)) {
+		struct wlblur_rect local = region_local_source(region);
+		struct wlblur_fbo *out_fbo = wlblur_region_copy(
+			ctx->kawase->fbo_pool, blurred_tex, &local);
+		if (!out_fbo) {
+			last_error = WLBLUR_ERROR_GL_ERROR;
+			return false;
+		}
+		blurred_tex = out_fbo->texture;
+	}
+
+	output_attribs->width = out_width;
+	output_attribs->height = out_height;
+
+	bool ok = wlblur_dmabuf_export(ctx->egl_ctx, blurred_tex,
+	                               out_width, out_height,
+	                               output_attribs);
+
+	if (region_needs_cut(region) && ok) {
+		wlblur_fbo_pool_detach_texture(ctx->kawase->fbo_pool, blurred_tex);
+	} else if (region_needs_cut(region)) {
+		wlblur_fbo_pool_release_texture(ctx->kawase->fbo_pool, blurred_tex);
+	}
+
+	if (!ok) {
+		last_error = WLBLUR_ERROR_DMABUF_EXPORT;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Hand a pooled blur result on: exported uncut, it leaves the pool;
+ * otherwise it is only released
+ */
+static void finish_pooled(
+	struct wlblur_context *ctx,
+	GLuint blurred_tex,
+	bool exported_uncut
+) {
+	if (exported_uncut) {
+		wlblur_fbo_pool_detach_texture(ctx->kawase->fbo_pool, blurred_tex);
+	} else {
+		wlblur_fbo_pool_release_texture(ctx->kawase->fbo_pool, blurred_tex);
+	}
+}
+
+/**
+ * Pick the ring slot for an output of the given size
+ *
+ * Prefers a free slot of that size, then an unallocated one, then any
+ * free slot. Returns -1 when every slot is in use.
+ */
+static int ring_pick_slot(
+	struct wlblur_output_ring *ring,
+	int width,
+	int height
+) {
+	int empty = -1;
+	int other = -1;
+	for (int i = 0; i < ring->depth; i++) {
+		struct wlblur_output_slot *slot = &ring->slots[i];
+		if (slot->in_use) {
+			continue;
+		}
+		if (!slot->fbo) {
+			if (empty < 0) empty = i;
+		} else if (slot->fbo->width == width && slot->fbo->height == height) {
+			return i;
+		} else if (other < 0) {
+			other = i;
+		}
+	}
+	return empty >= 0 ? empty : other;
+}
+
+/**
+ * Copy the source area of a blurred crop into a free ring slot
+ *
+ * A slot is exported once, when it is (re)allocated; output_attribs has
+ * FDs only then, and -1 FDs when the client already holds the buffer.
+ */
+static bool ring_store(
+	struct wlblur_context *ctx,
+	struct wlblur_output_ring *ring,
+	GLuint blurred_tex,
+	const struct wlblur_region *region,
+	int *index,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	int width = region->source.x2 - region->source.x1;
+	int height = region->source.y2 - region->source.y1;
+
+	int i = ring_pick_slot(ring, width, height);
+	if (i < 0) {
+		fprintf(stderr, "[wlblur] All %d output buffers in use\n",
+		        ring->depth);
+		last_error = WLBLUR_ERROR_BUSY;
+		return false;
+	}
+
+	struct wlblur_output_slot *slot = &ring->slots[i];
+	bool fresh = !slot->fbo || slot->fbo->width != width ||
+	             slot->fbo->height != height;
+	if (fresh) {
+		wlblur_fbo_destroy(slot->fbo);
+		slot->fbo = wlblur_fbo_create(width, height);
+		if (!slot->fbo) {
+			last_error = WLBLUR_ERROR_GL_ERROR;
+			return false;
+		}
+	}
+
+	struct wlblur_rect local = region_local_source(region);
+	bool copied = wlblur_region_copy_to(blurred_tex, &local, slot->fbo);
+	if (fresh && (!copied ||
+	              !wlblur_dmabuf_export(ctx->egl_ctx, slot->fbo->texture,
+	                                    width, height, output_attribs))) {
+		// Never handed out, so drop it rather than keep it unexported
+		wlblur_fbo_destroy(slot->fbo);
+		slot->fbo = NULL;
+		last_error = copied ? WLBLUR_ERROR_DMABUF_EXPORT :
+		                      WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+	if (!copied) {
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+
+	if (fresh) {
+		// Remember the layout without the FDs, which the caller owns
+		slot->attribs = *output_attribs;
+		for (int p = 0; p < 4; p++) {
+			slot->attribs.planes[p].fd = -1;
+		}
+	} else {
+		*output_attribs = slot->attribs;
+	}
+
+	slot->in_use = true;
+	*index = i;
+	return true;
+}
+
+/**
+ * Framebuffer of a caller's buffer, created the first time it is
+ * rendered into; NULL if the buffer cannot be rendered to
+ *
+ * Its layout and modifier are whatever the caller allocated.
+ */
+static struct wlblur_fbo* target_framebuffer(struct wlblur_buffer *target) {
+	struct wlblur_fbo *fbo = &target->target;
+	if (fbo->fbo == 0) {
+		glGenFramebuffers(1, &fbo->fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo->fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, target->texture, 0);
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+		                GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!complete) {
+			fprintf(stderr, "[wlblur] Output buffer is not renderable\n");
+			glDeleteFramebuffers(1, &fbo->fbo);
+			fbo->fbo = 0;
+			last_error = WLBLUR_ERROR_GL_ERROR;
+			return NULL;
+		}
+
+		fbo->texture = target->texture;
+		fbo->width = target->attribs.width;
+		fbo->height = target->attribs.height;
+		fbo->alloc_width = fbo->width;
+		fbo->alloc_height = fbo->height;
+	}
+
+	return fbo;
+}
+
+/**
+ * Copy the output area of a blurred crop into a caller's buffer
+ */
+static bool target_store(
+	struct wlblur_buffer *target,
+	GLuint blurred_tex,
+	const struct wlblur_region *region,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	struct wlblur_fbo *fbo = target_framebuffer(target);
+	if (!fbo) {
+		return false;
+	}
+
+	struct wlblur_rect local = region_local_source(region);
+	if (!wlblur_region_copy_to(blurred_tex, &local, fbo)) {
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+
+	*output_attribs = target->attribs;
+	return true;
+}
+
+/**
+ * Import, blur and export; renders into the node's retained chain when
+ * a node is given, otherwise through the shared FBO pool
+ *
+ * Only Kawase keeps a retained chain. Other algorithms always render the
+ * full crop through the pool and ignore the damage. With a ring or a
+ * target buffer, the result is copied there instead of exported; a
+ * pooled Kawase blur renders its last pass into the target buffer.
+ */
+static bool apply_blur(
+	struct wlblur_context *ctx,
+	struct wlblur_output_ring *ring,
+	int *index,
+	struct wlblur_buffer *target,
+	struct wlblur_node *node,
 	const struct wlblur_dmabuf_attribs *input_attribs,
 	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
 	struct wlblur_dmabuf_attribs *output_attribs
 ) {
 	if (!ctx || !input_attribs || !params || !output_attribs) {
@@ -77,59 +719,798 @@ bool wlblur_apply_blur(
 		return false;
 	}
 
-	// Validate parameters
-	if (!wlblur_params_validate(params)) {
+	// Area to output, and the part of the input it depends on
+	struct wlblur_region region;
+	if (!wlblur_region_compute(source, (int)input_attribs->width,
+	                           (int)input_attribs->height, params, &region)) {
 		last_error = WLBLUR_ERROR_INVALID_PARAMS;
 		return false;
 	}
+	int crop_width = region.crop.x2 - region.crop.x1;
+	int crop_height = region.crop.y2 - region.crop.y1;
 
-	// Make EGL context current
-	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
-		last_error = WLBLUR_ERROR_EGL_INIT;
+	// A target buffer must match the output and not be the input
+	int out_width = region.source.x2 - region.source.x1;
+	int out_height = region.source.y2 - region.source.y1;
+	if (target && (target->attribs.width != out_width ||
+	               target->attribs.height != out_height)) {
+		fprintf(stderr, "[wlblur] Output buffer is %dx%d, blur output "
+		        "is %dx%d\n", target->attribs.width,
+		        target->attribs.height, out_width, out_height);
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
 		return false;
 	}
+	if (target && &target->attribs == input_attribs) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	// Steady state: same params as the node's last render
+	bool retained = node && params->algorithm == WLBLUR_ALGO_KAWASE;
+	bool validated = retained && node->chain->valid &&
+	                 memcmp(&node->chain->params, params,
+	                        sizeof(*params)) == 0;
 
-	// Import input DMA-BUF
-	GLuint input_tex = wlblur_dmabuf_import(ctx->egl_ctx, input_attribs);
+	GLuint input_tex = import_input(ctx, input_attribs, params, validated);
 	if (input_tex == 0) {
-		last_error = WLBLUR_ERROR_DMABUF_IMPORT;
 		return false;
 	}
 
+	// Blur only the crop
+	struct wlblur_fbo *crop_fbo;
+	GLuint blur_tex = crop_input(ctx, input_tex, input_attribs,
+	                             &region.crop, &crop_fbo);
+
+	// A pooled Kawase blur writes the target buffer without a copy
+	if (target && !retained && !ctx->compute &&
+	    params->algorithm == WLBLUR_ALGO_KAWASE) {
+		struct wlblur_fbo *fbo = target_framebuffer(target);
+		struct wlblur_rect local = region_local_source(&region);
+		bool ok = blur_tex != 0 && fbo &&
+		          wlblur_kawase_blur_into(ctx->kawase, blur_tex,
+		                                  crop_width, crop_height, params,
+		                                  fbo, local.x1, local.y1);
+		wlblur_fbo_pool_release(ctx->kawase->fbo_pool, crop_fbo);
+		if (!ok) {
+			if (fbo) {
+				last_error = WLBLUR_ERROR_GL_ERROR;
+			}
+			return false;
+		}
+
+		*output_attribs = target->attribs;
+		last_error = WLBLUR_ERROR_NONE;
+		return true;
+	}
+
 	// Apply blur
-	GLuint blurred_tex = wlblur_kawase_blur(
-		ctx->kawase,
-		input_tex,
-		input_attribs->width,
-		input_attribs->height,
-		params
-	);
+	GLuint blurred_tex = 0;
+	if (blur_tex != 0 && retained) {
+		struct wlblur_rect local[WLBLUR_MAX_DAMAGE_RECTS];
+		int num_local = crop_damage(node, &region.crop, damage, num_damage,
+		                            local);
+		blurred_tex = wlblur_kawase_blur_damage(
+			ctx->kawase,
+			node->chain,
+			blur_tex,
+			crop_width,
+			crop_height,
+			params,
+			local,
+			num_local
+		);
+	} else if (blur_tex != 0) {
+		blurred_tex = blur_texture(ctx, blur_tex, crop_width, crop_height,
+		                           params);
+	}
+
+	wlblur_fbo_pool_release(ctx->kawase->fbo_pool, crop_fbo);
 
 	if (blurred_tex == 0) {
 		last_error = WLBLUR_ERROR_GL_ERROR;
-		glDeleteTextures(1, &input_tex);
 		return false;
 	}
 
-	// Export result
-	output_attribs->width = input_attribs->width;
-	output_attribs->height = input_attribs->height;
+	// Export result; the blurred crop is pooled unless it is a node's
+	// retained output
+	bool ok;
+	if (ring || target) {
+		ok = ring ? ring_store(ctx, ring, blurred_tex, &region, index,
+		                       output_attribs) :
+		            target_store(target, blurred_tex, &region,
+		                         output_attribs);
+		if (!retained) {
+			finish_pooled(ctx, blurred_tex, false);
+		}
+	} else {
+		ok = export_source(ctx, blurred_tex, &region, output_attribs);
+		if (!retained) {
+			finish_pooled(ctx, blurred_tex,
+			              ok && !region_needs_cut(&region));
+		}
+	}
 
-	if (!wlblur_dmabuf_export(ctx->egl_ctx, blurred_tex,
-	                          input_attribs->width, input_attribs->height,
-	                          output_attribs)) {
-		last_error = WLBLUR_ERROR_DMABUF_EXPORT;
-		glDeleteTextures(1, &input_tex);
+	if (!ok) {
 		return false;
 	}
 
-	// Cleanup imported texture (exported texture managed by caller)
-	glDeleteTextures(1, &input_tex);
-
 	last_error = WLBLUR_ERROR_NONE;
 	return true;
 }
 
+bool wlblur_apply_blur(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	return apply_blur(ctx, NULL, NULL, NULL, NULL, input_attribs, params,
+	                  NULL, NULL, 0, output_attribs);
+}
+
+bool wlblur_apply_blur_region(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	return apply_blur(ctx, NULL, NULL, NULL, NULL, input_attribs, params,
+	                  source, NULL, 0, output_attribs);
+}
+
+bool wlblur_apply_blur_regions(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *sources,
+	int num_sources,
+	struct wlblur_dmabuf_attribs *outputs
+) {
+	if (!ctx || !input_attribs || !params || !sources ||
+	    num_sources <= 0 || !outputs) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	struct wlblur_region *regions = calloc(num_sources, sizeof(*regions));
+	struct wlblur_rect *local = calloc(num_sources, sizeof(*local));
+	if (!regions || !local) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		free(regions);
+		free(local);
+		return false;
+	}
+
+	// One crop covering every region's crop
+	struct wlblur_rect crop = { 0 };
+	for (int i = 0; i < num_sources; i++) {
+		if (!wlblur_region_compute(&sources[i], (int)input_attribs->width,
+		                           (int)input_attribs->height, params,
+		                           &regions[i])) {
+			last_error = WLBLUR_ERROR_INVALID_PARAMS;
+			free(regions);
+			free(local);
+			return false;
+		}
+
+		const struct wlblur_rect *c = &regions[i].crop;
+		if (i == 0 || c->x1 < crop.x1) crop.x1 = c->x1;
+		if (i == 0 || c->y1 < crop.y1) crop.y1 = c->y1;
+		if (i == 0 || c->x2 > crop.x2) crop.x2 = c->x2;
+		if (i == 0 || c->y2 > crop.y2) crop.y2 = c->y2;
+	}
+
+	bool ok = false;
+	int exported = 0;
+	GLuint input_tex = import_input(ctx, input_attribs, params, false);
+	if (input_tex == 0) {
+		goto out;
+	}
+
+	struct wlblur_fbo *crop_fbo;
+	GLuint blur_tex = crop_input(ctx, input_tex, input_attribs, &crop,
+	                             &crop_fbo);
+
+	// Import and downsample once; Kawase renders only around the regions
+	int crop_width = crop.x2 - crop.x1;
+	int crop_height = crop.y2 - crop.y1;
+	bool shared_output = false;
+	for (int i = 0; i < num_sources; i++) {
+		regions[i].crop = crop;
+		local[i] = (struct wlblur_rect){
+			regions[i].source.x1 - crop.x1,
+			regions[i].source.y1 - crop.y1,
+			regions[i].source.x2 - crop.x1,
+			regions[i].source.y2 - crop.y1,
+		};
+		shared_output |= !region_needs_cut(&regions[i]);
+	}
+
+	GLuint blurred_tex = 0;
+	if (blur_tex != 0 && params->algorithm == WLBLUR_ALGO_KAWASE) {
+		blurred_tex = wlblur_kawase_blur_regions(ctx->kawase, blur_tex,
+		                                         crop_width, crop_height,
+		                                         params, local, num_sources);
+	} else if (blur_tex != 0) {
+		blurred_tex = blur_texture(ctx, blur_tex, crop_width, crop_height,
+		                           params);
+	}
+
+	wlblur_fbo_pool_release(ctx->kawase->fbo_pool, crop_fbo);
+
+	if (blurred_tex == 0) {
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		goto out;
+	}
+
+	// Then cut and export every region
+	for (; exported < num_sources; exported++) {
+		if (!export_source(ctx, blurred_tex, &regions[exported],
+		                   &outputs[exported])) {
+			break;
+		}
+	}
+	ok = exported == num_sources;
+
+	// A region covering the whole crop exports the blurred texture itself
+	finish_pooled(ctx, blurred_tex, shared_output && ok);
+
+out:
+	if (!ok) {
+		for (int i = 0; i < exported; i++) {
+			wlblur_dmabuf_close(&outputs[i]);
+		}
+	}
+	free(regions);
+	free(local);
+
+	if (ok) {
+		last_error = WLBLUR_ERROR_NONE;
+	}
+	return ok;
+}
+
+bool wlblur_context_blur_sets(
+	struct wlblur_context *ctx,
+	GLuint texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	int num_params,
+	GLuint *blurred
+) {
+	// Kawase sets share pyramids; the rest blur one by one
+	struct wlblur_blur_params kawase[WLBLUR_MAX_PARAM_SETS];
+	GLuint kawase_out[WLBLUR_MAX_PARAM_SETS];
+	int num_kawase = 0;
+	for (int i = 0; i < num_params; i++) {
+		blurred[i] = 0;
+		if (params[i].algorithm == WLBLUR_ALGO_KAWASE) {
+			kawase[num_kawase++] = params[i];
+		}
+	}
+
+	if (num_kawase > 0 &&
+	    !wlblur_kawase_blur_shared(ctx->kawase, texture, width, height,
+	                               kawase, num_kawase, kawase_out)) {
+		return false;
+	}
+
+	// Hand every Kawase output to its set first, so a failure below
+	// releases them all
+	for (int i = 0, k = 0; i < num_params; i++) {
+		if (params[i].algorithm == WLBLUR_ALGO_KAWASE) {
+			blurred[i] = kawase_out[k++];
+		}
+	}
+
+	bool ok = true;
+	for (int i = 0; ok && i < num_params; i++) {
+		if (params[i].algorithm != WLBLUR_ALGO_KAWASE) {
+			blurred[i] = blur_texture(ctx, texture, width, height,
+			                          &params[i]);
+			ok = blurred[i] != 0;
+		}
+	}
+
+	if (!ok) {
+		for (int i = 0; i < num_params; i++) {
+			wlblur_fbo_pool_release_texture(ctx->kawase->fbo_pool,
+			                                blurred[i]);
+			blurred[i] = 0;
+		}
+	}
+	return ok;
+}
+
+bool wlblur_apply_blur_multi(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	int num_params,
+	const struct wlblur_rect *source,
+	struct wlblur_dmabuf_attribs *outputs
+) {
+	if (!ctx || !input_attribs || !params || !outputs ||
+	    num_params <= 0 || num_params > WLBLUR_MAX_PARAM_SETS) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	// One crop covering the widest blur; every set exports the same source
+	struct wlblur_region regions[WLBLUR_MAX_PARAM_SETS];
+	struct wlblur_rect crop = { 0 };
+	for (int i = 0; i < num_params; i++) {
+		if (!wlblur_params_validate(&params[i]) ||
+		    !algorithm_available(ctx, params[i].algorithm) ||
+		    !wlblur_region_compute(source, (int)input_attribs->width,
+		                           (int)input_attribs->height, &params[i],
+		                           &regions[i])) {
+			last_error = WLBLUR_ERROR_INVALID_PARAMS;
+			return false;
+		}
+
+		const struct wlblur_rect *c = &regions[i].crop;
+		if (i == 0 || c->x1 < crop.x1) crop.x1 = c->x1;
+		if (i == 0 || c->y1 < crop.y1) crop.y1 = c->y1;
+		if (i == 0 || c->x2 > crop.x2) crop.x2 = c->x2;
+		if (i == 0 || c->y2 > crop.y2) crop.y2 = c->y2;
+	}
+	for (int i = 0; i < num_params; i++) {
+		regions[i].crop = crop;
+	}
+
+	GLuint input_tex = import_input(ctx, input_attribs, &params[0], false);
+	if (input_tex == 0) {
+		return false;
+	}
+
+	struct wlblur_fbo *crop_fbo;
+	GLuint blur_tex = crop_input(ctx, input_tex, input_attribs, &crop,
+	                             &crop_fbo);
+	int crop_width = crop.x2 - crop.x1;
+	int crop_height = crop.y2 - crop.y1;
+
+	GLuint blurred[WLBLUR_MAX_PARAM_SETS] = { 0 };
+	bool ok = blur_tex != 0 &&
+	          wlblur_context_blur_sets(ctx, blur_tex, crop_width, crop_height,
+	                                   params, num_params, blurred);
+
+	wlblur_fbo_pool_release(ctx->kawase->fbo_pool, crop_fbo);
+	if (!ok) {
+		last_error = WLBLUR_ERROR_GL_ERROR;
+	}
+
+	int exported = 0;
+	for (; ok && exported < num_params; exported++) {
+		ok = export_source(ctx, blurred[exported], &regions[exported],
+		                   &outputs[exported]);
+		if (!ok) {
+			break;
+		}
+	}
+
+	for (int i = 0; i < num_params; i++) {
+		finish_pooled(ctx, blurred[i], ok && !region_needs_cut(&regions[i]));
+		if (!ok && i < exported) {
+			wlblur_dmabuf_close(&outputs[i]);
+		}
+	}
+
+	if (!ok) {
+		return false;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+struct wlblur_node* wlblur_node_create(struct wlblur_context *ctx) {
+	if (!ctx) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return NULL;
+	}
+
+	struct wlblur_node *node = calloc(1, sizeof(*node));
+	if (!node) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	node->ctx = ctx;
+	node->chain = wlblur_kawase_chain_create();
+	if (!node->chain) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		free(node);
+		return NULL;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return node;
+}
+
+void wlblur_node_destroy(struct wlblur_node *node) {
+	if (!node) return;
+
+	// Chain owns GL objects, so the context must be current
+	wlblur_egl_make_current(node->ctx->egl_ctx);
+	wlblur_kawase_chain_destroy(node->chain);
+	free(node);
+}
+
+bool wlblur_node_reserve(
+	struct wlblur_node *node,
+	int width,
+	int height,
+	uint32_t format,
+	const struct wlblur_blur_params *params
+) {
+	if (!node || width <= 0 || height <= 0 || !params ||
+	    !wlblur_params_validate(params)) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	// Only Kawase keeps a retained chain
+	if (params->algorithm != WLBLUR_ALGO_KAWASE) {
+		last_error = WLBLUR_ERROR_NONE;
+		return true;
+	}
+
+	struct wlblur_context *ctx = node->ctx;
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return false;
+	}
+
+	// Whole-buffer renders crop exactly the input
+	ctx->kawase->intermediate_format = pyramid_format(ctx, format);
+	if (!wlblur_kawase_chain_reserve(ctx->kawase, node->chain, width,
+	                                 height, params)) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		return false;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+bool wlblur_apply_blur_damage(
+	struct wlblur_context *ctx,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	if (!node || node->ctx != ctx) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	return apply_blur(ctx, NULL, NULL, NULL, node, input_attribs, params,
+	                  source, damage, num_damage, output_attribs);
+}
+
+struct wlblur_output_ring* wlblur_output_ring_create(
+	struct wlblur_context *ctx,
+	int depth
+) {
+	if (!ctx || depth < 1 || depth > WLBLUR_MAX_RING_DEPTH) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return NULL;
+	}
+
+	struct wlblur_output_ring *ring = calloc(1, sizeof(*ring));
+	if (!ring) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	ring->ctx = ctx;
+	ring->depth = depth;
+
+	last_error = WLBLUR_ERROR_NONE;
+	return ring;
+}
+
+void wlblur_output_ring_destroy(struct wlblur_output_ring *ring) {
+	if (!ring) return;
+
+	// Slots own GL objects, so the context must be current
+	wlblur_egl_make_current(ring->ctx->egl_ctx);
+	for (int i = 0; i < ring->depth; i++) {
+		wlblur_fbo_destroy(ring->slots[i].fbo);
+	}
+	free(ring);
+}
+
+bool wlblur_apply_blur_ring(
+	struct wlblur_context *ctx,
+	struct wlblur_output_ring *ring,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	int *index,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	if (!ring || ring->ctx != ctx || !index ||
+	    (node && node->ctx != ctx)) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	return apply_blur(ctx, ring, index, NULL, node, input_attribs, params,
+	                  source, damage, num_damage, output_attribs);
+}
+
+bool wlblur_apply_blur_to(
+	struct wlblur_context *ctx,
+	struct wlblur_node *node,
+	const struct wlblur_dmabuf_attribs *input_attribs,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *source,
+	const struct wlblur_rect *damage,
+	int num_damage,
+	struct wlblur_buffer *output,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	if (!output || output->ctx != ctx || (node && node->ctx != ctx)) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	return apply_blur(ctx, NULL, NULL, output, node, input_attribs, params,
+	                  source, damage, num_damage, output_attribs);
+}
+
+void wlblur_output_ring_release(struct wlblur_output_ring *ring, int index) {
+	if (ring && index >= 0 && index < ring->depth) {
+		ring->slots[index].in_use = false;
+	}
+}
+
+struct wlblur_buffer* wlblur_buffer_import(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs
+) {
+	if (!ctx || !attribs) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return NULL;
+	}
+
+	struct wlblur_buffer *buffer = calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		last_error = WLBLUR_ERROR_OUT_OF_MEMORY;
+		return NULL;
+	}
+
+	buffer->texture = wlblur_dmabuf_import(ctx->egl_ctx, attribs);
+	if (buffer->texture == 0) {
+		last_error = WLBLUR_ERROR_DMABUF_IMPORT;
+		free(buffer);
+		return NULL;
+	}
+
+	// The texture keeps the dma-buf alive; the caller keeps its FDs
+	buffer->ctx = ctx;
+	buffer->attribs = *attribs;
+	for (int i = 0; i < 4; i++) {
+		buffer->attribs.planes[i].fd = -1;
+	}
+	buffer->next = ctx->buffers;
+	ctx->buffers = buffer;
+
+	last_error = WLBLUR_ERROR_NONE;
+	return buffer;
+}
+
+const struct wlblur_dmabuf_attribs* wlblur_buffer_get_attribs(
+	const struct wlblur_buffer *buffer
+) {
+	return buffer ? &buffer->attribs : NULL;
+}
+
+void wlblur_buffer_destroy(struct wlblur_buffer *buffer) {
+	if (!buffer) return;
+
+	struct wlblur_context *ctx = buffer->ctx;
+	for (struct wlblur_buffer **link = &ctx->buffers; *link;
+	     link = &(*link)->next) {
+		if (*link == buffer) {
+			*link = buffer->next;
+			break;
+		}
+	}
+
+	wlblur_egl_make_current(ctx->egl_ctx);
+	glDeleteFramebuffers(1, &buffer->target.fbo);
+	glDeleteTextures(1, &buffer->texture);
+	free(buffer);
+}
+
+void wlblur_get_import_stats(
+	struct wlblur_context *ctx,
+	struct wlblur_import_stats *stats
+) {
+	if (!ctx || !stats) return;
+	wlblur_import_cache_get_stats(ctx->imports, stats);
+}
+
+void wlblur_import_cache_flush(struct wlblur_context *ctx) {
+	if (!ctx) return;
+
+	struct wlblur_import_stats stats;
+	wlblur_import_cache_get_stats(ctx->imports, &stats);
+	if (stats.entries == 0) {
+		return;
+	}
+
+	wlblur_egl_make_current(ctx->egl_ctx);
+	wlblur_import_cache_clear(ctx->imports);
+}
+
+bool wlblur_read_pixels(
+	struct wlblur_context *ctx,
+	const struct wlblur_dmabuf_attribs *attribs,
+	void *pixels
+) {
+	if (!ctx || !attribs || !pixels) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return false;
+	}
+
+	// One-off reads (e.g. of outputs) stay out of the import cache
+	struct wlblur_buffer *buffer = find_buffer(ctx, attribs);
+	GLuint texture = buffer ? buffer->texture :
+		wlblur_dmabuf_import(ctx->egl_ctx, attribs);
+	if (texture == 0) {
+		last_error = WLBLUR_ERROR_DMABUF_IMPORT;
+		return false;
+	}
+
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+
+	bool ok = glCheckFramebufferStatus(GL_FRAMEBUFFER) ==
+	          GL_FRAMEBUFFER_COMPLETE;
+	if (ok) {
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, attribs->width, attribs->height,
+		             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		ok = glGetError() == GL_NO_ERROR;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	if (!buffer) {
+		glDeleteTextures(1, &texture);
+	}
+
+	if (!ok) {
+		fprintf(stderr, "[wlblur] Failed to read back buffer\n");
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+bool wlblur_upload_pixels(
+	struct wlblur_context *ctx,
+	const void *pixels,
+	int width,
+	int height,
+	struct wlblur_dmabuf_attribs *output_attribs
+) {
+	if (!ctx || !pixels || width <= 0 || height <= 0 || !output_attribs) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return false;
+	}
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height,
+	                GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	if (glGetError() != GL_NO_ERROR) {
+		glDeleteTextures(1, &texture);
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+
+	bool ok = wlblur_dmabuf_export(ctx->egl_ctx, texture, width, height,
+	                               output_attribs);
+
+	// The exported buffer keeps the storage alive
+	glDeleteTextures(1, &texture);
+
+	if (!ok) {
+		last_error = WLBLUR_ERROR_DMABUF_EXPORT;
+		return false;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+bool wlblur_wait_fence(
+	struct wlblur_context *ctx,
+	int fence_fd,
+	enum wlblur_fence_type type
+) {
+	if (!ctx || !wlblur_egl_make_current(ctx->egl_ctx)) {
+		if (fence_fd >= 0) {
+			close(fence_fd);
+		}
+		last_error = ctx ? WLBLUR_ERROR_EGL_INIT : WLBLUR_ERROR_INVALID_PARAMS;
+		return false;
+	}
+
+	if (!wlblur_fence_wait(ctx->egl_ctx, fence_fd, type)) {
+		last_error = WLBLUR_ERROR_GL_ERROR;
+		return false;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return true;
+}
+
+int wlblur_create_fence(
+	struct wlblur_context *ctx,
+	enum wlblur_fence_type *type
+) {
+	if (!ctx || !type) {
+		last_error = WLBLUR_ERROR_INVALID_PARAMS;
+		return -1;
+	}
+
+	if (!wlblur_egl_make_current(ctx->egl_ctx)) {
+		*type = WLBLUR_FENCE_NONE;
+		last_error = WLBLUR_ERROR_EGL_INIT;
+		return -1;
+	}
+
+	int fd = wlblur_fence_export(ctx->egl_ctx, true, type);
+	if (fd < 0) {
+		last_error = ctx->egl_ctx->has_fence_sync ?
+			WLBLUR_ERROR_GL_ERROR : WLBLUR_ERROR_MISSING_EXTENSION;
+		return -1;
+	}
+
+	last_error = WLBLUR_ERROR_NONE;
+	return fd;
+}
+
 enum wlblur_error wlblur_get_error(void) {
 	return last_error;
 }
@@ -154,6 +1535,8 @@ const char* wlblur_error_string(enum wlblur_error error) {
 		return "OpenGL error occurred";
 	case WLBLUR_ERROR_OUT_OF_MEMORY:
 		return "Out of memory";
+	case WLBLUR_ERROR_BUSY:
+		return "All output buffers in use";
 	default:
 		return "Unknown error";
 	}
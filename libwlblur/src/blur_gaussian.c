@@ -0,0 +1,332 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_gaussian.c - Separable Gaussian blur with linear-sampling weights
+ */
+
+#include "../private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Largest sigma blurred directly; above it the image is halved first.
+ * 3 sigma must fit 2 * (WLBLUR_GAUSSIAN_MAX_TAPS - 1) texels. */
+#define MAX_SIGMA 6.0f
+#define MAX_RADIUS (2 * (WLBLUR_GAUSSIAN_MAX_TAPS - 1))
+#define MAX_LEVELS 8
+
+/**
+ * Merged 1D kernel: taps[0] is the center, the others are used at +/-
+ */
+struct gaussian_kernel {
+	int num_taps;
+	GLfloat weights[WLBLUR_GAUSSIAN_MAX_TAPS];
+	GLfloat offsets[WLBLUR_GAUSSIAN_MAX_TAPS];
+};
+
+/**
+ * Build the discrete kernel for sigma (in texels) and merge neighbouring
+ * taps into single bilinear fetches
+ *
+ * Taps i and i + 1 with weights w1, w2 are replaced by one fetch at
+ * (i * w1 + (i + 1) * w2) / (w1 + w2) with weight w1 + w2, which GL_LINEAR
+ * turns back into exactly the two weighted texels.
+ */
+static void build_kernel(float sigma, struct gaussian_kernel *kernel) {
+	int radius = (int)ceilf(3.0f * sigma);
+	if (radius < 1) radius = 1;
+	if (radius > MAX_RADIUS) radius = MAX_RADIUS;
+
+	float w[MAX_RADIUS + 2] = { 0 };
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++) {
+		w[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? w[i] : 2.0f * w[i];
+	}
+
+	kernel->weights[0] = w[0] / total;
+	kernel->offsets[0] = 0.0f;
+	kernel->num_taps = 1;
+
+	for (int i = 1; i <= radius; i += 2) {
+		float pair = w[i] + w[i + 1];  /* w[radius + 1] is 0 */
+		int tap = kernel->num_taps++;
+		kernel->weights[tap] = pair / total;
+		kernel->offsets[tap] = (i * w[i] + (i + 1) * w[i + 1]) / pair;
+	}
+}
+
+/**
+ * Number of 2x reductions before blurring, and sigma at that level
+ *
+ * The box downsamples (variance 1/4 texel² at each level) and the final
+ * bilinear upsample (variance 1/6 of a level texel²) already blur, so
+ * they are subtracted from the kernel to keep the total at sigma.
+ */
+static int pick_levels(float sigma, int width, int height, float *level_sigma) {
+	float variance = sigma * sigma;
+	int levels = 0;
+
+	for (;;) {
+		float scale = (float)(1 << levels);
+		float added = 0.0f;
+		for (int j = 0; j < levels; j++) {
+			added += 0.25f * (float)(1 << (2 * j));
+		}
+		if (levels > 0) {
+			added += scale * scale / 6.0f;
+		}
+
+		float remaining = variance - added;
+		*level_sigma = sqrtf(remaining > 0.25f ? remaining : 0.25f) / scale;
+
+		if (*level_sigma <= MAX_SIGMA || levels == MAX_LEVELS ||
+		    (width >> (levels + 1)) < 2 || (height >> (levels + 1)) < 2) {
+			return levels;
+		}
+		levels++;
+	}
+}
+
+/**
+ * Render fullscreen quad
+ */
+static void render_fullscreen_quad(struct wlblur_gaussian_renderer *renderer) {
+	glBindVertexArray(renderer->kawase->vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
+
+/**
+ * Gaussian blur state shared by its render graph passes
+ */
+struct gaussian_blur {
+	struct wlblur_gaussian_renderer *renderer;
+	const struct wlblur_blur_params *params;
+	struct gaussian_kernel kernel;
+};
+
+/**
+ * Gaussian passes, in pass->arg
+ */
+enum gaussian_pass {
+	GAUSSIAN_DOWNSAMPLE,
+	GAUSSIAN_HORIZONTAL,
+	GAUSSIAN_VERTICAL,
+	GAUSSIAN_VERTICAL_FINISH,  /* Full resolution: post-process too */
+};
+
+/**
+ * Set the post-processing uniforms of the currently used shader
+ */
+static void set_finish_uniforms(
+	struct wlblur_shader_program *shader,
+	const struct wlblur_blur_params *params
+) {
+	glUniform1f(shader->u_brightness, params->brightness);
+	glUniform1f(shader->u_contrast, params->contrast);
+	glUniform1f(shader->u_saturation, params->saturation);
+	glUniform1f(shader->u_noise, params->noise);
+}
+
+struct wlblur_gaussian_renderer* wlblur_gaussian_create(
+	struct wlblur_kawase_renderer *kawase
+) {
+	if (!kawase) {
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(kawase->egl_ctx)) {
+		fprintf(stderr, "[wlblur] Failed to make context current\n");
+		return NULL;
+	}
+
+	struct wlblur_gaussian_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (!renderer) {
+		fprintf(stderr, "[wlblur] Failed to allocate Gaussian renderer\n");
+		return NULL;
+	}
+
+	renderer->kawase = kawase;
+
+	char *source = wlblur_shader_read_source("gaussian.frag.glsl");
+	if (!source) {
+		goto error;
+	}
+
+	renderer->shader = wlblur_shader_load_from_source(NULL, source);
+	free(source);
+	if (!renderer->shader) {
+		fprintf(stderr, "[wlblur] Failed to load Gaussian shader\n");
+		goto error;
+	}
+
+	GLuint program = renderer->shader->program;
+	renderer->u_direction = glGetUniformLocation(program, "direction");
+	renderer->u_num_taps = glGetUniformLocation(program, "num_taps");
+	renderer->u_weights = glGetUniformLocation(program, "weights");
+	renderer->u_offsets = glGetUniformLocation(program, "offsets");
+	renderer->u_apply_finish = glGetUniformLocation(program, "apply_finish");
+
+	fprintf(stderr, "[wlblur] Gaussian renderer created successfully\n");
+	return renderer;
+
+error:
+	wlblur_gaussian_destroy(renderer);
+	return NULL;
+}
+
+void wlblur_gaussian_destroy(struct wlblur_gaussian_renderer *renderer) {
+	if (!renderer) {
+		return;
+	}
+
+	if (renderer->shader) {
+		wlblur_shader_destroy(renderer->shader);
+	}
+
+	free(renderer);
+}
+
+/**
+ * Set the kernel and direction of a pass and draw it
+ *
+ * Directions are one texel of the target, which is the source's size
+ * for both blur passes.
+ */
+static void draw_gaussian(void *data, const struct wlblur_rg_pass *pass,
+                          const struct wlblur_fbo *target) {
+	struct gaussian_blur *blur = data;
+	struct wlblur_gaussian_renderer *renderer = blur->renderer;
+
+	/* A single center tap at the target's pixel centers is a 2x2 box */
+	static const struct gaussian_kernel box = {
+		.num_taps = 1, .weights = { 1.0f }, .offsets = { 0.0f },
+	};
+	const struct gaussian_kernel *kernel =
+		pass->arg == GAUSSIAN_DOWNSAMPLE ? &box : &blur->kernel;
+
+	float direction_x = 0.0f, direction_y = 0.0f;
+	if (pass->arg == GAUSSIAN_HORIZONTAL) {
+		direction_x = 1.0f / target->width;
+	} else if (pass->arg != GAUSSIAN_DOWNSAMPLE) {
+		direction_y = 1.0f / target->height;
+	}
+
+	glUniform1i(renderer->shader->u_tex, 0);
+	glUniform2f(renderer->u_direction, direction_x, direction_y);
+	glUniform1i(renderer->u_num_taps, kernel->num_taps);
+	glUniform1fv(renderer->u_weights, kernel->num_taps, kernel->weights);
+	glUniform1fv(renderer->u_offsets, kernel->num_taps, kernel->offsets);
+	glUniform1i(renderer->u_apply_finish,
+	            pass->arg == GAUSSIAN_VERTICAL_FINISH);
+	if (pass->arg == GAUSSIAN_VERTICAL_FINISH) {
+		set_finish_uniforms(renderer->shader, blur->params);
+	}
+
+	render_fullscreen_quad(renderer);
+}
+
+/**
+ * Post-process and upsample the reduced result
+ *
+ * The finish pass samples with GL_LINEAR, so it also upsamples.
+ */
+static void draw_finish(void *data, const struct wlblur_rg_pass *pass,
+                        const struct wlblur_fbo *target) {
+	struct gaussian_blur *blur = data;
+	(void)target;
+
+	glUniform1i(pass->shader->u_tex, 0);
+	set_finish_uniforms(pass->shader, blur->params);
+	render_fullscreen_quad(blur->renderer);
+}
+
+GLuint wlblur_gaussian_blur(
+	struct wlblur_gaussian_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	if (!renderer || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
+	}
+
+	if (!wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
+
+	struct wlblur_blur_computed computed = wlblur_params_compute(params);
+
+	float sigma;
+	int levels = pick_levels(computed.sigma, width, height, &sigma);
+	int level_width = width >> levels;
+	int level_height = height >> levels;
+
+	struct gaussian_blur blur = { .renderer = renderer, .params = params };
+	build_kernel(sigma, &blur.kernel);
+
+	struct wlblur_render_graph graph;
+	wlblur_rg_init(&graph, renderer->kawase->fbo_pool, input_texture, &blur);
+
+	/* === DOWNSAMPLE PASSES === */
+	int current = WLBLUR_RG_INPUT;
+	for (int level = 1; level <= levels; level++) {
+		int target = wlblur_rg_resource(&graph, width >> level,
+		                                height >> level, GL_RGBA8, 1);
+		wlblur_rg_pass(&graph, renderer->shader, draw_gaussian,
+		               current, 0, target, 0, GAUSSIAN_DOWNSAMPLE);
+		current = target;
+	}
+
+	/* === HORIZONTAL PASS === */
+	int horizontal = wlblur_rg_resource(&graph, level_width, level_height,
+	                                    GL_RGBA8, 1);
+	wlblur_rg_pass(&graph, renderer->shader, draw_gaussian,
+	               current, 0, horizontal, 0, GAUSSIAN_HORIZONTAL);
+
+	/* === VERTICAL PASS === */
+	enum wlblur_finish finish = wlblur_finish_pick(params);
+	int output;
+	if (levels == 0) {
+		/* Full resolution: post-process in the same pass, if at all */
+		output = wlblur_rg_resource(&graph, width, height, GL_RGBA8, 1);
+		wlblur_rg_pass(&graph, renderer->shader, draw_gaussian,
+		               horizontal, 0, output, 0,
+		               finish == WLBLUR_FINISH_NONE ?
+		               GAUSSIAN_VERTICAL : GAUSSIAN_VERTICAL_FINISH);
+	} else {
+		/* Aliases the reduced level, which the horizontal pass was
+		 * the last to read */
+		int vertical = wlblur_rg_resource(&graph, level_width,
+		                                  level_height, GL_RGBA8, 1);
+		wlblur_rg_pass(&graph, renderer->shader, draw_gaussian,
+		               horizontal, 0, vertical, 0, GAUSSIAN_VERTICAL);
+
+		/* === POST-PROCESSING === */
+		output = wlblur_rg_resource(&graph, width, height, GL_RGBA8, 1);
+		wlblur_rg_pass(&graph,
+		               wlblur_kawase_finish_shader(renderer->kawase, finish),
+		               draw_finish, vertical, 0, output, 0, 0);
+	}
+
+	struct wlblur_fbo *final_fbo = wlblur_rg_execute(&graph, output);
+	if (!final_fbo) {
+		fprintf(stderr, "[wlblur] Failed to acquire FBO for Gaussian blur\n");
+		return 0;
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during Gaussian blur: 0x%x\n", error);
+		wlblur_fbo_pool_release(renderer->kawase->fbo_pool, final_fbo);
+		return 0;
+	}
+
+	return final_fbo->texture;
+}
@@ -0,0 +1,342 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_iir.c - Recursive (IIR) Gaussian blur in compute shaders
+ */
+
+#include "../private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Must match iir_gaussian.comp.glsl */
+#define LINES_PER_GROUP 64
+
+/* Largest sigma filtered directly. Beyond it the poles get close enough
+ * to 1 that single-precision recursions drift. */
+#define MAX_SIGMA 16.0f
+#define MAX_LEVELS 8
+
+/**
+ * Young-van Vliet coefficients and boundary matrix for one sigma
+ */
+struct iir_filter {
+	GLfloat gain;
+	GLfloat a[3];
+	GLfloat boundary[9];   /* Column-major mat3 */
+};
+
+/**
+ * Number of 2x reductions the input is block-averaged by, and sigma left
+ * for the recursive filter in buffer texels
+ *
+ * The block average (variance (4^k - 1) / 12) and the final bilinear
+ * upsample (4^k / 6) already blur, so they are subtracted.
+ */
+static int pick_levels(float sigma, int width, int height, float *level_sigma) {
+	int levels = 0;
+	while (levels < MAX_LEVELS &&
+	       sigma / (float)(1 << levels) > MAX_SIGMA &&
+	       (width >> (levels + 1)) >= 4 && (height >> (levels + 1)) >= 4) {
+		levels++;
+	}
+
+	float scale = (float)(1 << levels);
+	float remaining = sigma * sigma;
+	if (levels > 0) {
+		remaining -= (scale * scale - 1.0f) / 12.0f + scale * scale / 6.0f;
+	}
+	*level_sigma = sqrtf(remaining > 0.25f ? remaining : 0.25f) / scale;
+	return levels;
+}
+
+/**
+ * Compute the recursion coefficients for sigma (in texels)
+ *
+ * The boundary matrix maps the causal pass's last three outputs (minus
+ * the edge value) to the anticausal pass's initial state. It is found by
+ * running both recursions over a long clamped extension for each basis
+ * vector, which is exact to float precision and avoids the closed form's
+ * sign conventions.
+ */
+static void build_filter(float sigma, struct iir_filter *filter) {
+	if (sigma < 0.5f) {
+		sigma = 0.5f;
+	}
+
+	/* Young & van Vliet 1995, eq. 11b and 8c */
+	double q = sigma >= 2.5f ?
+		0.98711 * sigma - 0.96330 :
+		3.97156 - 4.14554 * sqrt(1.0 - 0.26891 * sigma);
+	double b0 = 1.57825 + q * (2.44413 + q * (1.4281 + q * 0.422205));
+	double a1 = q * (2.44413 + q * (2.85619 + q * 1.26661)) / b0;
+	double a2 = -q * q * (1.4281 + q * 1.26661) / b0;
+	double a3 = q * q * q * 0.422205 / b0;
+	double gain = 1.0 - (a1 + a2 + a3);
+
+	filter->gain = (GLfloat)gain;
+	filter->a[0] = (GLfloat)a1;
+	filter->a[1] = (GLfloat)a2;
+	filter->a[2] = (GLfloat)a3;
+
+	/* The impulse response has decayed below float precision by then */
+	int extension = (int)(10.0f * sigma) + 50;
+	double *causal = malloc(extension * sizeof(double));
+	if (!causal) {
+		/* Fall back to starting from the last causal output */
+		for (int i = 0; i < 9; i++) {
+			filter->boundary[i] = i % 3 == 0 ? 1.0f : 0.0f;
+		}
+		return;
+	}
+
+	for (int j = 0; j < 3; j++) {
+		double w[3] = { 0.0, 0.0, 0.0 };   /* w[n-1], w[n-2], w[n-3] */
+		w[j] = 1.0;
+		for (int i = 0; i < extension; i++) {
+			double v = a1 * w[0] + a2 * w[1] + a3 * w[2];
+			causal[i] = v;
+			w[2] = w[1];
+			w[1] = w[0];
+			w[0] = v;
+		}
+
+		double y[3] = { 0.0, 0.0, 0.0 };   /* y[n+1], y[n+2], y[n+3] */
+		for (int i = extension - 1; i >= 0; i--) {
+			double v = gain * causal[i] + a1 * y[0] + a2 * y[1] + a3 * y[2];
+			y[2] = y[1];
+			y[1] = y[0];
+			y[0] = v;
+		}
+
+		/* Column j: initial y[N], y[N + 1], y[N + 2] per unit of d_j */
+		for (int r = 0; r < 3; r++) {
+			filter->boundary[j * 3 + r] = (GLfloat)y[r];
+		}
+	}
+
+	free(causal);
+}
+
+/**
+ * Set the post-processing uniforms of the currently used shader
+ */
+static void set_finish_uniforms(
+	struct wlblur_shader_program *shader,
+	const struct wlblur_blur_params *params
+) {
+	glUniform1f(shader->u_brightness, params->brightness);
+	glUniform1f(shader->u_contrast, params->contrast);
+	glUniform1f(shader->u_saturation, params->saturation);
+	glUniform1f(shader->u_noise, params->noise);
+}
+
+struct wlblur_iir_renderer* wlblur_iir_create(
+	struct wlblur_kawase_renderer *kawase
+) {
+	if (!kawase) {
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(kawase->egl_ctx)) {
+		fprintf(stderr, "[wlblur] Failed to make context current\n");
+		return NULL;
+	}
+
+	/* Compute shaders need GLES 3.1 */
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major < 3 || (major == 3 && minor < 1)) {
+		fprintf(stderr, "[wlblur] GLES %d.%d: IIR Gaussian unavailable\n",
+		        major, minor);
+		return NULL;
+	}
+
+	struct wlblur_iir_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (!renderer) {
+		fprintf(stderr, "[wlblur] Failed to allocate IIR renderer\n");
+		return NULL;
+	}
+
+	renderer->kawase = kawase;
+
+	char *source = wlblur_shader_read_source("iir_gaussian.comp.glsl");
+	if (!source) {
+		goto error;
+	}
+
+	renderer->shader = wlblur_shader_load_compute_from_source(source);
+	free(source);
+	if (!renderer->shader) {
+		fprintf(stderr, "[wlblur] Failed to load IIR Gaussian shader\n");
+		goto error;
+	}
+
+	GLuint program = renderer->shader->program;
+	renderer->u_size = glGetUniformLocation(program, "size");
+	renderer->u_block = glGetUniformLocation(program, "block");
+	renderer->u_columns = glGetUniformLocation(program, "columns");
+	renderer->u_gain = glGetUniformLocation(program, "gain");
+	renderer->u_a = glGetUniformLocation(program, "a");
+	renderer->u_boundary = glGetUniformLocation(program, "boundary");
+	renderer->u_apply_finish = glGetUniformLocation(program, "apply_finish");
+
+	glGenBuffers(1, &renderer->line_buffer);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error creating IIR renderer: 0x%x\n",
+		        error);
+		goto error;
+	}
+
+	fprintf(stderr, "[wlblur] IIR Gaussian renderer created successfully\n");
+	return renderer;
+
+error:
+	wlblur_iir_destroy(renderer);
+	return NULL;
+}
+
+void wlblur_iir_destroy(struct wlblur_iir_renderer *renderer) {
+	if (!renderer) {
+		return;
+	}
+
+	if (renderer->shader) {
+		wlblur_shader_destroy(renderer->shader);
+	}
+	if (renderer->line_buffer) {
+		glDeleteBuffers(1, &renderer->line_buffer);
+	}
+
+	free(renderer);
+}
+
+GLuint wlblur_iir_blur(
+	struct wlblur_iir_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	if (!renderer || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
+	}
+
+	if (!wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
+
+	struct wlblur_fbo_pool *pool = renderer->kawase->fbo_pool;
+	struct wlblur_blur_computed computed = wlblur_params_compute(params);
+
+	float sigma;
+	int levels = pick_levels(computed.sigma, width, height, &sigma);
+	int level_width = width >> levels;
+	int level_height = height >> levels;
+
+	struct iir_filter filter;
+	build_filter(sigma, &filter);
+
+	/* Grow the line buffer (two packed half floats per texel); never
+	 * shrinks */
+	GLsizeiptr buffer_size =
+		(GLsizeiptr)level_width * level_height * 2 * sizeof(GLuint);
+	if (buffer_size > renderer->line_buffer_size) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer->line_buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, buffer_size,
+		             NULL, GL_DYNAMIC_COPY);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		renderer->line_buffer_size = buffer_size;
+	}
+
+	/* Full size: the column pass writes the finished output itself */
+	struct wlblur_fbo *level_fbo = wlblur_fbo_pool_acquire(
+		pool, level_width, level_height);
+	if (!level_fbo) {
+		fprintf(stderr, "[wlblur] Failed to acquire FBO for IIR blur\n");
+		return 0;
+	}
+
+	struct wlblur_shader_program *shader = renderer->shader;
+	wlblur_shader_use(shader);
+
+	glUniform1i(shader->u_tex, 0);
+	glUniform2i(renderer->u_size, level_width, level_height);
+	glUniform1i(renderer->u_block, 1 << levels);
+	glUniform1f(renderer->u_gain, filter.gain);
+	glUniform3fv(renderer->u_a, 1, filter.a);
+	glUniformMatrix3fv(renderer->u_boundary, 1, GL_FALSE, filter.boundary);
+	glUniform1i(renderer->u_apply_finish, levels == 0);
+	set_finish_uniforms(shader, params);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, input_texture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, renderer->line_buffer);
+	glBindImageTexture(0, level_fbo->texture, 0, GL_FALSE, 0,
+	                   GL_WRITE_ONLY, GL_RGBA8);
+
+	/* === ROW PASS === */
+	glUniform1i(renderer->u_columns, GL_FALSE);
+	glDispatchCompute((level_height + LINES_PER_GROUP - 1) / LINES_PER_GROUP,
+	                  1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+	/* === COLUMN PASS === */
+	glUniform1i(renderer->u_columns, GL_TRUE);
+	glDispatchCompute((level_width + LINES_PER_GROUP - 1) / LINES_PER_GROUP,
+	                  1, 1);
+
+	/* Output is sampled, exported or read back next; the line buffer is
+	 * rewritten by the next blur */
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT |
+	                GL_FRAMEBUFFER_BARRIER_BIT |
+	                GL_TEXTURE_UPDATE_BARRIER_BIT |
+	                GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+	struct wlblur_fbo *final_fbo = level_fbo;
+
+	/* === POST-PROCESSING === */
+	if (levels > 0) {
+		/* The finish pass samples with GL_LINEAR, so it also upsamples */
+		final_fbo = wlblur_fbo_pool_acquire(pool, width, height);
+		if (!final_fbo) {
+			fprintf(stderr, "[wlblur] Failed to acquire FBO for IIR blur\n");
+			wlblur_fbo_pool_release(pool, level_fbo);
+			return 0;
+		}
+
+		struct wlblur_shader_program *finish = renderer->kawase->finish_shader;
+		wlblur_shader_use(finish);
+		wlblur_fbo_bind(final_fbo);
+		glViewport(0, 0, width, height);
+		glUniform1i(finish->u_tex, 0);
+		wlblur_shader_set_source(finish, level_fbo);
+		set_finish_uniforms(finish, params);
+		glBindTexture(GL_TEXTURE_2D, level_fbo->texture);
+		glBindVertexArray(renderer->kawase->vao);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		glBindVertexArray(0);
+		wlblur_fbo_unbind();
+
+		wlblur_fbo_pool_release(pool, level_fbo);
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during IIR blur: 0x%x\n", error);
+		wlblur_fbo_pool_release(pool, final_fbo);
+		return 0;
+	}
+
+	return final_fbo->texture;
+}
@@ -7,6 +7,7 @@
  */
 
 #include "../private/internal.h"
+#include <drm_fourcc.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -62,54 +63,216 @@ static void render_fullscreen_quad(struct wlblur_kawase_renderer *renderer) {
 }
 
 /**
- * Load shader from file with embedded shader directory path
+ * Bind target FBO and source texture and set the Kawase pass uniforms
+ *
+ * source_area is the FBO holding source_texture, or NULL for a texture
+ * used whole (the input).
  */
-static struct wlblur_shader_program* load_shader_from_relative(
-	const char *relative_path
+static void bind_kawase_pass(
+	struct wlblur_shader_program *shader,
+	struct wlblur_fbo *target,
+	GLuint source_texture,
+	const struct wlblur_fbo *source_area,
+	float radius
 ) {
-	/* Try to load from shader directory */
-	char full_path[512];
-
-	/* First try: relative to current directory (for development) */
-	snprintf(full_path, sizeof(full_path), "libwlblur/shaders/%s", relative_path);
-	char *source = NULL;
-	FILE *file = fopen(full_path, "r");
-
-	if (!file) {
-		/* Second try: absolute path or WLBLUR_SHADER_PATH */
-		const char *shader_dir = getenv("WLBLUR_SHADER_PATH");
-		if (shader_dir) {
-			snprintf(full_path, sizeof(full_path), "%s/%s", shader_dir, relative_path);
-			file = fopen(full_path, "r");
-		}
+	wlblur_fbo_bind(target);
+	glViewport(0, 0, target->width, target->height);
+
+	glUniform1i(shader->u_tex, 0);
+	wlblur_shader_set_source(shader, source_area);
+	glUniform2f(shader->u_halfpixel,
+	            0.5f / target->width,
+	            0.5f / target->height);
+	glUniform1f(shader->u_radius, radius);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source_texture);
+}
+
+/**
+ * Set the post-processing uniforms of the currently used shader
+ */
+static void set_finish_uniforms(
+	struct wlblur_shader_program *shader,
+	const struct wlblur_blur_params *params
+) {
+	glUniform1f(shader->u_brightness, params->brightness);
+	glUniform1f(shader->u_contrast, params->contrast);
+	glUniform1f(shader->u_saturation, params->saturation);
+	glUniform1f(shader->u_noise, params->noise);
+}
+
+/**
+ * Bind target FBO and source texture and set the post-processing uniforms
+ */
+static void bind_finish_pass(
+	struct wlblur_shader_program *shader,
+	struct wlblur_fbo *target,
+	const struct wlblur_fbo *source,
+	const struct wlblur_blur_params *params
+) {
+	wlblur_fbo_bind(target);
+	glViewport(0, 0, target->width, target->height);
+
+	glUniform1i(shader->u_tex, 0);
+	wlblur_shader_set_source(shader, source);
+	set_finish_uniforms(shader, params);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source->texture);
+}
+
+/* Variant defines per enum wlblur_finish */
+static const char *const FINISH_DEFINES[WLBLUR_FINISH_COUNT] = {
+	[WLBLUR_FINISH_FULL] = NULL,
+	[WLBLUR_FINISH_COLOR] = "#define WLBLUR_NO_NOISE\n",
+	[WLBLUR_FINISH_NOISE] = "#define WLBLUR_NO_COLOR\n",
+	[WLBLUR_FINISH_NONE] = "#define WLBLUR_NO_COLOR\n#define WLBLUR_NO_NOISE\n",
+};
+
+enum wlblur_finish wlblur_finish_pick(const struct wlblur_blur_params *params) {
+	bool color = params->brightness != 1.0f || params->contrast != 1.0f ||
+	             params->saturation != 1.0f;
+	bool noise = params->noise != 0.0f;
+
+	if (color) {
+		return noise ? WLBLUR_FINISH_FULL : WLBLUR_FINISH_COLOR;
 	}
+	return noise ? WLBLUR_FINISH_NOISE : WLBLUR_FINISH_NONE;
+}
 
-	if (!file) {
-		/* Third try: installed location */
-		snprintf(full_path, sizeof(full_path), "/usr/share/wlblur/shaders/%s", relative_path);
-		file = fopen(full_path, "r");
+struct wlblur_shader_program* wlblur_kawase_finish_shader(
+	struct wlblur_kawase_renderer *renderer,
+	enum wlblur_finish kind
+) {
+	struct wlblur_shader_program *shader = NULL;
+	if (kind != WLBLUR_FINISH_FULL) {
+		shader = wlblur_shader_variant_get(renderer->egl_ctx,
+		                                   &renderer->finish_variants[kind],
+		                                   false);
 	}
 
-	if (!file) {
-		fprintf(stderr, "[wlblur] Failed to open shader: %s\n", relative_path);
-		return NULL;
+	return shader ? shader : renderer->finish_shader;
+}
+
+/**
+ * Programs that end a blur with params
+ *
+ * *last renders the final upsample and *finish the separate finish pass
+ * after it, or is NULL when *last writes the output: the finish is fused
+ * into it, or is a no-op. Query once per blur, as variants may become
+ * ready at any call; never waits for one.
+ */
+static void pick_last_passes(
+	struct wlblur_kawase_renderer *renderer,
+	const struct wlblur_blur_params *params,
+	struct wlblur_shader_program **last,
+	struct wlblur_shader_program **finish
+) {
+	enum wlblur_finish kind = wlblur_finish_pick(params);
+	*last = renderer->upsample_shader;
+	*finish = NULL;
+
+	if (kind == WLBLUR_FINISH_NONE) {
+		return;
+	}
+
+	struct wlblur_shader_program *fused = NULL;
+	if (renderer->fuse_finish) {
+		fused = wlblur_shader_variant_get(renderer->egl_ctx,
+		                                  &renderer->upsample_finish[kind],
+		                                  false);
+	}
+
+	if (fused) {
+		*last = fused;
+	} else {
+		*finish = wlblur_kawase_finish_shader(renderer, kind);
+	}
+}
+
+/**
+ * Bind the final upsample pass with the last program of pick_last_passes()
+ */
+static void bind_last_upsample_pass(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_shader_program *last,
+	struct wlblur_fbo *target,
+	const struct wlblur_fbo *source,
+	const struct wlblur_blur_params *params
+) {
+	wlblur_shader_use(last);
+	bind_kawase_pass(last, target, source->texture, source, params->radius);
+	if (last != renderer->upsample_shader) {
+		set_finish_uniforms(last, params);
+	}
+}
+
+/**
+ * Record which float formats can be render targets (context current)
+ */
+static void detect_float_targets(struct wlblur_kawase_renderer *renderer) {
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+
+	const char *extensions = (const char *)glGetString(GL_EXTENSIONS);
+	if (!extensions) {
+		extensions = "";
 	}
 
-	/* Read file */
-	fseek(file, 0, SEEK_END);
-	long size = ftell(file);
-	fseek(file, 0, SEEK_SET);
+	/* EXT_color_buffer_float is core in GLES 3.2 */
+	renderer->has_float_targets =
+		major > 3 || (major == 3 && minor >= 2) ||
+		strstr(extensions, "GL_EXT_color_buffer_float") != NULL;
+	renderer->has_half_float_targets = renderer->has_float_targets ||
+		strstr(extensions, "GL_EXT_color_buffer_half_float") != NULL;
+}
+
+GLenum wlblur_kawase_pick_format(
+	const struct wlblur_kawase_renderer *renderer,
+	uint32_t drm_format
+) {
+	switch (drm_format) {
+	case DRM_FORMAT_XRGB8888:
+	case DRM_FORMAT_XBGR8888:
+		/* Always renderable in GLES 3.0 */
+		return GL_RGB565;
+
+	case DRM_FORMAT_XRGB2101010:
+	case DRM_FORMAT_XBGR2101010:
+	case DRM_FORMAT_XRGB16161616F:
+	case DRM_FORMAT_XBGR16161616F:
+		if (renderer->has_float_targets) {
+			return GL_R11F_G11F_B10F;
+		}
+		if (renderer->has_half_float_targets) {
+			return GL_RGBA16F;
+		}
+		return GL_RGBA8;
+
+	case DRM_FORMAT_ARGB2101010:
+	case DRM_FORMAT_ABGR2101010:
+	case DRM_FORMAT_ARGB16161616F:
+	case DRM_FORMAT_ABGR16161616F:
+		return renderer->has_half_float_targets ? GL_RGBA16F : GL_RGBA8;
+
+	default:
+		return GL_RGBA8;
+	}
+}
 
-	source = malloc(size + 1);
+/**
+ * Load a fragment shader by file name
+ */
+static struct wlblur_shader_program* load_shader_from_relative(
+	const char *relative_path
+) {
+	char *source = wlblur_shader_read_source(relative_path);
 	if (!source) {
-		fclose(file);
 		return NULL;
 	}
 
-	size_t read_size = fread(source, 1, size, file);
-	source[read_size] = '\0';
-	fclose(file);
-
 	/* Compile shader */
 	struct wlblur_shader_program *shader =
 		wlblur_shader_load_from_source(NULL, source);
@@ -167,6 +330,24 @@ struct wlblur_kawase_renderer* wlblur_kawase_create(
 		goto error;
 	}
 
+	/* Optional and built on demand: until then, or if they fail, blurs
+	 * run the generic separate finish pass */
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT; kind++) {
+		renderer->finish_variants[kind] = (struct wlblur_shader_variant){
+			.name = "blur_finish.frag.glsl",
+			.defines = FINISH_DEFINES[kind],
+		};
+		renderer->upsample_finish[kind] = (struct wlblur_shader_variant){
+			.name = "kawase_upsample_finish.frag.glsl",
+			.defines = FINISH_DEFINES[kind],
+		};
+	}
+	renderer->fuse_finish = true;
+	renderer->layout = WLBLUR_KAWASE_LAYOUT_LEVELS;
+
+	renderer->intermediate_format = GL_RGBA8;
+	detect_float_targets(renderer);
+
 	/* Create fullscreen quad */
 	if (!create_fullscreen_quad(&renderer->vao, &renderer->vbo)) {
 		fprintf(stderr, "[wlblur] Failed to create fullscreen quad\n");
@@ -196,6 +377,10 @@ void wlblur_kawase_destroy(struct wlblur_kawase_renderer *renderer) {
 	if (renderer->finish_shader) {
 		wlblur_shader_destroy(renderer->finish_shader);
 	}
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT; kind++) {
+		wlblur_shader_variant_reset(&renderer->finish_variants[kind]);
+		wlblur_shader_variant_reset(&renderer->upsample_finish[kind]);
+	}
 
 	/* Destroy geometry */
 	if (renderer->vao) {
@@ -213,12 +398,236 @@ void wlblur_kawase_destroy(struct wlblur_kawase_renderer *renderer) {
 	free(renderer);
 }
 
-GLuint wlblur_kawase_blur(
+void wlblur_kawase_prepare(
+	struct wlblur_kawase_renderer *renderer,
+	const struct wlblur_blur_params *params
+) {
+	enum wlblur_finish kind = wlblur_finish_pick(params);
+
+	/* Without a finish the generic upsample writes the output */
+	if (renderer->fuse_finish && kind != WLBLUR_FINISH_NONE &&
+	    params->algorithm == WLBLUR_ALGO_KAWASE) {
+		wlblur_shader_variant_request(&renderer->upsample_finish[kind]);
+	}
+
+	/* Shared pyramids, blurs before the fused pass is ready and reduced
+	 * Gaussian blurs finish separately; a no-op finish still copies
+	 * there */
+	if (kind != WLBLUR_FINISH_FULL) {
+		wlblur_shader_variant_request(&renderer->finish_variants[kind]);
+	}
+}
+
+/**
+ * Expand and clamp damage rects to the full-resolution region whose
+ * blurred output may change. Returns the number of non-empty rects.
+ */
+static int expand_damage(
+	const struct wlblur_rect *damage,
+	int num_damage,
+	int expand,
+	int width,
+	int height,
+	struct wlblur_rect *out
+) {
+	struct wlblur_rect bounds;
+
+	/* Too many rects: one scissor over their bounding box is cheaper */
+	if (num_damage > WLBLUR_MAX_DAMAGE_RECTS) {
+		bounds = damage[0];
+		for (int i = 1; i < num_damage; i++) {
+			if (damage[i].x1 < bounds.x1) bounds.x1 = damage[i].x1;
+			if (damage[i].y1 < bounds.y1) bounds.y1 = damage[i].y1;
+			if (damage[i].x2 > bounds.x2) bounds.x2 = damage[i].x2;
+			if (damage[i].y2 > bounds.y2) bounds.y2 = damage[i].y2;
+		}
+		damage = &bounds;
+		num_damage = 1;
+	}
+
+	int count = 0;
+	for (int i = 0; i < num_damage; i++) {
+		if (damage[i].x2 <= damage[i].x1 || damage[i].y2 <= damage[i].y1) {
+			continue;
+		}
+
+		struct wlblur_rect r = {
+			.x1 = damage[i].x1 - expand,
+			.y1 = damage[i].y1 - expand,
+			.x2 = damage[i].x2 + expand,
+			.y2 = damage[i].y2 + expand,
+		};
+		if (r.x1 < 0) r.x1 = 0;
+		if (r.y1 < 0) r.y1 = 0;
+		if (r.x2 > width) r.x2 = width;
+		if (r.y2 > height) r.y2 = height;
+
+		if (r.x2 > r.x1 && r.y2 > r.y1) {
+			out[count++] = r;
+		}
+	}
+
+	return count;
+}
+
+/**
+ * Draw the fullscreen quad once per clip rect, scaled to the target level
+ *
+ * Each rect is padded by one target texel so the bilinear taps along its
+ * edge are re-rendered too.
+ */
+static void render_clipped(
+	struct wlblur_kawase_renderer *renderer,
+	const struct wlblur_fbo *target,
+	int width,
+	int height,
+	const struct wlblur_rect *clip,
+	int num_clip
+) {
+	for (int i = 0; i < num_clip; i++) {
+		int x1 = clip[i].x1 * target->width / width - 1;
+		int y1 = clip[i].y1 * target->height / height - 1;
+		int x2 = (clip[i].x2 * target->width + width - 1) / width + 1;
+		int y2 = (clip[i].y2 * target->height + height - 1) / height + 1;
+
+		if (x1 < 0) x1 = 0;
+		if (y1 < 0) y1 = 0;
+		if (x2 > target->width) x2 = target->width;
+		if (y2 > target->height) y2 = target->height;
+
+		glScissor(x1, y1, x2 - x1, y2 - y1);
+		render_fullscreen_quad(renderer);
+	}
+}
+
+/**
+ * Draw a pass over the whole target, or only inside clip when given
+ */
+static void render_pass(
+	struct wlblur_kawase_renderer *renderer,
+	const struct wlblur_fbo *target,
+	int width,
+	int height,
+	const struct wlblur_rect *clip,
+	int num_clip
+) {
+	if (clip) {
+		render_clipped(renderer, target, width, height, clip, num_clip);
+	} else {
+		render_fullscreen_quad(renderer);
+	}
+}
+
+/**
+ * Pooled blur state shared by its render graph passes
+ */
+struct pooled_blur {
+	struct wlblur_kawase_renderer *renderer;
+	const struct wlblur_blur_params *params;
+	int width;
+	int height;
+	const struct wlblur_rect *clip;
+	int num_clip;
+};
+
+/**
+ * Draw a downsample or upsample pass at radius + pass->arg
+ */
+static void draw_kawase(void *data, const struct wlblur_rg_pass *pass,
+                        const struct wlblur_fbo *target) {
+	struct pooled_blur *blur = data;
+	struct wlblur_shader_program *shader = pass->shader;
+
+	glUniform1i(shader->u_tex, 0);
+	glUniform2f(shader->u_halfpixel,
+	            0.5f / target->width,
+	            0.5f / target->height);
+	glUniform1f(shader->u_radius, blur->params->radius + (float)pass->arg);
+	if (shader != blur->renderer->downsample_shader &&
+	    shader != blur->renderer->upsample_shader) {
+		set_finish_uniforms(shader, blur->params);  /* Fused finish */
+	}
+
+	render_pass(blur->renderer, target, blur->width, blur->height,
+	            blur->clip, blur->num_clip);
+}
+
+/**
+ * Draw the post-processing pass
+ */
+static void draw_finish(void *data, const struct wlblur_rg_pass *pass,
+                        const struct wlblur_fbo *target) {
+	struct pooled_blur *blur = data;
+
+	glUniform1i(pass->shader->u_tex, 0);
+	set_finish_uniforms(pass->shader, blur->params);
+
+	render_pass(blur->renderer, target, blur->width, blur->height,
+	            blur->clip, blur->num_clip);
+}
+
+/**
+ * Declare the pyramid levels of a pooled blur
+ *
+ * Level i is level[i] at mip sub[i]. With the atlas layout all levels are
+ * mips of one resource; inputs too small for a mip chain of num_passes
+ * levels get one resource per level, like the default layout.
+ */
+static void declare_levels(
+	struct wlblur_render_graph *graph,
+	struct wlblur_kawase_renderer *renderer,
+	int width,
+	int height,
+	int num_passes,
+	int *level,
+	int *sub
+) {
+	int base_width = width > 1 ? width >> 1 : 1;
+	int base_height = height > 1 ? height >> 1 : 1;
+	int max_levels = 1;
+	for (int size = base_width > base_height ? base_width : base_height;
+	     size > 1; size >>= 1) {
+		max_levels++;
+	}
+
+	if (renderer->layout == WLBLUR_KAWASE_LAYOUT_ATLAS &&
+	    num_passes <= max_levels) {
+		int atlas = wlblur_rg_resource(graph, base_width, base_height,
+		                               renderer->intermediate_format,
+		                               num_passes);
+		for (int i = 0; i < num_passes; i++) {
+			level[i] = atlas;
+			sub[i] = i;
+		}
+		return;
+	}
+
+	for (int i = 0; i < num_passes; i++) {
+		/* Divide by 2^(i+1); the graph keeps levels at least 1x1 */
+		level[i] = wlblur_rg_resource(graph, width >> (i + 1),
+		                              height >> (i + 1),
+		                              renderer->intermediate_format, 1);
+		sub[i] = 0;
+	}
+}
+
+/**
+ * Pooled Dual Kawase blur, scissored to clip when it is not NULL
+ *
+ * With a target, the last pass renders into it at (x, y) instead of into
+ * a pooled texture (see wlblur_rg_external()); clip must then be NULL.
+ */
+static GLuint blur_pooled(
 	struct wlblur_kawase_renderer *renderer,
 	GLuint input_texture,
 	int width,
 	int height,
-	const struct wlblur_blur_params *params
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *clip,
+	int num_clip,
+	struct wlblur_fbo *target,
+	int x,
+	int y
 ) {
 	if (!renderer || !input_texture || width <= 0 || height <= 0) {
 		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
@@ -237,155 +646,628 @@ GLuint wlblur_kawase_blur(
 		return 0;
 	}
 
-	/* Allocate FBOs for each resolution level */
-	struct wlblur_fbo *fbos[8];  /* Max 8 passes */
-	for (int i = 0; i < num_passes; i++) {
-		int fbo_width = width >> (i + 1);   /* Divide by 2^(i+1) */
-		int fbo_height = height >> (i + 1);
-
-		/* Ensure minimum size of 1x1 */
-		if (fbo_width < 1) fbo_width = 1;
-		if (fbo_height < 1) fbo_height = 1;
-
-		fbos[i] = wlblur_fbo_pool_acquire(renderer->fbo_pool,
-		                                  fbo_width, fbo_height);
-		if (!fbos[i]) {
-			fprintf(stderr, "[wlblur] Failed to acquire FBO for pass %d\n", i);
-			/* Release acquired FBOs */
-			for (int j = 0; j < i; j++) {
-				wlblur_fbo_pool_release(renderer->fbo_pool, fbos[j]);
-			}
-			return 0;
-		}
+	struct pooled_blur blur = {
+		.renderer = renderer,
+		.params = params,
+		.width = width,
+		.height = height,
+		.clip = clip,
+		.num_clip = num_clip,
+	};
+	struct wlblur_render_graph graph;
+	wlblur_rg_init(&graph, renderer->fbo_pool, input_texture, &blur);
+	graph.size_classes = true;  /* Every pass samples the source area */
+
+	int level[8], sub[8];  /* Max 8 passes */
+	declare_levels(&graph, renderer, width, height, num_passes, level, sub);
+
+	/* === DOWNSAMPLE PASSES === */
+	for (int pass = 0; pass < num_passes; pass++) {
+		wlblur_rg_pass(&graph, renderer->downsample_shader, draw_kawase,
+		               pass > 0 ? level[pass - 1] : WLBLUR_RG_INPUT,
+		               pass > 0 ? sub[pass - 1] : 0,
+		               level[pass], sub[pass], pass);
 	}
 
-	GLuint current_tex = input_texture;
+	/* === UPSAMPLE PASSES === */
+	for (int pass = num_passes - 1; pass >= 1; pass--) {
+		/* Intermediate pass: render to previous level */
+		wlblur_rg_pass(&graph, renderer->upsample_shader, draw_kawase,
+		               level[pass], sub[pass],
+		               level[pass - 1], sub[pass - 1], pass);
+	}
 
-	/* === DOWNSAMPLE PASSES === */
-	wlblur_shader_use(renderer->downsample_shader);
+	/* Final upsample pass: render to full resolution, into the output
+	 * when the finish is fused into it or is a no-op */
+	struct wlblur_shader_program *last, *finish;
+	pick_last_passes(renderer, params, &last, &finish);
+	int output = target ?
+		wlblur_rg_external(&graph, target, x, y, width, height) :
+		wlblur_rg_resource(&graph, width, height, GL_RGBA8, 1);
+	int upsampled = finish ?
+		wlblur_rg_resource(&graph, width, height,
+		                   renderer->intermediate_format, 1) :
+		output;
+	wlblur_rg_pass(&graph, last, draw_kawase, level[0], sub[0],
+	               upsampled, 0, 0);
 
-	for (int pass = 0; pass < num_passes; pass++) {
-		struct wlblur_fbo *target_fbo = fbos[pass];
+	/* === POST-PROCESSING === */
+	if (finish) {
+		/* The pyramid is released by now, so this costs one extra
+		 * full-size target rather than the whole chain */
+		wlblur_rg_pass(&graph, finish, draw_finish,
+		               upsampled, 0, output, 0, 0);
+	}
 
-		/* Bind target framebuffer */
-		wlblur_fbo_bind(target_fbo);
-		glViewport(0, 0, target_fbo->width, target_fbo->height);
+	if (clip) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	struct wlblur_fbo *final_fbo = wlblur_rg_execute(&graph, output);
+	glDisable(GL_SCISSOR_TEST);
 
-		/* Set uniforms */
-		glUniform1i(renderer->downsample_shader->u_tex, 0);
-		glUniform2f(renderer->downsample_shader->u_halfpixel,
-		            0.5f / target_fbo->width,
-		            0.5f / target_fbo->height);
-		glUniform1f(renderer->downsample_shader->u_radius,
-		            params->radius + (float)pass);
+	if (!final_fbo) {
+		return 0;
+	}
 
-		/* Bind input texture */
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, current_tex);
+	/* Check for GL errors */
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during blur: 0x%x\n", error);
+		if (!target) {
+			wlblur_fbo_pool_release(renderer->fbo_pool, final_fbo);
+		}
+		return 0;
+	}
 
-		/* Draw fullscreen quad */
-		render_fullscreen_quad(renderer);
+	return final_fbo->texture;
+}
 
-		/* Output becomes input for next pass */
-		current_tex = target_fbo->texture;
+GLuint wlblur_kawase_blur(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	return blur_pooled(renderer, input_texture, width, height, params,
+	                   NULL, 0, NULL, 0, 0);
+}
+
+bool wlblur_kawase_blur_into(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	struct wlblur_fbo *target,
+	int x,
+	int y
+) {
+	if (!target) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return false;
+	}
+
+	return blur_pooled(renderer, input_texture, width, height, params,
+	                   NULL, 0, target, x, y) != 0;
+}
+
+GLuint wlblur_kawase_blur_regions(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *regions,
+	int num_regions
+) {
+	if (!params || !regions || num_regions <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
 	}
 
+	/* Every pass reaches damage_expand around the regions at most */
+	struct wlblur_rect clip[WLBLUR_MAX_DAMAGE_RECTS];
+	int num_clip = expand_damage(regions, num_regions,
+	                             wlblur_params_compute(params).damage_expand,
+	                             width, height, clip);
+	if (num_clip == 0) {
+		fprintf(stderr, "[wlblur] Blur regions are empty\n");
+		return 0;
+	}
+
+	return blur_pooled(renderer, input_texture, width, height, params,
+	                   clip, num_clip, NULL, 0, 0);
+}
+
+/**
+ * Upsample from the smallest level of a shared pyramid and post-process
+ * into one output per member
+ *
+ * A single member gets the fused last pass when available; several
+ * members share an unfused full-size upsample and differ only in their
+ * finish pass.
+ */
+static bool upsample_shared(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_fbo **down,
+	struct wlblur_fbo **up,
+	int width,
+	int height,
+	int num_passes,
+	const struct wlblur_blur_params *params,
+	const int *members,
+	int num_members,
+	GLuint *outputs
+) {
+	const struct wlblur_blur_params *first = &params[members[0]];
+	struct wlblur_fbo *current = down[num_passes - 1];
+
 	/* === UPSAMPLE PASSES === */
 	wlblur_shader_use(renderer->upsample_shader);
 
-	for (int pass = num_passes - 1; pass >= 0; pass--) {
-		struct wlblur_fbo *target_fbo;
+	for (int pass = num_passes - 1; pass >= 1; pass--) {
+		/* Separate from down[] so deeper members can still read it */
+		if (!up[pass - 1]) {
+			up[pass - 1] = wlblur_fbo_pool_acquire_class(
+				renderer->fbo_pool, down[pass - 1]->width,
+				down[pass - 1]->height, renderer->intermediate_format, 1);
+			if (!up[pass - 1]) {
+				fprintf(stderr, "[wlblur] Failed to acquire FBO for pass %d\n",
+				        pass);
+				return false;
+			}
+		}
+
+		bind_kawase_pass(renderer->upsample_shader, up[pass - 1],
+		                 current->texture, current,
+		                 first->radius + (float)pass);
+		render_fullscreen_quad(renderer);
+		current = up[pass - 1];
+	}
+
+	/* One member: same final passes as wlblur_kawase_blur() */
+	struct wlblur_shader_program *last = renderer->upsample_shader;
+	struct wlblur_shader_program *finish = NULL;
+	if (num_members == 1) {
+		pick_last_passes(renderer, first, &last, &finish);
+	}
+	bool finished = num_members == 1 && !finish;
+
+	/* Exported when it is the output */
+	struct wlblur_fbo *upsampled_fbo = finished ?
+		wlblur_fbo_pool_acquire(renderer->fbo_pool, width, height) :
+		wlblur_fbo_pool_acquire_class(renderer->fbo_pool, width, height,
+		                              renderer->intermediate_format, 1);
+	if (!upsampled_fbo) {
+		fprintf(stderr, "[wlblur] Failed to acquire target FBO for upsample\n");
+		return false;
+	}
+
+	bind_last_upsample_pass(renderer, last, upsampled_fbo, current, first);
+	render_fullscreen_quad(renderer);
 
-		if (pass == 0) {
-			/* Final upsample pass: render to full resolution */
-			target_fbo = wlblur_fbo_pool_acquire(renderer->fbo_pool,
-			                                     width, height);
-		} else {
-			/* Intermediate pass: render to previous level */
-			target_fbo = fbos[pass - 1];
+	if (finished) {
+		outputs[members[0]] = upsampled_fbo->texture;
+		return true;
+	}
+
+	/* === POST-PROCESSING === */
+	bool ok = true;
+	for (int m = 0; m < num_members; m++) {
+		const struct wlblur_blur_params *member = &params[members[m]];
+		struct wlblur_fbo *final_fbo = wlblur_fbo_pool_acquire(
+			renderer->fbo_pool, width, height);
+		if (!final_fbo) {
+			fprintf(stderr, "[wlblur] Failed to acquire final FBO\n");
+			ok = false;
+			break;
+		}
+
+		/* Members with a no-op finish still need their own copy */
+		struct wlblur_shader_program *shader = finish ? finish :
+			wlblur_kawase_finish_shader(renderer,
+			                            wlblur_finish_pick(member));
+		wlblur_shader_use(shader);
+		bind_finish_pass(shader, final_fbo, upsampled_fbo, member);
+		render_fullscreen_quad(renderer);
+		outputs[members[m]] = final_fbo->texture;
+	}
+
+	wlblur_fbo_pool_release(renderer->fbo_pool, upsampled_fbo);
+	return ok;
+}
+
+bool wlblur_kawase_blur_shared(
+	struct wlblur_kawase_renderer *renderer,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	int count,
+	GLuint *outputs
+) {
+	if (!renderer || !input_texture || width <= 0 || height <= 0 ||
+	    !params || !outputs || count <= 0 ||
+	    count > WLBLUR_MAX_PARAM_SETS) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return false;
+	}
+
+	for (int i = 0; i < count; i++) {
+		outputs[i] = 0;
+		if (!wlblur_params_validate(&params[i])) {
+			fprintf(stderr, "[wlblur] Invalid blur params\n");
+			return false;
+		}
+	}
+
+	bool done[WLBLUR_MAX_PARAM_SETS] = { false };
+	bool ok = true;
+
+	/* Downsample levels depend only on the radius: one pyramid per radius,
+	 * as deep as its deepest member */
+	for (int first = 0; first < count && ok; first++) {
+		if (done[first]) {
+			continue;
 		}
 
-		if (!target_fbo) {
-			fprintf(stderr, "[wlblur] Failed to acquire target FBO for upsample\n");
-			/* Release FBOs */
-			for (int i = 0; i < num_passes; i++) {
-				wlblur_fbo_pool_release(renderer->fbo_pool, fbos[i]);
+		float radius = params[first].radius;
+		int deepest = 0;
+		for (int i = first; i < count; i++) {
+			if (params[i].radius == radius && params[i].num_passes > deepest) {
+				deepest = params[i].num_passes;
 			}
-			return 0;
 		}
 
-		/* Bind target framebuffer */
-		wlblur_fbo_bind(target_fbo);
-		glViewport(0, 0, target_fbo->width, target_fbo->height);
+		struct wlblur_fbo *down[8] = { NULL };
+		struct wlblur_fbo *up[8] = { NULL };
+
+		/* === DOWNSAMPLE PASSES === */
+		GLuint current_tex = input_texture;
+		const struct wlblur_fbo *current = NULL;
+		wlblur_shader_use(renderer->downsample_shader);
+
+		for (int pass = 0; pass < deepest; pass++) {
+			int fbo_width = width >> (pass + 1);
+			int fbo_height = height >> (pass + 1);
+			if (fbo_width < 1) fbo_width = 1;
+			if (fbo_height < 1) fbo_height = 1;
+
+			down[pass] = wlblur_fbo_pool_acquire_class(
+				renderer->fbo_pool, fbo_width, fbo_height,
+				renderer->intermediate_format, 1);
+			if (!down[pass]) {
+				fprintf(stderr, "[wlblur] Failed to acquire FBO for pass %d\n",
+				        pass);
+				ok = false;
+				break;
+			}
 
-		/* Set uniforms */
-		glUniform1i(renderer->upsample_shader->u_tex, 0);
-		glUniform2f(renderer->upsample_shader->u_halfpixel,
-		            0.5f / target_fbo->width,
-		            0.5f / target_fbo->height);
-		glUniform1f(renderer->upsample_shader->u_radius,
-		            params->radius + (float)pass);
+			bind_kawase_pass(renderer->downsample_shader, down[pass],
+			                 current_tex, current, radius + (float)pass);
+			render_fullscreen_quad(renderer);
+			current = down[pass];
+			current_tex = current->texture;
+		}
 
-		/* Bind input texture */
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, current_tex);
+		/* One upsample chain per pass count, shared by every finish */
+		for (int passes = 1; passes <= deepest && ok; passes++) {
+			int members[WLBLUR_MAX_PARAM_SETS];
+			int num_members = 0;
+			for (int i = first; i < count; i++) {
+				if (params[i].radius == radius &&
+				    params[i].num_passes == passes) {
+					members[num_members++] = i;
+					done[i] = true;
+				}
+			}
 
-		/* Draw */
-		render_fullscreen_quad(renderer);
+			if (num_members > 0) {
+				ok = upsample_shared(renderer, down, up, width, height,
+				                     passes, params, members, num_members,
+				                     outputs);
+			}
+		}
 
-		/* For the final pass, save the texture */
-		if (pass == 0) {
-			current_tex = target_fbo->texture;
-		} else {
-			current_tex = target_fbo->texture;
+		for (int i = 0; i < 8; i++) {
+			wlblur_fbo_pool_release(renderer->fbo_pool, down[i]);
+			wlblur_fbo_pool_release(renderer->fbo_pool, up[i]);
 		}
 	}
 
-	/* === POST-PROCESSING === */
-	struct wlblur_fbo *final_fbo = wlblur_fbo_pool_acquire(
-		renderer->fbo_pool, width, height
-	);
+	wlblur_fbo_unbind();
 
-	if (!final_fbo) {
-		fprintf(stderr, "[wlblur] Failed to acquire final FBO\n");
-		/* Release FBOs */
-		for (int i = 0; i < num_passes; i++) {
-			wlblur_fbo_pool_release(renderer->fbo_pool, fbos[i]);
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during shared blur: 0x%x\n", error);
+		ok = false;
+	}
+
+	if (!ok) {
+		for (int i = 0; i < count; i++) {
+			wlblur_fbo_pool_release_texture(renderer->fbo_pool, outputs[i]);
+			outputs[i] = 0;
+		}
+	}
+
+	return ok;
+}
+
+/**
+ * Destroy all FBOs held by a chain
+ */
+static void chain_release(struct wlblur_kawase_chain *chain) {
+	for (int i = 0; i < 8; i++) {
+		wlblur_fbo_destroy(chain->down[i]);
+		wlblur_fbo_destroy(chain->up[i]);
+		chain->down[i] = NULL;
+		chain->up[i] = NULL;
+	}
+	wlblur_fbo_destroy(chain->output);
+	chain->output = NULL;
+
+	chain->width = 0;
+	chain->height = 0;
+	chain->num_passes = 0;
+	chain->format = 0;
+	chain->valid = false;
+}
+
+/**
+ * Resize a chain level in place while the size stays in its class,
+ * otherwise replace it
+ */
+static bool chain_fit(
+	struct wlblur_fbo **fbo,
+	int width,
+	int height,
+	GLenum format
+) {
+	if (width < 1) width = 1;
+	if (height < 1) height = 1;
+
+	struct wlblur_fbo *old = *fbo;
+	if (old && old->format == format &&
+	    old->alloc_width == wlblur_fbo_size_class(width) &&
+	    old->alloc_height == wlblur_fbo_size_class(height)) {
+		old->width = width;
+		old->height = height;
+		return true;
+	}
+
+	wlblur_fbo_destroy(old);
+	*fbo = wlblur_fbo_create_class(width, height, format, 1);
+	return *fbo != NULL;
+}
+
+/**
+ * Size chain FBOs for a new size or pass count
+ *
+ * Levels whose size class is unchanged are kept, so a resize by a few
+ * pixels only reallocates the exact-size output.
+ */
+static bool chain_allocate(
+	struct wlblur_kawase_chain *chain,
+	int width,
+	int height,
+	int num_passes,
+	GLenum format
+) {
+	chain->valid = false;
+
+	for (int i = 0; i < 8; i++) {
+		if (i >= num_passes) {
+			wlblur_fbo_destroy(chain->down[i]);
+			wlblur_fbo_destroy(chain->up[i]);
+			chain->down[i] = NULL;
+			chain->up[i] = NULL;
+			continue;
+		}
+
+		if (!chain_fit(&chain->down[i], width >> (i + 1),
+		               height >> (i + 1), format)) {
+			goto error;
+		}
+
+		/* up[0] is only needed for a separate finish pass, see
+		 * wlblur_kawase_chain_reserve() */
+		if (i > 0 && !chain_fit(&chain->up[i], chain->down[i - 1]->width,
+		                        chain->down[i - 1]->height, format)) {
+			goto error;
+		}
+	}
+
+	if (chain->up[0] && !chain_fit(&chain->up[0], width, height, format)) {
+		goto error;
+	}
+
+	/* Exported as is, so it has the exact size */
+	if (!chain->output || chain->output->width != width ||
+	    chain->output->height != height) {
+		wlblur_fbo_destroy(chain->output);
+		chain->output = wlblur_fbo_create(width, height);
+		if (!chain->output) {
+			goto error;
 		}
+	}
+
+	chain->width = width;
+	chain->height = height;
+	chain->num_passes = num_passes;
+	chain->format = format;
+	return true;
+
+error:
+	fprintf(stderr, "[wlblur] Failed to allocate retained chain (%dx%d)\n",
+	        width, height);
+	chain_release(chain);
+	return false;
+}
+
+struct wlblur_kawase_chain* wlblur_kawase_chain_create(void) {
+	struct wlblur_kawase_chain *chain = calloc(1, sizeof(*chain));
+	if (!chain) {
+		fprintf(stderr, "[wlblur] Failed to allocate retained chain\n");
+		return NULL;
+	}
+
+	return chain;
+}
+
+void wlblur_kawase_chain_destroy(struct wlblur_kawase_chain *chain) {
+	if (!chain) {
+		return;
+	}
+
+	chain_release(chain);
+	free(chain);
+}
+
+bool wlblur_kawase_chain_reserve(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_kawase_chain *chain,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	int num_passes = params->num_passes;
+	if (chain->width != width || chain->height != height ||
+	    chain->num_passes != num_passes ||
+	    chain->format != renderer->intermediate_format) {
+		if (!chain_allocate(chain, width, height, num_passes,
+		                    renderer->intermediate_format)) {
+			return false;
+		}
+	}
+
+	/* Full-size upsample target for the separate finish pass, which runs
+	 * at least until the fused shader is ready */
+	struct wlblur_shader_program *last, *finish;
+	pick_last_passes(renderer, params, &last, &finish);
+	if (finish && !chain->up[0]) {
+		chain->up[0] = wlblur_fbo_create_class(width, height, chain->format,
+		                                       1);
+		if (!chain->up[0]) {
+			fprintf(stderr, "[wlblur] Failed to allocate upsample FBO\n");
+			return false;
+		}
+		chain->valid = false;
+	}
+
+	return true;
+}
+
+GLuint wlblur_kawase_blur_damage(
+	struct wlblur_kawase_renderer *renderer,
+	struct wlblur_kawase_chain *chain,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	const struct wlblur_rect *damage,
+	int num_damage
+) {
+	if (!renderer || !chain || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
 		return 0;
 	}
 
-	wlblur_fbo_bind(final_fbo);
-	glViewport(0, 0, width, height);
+	/* Params the chain was rendered with were validated then */
+	bool same = chain->valid &&
+	            memcmp(&chain->params, params, sizeof(*params)) == 0;
+	if (!same && !wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
 
-	wlblur_shader_use(renderer->finish_shader);
+	int num_passes = params->num_passes;
 
-	/* Set effect uniforms */
-	glUniform1i(renderer->finish_shader->u_tex, 0);
-	glUniform1f(renderer->finish_shader->u_brightness, params->brightness);
-	glUniform1f(renderer->finish_shader->u_contrast, params->contrast);
-	glUniform1f(renderer->finish_shader->u_saturation, params->saturation);
-	glUniform1f(renderer->finish_shader->u_noise, params->noise);
+	/* No-op once the chain is sized, e.g. by wlblur_node_reserve() */
+	if (!wlblur_kawase_chain_reserve(renderer, chain, width, height,
+	                                 params)) {
+		return 0;
+	}
 
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, current_tex);
+	/* After reserving: a chain reserved without a finish pass has no
+	 * up[0], and a ready variant never stops being ready */
+	struct wlblur_shader_program *last_shader, *finish;
+	pick_last_passes(renderer, params, &last_shader, &finish);
+
+	bool full = !chain->valid || !same || !damage || num_damage <= 0;
+
+	/* Region of the output that may change this frame */
+	struct wlblur_rect clip[WLBLUR_MAX_DAMAGE_RECTS];
+	int num_clip;
+
+	if (full) {
+		clip[0] = (struct wlblur_rect){ 0, 0, width, height };
+		num_clip = 1;
+	} else {
+		struct wlblur_blur_computed computed = wlblur_params_compute(params);
+		num_clip = expand_damage(damage, num_damage, computed.damage_expand,
+		                         width, height, clip);
+		if (num_clip == 0) {
+			/* Damage was empty: the retained output is still current */
+			return chain->output->texture;
+		}
+	}
 
-	render_fullscreen_quad(renderer);
+	/* Contents are undefined until every pass has been patched */
+	chain->valid = false;
 
-	wlblur_fbo_unbind();
+	glEnable(GL_SCISSOR_TEST);
 
-	/* Release intermediate FBOs */
-	for (int i = 0; i < num_passes; i++) {
-		wlblur_fbo_pool_release(renderer->fbo_pool, fbos[i]);
+	/* === DOWNSAMPLE PASSES === */
+	GLuint current_tex = input_texture;
+	const struct wlblur_fbo *current = NULL;
+	wlblur_shader_use(renderer->downsample_shader);
+
+	for (int pass = 0; pass < num_passes; pass++) {
+		bind_kawase_pass(renderer->downsample_shader, chain->down[pass],
+		                 current_tex, current, params->radius + (float)pass);
+		render_clipped(renderer, chain->down[pass], width, height,
+		               clip, num_clip);
+		current = chain->down[pass];
+		current_tex = current->texture;
 	}
 
-	/* Check for GL errors */
+	/* === UPSAMPLE PASSES === */
+	wlblur_shader_use(renderer->upsample_shader);
+
+	for (int pass = num_passes - 1; pass >= 1; pass--) {
+		bind_kawase_pass(renderer->upsample_shader, chain->up[pass],
+		                 current_tex, current, params->radius + (float)pass);
+		render_clipped(renderer, chain->up[pass], width, height,
+		               clip, num_clip);
+		current = chain->up[pass];
+		current_tex = current->texture;
+	}
+
+	/* Last upsample writes the output directly without a finish pass */
+	struct wlblur_fbo *last = finish ? chain->up[0] : chain->output;
+	bind_last_upsample_pass(renderer, last_shader, last, current, params);
+	render_clipped(renderer, last, width, height, clip, num_clip);
+
+	/* === POST-PROCESSING === */
+	if (finish) {
+		wlblur_shader_use(finish);
+		bind_finish_pass(finish, chain->output, chain->up[0], params);
+		render_clipped(renderer, chain->output, width, height,
+		               clip, num_clip);
+	}
+
+	glDisable(GL_SCISSOR_TEST);
+	wlblur_fbo_unbind();
+
 	GLenum error = glGetError();
 	if (error != GL_NO_ERROR) {
-		fprintf(stderr, "[wlblur] GL error during blur: 0x%x\n", error);
-		wlblur_fbo_pool_release(renderer->fbo_pool, final_fbo);
+		fprintf(stderr, "[wlblur] GL error during damage blur: 0x%x\n", error);
 		return 0;
 	}
 
-	return final_fbo->texture;
+	chain->params = *params;
+	chain->valid = true;
+
+	return chain->output->texture;
 }
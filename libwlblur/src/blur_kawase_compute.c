@@ -0,0 +1,329 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_kawase_compute.c - Compute Dual Kawase backend, one dispatch per stage
+ */
+
+#include "../private/internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Must match kawase_pyramid.comp.glsl */
+#define TILE 16
+#define CACHE_DIM 60
+#define KIND_DOWN_INPUT 0
+#define KIND_DOWN 1
+#define KIND_UP 2
+#define KIND_UP_FINISH 3
+
+/* Minimum GL_MAX_COMPUTE_WORK_GROUP_COUNT per dimension in GLES 3.1 */
+#define MAX_GROUPS_X 65535
+
+/**
+ * Stage table uploaded as uniform arrays (see kawase_pyramid.comp.glsl)
+ */
+struct stage_table {
+	int count;
+	GLint src[WLBLUR_COMPUTE_MAX_STAGES][4];    /* offset, width, height, kind */
+	GLint dst[WLBLUR_COMPUTE_MAX_STAGES][4];    /* offset, width, height, tile size */
+	GLint tiles[WLBLUR_COMPUTE_MAX_STAGES][2];  /* tile count, tiles_x */
+	GLfloat radius[WLBLUR_COMPUTE_MAX_STAGES];
+};
+
+/**
+ * Source texels one axis of a tile reads, including the shader's margins
+ */
+static float footprint(int tile, int src_size, int dst_size, float reach) {
+	float scale = (float)src_size / (float)dst_size;
+	float texels = (tile - 1) * scale + 2.0f * reach + 5.0f;
+	return texels < src_size ? texels : (float)src_size;
+}
+
+/**
+ * Largest tile (16, 8, ..., 1) whose source footprint fits the
+ * shared-memory cache. Only very large radii need less than 16.
+ */
+static int pick_tile(
+	int src_width, int src_height,
+	int dst_width, int dst_height,
+	float radius,
+	bool upsample
+) {
+	/* Tap reach in source texels: radius * halfpixel, doubled for upsample */
+	float factor = upsample ? 1.0f : 0.5f;
+	float reach_x = radius * factor * src_width / dst_width;
+	float reach_y = radius * factor * src_height / dst_height;
+
+	int tile = TILE;
+	while (tile > 1 &&
+	       (footprint(tile, src_width, dst_width, reach_x) > CACHE_DIM ||
+	        footprint(tile, src_height, dst_height, reach_y) > CACHE_DIM)) {
+		tile /= 2;
+	}
+	return tile;
+}
+
+/**
+ * Append one stage; offsets are in texels into the pyramid buffer
+ */
+static void add_stage(
+	struct stage_table *table,
+	int kind,
+	int src_offset, int src_width, int src_height,
+	int dst_offset, int dst_width, int dst_height,
+	float radius
+) {
+	int i = table->count++;
+	int tile = pick_tile(src_width, src_height, dst_width, dst_height,
+	                     radius, kind >= KIND_UP);
+	int tiles_x = (dst_width + tile - 1) / tile;
+	int tiles_y = (dst_height + tile - 1) / tile;
+
+	table->src[i][0] = src_offset;
+	table->src[i][1] = src_width;
+	table->src[i][2] = src_height;
+	table->src[i][3] = kind;
+
+	table->dst[i][0] = dst_offset;
+	table->dst[i][1] = dst_width;
+	table->dst[i][2] = dst_height;
+	table->dst[i][3] = tile;
+
+	table->tiles[i][0] = tiles_x * tiles_y;
+	table->tiles[i][1] = tiles_x;
+	table->radius[i] = radius;
+}
+
+/**
+ * Lay out the pyramid and build the stage table
+ *
+ * Mirrors wlblur_kawase_blur(): downsample level i is (width, height)
+ * >> i, upsample pass p writes the size of level p and uses radius + p.
+ *
+ * @return Pyramid buffer size in texels
+ */
+static int build_stages(
+	struct stage_table *table,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	int num_passes = params->num_passes;
+	int level_width[9], level_height[9];
+	int down_offset[9], up_offset[9];
+	int texels = 0;
+
+	level_width[0] = width;
+	level_height[0] = height;
+	for (int i = 1; i <= num_passes; i++) {
+		level_width[i] = width >> i;
+		level_height[i] = height >> i;
+		if (level_width[i] < 1) level_width[i] = 1;
+		if (level_height[i] < 1) level_height[i] = 1;
+
+		down_offset[i] = texels;
+		texels += level_width[i] * level_height[i];
+	}
+	for (int i = 1; i < num_passes; i++) {
+		up_offset[i] = texels;
+		texels += level_width[i] * level_height[i];
+	}
+
+	memset(table, 0, sizeof(*table));
+
+	/* === DOWNSAMPLE STAGES === */
+	for (int pass = 0; pass < num_passes; pass++) {
+		int src_offset = pass == 0 ? 0 : down_offset[pass];
+		add_stage(table, pass == 0 ? KIND_DOWN_INPUT : KIND_DOWN,
+		          src_offset, level_width[pass], level_height[pass],
+		          down_offset[pass + 1],
+		          level_width[pass + 1], level_height[pass + 1],
+		          params->radius + (float)pass);
+	}
+
+	/* === UPSAMPLE STAGES === */
+	for (int pass = num_passes - 1; pass >= 0; pass--) {
+		int src_offset = (pass == num_passes - 1) ?
+			down_offset[pass + 1] : up_offset[pass + 1];
+		add_stage(table, pass == 0 ? KIND_UP_FINISH : KIND_UP,
+		          src_offset, level_width[pass + 1], level_height[pass + 1],
+		          pass == 0 ? 0 : up_offset[pass],
+		          level_width[pass], level_height[pass],
+		          params->radius + (float)pass);
+	}
+
+	return texels;
+}
+
+struct wlblur_kawase_compute* wlblur_kawase_compute_create(
+	struct wlblur_kawase_renderer *renderer
+) {
+	if (!renderer) {
+		return NULL;
+	}
+
+	if (!wlblur_egl_make_current(renderer->egl_ctx)) {
+		fprintf(stderr, "[wlblur] Failed to make context current\n");
+		return NULL;
+	}
+
+	/* Compute shaders need GLES 3.1 */
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major < 3 || (major == 3 && minor < 1)) {
+		fprintf(stderr, "[wlblur] GLES %d.%d: compute backend unavailable\n",
+		        major, minor);
+		return NULL;
+	}
+
+	struct wlblur_kawase_compute *compute = calloc(1, sizeof(*compute));
+	if (!compute) {
+		fprintf(stderr, "[wlblur] Failed to allocate compute backend\n");
+		return NULL;
+	}
+
+	compute->renderer = renderer;
+
+	char *source = wlblur_shader_read_source("kawase_pyramid.comp.glsl");
+	if (!source) {
+		goto error;
+	}
+
+	compute->shader = wlblur_shader_load_compute_from_source(source);
+	free(source);
+	if (!compute->shader) {
+		fprintf(stderr, "[wlblur] Failed to load pyramid compute shader\n");
+		goto error;
+	}
+
+	GLuint program = compute->shader->program;
+	compute->u_stage = glGetUniformLocation(program, "stage");
+	compute->u_stage_src = glGetUniformLocation(program, "stage_src");
+	compute->u_stage_dst = glGetUniformLocation(program, "stage_dst");
+	compute->u_stage_tiles = glGetUniformLocation(program, "stage_tiles");
+	compute->u_stage_radius = glGetUniformLocation(program, "stage_radius");
+
+	glGenBuffers(1, &compute->pyramid_buffer);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error creating compute backend: 0x%x\n",
+		        error);
+		goto error;
+	}
+
+	fprintf(stderr, "[wlblur] Compute Kawase backend created successfully\n");
+	return compute;
+
+error:
+	wlblur_kawase_compute_destroy(compute);
+	return NULL;
+}
+
+void wlblur_kawase_compute_destroy(struct wlblur_kawase_compute *compute) {
+	if (!compute) {
+		return;
+	}
+
+	if (compute->shader) {
+		wlblur_shader_destroy(compute->shader);
+	}
+	if (compute->pyramid_buffer) {
+		glDeleteBuffers(1, &compute->pyramid_buffer);
+	}
+
+	free(compute);
+}
+
+GLuint wlblur_kawase_compute_blur(
+	struct wlblur_kawase_compute *compute,
+	GLuint input_texture,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params
+) {
+	if (!compute || !input_texture || width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid blur parameters\n");
+		return 0;
+	}
+
+	if (!wlblur_params_validate(params)) {
+		fprintf(stderr, "[wlblur] Invalid blur params\n");
+		return 0;
+	}
+
+	struct stage_table table;
+	int texels = build_stages(&table, width, height, params);
+
+	/* Grow the pyramid buffer; never shrinks */
+	GLsizeiptr pyramid_size = (GLsizeiptr)texels * sizeof(GLuint);
+	if (pyramid_size > compute->pyramid_size) {
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, compute->pyramid_buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, pyramid_size,
+		             NULL, GL_DYNAMIC_COPY);
+		compute->pyramid_size = pyramid_size;
+	}
+
+	struct wlblur_fbo *output = wlblur_fbo_pool_acquire(
+		compute->renderer->fbo_pool, width, height
+	);
+	if (!output) {
+		fprintf(stderr, "[wlblur] Failed to acquire output FBO\n");
+		return 0;
+	}
+
+	struct wlblur_shader_program *shader = compute->shader;
+	wlblur_shader_use(shader);
+
+	glUniform1i(shader->u_tex, 0);
+	glUniform1f(shader->u_brightness, params->brightness);
+	glUniform1f(shader->u_contrast, params->contrast);
+	glUniform1f(shader->u_saturation, params->saturation);
+	glUniform1f(shader->u_noise, params->noise);
+
+	glUniform4iv(compute->u_stage_src, table.count, &table.src[0][0]);
+	glUniform4iv(compute->u_stage_dst, table.count, &table.dst[0][0]);
+	glUniform2iv(compute->u_stage_tiles, table.count, &table.tiles[0][0]);
+	glUniform1fv(compute->u_stage_radius, table.count, table.radius);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, input_texture);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, compute->pyramid_buffer);
+	glBindImageTexture(0, output->texture, 0, GL_FALSE, 0,
+	                   GL_WRITE_ONLY, GL_RGBA8);
+
+	/*
+	 * One dispatch per stage: each stage reads the level the previous one
+	 * wrote, and workgroups of one dispatch cannot wait on each other
+	 */
+	for (int i = 0; i < table.count; i++) {
+		int tiles = table.tiles[i][0];
+		int groups_x = tiles < MAX_GROUPS_X ? tiles : MAX_GROUPS_X;
+		int groups_y = (tiles + groups_x - 1) / groups_x;
+
+		glUniform1i(compute->u_stage, i);
+		glDispatchCompute(groups_x, groups_y, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	/* Output is sampled, exported or read back next */
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT |
+	                GL_FRAMEBUFFER_BARRIER_BIT |
+	                GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+	glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR) {
+		fprintf(stderr, "[wlblur] GL error during compute blur: 0x%x\n", error);
+		wlblur_fbo_pool_release(compute->renderer->fbo_pool, output);
+		return 0;
+	}
+
+	return output->texture;
+}
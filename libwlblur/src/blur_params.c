@@ -24,6 +24,7 @@ struct wlblur_blur_params wlblur_params_default(void) {
         .tint_g = 0.0f,
         .tint_b = 0.0f,
         .tint_a = 0.0f,
+        .box_iterations = 1,
     };
 }
 
@@ -41,6 +42,7 @@ struct wlblur_blur_params wlblur_params_from_preset(enum wlblur_preset preset) {
             .vibrancy = 0.0f,
             .vibrancy_darkness = 0.0f,
             .tint_r = 0.0f, .tint_g = 0.0f, .tint_b = 0.0f, .tint_a = 0.0f,
+            .box_iterations = 1,
         };
 
     case WLBLUR_PRESET_HYPRLAND_DEFAULT:
@@ -56,6 +58,7 @@ struct wlblur_blur_params wlblur_params_from_preset(enum wlblur_preset preset) {
             .vibrancy = 0.0f,  // Can be enabled separately
             .vibrancy_darkness = 0.0f,
             .tint_r = 0.0f, .tint_g = 0.0f, .tint_b = 0.0f, .tint_a = 0.0f,
+            .box_iterations = 1,
         };
 
     case WLBLUR_PRESET_WAYFIRE_DEFAULT:
@@ -70,6 +73,7 @@ struct wlblur_blur_params wlblur_params_from_preset(enum wlblur_preset preset) {
             .vibrancy = 0.0f,
             .vibrancy_darkness = 0.0f,
             .tint_r = 0.0f, .tint_g = 0.0f, .tint_b = 0.0f, .tint_a = 0.0f,
+            .box_iterations = 1,
         };
 
     case WLBLUR_PRESET_CUSTOM:
@@ -80,8 +84,11 @@ struct wlblur_blur_params wlblur_params_from_preset(enum wlblur_preset preset) {
 
 bool wlblur_params_validate(const struct wlblur_blur_params *params) {
     // Core algorithm
+    if (params->algorithm < WLBLUR_ALGO_KAWASE ||
+        params->algorithm > WLBLUR_ALGO_IIR) return false;
     if (params->num_passes < 1 || params->num_passes > 8) return false;
     if (params->radius < 1.0f || params->radius > 20.0f) return false;
+    if (params->box_iterations < 0 || params->box_iterations > 4) return false;
 
     // Post-processing
     if (params->brightness < 0.0f || params->brightness > 2.0f) return false;
@@ -108,8 +115,59 @@ struct wlblur_blur_computed wlblur_params_compute(
     // Formula from SceneFX: blur_size = 2^(passes+1) * radius
     int blur_size = (int)(powf(2.0f, params->num_passes + 1) * params->radius);
 
+    // Sampling footprint of the Kawase chain in full-resolution pixels.
+    // Pass i reads its source (scale 2^i) with taps up to (radius + i)
+    // texels away plus one bilinear texel; the matching upsample pass
+    // reaches (radius + i) target texels plus one source texel (2^(i+1)).
+    int footprint = 0;
+    for (int i = 0; i < params->num_passes; i++) {
+        float down = (params->radius + i + 1.0f) * (float)(1 << i);
+        float up = (params->radius + i) * (float)(1 << i) + (float)(2 << i);
+        footprint += (int)ceilf(down + up);
+    }
+
+    // Equivalent Gaussian, fitted to the Kawase edge response: each
+    // pass adds its tap spread (radius + i at scale 2^i) plus a constant
+    // from the bilinear resampling at that level
+    float variance = 0.0f;
+    for (int i = 0; i < params->num_passes; i++) {
+        float spread = (params->radius + i) * (float)(1 << i);
+        variance += 0.834f * spread * spread + 0.85f * (float)(1 << (2 * i));
+    }
+    float sigma = sqrtf(variance);
+
+    // A separable Gaussian reads 3 sigma plus the resampling margins
+    if (params->algorithm == WLBLUR_ALGO_GAUSSIAN) {
+        footprint = (int)ceilf(4.0f * sigma) + 2;
+    }
+
+    // n boxes of variance sigma²/n reach sqrt(3 n) sigma, plus rounding
+    // each box width up to the next odd size
+    if (params->algorithm == WLBLUR_ALGO_BOX) {
+        int n = params->box_iterations > 1 ? params->box_iterations : 1;
+        footprint = (int)ceilf(sqrtf(3.0f * n) * sigma) + n;
+    }
+
+    // A hexagon of circumradius sqrt(24/5) sigma, plus two texels of
+    // resampling at the working level, which is at most R/16 pixels wide
+    // (taps stay a texel apart) and at least 2
+    if (params->algorithm == WLBLUR_ALGO_BOKEH) {
+        float hexagon = sqrtf(24.0f / 5.0f) * sigma;
+        float margin = hexagon / 8.0f > 4.0f ? hexagon / 8.0f : 4.0f;
+        footprint = (int)ceilf(hexagon + margin);
+    }
+
+    // The recursion's response is below 8-bit precision past 4 sigma;
+    // block averaging and upsampling add two blocks of at most sigma/8
+    if (params->algorithm == WLBLUR_ALGO_IIR) {
+        float margin = sigma / 4.0f > 2.0f ? sigma / 4.0f : 2.0f;
+        footprint = (int)ceilf(4.0f * sigma + margin);
+    }
+
     return (struct wlblur_blur_computed){
         .blur_size = blur_size,
-        .damage_expand = blur_size,  // Damage must expand by full blur radius
+        // Damage must expand by whatever the blur can actually read
+        .damage_expand = footprint > blur_size ? footprint : blur_size,
+        .sigma = sigma,
     };
 }
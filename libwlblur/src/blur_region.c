@@ -0,0 +1,106 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_region.c - Region-of-interest cropping
+ */
+
+#include "../private/internal.h"
+#include <stdio.h>
+
+static int32_t clamp_i32(int32_t value, int32_t min, int32_t max) {
+	return value < min ? min : value > max ? max : value;
+}
+
+bool wlblur_rect_is_full(const struct wlblur_rect *rect, int width, int height) {
+	return rect->x1 <= 0 && rect->y1 <= 0 &&
+	       rect->x2 >= width && rect->y2 >= height;
+}
+
+bool wlblur_region_compute(
+	const struct wlblur_rect *source,
+	int width,
+	int height,
+	const struct wlblur_blur_params *params,
+	struct wlblur_region *region
+) {
+	struct wlblur_rect full = { 0, 0, width, height };
+
+	if (!source || source->x2 <= source->x1 || source->y2 <= source->y1) {
+		region->source = full;
+		region->crop = full;
+		return true;
+	}
+
+	struct wlblur_rect *s = &region->source;
+	s->x1 = clamp_i32(source->x1, 0, width);
+	s->y1 = clamp_i32(source->y1, 0, height);
+	s->x2 = clamp_i32(source->x2, 0, width);
+	s->y2 = clamp_i32(source->y2, 0, height);
+	if (s->x2 <= s->x1 || s->y2 <= s->y1) {
+		return false;
+	}
+
+	// Everything the blur reads for the source, rounded out to whole
+	// texels of the smallest pyramid level
+	int32_t expand = wlblur_params_compute(params).damage_expand;
+	int32_t align = 1 << params->num_passes;
+	struct wlblur_rect *c = &region->crop;
+	c->x1 = clamp_i32((s->x1 - expand) / align * align, 0, width);
+	c->y1 = clamp_i32((s->y1 - expand) / align * align, 0, height);
+	c->x2 = clamp_i32((s->x2 + expand + align - 1) / align * align, 0, width);
+	c->y2 = clamp_i32((s->y2 + expand + align - 1) / align * align, 0, height);
+
+	return true;
+}
+
+bool wlblur_region_copy_to(
+	GLuint texture,
+	const struct wlblur_rect *rect,
+	struct wlblur_fbo *target
+) {
+	GLuint read_fbo;
+	glGenFramebuffers(1, &read_fbo);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+
+	if (glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) !=
+	    GL_FRAMEBUFFER_COMPLETE) {
+		fprintf(stderr, "[wlblur] Source texture is not readable\n");
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &read_fbo);
+		return false;
+	}
+
+	// Same size on both sides, so this is a plain texel copy
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->fbo);
+	glBlitFramebuffer(rect->x1, rect->y1, rect->x2, rect->y2,
+	                  0, 0, target->width, target->height,
+	                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &read_fbo);
+
+	return true;
+}
+
+struct wlblur_fbo* wlblur_region_copy(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture,
+	const struct wlblur_rect *rect
+) {
+	struct wlblur_fbo *target = wlblur_fbo_pool_acquire(pool,
+		rect->x2 - rect->x1, rect->y2 - rect->y1);
+	if (!target) {
+		return NULL;
+	}
+
+	if (!wlblur_region_copy_to(texture, rect, target)) {
+		wlblur_fbo_pool_release(pool, target);
+		return NULL;
+	}
+
+	return target;
+}
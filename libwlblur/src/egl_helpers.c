@@ -75,25 +75,31 @@ struct wlblur_egl_context* wlblur_egl_create(void) {
 		goto error_terminate;
 	}
 
-	/* Check for DMA-BUF import */
+	/*
+	 * DMA-BUF import/export: optional here, texture-level rendering works
+	 * without them. wlblur_context_create() and dmabuf.c check the flags.
+	 */
 	ctx->has_dmabuf_import =
 		check_egl_extension(egl_exts, "EGL_EXT_image_dma_buf_import") &&
 		check_egl_extension(egl_exts, "EGL_KHR_image_base");
 
 	if (!ctx->has_dmabuf_import) {
 		fprintf(stderr, "[wlblur] DMA-BUF import extensions not available\n");
-		goto error_terminate;
 	}
 
-	/* Check for DMA-BUF export */
 	ctx->has_dmabuf_export =
 		check_egl_extension(egl_exts, "EGL_MESA_image_dma_buf_export");
 
 	if (!ctx->has_dmabuf_export) {
 		fprintf(stderr, "[wlblur] DMA-BUF export extension not available\n");
-		goto error_terminate;
 	}
 
+	/* Optional: explicit synchronization */
+	ctx->has_fence_sync = check_egl_extension(egl_exts, "EGL_KHR_fence_sync");
+	ctx->has_wait_sync = check_egl_extension(egl_exts, "EGL_KHR_wait_sync");
+	ctx->has_native_fence = ctx->has_fence_sync &&
+		check_egl_extension(egl_exts, "EGL_ANDROID_native_fence_sync");
+
 	/* Bind OpenGL ES API */
 	if (!eglBindAPI(EGL_OPENGL_ES_API)) {
 		fprintf(stderr, "[wlblur] Failed to bind OpenGL ES API: 0x%x\n",
@@ -155,15 +161,41 @@ struct wlblur_egl_context* wlblur_egl_create(void) {
 	ctx->glEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)
 		eglGetProcAddress("glEGLImageTargetTexture2DOES");
 
-	if (!ctx->eglCreateImageKHR || !ctx->eglDestroyImageKHR ||
-	    !ctx->glEGLImageTargetTexture2DOES) {
-		fprintf(stderr, "[wlblur] Failed to load required extension functions\n");
-		goto error_context;
+	if (ctx->has_dmabuf_import &&
+	    (!ctx->eglCreateImageKHR || !ctx->eglDestroyImageKHR ||
+	     !ctx->glEGLImageTargetTexture2DOES)) {
+		fprintf(stderr, "[wlblur] Failed to load DMA-BUF import functions\n");
+		ctx->has_dmabuf_import = false;
 	}
 
-	if (!ctx->eglExportDMABUFImageMESA || !ctx->eglExportDMABUFImageQueryMESA) {
+	if (ctx->has_dmabuf_export &&
+	    (!ctx->eglCreateImageKHR || !ctx->eglDestroyImageKHR ||
+	     !ctx->eglExportDMABUFImageMESA ||
+	     !ctx->eglExportDMABUFImageQueryMESA)) {
 		fprintf(stderr, "[wlblur] Failed to load DMA-BUF export functions\n");
-		goto error_context;
+		ctx->has_dmabuf_export = false;
+	}
+
+	if (ctx->has_fence_sync) {
+		ctx->eglCreateSyncKHR = (PFNEGLCREATESYNCKHRPROC)
+			eglGetProcAddress("eglCreateSyncKHR");
+		ctx->eglDestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC)
+			eglGetProcAddress("eglDestroySyncKHR");
+		ctx->eglClientWaitSyncKHR = (PFNEGLCLIENTWAITSYNCKHRPROC)
+			eglGetProcAddress("eglClientWaitSyncKHR");
+		ctx->has_fence_sync = ctx->eglCreateSyncKHR &&
+			ctx->eglDestroySyncKHR && ctx->eglClientWaitSyncKHR;
+	}
+	if (ctx->has_wait_sync) {
+		ctx->eglWaitSyncKHR = (PFNEGLWAITSYNCKHRPROC)
+			eglGetProcAddress("eglWaitSyncKHR");
+		ctx->has_wait_sync = ctx->eglWaitSyncKHR != NULL;
+	}
+	if (ctx->has_native_fence) {
+		ctx->eglDupNativeFenceFDANDROID = (PFNEGLDUPNATIVEFENCEFDANDROIDPROC)
+			eglGetProcAddress("eglDupNativeFenceFDANDROID");
+		ctx->has_native_fence = ctx->has_fence_sync &&
+			ctx->eglDupNativeFenceFDANDROID != NULL;
 	}
 
 	/* Verify GL version */
@@ -171,6 +203,11 @@ struct wlblur_egl_context* wlblur_egl_create(void) {
 	fprintf(stderr, "[wlblur] OpenGL ES version: %s\n",
 	        gl_version ? gl_version : "unknown");
 
+	/* Lets shader variants compile in the background */
+	const char *gl_exts = (const char *)glGetString(GL_EXTENSIONS);
+	ctx->has_parallel_compile = gl_exts &&
+		strstr(gl_exts, "GL_KHR_parallel_shader_compile") != NULL;
+
 	/* Check for GL errors */
 	GLenum gl_error = glGetError();
 	if (gl_error != GL_NO_ERROR) {
@@ -196,6 +233,9 @@ void wlblur_egl_destroy(struct wlblur_egl_context *ctx) {
 		return;
 	}
 
+	/* Pending fences reference the display */
+	wlblur_fence_worker_destroy(ctx->fence_worker);
+
 	if (ctx->display != EGL_NO_DISPLAY) {
 		eglMakeCurrent(ctx->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
 		               EGL_NO_CONTEXT);
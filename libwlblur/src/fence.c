@@ -0,0 +1,280 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * fence.c - Explicit synchronization (sync_file / eventfd fences)
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../private/internal.h"
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/**
+ * EGL fence waiting to be signalled through an eventfd
+ */
+struct fence_job {
+	EGLSyncKHR sync;
+	int event_fd;  // Worker's copy
+	struct fence_job *next;
+};
+
+/**
+ * Thread that waits on EGL fences in submission order
+ *
+ * EGL_KHR_fence_sync has no FD of its own, so this turns each fence into
+ * an eventfd the compositor can poll.
+ */
+struct wlblur_fence_worker {
+	struct wlblur_egl_context *egl;
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	struct fence_job *head;
+	struct fence_job *tail;
+	bool stop;
+};
+
+static void* fence_worker_run(void *data) {
+	struct wlblur_fence_worker *worker = data;
+	struct wlblur_egl_context *egl = worker->egl;
+
+	pthread_mutex_lock(&worker->lock);
+	for (;;) {
+		while (!worker->head && !worker->stop) {
+			pthread_cond_wait(&worker->cond, &worker->lock);
+		}
+		if (!worker->head) {
+			break;  // Stopped and drained
+		}
+
+		struct fence_job *job = worker->head;
+		worker->head = job->next;
+		if (!worker->head) {
+			worker->tail = NULL;
+		}
+		pthread_mutex_unlock(&worker->lock);
+
+		// Submitter flushed, so this needs no current context
+		egl->eglClientWaitSyncKHR(egl->display, job->sync, 0,
+		                          EGL_FOREVER_KHR);
+		egl->eglDestroySyncKHR(egl->display, job->sync);
+
+		uint64_t one = 1;
+		if (write(job->event_fd, &one, sizeof(one)) != sizeof(one)) {
+			fprintf(stderr, "[wlblur] Failed to signal fence eventfd\n");
+		}
+		close(job->event_fd);
+		free(job);
+
+		pthread_mutex_lock(&worker->lock);
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	return NULL;
+}
+
+static struct wlblur_fence_worker* fence_worker_get(
+	struct wlblur_egl_context *egl
+) {
+	if (egl->fence_worker) {
+		return egl->fence_worker;
+	}
+
+	struct wlblur_fence_worker *worker = calloc(1, sizeof(*worker));
+	if (!worker) {
+		return NULL;
+	}
+
+	worker->egl = egl;
+	pthread_mutex_init(&worker->lock, NULL);
+	pthread_cond_init(&worker->cond, NULL);
+
+	if (pthread_create(&worker->thread, NULL, fence_worker_run, worker) != 0) {
+		fprintf(stderr, "[wlblur] Failed to start fence worker\n");
+		pthread_cond_destroy(&worker->cond);
+		pthread_mutex_destroy(&worker->lock);
+		free(worker);
+		return NULL;
+	}
+
+	egl->fence_worker = worker;
+	return worker;
+}
+
+void wlblur_fence_worker_destroy(struct wlblur_fence_worker *worker) {
+	if (!worker) {
+		return;
+	}
+
+	pthread_mutex_lock(&worker->lock);
+	worker->stop = true;
+	pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+
+	pthread_join(worker->thread, NULL);
+	pthread_cond_destroy(&worker->cond);
+	pthread_mutex_destroy(&worker->lock);
+	free(worker);
+}
+
+/**
+ * Export a sync_file for the work submitted so far
+ */
+static int export_native(struct wlblur_egl_context *egl) {
+	EGLSyncKHR sync = egl->eglCreateSyncKHR(egl->display,
+	                                        EGL_SYNC_NATIVE_FENCE_ANDROID,
+	                                        NULL);
+	if (sync == EGL_NO_SYNC_KHR) {
+		return -1;
+	}
+
+	// The sync_file only exists once the fence is submitted
+	glFlush();
+
+	int fd = egl->eglDupNativeFenceFDANDROID(egl->display, sync);
+	egl->eglDestroySyncKHR(egl->display, sync);
+
+	return fd == EGL_NO_NATIVE_FENCE_FD_ANDROID ? -1 : fd;
+}
+
+/**
+ * Export an eventfd the fence worker signals for the work submitted so far
+ */
+static int export_eventfd(struct wlblur_egl_context *egl) {
+	struct wlblur_fence_worker *worker = fence_worker_get(egl);
+	if (!worker) {
+		return -1;
+	}
+
+	struct fence_job *job = calloc(1, sizeof(*job));
+	if (!job) {
+		return -1;
+	}
+
+	int fd = eventfd(0, EFD_CLOEXEC);
+	if (fd < 0) {
+		free(job);
+		return -1;
+	}
+
+	job->event_fd = dup(fd);
+	job->sync = egl->eglCreateSyncKHR(egl->display, EGL_SYNC_FENCE_KHR, NULL);
+	if (job->event_fd < 0 || job->sync == EGL_NO_SYNC_KHR) {
+		if (job->sync != EGL_NO_SYNC_KHR) {
+			egl->eglDestroySyncKHR(egl->display, job->sync);
+		}
+		if (job->event_fd >= 0) {
+			close(job->event_fd);
+		}
+		close(fd);
+		free(job);
+		return -1;
+	}
+
+	// The worker waits without a context, so submit the fence here
+	glFlush();
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->tail) {
+		worker->tail->next = job;
+	} else {
+		worker->head = job;
+	}
+	worker->tail = job;
+	pthread_cond_signal(&worker->cond);
+	pthread_mutex_unlock(&worker->lock);
+
+	return fd;
+}
+
+int wlblur_fence_export(
+	struct wlblur_egl_context *ctx,
+	bool native,
+	enum wlblur_fence_type *type
+) {
+	*type = WLBLUR_FENCE_NONE;
+	if (!ctx || !ctx->has_fence_sync) {
+		return -1;
+	}
+
+	if (native && ctx->has_native_fence) {
+		int fd = export_native(ctx);
+		if (fd >= 0) {
+			*type = WLBLUR_FENCE_SYNC_FILE;
+			return fd;
+		}
+	}
+
+	int fd = export_eventfd(ctx);
+	if (fd < 0) {
+		fprintf(stderr, "[wlblur] Failed to create fence\n");
+		return -1;
+	}
+
+	*type = WLBLUR_FENCE_EVENTFD;
+	return fd;
+}
+
+/**
+ * Queue a GPU-side wait for a sync_file; takes the FD on success
+ */
+static bool wait_native(struct wlblur_egl_context *egl, int fence_fd) {
+	if (!egl->has_native_fence || !egl->has_wait_sync) {
+		return false;
+	}
+
+	EGLint attribs[] = {
+		EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fence_fd,
+		EGL_NONE,
+	};
+	EGLSyncKHR sync = egl->eglCreateSyncKHR(egl->display,
+	                                        EGL_SYNC_NATIVE_FENCE_ANDROID,
+	                                        attribs);
+	if (sync == EGL_NO_SYNC_KHR) {
+		return false;
+	}
+
+	// Fence FD now belongs to the sync
+	egl->eglWaitSyncKHR(egl->display, sync, 0);
+	egl->eglDestroySyncKHR(egl->display, sync);
+	return true;
+}
+
+bool wlblur_fence_wait(
+	struct wlblur_egl_context *ctx,
+	int fence_fd,
+	enum wlblur_fence_type type
+) {
+	if (fence_fd < 0) {
+		return true;
+	}
+
+	if (ctx && type == WLBLUR_FENCE_SYNC_FILE && wait_native(ctx, fence_fd)) {
+		return true;
+	}
+
+	// Both sync_files and eventfds turn readable once signalled
+	struct pollfd pfd = { .fd = fence_fd, .events = POLLIN };
+	int ret;
+	do {
+		ret = poll(&pfd, 1, WLBLUR_FENCE_TIMEOUT_MS);
+	} while (ret < 0 && errno == EINTR);
+	close(fence_fd);
+
+	if (ret <= 0) {
+		fprintf(stderr, "[wlblur] %s waiting for fence\n",
+		        ret == 0 ? "Timed out" : "Failed");
+		return false;
+	}
+
+	return true;
+}
@@ -12,7 +12,39 @@
 #include <string.h>
 
 struct wlblur_fbo* wlblur_fbo_create(int width, int height) {
-	if (width <= 0 || height <= 0) {
+	return wlblur_fbo_create_format(width, height, GL_RGBA8);
+}
+
+/**
+ * Whether a sized internal format is an integer format (unfilterable)
+ */
+static bool is_integer_format(GLenum internal_format) {
+	switch (internal_format) {
+	case GL_RGBA32UI:
+	case GL_RGBA16UI:
+	case GL_RGBA8UI:
+	case GL_R32UI:
+		return true;
+	default:
+		return false;
+	}
+}
+
+struct wlblur_fbo* wlblur_fbo_create_format(
+	int width,
+	int height,
+	GLenum internal_format
+) {
+	return wlblur_fbo_create_levels(width, height, internal_format, 1);
+}
+
+struct wlblur_fbo* wlblur_fbo_create_levels(
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+) {
+	if (width <= 0 || height <= 0 || levels < 1) {
 		fprintf(stderr, "[wlblur] Invalid FBO dimensions: %dx%d\n",
 		        width, height);
 		return NULL;
@@ -26,16 +58,21 @@ struct wlblur_fbo* wlblur_fbo_create(int width, int height) {
 
 	fbo->width = width;
 	fbo->height = height;
+	fbo->alloc_width = width;
+	fbo->alloc_height = height;
+	fbo->format = internal_format;
+	fbo->levels = levels;
 	fbo->in_use = false;
 
 	/* Create texture */
 	glGenTextures(1, &fbo->texture);
 	glBindTexture(GL_TEXTURE_2D, fbo->texture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8,
-	             width, height, 0,
-	             GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	/* Immutable storage so the compute backend can bind it as an image */
+	glTexStorage2D(GL_TEXTURE_2D, levels, internal_format, width, height);
+	/* Integer textures are incomplete with GL_LINEAR, even for texelFetch */
+	GLint filter = is_integer_format(internal_format) ? GL_NEAREST : GL_LINEAR;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
@@ -67,6 +104,36 @@ struct wlblur_fbo* wlblur_fbo_create(int width, int height) {
 	return fbo;
 }
 
+int wlblur_fbo_size_class(int size) {
+	int step = 64;
+	while (step * 16 < size) {
+		step <<= 1;
+	}
+	return (size + step - 1) / step * step;
+}
+
+struct wlblur_fbo* wlblur_fbo_create_class(
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+) {
+	if (width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid FBO dimensions: %dx%d\n",
+		        width, height);
+		return NULL;
+	}
+
+	struct wlblur_fbo *fbo = wlblur_fbo_create_levels(
+		wlblur_fbo_size_class(width), wlblur_fbo_size_class(height),
+		internal_format, levels);
+	if (fbo) {
+		fbo->width = width;
+		fbo->height = height;
+	}
+	return fbo;
+}
+
 void wlblur_fbo_destroy(struct wlblur_fbo *fbo) {
 	if (!fbo) {
 		return;
@@ -82,18 +149,122 @@ void wlblur_fbo_destroy(struct wlblur_fbo *fbo) {
 	free(fbo);
 }
 
+struct wlblur_fbo wlblur_fbo_atlas_level(const struct wlblur_fbo *atlas,
+                                         int level) {
+	struct wlblur_fbo view = *atlas;
+	view.level = level;
+	view.width = atlas->width >> level;
+	view.height = atlas->height >> level;
+	view.alloc_width = atlas->alloc_width >> level;
+	view.alloc_height = atlas->alloc_height >> level;
+	if (view.width < 1) view.width = 1;
+	if (view.height < 1) view.height = 1;
+	if (view.alloc_width < 1) view.alloc_width = 1;
+	if (view.alloc_height < 1) view.alloc_height = 1;
+	return view;
+}
+
 void wlblur_fbo_bind(struct wlblur_fbo *fbo) {
 	if (!fbo) {
 		return;
 	}
 
 	glBindFramebuffer(GL_FRAMEBUFFER, fbo->fbo);
+
+	/* Atlas levels share one framebuffer */
+	if (fbo->levels > 1) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+		                       GL_TEXTURE_2D, fbo->texture, fbo->level);
+	}
 }
 
 void wlblur_fbo_unbind(void) {
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+/**
+ * Bytes per texel of a sized internal format used for pool FBOs
+ */
+static size_t format_bytes(GLenum internal_format) {
+	switch (internal_format) {
+	case GL_RGBA32UI:
+	case GL_RGBA32F:
+		return 16;
+	case GL_RGBA16UI:
+	case GL_RGBA16F:
+		return 8;
+	default:
+		return 4;  /* RGBA8, RGB10_A2, R11F_G11F_B10F, R32UI, ... */
+	}
+}
+
+/**
+ * Texture memory of a size and format, summed over mip levels
+ */
+static size_t texture_bytes(int width, int height, GLenum internal_format,
+                            int levels) {
+	size_t texels = 0;
+	for (int i = 0; i < levels; i++) {
+		int level_width = width >> i;
+		int level_height = height >> i;
+		texels += (size_t)(level_width > 0 ? level_width : 1) *
+		          (level_height > 0 ? level_height : 1);
+	}
+	return texels * format_bytes(internal_format);
+}
+
+static size_t fbo_bytes(const struct wlblur_fbo *fbo) {
+	return texture_bytes(fbo->alloc_width, fbo->alloc_height, fbo->format,
+	                     fbo->levels);
+}
+
+/**
+ * Destroy the pooled FBO at index i
+ */
+static void pool_remove(struct wlblur_fbo_pool *pool, int i) {
+	pool->bytes -= fbo_bytes(pool->fbos[i]);
+	if (pool->fbos[i]->in_use) {
+		pool->in_use -= fbo_bytes(pool->fbos[i]);
+	}
+	wlblur_fbo_destroy(pool->fbos[i]);
+	pool->fbos[i] = pool->fbos[--pool->count];
+	pool->fbos[pool->count] = NULL;
+}
+
+/**
+ * Hand out a pooled FBO, raising the in-use watermark
+ */
+static void pool_use(struct wlblur_fbo_pool *pool, struct wlblur_fbo *fbo,
+                     uint64_t now) {
+	fbo->in_use = true;
+	fbo->last_use = now;
+	pool->in_use += fbo_bytes(fbo);
+	if (pool->in_use > pool->peak) {
+		pool->peak = pool->in_use;
+	}
+}
+
+/**
+ * Drop idle FBOs, least recently used first, until reserve more bytes
+ * fit in the budget
+ */
+static void pool_trim(struct wlblur_fbo_pool *pool, size_t reserve) {
+	while (pool->bytes + reserve > pool->budget) {
+		int lru = -1;
+		for (int i = 0; i < pool->count; i++) {
+			struct wlblur_fbo *fbo = pool->fbos[i];
+			if (!fbo->in_use &&
+			    (lru < 0 || fbo->last_use < pool->fbos[lru]->last_use)) {
+				lru = i;
+			}
+		}
+		if (lru < 0) {
+			return;  /* Everything left is in use */
+		}
+		pool_remove(pool, lru);
+	}
+}
+
 struct wlblur_fbo_pool* wlblur_fbo_pool_create(void) {
 	struct wlblur_fbo_pool *pool = calloc(1, sizeof(*pool));
 	if (!pool) {
@@ -101,8 +272,7 @@ struct wlblur_fbo_pool* wlblur_fbo_pool_create(void) {
 		return NULL;
 	}
 
-	pool->count = 0;
-	memset(pool->fbos, 0, sizeof(pool->fbos));
+	pool->budget = WLBLUR_FBO_POOL_BUDGET;
 
 	return pool;
 }
@@ -117,54 +287,182 @@ void wlblur_fbo_pool_destroy(struct wlblur_fbo_pool *pool) {
 		wlblur_fbo_destroy(pool->fbos[i]);
 	}
 
+	free(pool->fbos);
 	free(pool);
 }
 
+void wlblur_fbo_pool_set_budget(struct wlblur_fbo_pool *pool, size_t bytes) {
+	if (!pool) {
+		return;
+	}
+
+	pool->budget = bytes;
+	pool_trim(pool, 0);
+}
+
 struct wlblur_fbo* wlblur_fbo_pool_acquire(
 	struct wlblur_fbo_pool *pool,
 	int width,
 	int height
+) {
+	return wlblur_fbo_pool_acquire_format(pool, width, height, GL_RGBA8);
+}
+
+struct wlblur_fbo* wlblur_fbo_pool_acquire_format(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format
+) {
+	return wlblur_fbo_pool_acquire_levels(pool, width, height,
+	                                      internal_format, 1);
+}
+
+/**
+ * Acquire an FBO whose texture is alloc_width x alloc_height, with
+ * width x height in use
+ */
+static struct wlblur_fbo* pool_acquire(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	int alloc_width,
+	int alloc_height,
+	GLenum internal_format,
+	int levels
 ) {
 	if (!pool) {
 		return NULL;
 	}
 
-	/* Try to find existing FBO with matching dimensions */
+	uint64_t now = ++pool->clock;
+
+	/* Sizes nobody asked for in a while (e.g. from a window resize) */
+	for (int i = pool->count - 1; i >= 0; i--) {
+		struct wlblur_fbo *fbo = pool->fbos[i];
+		if (!fbo->in_use && now - fbo->last_use > WLBLUR_FBO_POOL_MAX_IDLE) {
+			pool_remove(pool, i);
+		}
+	}
+
+	/* Try to find existing FBO with matching storage and format */
 	for (int i = 0; i < pool->count; i++) {
 		struct wlblur_fbo *fbo = pool->fbos[i];
-		if (fbo && !fbo->in_use &&
-		    fbo->width == width && fbo->height == height) {
-			fbo->in_use = true;
+		if (!fbo->in_use &&
+		    fbo->alloc_width == alloc_width &&
+		    fbo->alloc_height == alloc_height &&
+		    fbo->format == internal_format && fbo->levels == levels) {
+			fbo->width = width;
+			fbo->height = height;
+			pool_use(pool, fbo, now);
 			return fbo;
 		}
 	}
 
-	/* No matching FBO found, create new one */
-	if (pool->count >= WLBLUR_FBO_POOL_SIZE) {
-		fprintf(stderr, "[wlblur] FBO pool exhausted (max %d)\n",
-		        WLBLUR_FBO_POOL_SIZE);
-		return NULL;
+	/* No matching FBO found: make room within the budget, then create */
+	size_t bytes = texture_bytes(alloc_width, alloc_height, internal_format,
+	                             levels);
+	pool_trim(pool, bytes);
+
+	if (pool->count == pool->capacity) {
+		int capacity = pool->capacity ? pool->capacity * 2 : 16;
+		struct wlblur_fbo **fbos = realloc(pool->fbos,
+		                                   capacity * sizeof(*fbos));
+		if (!fbos) {
+			fprintf(stderr, "[wlblur] Failed to grow FBO pool\n");
+			return NULL;
+		}
+		pool->fbos = fbos;
+		pool->capacity = capacity;
 	}
 
-	struct wlblur_fbo *fbo = wlblur_fbo_create(width, height);
+	struct wlblur_fbo *fbo = wlblur_fbo_create_levels(alloc_width,
+	                                                  alloc_height,
+	                                                  internal_format, levels);
 	if (!fbo) {
 		return NULL;
 	}
+	fbo->width = width;
+	fbo->height = height;
 
-	fbo->in_use = true;
 	pool->fbos[pool->count++] = fbo;
+	pool->bytes += bytes;
+	pool_use(pool, fbo, now);
 
 	return fbo;
 }
 
+struct wlblur_fbo* wlblur_fbo_pool_acquire_levels(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+) {
+	return pool_acquire(pool, width, height, width, height,
+	                    internal_format, levels);
+}
+
+struct wlblur_fbo* wlblur_fbo_pool_acquire_class(
+	struct wlblur_fbo_pool *pool,
+	int width,
+	int height,
+	GLenum internal_format,
+	int levels
+) {
+	if (width <= 0 || height <= 0) {
+		fprintf(stderr, "[wlblur] Invalid FBO dimensions: %dx%d\n",
+		        width, height);
+		return NULL;
+	}
+
+	return pool_acquire(pool, width, height, wlblur_fbo_size_class(width),
+	                    wlblur_fbo_size_class(height), internal_format,
+	                    levels);
+}
+
 void wlblur_fbo_pool_release(
 	struct wlblur_fbo_pool *pool,
 	struct wlblur_fbo *fbo
 ) {
-	if (!pool || !fbo) {
+	if (!pool || !fbo || !fbo->in_use) {
 		return;
 	}
 
-	/* Mark FBO as not in use */
+	/* Mark FBO as not in use; it stays pooled while within budget */
 	fbo->in_use = false;
+	pool->in_use -= fbo_bytes(fbo);
+	pool_trim(pool, 0);
+}
+
+void wlblur_fbo_pool_release_texture(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture
+) {
+	if (!pool) {
+		return;
+	}
+
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+			return;
+		}
+	}
+}
+
+void wlblur_fbo_pool_detach_texture(
+	struct wlblur_fbo_pool *pool,
+	GLuint texture
+) {
+	if (!pool) {
+		return;
+	}
+
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			pool_remove(pool, i);
+			return;
+		}
+	}
 }
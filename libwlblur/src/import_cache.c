@@ -0,0 +1,179 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * import_cache.c - Cache of imported input textures
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../private/internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/**
+ * Identity of an imported buffer
+ *
+ * FD numbers change from call to call, so planes are keyed by the
+ * dma-buf inode behind them. A cached texture holds a reference to the
+ * dma-buf, so its inode cannot be reused for another buffer while the
+ * entry lives. The same reference keeps the inode alive after the
+ * compositor frees the buffer, so entries are never invalidated by the
+ * buffer going away: they are dropped when least recently used, idle for
+ * WLBLUR_IMPORT_CACHE_MAX_IDLE_MS, or cleared.
+ */
+struct import_key {
+	dev_t dev[4];
+	ino_t ino[4];
+	uint32_t offset[4];
+	uint32_t stride[4];
+	int width;
+	int height;
+	int num_planes;
+	uint32_t format;
+	uint64_t modifier;
+};
+
+struct import_entry {
+	struct import_key key;
+	GLuint texture;
+	uint64_t last_use;     // Cache clock at last hit
+	uint64_t last_use_ms;  // Monotonic time at last hit
+};
+
+struct wlblur_import_cache {
+	struct import_entry entries[WLBLUR_IMPORT_CACHE_SIZE];
+	int count;
+	uint64_t clock;  // Lookups so far
+	struct wlblur_import_stats stats;
+};
+
+static bool make_key(
+	const struct wlblur_dmabuf_attribs *attribs,
+	struct import_key *key
+) {
+	if (attribs->num_planes < 1 || attribs->num_planes > 4) {
+		return false;
+	}
+
+	// Zeroed so keys compare with memcmp, padding included
+	memset(key, 0, sizeof(*key));
+	for (int i = 0; i < attribs->num_planes; i++) {
+		struct stat st;
+		if (fstat(attribs->planes[i].fd, &st) < 0) {
+			return false;
+		}
+		key->dev[i] = st.st_dev;
+		key->ino[i] = st.st_ino;
+		key->offset[i] = attribs->planes[i].offset;
+		key->stride[i] = attribs->planes[i].stride;
+	}
+	key->width = attribs->width;
+	key->height = attribs->height;
+	key->num_planes = attribs->num_planes;
+	key->format = attribs->format;
+	key->modifier = attribs->modifier;
+	return true;
+}
+
+static uint64_t now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+static void evict(struct wlblur_import_cache *cache, int index) {
+	glDeleteTextures(1, &cache->entries[index].texture);
+	cache->entries[index] = cache->entries[--cache->count];
+	cache->stats.evictions++;
+}
+
+struct wlblur_import_cache* wlblur_import_cache_create(void) {
+	return calloc(1, sizeof(struct wlblur_import_cache));
+}
+
+void wlblur_import_cache_destroy(struct wlblur_import_cache *cache) {
+	if (!cache) {
+		return;
+	}
+
+	for (int i = 0; i < cache->count; i++) {
+		glDeleteTextures(1, &cache->entries[i].texture);
+	}
+	free(cache);
+}
+
+GLuint wlblur_import_cache_get(
+	struct wlblur_import_cache *cache,
+	struct wlblur_egl_context *egl,
+	const struct wlblur_dmabuf_attribs *attribs
+) {
+	struct import_key key;
+	if (!make_key(attribs, &key)) {
+		fprintf(stderr, "[wlblur] Invalid DMA-BUF file descriptor\n");
+		return 0;
+	}
+
+	uint64_t now = ++cache->clock;
+	uint64_t ms = now_ms();
+
+	// Buffers the compositor dropped are only kept alive by us
+	for (int i = cache->count - 1; i >= 0; i--) {
+		if (ms - cache->entries[i].last_use_ms >
+		    WLBLUR_IMPORT_CACHE_MAX_IDLE_MS) {
+			evict(cache, i);
+		}
+	}
+
+	for (int i = 0; i < cache->count; i++) {
+		struct import_entry *entry = &cache->entries[i];
+		if (memcmp(&entry->key, &key, sizeof(key)) == 0) {
+			entry->last_use = now;
+			entry->last_use_ms = ms;
+			cache->stats.hits++;
+			return entry->texture;
+		}
+	}
+
+	cache->stats.misses++;
+	GLuint texture = wlblur_dmabuf_import(egl, attribs);
+	if (texture == 0) {
+		return 0;
+	}
+
+	if (cache->count == WLBLUR_IMPORT_CACHE_SIZE) {
+		int oldest = 0;
+		for (int i = 1; i < cache->count; i++) {
+			if (cache->entries[i].last_use < cache->entries[oldest].last_use) {
+				oldest = i;
+			}
+		}
+		evict(cache, oldest);
+	}
+
+	cache->entries[cache->count++] = (struct import_entry){
+		.key = key,
+		.texture = texture,
+		.last_use = now,
+		.last_use_ms = ms,
+	};
+	return texture;
+}
+
+void wlblur_import_cache_clear(struct wlblur_import_cache *cache) {
+	while (cache->count > 0) {
+		evict(cache, cache->count - 1);
+	}
+}
+
+void wlblur_import_cache_get_stats(
+	const struct wlblur_import_cache *cache,
+	struct wlblur_import_stats *stats
+) {
+	*stats = cache->stats;
+	stats->entries = cache->count;
+}
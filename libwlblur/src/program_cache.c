@@ -0,0 +1,220 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * program_cache.c - On-disk cache of linked GL program binaries
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "../private/internal.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "WLBLURPB"
+#define CACHE_VERSION 1
+#define CACHE_MAX_BINARY ((uint32_t)16 << 20)
+
+/**
+ * Header of a cache file, followed by the program binary
+ */
+struct cache_header {
+	char magic[8];
+	uint64_t key;     /* Guards against file name collisions */
+	uint32_t format;  /* Program binary format */
+	uint32_t length;  /* Program binary bytes */
+};
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static uint64_t fnv1a_string(uint64_t hash, const char *string) {
+	/* Include the terminator so "ab" + "c" and "a" + "bc" differ */
+	return fnv1a(hash, string ? string : "", string ? strlen(string) + 1 : 1);
+}
+
+/**
+ * Cache directory, $XDG_CACHE_HOME/wlblur or ~/.cache/wlblur
+ *
+ * Returns false when caching is disabled or no directory is known.
+ */
+static bool cache_dir(char *dir, size_t size) {
+	const char *enabled = getenv("WLBLUR_SHADER_CACHE");
+	if (enabled && strcmp(enabled, "0") == 0) {
+		return false;
+	}
+
+	const char *base = getenv("XDG_CACHE_HOME");
+	int len;
+	if (base && base[0] == '/') {
+		len = snprintf(dir, size, "%s/wlblur", base);
+	} else {
+		const char *home = getenv("HOME");
+		if (!home || home[0] != '/') {
+			return false;
+		}
+		len = snprintf(dir, size, "%s/.cache/wlblur", home);
+	}
+	return len > 0 && (size_t)len < size;
+}
+
+static bool cache_path(uint64_t key, char *path, size_t size) {
+	char dir[448];
+	if (!cache_dir(dir, sizeof(dir))) {
+		return false;
+	}
+	int len = snprintf(path, size, "%s/%016llx.bin", dir,
+	                   (unsigned long long)key);
+	return len > 0 && (size_t)len < size;
+}
+
+/**
+ * Create the cache directory and its parent if missing
+ */
+static bool make_cache_dir(void) {
+	char dir[448];
+	if (!cache_dir(dir, sizeof(dir))) {
+		return false;
+	}
+
+	char *slash = strrchr(dir, '/');
+	*slash = '\0';
+	if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+		return false;
+	}
+	*slash = '/';
+	return mkdir(dir, 0700) == 0 || errno == EEXIST;
+}
+
+uint64_t wlblur_program_cache_key(const char *const *sources, int num_sources) {
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	if (num_formats <= 0) {
+		return 0;
+	}
+
+	/* Driver updates invalidate binaries, so they are part of the key */
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	uint32_t version = CACHE_VERSION;
+	hash = fnv1a(hash, &version, sizeof(version));
+	hash = fnv1a_string(hash, (const char *)glGetString(GL_VENDOR));
+	hash = fnv1a_string(hash, (const char *)glGetString(GL_RENDERER));
+	hash = fnv1a_string(hash, (const char *)glGetString(GL_VERSION));
+	for (int i = 0; i < num_sources; i++) {
+		hash = fnv1a_string(hash, sources[i]);
+	}
+
+	/* 0 means no caching */
+	return hash ? hash : 1;
+}
+
+GLuint wlblur_program_cache_load(uint64_t key) {
+	char path[512];
+	if (!key || !cache_path(key, path, sizeof(path))) {
+		return 0;
+	}
+
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		return 0;
+	}
+
+	struct cache_header header;
+	void *binary = NULL;
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+	    header.key != key || header.length == 0 ||
+	    header.length > CACHE_MAX_BINARY ||
+	    !(binary = malloc(header.length)) ||
+	    fread(binary, 1, header.length, file) != header.length) {
+		free(binary);
+		fclose(file);
+		return 0;
+	}
+	fclose(file);
+
+	GLuint program = glCreateProgram();
+	if (!program) {
+		free(binary);
+		return 0;
+	}
+
+	glProgramBinary(program, header.format, binary, (GLsizei)header.length);
+	free(binary);
+
+	/* Rejected binaries (e.g. after a driver update) just recompile */
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		glDeleteProgram(program);
+		while (glGetError() != GL_NO_ERROR) {
+		}
+		return 0;
+	}
+
+	return program;
+}
+
+void wlblur_program_cache_store(uint64_t key, GLuint program) {
+	char path[512];
+	if (!key || !cache_path(key, path, sizeof(path)) || !make_cache_dir()) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0 || (uint32_t)length > CACHE_MAX_BINARY) {
+		return;
+	}
+
+	void *binary = malloc(length);
+	if (!binary) {
+		return;
+	}
+
+	GLenum format = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &format, binary);
+	if (written <= 0) {
+		free(binary);
+		return;
+	}
+
+	struct cache_header header = {
+		.key = key,
+		.format = format,
+		.length = (uint32_t)written,
+	};
+	memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+
+	/* Write then rename, so concurrent loaders never see a partial file */
+	char tmp_path[528];
+	snprintf(tmp_path, sizeof(tmp_path), "%s.%ld", path, (long)getpid());
+	FILE *file = fopen(tmp_path, "wb");
+	if (!file) {
+		free(binary);
+		return;
+	}
+
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+	          fwrite(binary, 1, written, file) == (size_t)written;
+	ok &= fclose(file) == 0;
+	free(binary);
+
+	if (!ok || rename(tmp_path, path) != 0) {
+		fprintf(stderr, "[wlblur] Failed to write program cache: %s\n", path);
+		unlink(tmp_path);
+	}
+}
@@ -0,0 +1,277 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * render_graph.c - Transient render graph with resource aliasing
+ */
+
+#include "../private/internal.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Physical FBO backing one or more resources in turn
+ */
+struct rg_slot {
+	const struct wlblur_rg_resource *desc;  /* First resource it backs */
+	int busy_until;   /* Last use of the latest resource it backs */
+	struct wlblur_fbo *fbo;
+	bool external;    /* fbo is the caller's, never pooled */
+};
+
+void wlblur_rg_init(
+	struct wlblur_render_graph *graph,
+	struct wlblur_fbo_pool *pool,
+	GLuint input,
+	void *data
+) {
+	memset(graph, 0, sizeof(*graph));
+	graph->pool = pool;
+	graph->input = input;
+	graph->data = data;
+}
+
+int wlblur_rg_resource(
+	struct wlblur_render_graph *graph,
+	int width,
+	int height,
+	GLenum format,
+	int levels
+) {
+	if (graph->num_resources == WLBLUR_RG_MAX_RESOURCES) {
+		graph->overflow = true;
+		return WLBLUR_RG_INPUT;
+	}
+
+	int id = graph->num_resources++;
+	graph->resources[id] = (struct wlblur_rg_resource){
+		.width = width > 1 ? width : 1,
+		.height = height > 1 ? height : 1,
+		.format = format,
+		.levels = levels > 1 ? levels : 1,
+		.first_use = -1,
+		.last_use = -1,
+		.slot = -1,
+	};
+	return id;
+}
+
+int wlblur_rg_external(
+	struct wlblur_render_graph *graph,
+	struct wlblur_fbo *fbo,
+	int x,
+	int y,
+	int width,
+	int height
+) {
+	int id = wlblur_rg_resource(graph, width, height, fbo->format, 1);
+	if (id != WLBLUR_RG_INPUT) {
+		graph->resources[id].external = fbo;
+		graph->resources[id].x = x;
+		graph->resources[id].y = y;
+	}
+	return id;
+}
+
+void wlblur_rg_pass(
+	struct wlblur_render_graph *graph,
+	struct wlblur_shader_program *shader,
+	wlblur_rg_draw_fn draw,
+	int source,
+	int source_level,
+	int target,
+	int target_level,
+	int arg
+) {
+	if (graph->num_passes == WLBLUR_RG_MAX_PASSES) {
+		graph->overflow = true;
+		return;
+	}
+
+	graph->passes[graph->num_passes++] = (struct wlblur_rg_pass){
+		.shader = shader,
+		.draw = draw,
+		.source = source,
+		.source_level = source_level,
+		.target = target,
+		.target_level = target_level,
+		.arg = arg,
+	};
+}
+
+static bool same_storage(const struct wlblur_rg_resource *a,
+                         const struct wlblur_rg_resource *b) {
+	return !a->external && !b->external && a->width == b->width && a->height == b->height &&
+	       a->format == b->format && a->levels == b->levels;
+}
+
+/**
+ * Compute lifetimes and assign each resource a slot, reusing the slot of
+ * a compatible resource whose last use came before its first write
+ *
+ * Returns the number of slots, or -1 if the graph is malformed.
+ */
+static int rg_plan(struct wlblur_render_graph *graph, int output,
+                   struct rg_slot *slots) {
+	for (int p = 0; p < graph->num_passes; p++) {
+		const struct wlblur_rg_pass *pass = &graph->passes[p];
+		if (pass->source >= graph->num_resources ||
+		    pass->target < 0 || pass->target >= graph->num_resources) {
+			return -1;
+		}
+
+		if (pass->source >= 0) {
+			struct wlblur_rg_resource *source = &graph->resources[pass->source];
+			if (source->first_use < 0) {
+				return -1;  /* Read before written */
+			}
+			source->last_use = p;
+		}
+
+		struct wlblur_rg_resource *target = &graph->resources[pass->target];
+		if (target->first_use < 0) {
+			target->first_use = p;
+		}
+		target->last_use = p;
+	}
+
+	if (output < 0 || output >= graph->num_resources ||
+	    graph->resources[output].first_use < 0) {
+		return -1;
+	}
+	graph->resources[output].last_use = graph->num_passes;
+
+	/* Greedy interval allocation, in order of first write */
+	int num_slots = 0;
+	for (int p = 0; p < graph->num_passes; p++) {
+		struct wlblur_rg_resource *res =
+			&graph->resources[graph->passes[p].target];
+		if (res->slot >= 0) {
+			continue;
+		}
+
+		for (int s = 0; s < num_slots && res->slot < 0; s++) {
+			if (slots[s].busy_until < p && same_storage(slots[s].desc, res)) {
+				res->slot = s;
+			}
+		}
+		if (res->slot < 0) {
+			res->slot = num_slots++;
+			slots[res->slot] = (struct rg_slot){
+				.desc = res,
+				.fbo = res->external,
+				.external = res->external != NULL,
+			};
+		}
+		slots[res->slot].busy_until = res->last_use;
+	}
+
+	return num_slots;
+}
+
+/**
+ * Level of an FBO a pass renders into, as an FBO of that level's size
+ */
+static struct wlblur_fbo rg_view(const struct wlblur_fbo *fbo, int level) {
+	return fbo->levels > 1 ? wlblur_fbo_atlas_level(fbo, level) : *fbo;
+}
+
+struct wlblur_fbo* wlblur_rg_execute(
+	struct wlblur_render_graph *graph,
+	int output
+) {
+	struct rg_slot slots[WLBLUR_RG_MAX_RESOURCES];
+	int num_slots = graph->overflow ? -1 : rg_plan(graph, output, slots);
+	if (num_slots < 0) {
+		fprintf(stderr, "[wlblur] Malformed render graph\n");
+		return NULL;
+	}
+
+	struct wlblur_shader_program *current = NULL;
+	int output_slot = graph->resources[output].slot;
+
+	for (int p = 0; p < graph->num_passes; p++) {
+		const struct wlblur_rg_pass *pass = &graph->passes[p];
+		const struct wlblur_rg_resource *target =
+			&graph->resources[pass->target];
+		struct rg_slot *slot = &slots[target->slot];
+
+		if (!slot->fbo) {
+			/* The output keeps its exact size: callers export it */
+			bool by_class = graph->size_classes &&
+			                target->slot != output_slot;
+			slot->fbo = by_class ?
+				wlblur_fbo_pool_acquire_class(
+					graph->pool, target->width, target->height,
+					target->format, target->levels) :
+				wlblur_fbo_pool_acquire_levels(
+					graph->pool, target->width, target->height,
+					target->format, target->levels);
+			if (!slot->fbo) {
+				fprintf(stderr, "[wlblur] Failed to acquire FBO for pass %d\n",
+				        p);
+				goto error;
+			}
+		}
+
+		if (pass->shader != current) {
+			wlblur_shader_use(pass->shader);
+			current = pass->shader;
+		}
+
+		struct wlblur_fbo view = rg_view(slot->fbo, pass->target_level);
+		if (slot->external) {
+			/* Draws see the resource's size, not the framebuffer's */
+			view.width = target->width;
+			view.height = target->height;
+		}
+		wlblur_fbo_bind(&view);
+		glViewport(-target->x, -target->y, view.width, view.height);
+
+		glActiveTexture(GL_TEXTURE0);
+		if (pass->source < 0) {
+			glBindTexture(GL_TEXTURE_2D, graph->input);
+			wlblur_shader_set_source(pass->shader, NULL);
+		} else {
+			const struct wlblur_fbo *source =
+				slots[graph->resources[pass->source].slot].fbo;
+			glBindTexture(GL_TEXTURE_2D, source->texture);
+
+			struct wlblur_fbo area = rg_view(source, pass->source_level);
+			wlblur_shader_set_source(pass->shader, &area);
+
+			/* Sample only the level read, so rendering into another
+			 * level of the same atlas is no feedback loop */
+			if (source->levels > 1) {
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL,
+				                pass->source_level);
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+				                pass->source_level);
+			}
+		}
+
+		pass->draw(graph->data, pass, &view);
+
+		/* Slots whose last resource is done go back to the pool */
+		for (int s = 0; s < num_slots; s++) {
+			if (slots[s].fbo && !slots[s].external &&
+			    slots[s].busy_until == p) {
+				wlblur_fbo_pool_release(graph->pool, slots[s].fbo);
+				slots[s].fbo = NULL;
+			}
+		}
+	}
+
+	wlblur_fbo_unbind();
+	return slots[graph->resources[output].slot].fbo;
+
+error:
+	wlblur_fbo_unbind();
+	for (int s = 0; s < num_slots; s++) {
+		if (slots[s].fbo && !slots[s].external) {
+			wlblur_fbo_pool_release(graph->pool, slots[s].fbo);
+		}
+	}
+	return NULL;
+}
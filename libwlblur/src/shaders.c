@@ -24,6 +24,9 @@ static const char *DEFAULT_VERTEX_SHADER =
 	"    gl_Position = vec4(position, 0.0, 1.0);\n"
 	"}\n";
 
+/* Nesting of #include directives, which also stops include cycles */
+#define MAX_INCLUDE_DEPTH 4
+
 /**
  * Read shader source from file
  */
@@ -62,7 +65,7 @@ static char* read_shader_file(const char *path) {
 }
 
 /**
- * Compile shader
+ * Start compiling a shader; status is checked by check_shader()
  */
 static GLuint compile_shader(GLenum type, const char *source) {
 	GLuint shader = glCreateShader(type);
@@ -73,8 +76,13 @@ static GLuint compile_shader(GLenum type, const char *source) {
 
 	glShaderSource(shader, 1, &source, NULL);
 	glCompileShader(shader);
+	return shader;
+}
 
-	/* Check compilation status */
+/**
+ * Whether a shader compiled, logging why not (blocks until compiled)
+ */
+static bool check_shader(GLuint shader) {
 	GLint status;
 	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
 	if (status != GL_TRUE) {
@@ -87,29 +95,16 @@ static GLuint compile_shader(GLenum type, const char *source) {
 			fprintf(stderr, "[wlblur] Shader compilation failed:\n%s\n", log);
 			free(log);
 		}
-
-		glDeleteShader(shader);
-		return 0;
+		return false;
 	}
 
-	return shader;
+	return true;
 }
 
 /**
- * Link shader program
+ * Whether a program linked, logging why not (blocks until linked)
  */
-static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader) {
-	GLuint program = glCreateProgram();
-	if (!program) {
-		fprintf(stderr, "[wlblur] Failed to create shader program\n");
-		return 0;
-	}
-
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
-
-	/* Check link status */
+static bool check_program(GLuint program) {
 	GLint status;
 	glGetProgramiv(program, GL_LINK_STATUS, &status);
 	if (status != GL_TRUE) {
@@ -122,15 +117,34 @@ static GLuint link_program(GLuint vertex_shader, GLuint fragment_shader) {
 			fprintf(stderr, "[wlblur] Program linking failed:\n%s\n", log);
 			free(log);
 		}
-
-		glDeleteProgram(program);
-		return 0;
+		return false;
 	}
 
-	return program;
+	return true;
 }
 
-struct wlblur_shader_program* wlblur_shader_load_from_source(
+/**
+ * Look up the uniform locations shared by wlblur shaders
+ */
+static void query_uniforms(struct wlblur_shader_program *shader) {
+	shader->u_tex = glGetUniformLocation(shader->program, "tex");
+	shader->u_halfpixel = glGetUniformLocation(shader->program, "halfpixel");
+	shader->u_radius = glGetUniformLocation(shader->program, "radius");
+	shader->u_src_scale = glGetUniformLocation(shader->program, "src_scale");
+	shader->u_src_max = glGetUniformLocation(shader->program, "src_max");
+	shader->u_brightness = glGetUniformLocation(shader->program, "brightness");
+	shader->u_contrast = glGetUniformLocation(shader->program, "contrast");
+	shader->u_saturation = glGetUniformLocation(shader->program, "saturation");
+	shader->u_noise = glGetUniformLocation(shader->program, "noise");
+}
+
+/**
+ * Start building a program from the cache or by compiling and linking
+ *
+ * Nothing waits for the driver: a compiled program is returned pending,
+ * for complete_program().
+ */
+static struct wlblur_shader_program* begin_program(
 	const char *vertex_source,
 	const char *fragment_source
 ) {
@@ -150,50 +164,322 @@ struct wlblur_shader_program* wlblur_shader_load_from_source(
 		return NULL;
 	}
 
-	/* Compile shaders */
+	/* A cached binary skips compiling and linking */
+	const char *sources[] = { vertex_source, fragment_source };
+	shader->cache_key = wlblur_program_cache_key(sources, 2);
+	shader->program = wlblur_program_cache_load(shader->cache_key);
+	if (shader->program) {
+		query_uniforms(shader);
+		return shader;
+	}
+
 	shader->vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
-	if (!shader->vertex_shader) {
-		free(shader);
+	shader->fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+	shader->program = glCreateProgram();
+	if (!shader->vertex_shader || !shader->fragment_shader ||
+	    !shader->program) {
+		fprintf(stderr, "[wlblur] Failed to create shader program\n");
+		wlblur_shader_destroy(shader);
 		return NULL;
 	}
 
-	shader->fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
-	if (!shader->fragment_shader) {
-		glDeleteShader(shader->vertex_shader);
-		free(shader);
+	glAttachShader(shader->program, shader->vertex_shader);
+	glAttachShader(shader->program, shader->fragment_shader);
+	glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+	                    GL_TRUE);
+	glLinkProgram(shader->program);
+
+	shader->pending = true;
+	return shader;
+}
+
+/**
+ * Check a pending program's status and make it usable
+ *
+ * Blocks until the driver has finished compiling and linking.
+ */
+static bool complete_program(struct wlblur_shader_program *shader) {
+	if (!shader->pending) {
+		return true;
+	}
+
+	/* The link log of a failed compile says less than its own log */
+	if (!check_shader(shader->vertex_shader) ||
+	    !check_shader(shader->fragment_shader) ||
+	    !check_program(shader->program)) {
+		return false;
+	}
+
+	shader->pending = false;
+	wlblur_program_cache_store(shader->cache_key, shader->program);
+	query_uniforms(shader);
+	return true;
+}
+
+/**
+ * Whether the driver has finished a pending program (never blocks)
+ */
+static bool program_compiled(
+	struct wlblur_egl_context *egl_ctx,
+	const struct wlblur_shader_program *shader
+) {
+	if (!shader->pending || !egl_ctx->has_parallel_compile) {
+		return true;
+	}
+
+	GLint done = GL_FALSE;
+	glGetProgramiv(shader->program, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+struct wlblur_shader_program* wlblur_shader_load_from_source(
+	const char *vertex_source,
+	const char *fragment_source
+) {
+	struct wlblur_shader_program *shader =
+		begin_program(vertex_source, fragment_source);
+	if (shader && !complete_program(shader)) {
+		wlblur_shader_destroy(shader);
+		return NULL;
+	}
+
+	return shader;
+}
+
+struct wlblur_shader_program* wlblur_shader_load_compute_from_source(
+	const char *compute_source
+) {
+	if (!compute_source) {
+		fprintf(stderr, "[wlblur] Compute shader source required\n");
+		return NULL;
+	}
+
+	struct wlblur_shader_program *shader = calloc(1, sizeof(*shader));
+	if (!shader) {
+		fprintf(stderr, "[wlblur] Failed to allocate shader program\n");
+		return NULL;
+	}
+
+	uint64_t key = wlblur_program_cache_key(&compute_source, 1);
+	shader->program = wlblur_program_cache_load(key);
+	if (shader->program) {
+		query_uniforms(shader);
+		return shader;
+	}
+
+	shader->compute_shader = compile_shader(GL_COMPUTE_SHADER, compute_source);
+	if (!shader->compute_shader || !check_shader(shader->compute_shader)) {
+		wlblur_shader_destroy(shader);
 		return NULL;
 	}
 
-	/* Link program */
-	shader->program = link_program(shader->vertex_shader, shader->fragment_shader);
+	shader->program = glCreateProgram();
 	if (!shader->program) {
-		glDeleteShader(shader->vertex_shader);
-		glDeleteShader(shader->fragment_shader);
+		fprintf(stderr, "[wlblur] Failed to create shader program\n");
+		glDeleteShader(shader->compute_shader);
 		free(shader);
 		return NULL;
 	}
 
-	/* Query uniform locations */
-	shader->u_tex = glGetUniformLocation(shader->program, "tex");
-	shader->u_halfpixel = glGetUniformLocation(shader->program, "halfpixel");
-	shader->u_radius = glGetUniformLocation(shader->program, "radius");
-	shader->u_brightness = glGetUniformLocation(shader->program, "brightness");
-	shader->u_contrast = glGetUniformLocation(shader->program, "contrast");
-	shader->u_saturation = glGetUniformLocation(shader->program, "saturation");
-	shader->u_noise = glGetUniformLocation(shader->program, "noise");
+	glAttachShader(shader->program, shader->compute_shader);
+	glProgramParameteri(shader->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+	                    GL_TRUE);
+	glLinkProgram(shader->program);
 
-	/* Validate program */
-	glValidateProgram(shader->program);
-	GLint status;
-	glGetProgramiv(shader->program, GL_VALIDATE_STATUS, &status);
-	if (status != GL_TRUE) {
-		fprintf(stderr, "[wlblur] Program validation failed\n");
-		/* Don't fail on validation error - some drivers are strict */
+	if (!check_program(shader->program)) {
+		wlblur_shader_destroy(shader);
+		return NULL;
+	}
+
+	wlblur_program_cache_store(key, shader->program);
+	query_uniforms(shader);
+	return shader;
+}
+
+/**
+ * Copy of a shader file: from WLBLUR_SHADER_PATH when it has one (for
+ * development), otherwise the source compiled into the library
+ */
+static char* read_raw_source(const char *name) {
+	const char *shader_dir = getenv("WLBLUR_SHADER_PATH");
+	if (shader_dir) {
+		char path[512];
+		snprintf(path, sizeof(path), "%s/%s", shader_dir, name);
+		FILE *file = fopen(path, "r");
+		if (file) {
+			fclose(file);
+			return read_shader_file(path);
+		}
+	}
+
+	for (int i = 0; i < wlblur_num_embedded_shaders; i++) {
+		if (strcmp(wlblur_embedded_shaders[i].name, name) == 0) {
+			const char *embedded = wlblur_embedded_shaders[i].source;
+			size_t size = strlen(embedded) + 1;
+			char *source = malloc(size);
+			if (!source) {
+				fprintf(stderr, "[wlblur] Failed to allocate shader buffer\n");
+				return NULL;
+			}
+			memcpy(source, embedded, size);
+			return source;
+		}
+	}
+
+	fprintf(stderr, "[wlblur] Unknown shader: %s\n", name);
+	return NULL;
+}
+
+/**
+ * Replace each line #include "name" with that shader's source
+ *
+ * Takes source; returns the spliced source or NULL.
+ */
+static char* resolve_includes(char *source, int depth) {
+	static const char directive[] = "#include \"";
+	const size_t directive_len = sizeof(directive) - 1;
+
+	char *line = source;
+	while (*line) {
+		char *end = strchr(line, '\n');
+		size_t len = end ? (size_t)(end - line) : strlen(line);
+		if (len < directive_len || strncmp(line, directive, directive_len) != 0) {
+			line += end ? len + 1 : len;
+			continue;
+		}
+
+		char name[256];
+		const char *start = line + directive_len;
+		const char *quote = memchr(start, '"', len - directive_len);
+		if (!quote || (size_t)(quote - start) >= sizeof(name) ||
+		    depth == MAX_INCLUDE_DEPTH) {
+			fprintf(stderr, "[wlblur] Invalid shader include: %.*s\n",
+			        (int)len, line);
+			free(source);
+			return NULL;
+		}
+		memcpy(name, start, quote - start);
+		name[quote - start] = '\0';
+
+		char *included = read_raw_source(name);
+		if (included) {
+			included = resolve_includes(included, depth + 1);
+		}
+		if (!included) {
+			free(source);
+			return NULL;
+		}
+
+		/* Keep the line's newline after the included source */
+		size_t prefix = line - source;
+		size_t included_len = strlen(included);
+		const char *rest = line + len;
+		char *spliced = malloc(prefix + included_len + strlen(rest) + 1);
+		if (!spliced) {
+			fprintf(stderr, "[wlblur] Failed to allocate shader buffer\n");
+			free(included);
+			free(source);
+			return NULL;
+		}
+		memcpy(spliced, source, prefix);
+		memcpy(spliced + prefix, included, included_len);
+		strcpy(spliced + prefix + included_len, rest);
+
+		free(included);
+		free(source);
+		source = spliced;
+		line = source + prefix + included_len;
+	}
+
+	return source;
+}
+
+char* wlblur_shader_read_source(const char *name) {
+	char *source = read_raw_source(name);
+	return source ? resolve_includes(source, 0) : NULL;
+}
+
+/**
+ * Insert defines after the #version line, which must come first
+ *
+ * Takes source; returns the new source or NULL.
+ */
+static char* insert_defines(char *source, const char *defines) {
+	char *version = strstr(source, "#version");
+	while (version && version != source && version[-1] != '\n') {
+		version = strstr(version + 1, "#version");
+	}
+	char *end = version ? strchr(version, '\n') : NULL;
+	if (!end) {
+		fprintf(stderr, "[wlblur] Shader has no #version line\n");
+		free(source);
+		return NULL;
+	}
+
+	size_t prefix = end + 1 - source;
+	size_t defines_len = strlen(defines);
+	char *result = malloc(strlen(source) + defines_len + 1);
+	if (!result) {
+		fprintf(stderr, "[wlblur] Failed to allocate shader buffer\n");
+		free(source);
+		return NULL;
+	}
+	memcpy(result, source, prefix);
+	memcpy(result + prefix, defines, defines_len);
+	strcpy(result + prefix + defines_len, end + 1);
+
+	free(source);
+	return result;
+}
+
+void wlblur_shader_variant_request(struct wlblur_shader_variant *variant) {
+	if (variant->program || variant->failed) {
+		return;
+	}
+
+	char *source = wlblur_shader_read_source(variant->name);
+	if (source && variant->defines) {
+		source = insert_defines(source, variant->defines);
+	}
+
+	variant->program = source ? begin_program(NULL, source) : NULL;
+	variant->failed = variant->program == NULL;
+	free(source);
+}
+
+struct wlblur_shader_program* wlblur_shader_variant_get(
+	struct wlblur_egl_context *egl_ctx,
+	struct wlblur_shader_variant *variant,
+	bool wait
+) {
+	wlblur_shader_variant_request(variant);
+	if (variant->failed) {
+		return NULL;
+	}
+
+	struct wlblur_shader_program *shader = variant->program;
+	if (!wait && !program_compiled(egl_ctx, shader)) {
+		return NULL;
+	}
+
+	if (!complete_program(shader)) {
+		fprintf(stderr, "[wlblur] Failed to build shader variant %s\n",
+		        variant->name);
+		wlblur_shader_destroy(shader);
+		variant->program = NULL;
+		variant->failed = true;
+		return NULL;
 	}
 
 	return shader;
 }
 
+void wlblur_shader_variant_reset(struct wlblur_shader_variant *variant) {
+	wlblur_shader_destroy(variant->program);
+	variant->program = NULL;
+	variant->failed = false;
+}
+
 struct wlblur_shader_program* wlblur_shader_load(
 	const char *vertex_source,
 	const char *fragment_path
@@ -254,6 +540,9 @@ void wlblur_shader_destroy(struct wlblur_shader_program *shader) {
 	if (shader->fragment_shader) {
 		glDeleteShader(shader->fragment_shader);
 	}
+	if (shader->compute_shader) {
+		glDeleteShader(shader->compute_shader);
+	}
 
 	free(shader);
 }
@@ -274,3 +563,27 @@ bool wlblur_shader_use(struct wlblur_shader_program *shader) {
 
 	return true;
 }
+
+void wlblur_shader_set_source(
+	const struct wlblur_shader_program *shader,
+	const struct wlblur_fbo *source
+) {
+	if (shader->u_src_scale < 0) {
+		return;
+	}
+
+	/* A texture used whole keeps plain CLAMP_TO_EDGE sampling */
+	if (!source || (source->alloc_width <= source->width &&
+	                source->alloc_height <= source->height)) {
+		glUniform2f(shader->u_src_scale, 1.0f, 1.0f);
+		glUniform2f(shader->u_src_max, 1.0f, 1.0f);
+		return;
+	}
+
+	glUniform2f(shader->u_src_scale,
+	            (float)source->width / source->alloc_width,
+	            (float)source->height / source->alloc_height);
+	glUniform2f(shader->u_src_max,
+	            (source->width - 0.5f) / source->alloc_width,
+	            (source->height - 0.5f) / source->alloc_height);
+}
@@ -0,0 +1,807 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * bench_kawase.c - Blur backend and algorithm benchmark
+ *
+ * Usage: bench_kawase [width height [iterations]]
+ *
+ * Times wlblur_kawase_blur() against wlblur_kawase_compute_blur() for 1-8
+ * passes, then the per-level and atlas pyramid layouts, then the generic
+ * finish pass against its specialized variants for each post-processing
+ * kind, then every built algorithm with the wlblurd standard preset
+ * strengths, timed and with the peak pooled memory of one blur, then 1-5
+ * window-sized regions blurred one by one or batched,
+ * then 1-4 presets of one radius blurred one by one or with a shared
+ * pyramid, then renderer startup to the first blur with the program binary
+ * cache off, empty and filled. Each iteration ends in glFinish(), so the
+ * numbers are GPU latency per blur, not CPU submission cost. Exits 77
+ * (skip) without EGL.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "wlblur/wlblur.h"
+#include "wlblur/blur_params.h"
+#include "../libwlblur/private/internal.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/**
+ * Return a pooled blur result to the pool so iterations do not exhaust it
+ */
+static void release_output(struct wlblur_kawase_renderer *renderer,
+                           GLuint texture) {
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+		}
+	}
+}
+
+/**
+ * Renderers under test; optional ones are NULL when unavailable
+ */
+struct backends {
+	struct wlblur_kawase_renderer *kawase;
+	struct wlblur_kawase_compute *compute;
+	struct wlblur_gaussian_renderer *gaussian;
+	struct wlblur_box_renderer *box;
+	struct wlblur_bokeh_renderer *bokeh;
+	struct wlblur_iir_renderer *iir;
+};
+
+enum backend {
+	BACKEND_FRAGMENT,
+	BACKEND_COMPUTE,
+	BACKEND_GAUSSIAN,
+	BACKEND_BOX,
+	BACKEND_BOKEH,
+	BACKEND_IIR,
+};
+
+/**
+ * Create every renderer this build has around a fresh Kawase renderer
+ */
+static bool create_backends(struct wlblur_egl_context *egl_ctx,
+                            struct backends *b) {
+	*b = (struct backends){ 0 };
+	b->kawase = wlblur_kawase_create(egl_ctx);
+	if (!b->kawase) {
+		return false;
+	}
+
+	b->compute = wlblur_kawase_compute_create(b->kawase);
+#ifdef WLBLUR_HAVE_GAUSSIAN
+	b->gaussian = wlblur_gaussian_create(b->kawase);
+#endif
+#ifdef WLBLUR_HAVE_BOX
+	b->box = wlblur_box_create(b->kawase);
+#endif
+#ifdef WLBLUR_HAVE_BOKEH
+	b->bokeh = wlblur_bokeh_create(b->kawase);
+#endif
+#ifdef WLBLUR_HAVE_IIR
+	b->iir = wlblur_iir_create(b->kawase);
+#endif
+	return true;
+}
+
+/**
+ * Wait for every shader variant, so timed blurs do not switch programs
+ * half-way
+ */
+static void build_variants(struct wlblur_kawase_renderer *kawase) {
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT; kind++) {
+		if (kind != WLBLUR_FINISH_FULL) {
+			wlblur_shader_variant_get(kawase->egl_ctx,
+			                          &kawase->finish_variants[kind], true);
+		}
+		if (kind != WLBLUR_FINISH_NONE) {
+			wlblur_shader_variant_get(kawase->egl_ctx,
+			                          &kawase->upsample_finish[kind], true);
+		}
+	}
+}
+
+static void destroy_backends(struct backends *b) {
+	wlblur_iir_destroy(b->iir);
+	wlblur_bokeh_destroy(b->bokeh);
+	wlblur_box_destroy(b->box);
+	wlblur_gaussian_destroy(b->gaussian);
+	wlblur_kawase_compute_destroy(b->compute);
+	wlblur_kawase_destroy(b->kawase);
+}
+
+/**
+ * Whether a backend was created
+ */
+static bool backend_available(const struct backends *b, enum backend backend) {
+	switch (backend) {
+	case BACKEND_FRAGMENT:
+		return true;
+	case BACKEND_COMPUTE:
+		return b->compute != NULL;
+	case BACKEND_GAUSSIAN:
+		return b->gaussian != NULL;
+	case BACKEND_BOX:
+		return b->box != NULL;
+	case BACKEND_BOKEH:
+		return b->bokeh != NULL;
+	case BACKEND_IIR:
+		return b->iir != NULL;
+	}
+	return false;
+}
+
+/**
+ * Run one blur with the selected backend and wait for it
+ */
+static bool run_blur(const struct backends *b, enum backend backend,
+                     GLuint input, int width, int height,
+                     const struct wlblur_blur_params *params) {
+	GLuint output = 0;
+	switch (backend) {
+	case BACKEND_FRAGMENT:
+		output = wlblur_kawase_blur(b->kawase, input, width, height, params);
+		break;
+	case BACKEND_COMPUTE:
+		output = wlblur_kawase_compute_blur(b->compute, input, width, height,
+		                                    params);
+		break;
+	case BACKEND_GAUSSIAN:
+		output = wlblur_gaussian_blur(b->gaussian, input, width, height,
+		                              params);
+		break;
+	case BACKEND_BOX:
+		output = wlblur_box_blur(b->box, input, width, height, params);
+		break;
+	case BACKEND_BOKEH:
+		output = wlblur_bokeh_blur(b->bokeh, input, width, height, params);
+		break;
+	case BACKEND_IIR:
+		output = wlblur_iir_blur(b->iir, input, width, height, params);
+		break;
+	}
+	if (!output) {
+		return false;
+	}
+
+	glFinish();
+	release_output(b->kawase, output);
+	return true;
+}
+
+/**
+ * Average milliseconds per blur, or -1 on failure
+ */
+static double time_blur(const struct backends *b, enum backend backend,
+                        GLuint input, int width, int height,
+                        const struct wlblur_blur_params *params,
+                        int iterations) {
+	/* Warm-up: allocates FBOs and buffers outside the timed loop */
+	if (!run_blur(b, backend, input, width, height, params)) {
+		return -1.0;
+	}
+
+	double start = now_ms();
+	for (int i = 0; i < iterations; i++) {
+		if (!run_blur(b, backend, input, width, height, params)) {
+			return -1.0;
+		}
+	}
+	return (now_ms() - start) / iterations;
+}
+
+/**
+ * Most pooled FBO memory in use at once during one blur, output included,
+ * in MiB, or -1 on failure. Textures a renderer owns outside the pool
+ * are not counted.
+ */
+static double peak_blur(const struct backends *b, enum backend backend,
+                        GLuint input, int width, int height,
+                        const struct wlblur_blur_params *params) {
+	struct wlblur_fbo_pool *pool = b->kawase->fbo_pool;
+	size_t in_use = pool->in_use;
+	pool->peak = in_use;
+	if (!run_blur(b, backend, input, width, height, params)) {
+		return -1.0;
+	}
+	return (double)(pool->peak - in_use) / (1 << 20);
+}
+
+/**
+ * Kawase fragment vs compute for 1-8 passes
+ */
+static int bench_backends(const struct backends *b, GLuint input,
+                          int width, int height, int iterations) {
+	printf("\n=== Kawase backends @ %dx%d (%d iterations) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s %14s %14s %9s\n", "passes", "fragment (ms)", "compute (ms)",
+	       "speedup");
+
+	for (int passes = 1; passes <= 8; passes++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		params.num_passes = passes;
+
+		double fragment = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+		                            &params, iterations);
+		double comp = b->compute ?
+			time_blur(b, BACKEND_COMPUTE, input, width, height,
+			          &params, iterations) : -1.0;
+
+		if (fragment < 0.0 || (b->compute && comp < 0.0)) {
+			fprintf(stderr, "[bench] Blur failed (%d passes)\n", passes);
+			return 1;
+		}
+
+		if (b->compute) {
+			printf("%-8d %14.3f %14.3f %8.2fx\n",
+			       passes, fragment, comp, fragment / comp);
+		} else {
+			printf("%-8d %14.3f %14s %9s\n", passes, fragment, "n/a", "-");
+		}
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * Kawase fragment path with each pyramid format for 1-8 passes
+ */
+static int bench_formats(const struct backends *b, GLuint input,
+                         int width, int height, int iterations) {
+	static const struct {
+		GLenum format;
+		const char *name;
+	} formats[] = {
+		{ GL_RGBA8, "RGBA8" },
+		{ GL_RGB565, "RGB565" },
+		{ GL_R11F_G11F_B10F, "R11G11B10F" },
+		{ GL_RGBA16F, "RGBA16F" },
+	};
+	enum { NUM_FORMATS = sizeof(formats) / sizeof(formats[0]) };
+
+	printf("=== Pyramid formats @ %dx%d (%d iterations, ms) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s", "passes");
+	for (int f = 0; f < NUM_FORMATS; f++) {
+		printf(" %11s", formats[f].name);
+	}
+	printf("\n");
+
+	for (int passes = 1; passes <= 8; passes++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		params.num_passes = passes;
+
+		printf("%-8d", passes);
+		for (int f = 0; f < NUM_FORMATS; f++) {
+			GLenum format = formats[f].format;
+			if ((format == GL_R11F_G11F_B10F && !b->kawase->has_float_targets) ||
+			    (format == GL_RGBA16F && !b->kawase->has_half_float_targets)) {
+				printf(" %11s", "n/a");
+				continue;
+			}
+
+			b->kawase->intermediate_format = format;
+			double ms = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+			                      &params, iterations);
+			b->kawase->intermediate_format = GL_RGBA8;
+			if (ms < 0.0) {
+				fprintf(stderr, "\n[bench] %s blur failed (%d passes)\n",
+				        formats[f].name, passes);
+				return 1;
+			}
+			printf(" %11.3f", ms);
+		}
+		printf("\n");
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * Kawase fragment path with one FBO per level vs one atlas texture, for
+ * 1-8 passes; "FBOs" counts pool acquires per blur, output included
+ */
+static int bench_layouts(const struct backends *b, GLuint input,
+                         int width, int height, int iterations) {
+	static const struct {
+		enum wlblur_kawase_layout layout;
+		const char *name;
+	} layouts[] = {
+		{ WLBLUR_KAWASE_LAYOUT_LEVELS, "levels" },
+		{ WLBLUR_KAWASE_LAYOUT_ATLAS, "atlas" },
+	};
+
+	printf("=== Pyramid layouts @ %dx%d (%d iterations) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s %12s %6s %12s %6s\n", "passes", "levels (ms)", "FBOs",
+	       "atlas (ms)", "FBOs");
+
+	for (int passes = 1; passes <= 8; passes++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		params.num_passes = passes;
+
+		printf("%-8d", passes);
+		for (int l = 0; l < 2; l++) {
+			b->kawase->layout = layouts[l].layout;
+			double ms = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+			                      &params, iterations);
+			uint64_t clock = b->kawase->fbo_pool->clock;
+			bool ok = ms >= 0.0 &&
+			          run_blur(b, BACKEND_FRAGMENT, input, width, height,
+			                   &params);
+			b->kawase->layout = WLBLUR_KAWASE_LAYOUT_LEVELS;
+			if (!ok) {
+				fprintf(stderr, "\n[bench] %s blur failed (%d passes)\n",
+				        layouts[l].name, passes);
+				return 1;
+			}
+			printf(" %12.3f %6llu", ms, (unsigned long long)
+			       (b->kawase->fbo_pool->clock - clock));
+		}
+		printf("\n");
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * N 400x300 windows over one backdrop: N full-frame blurs, as separate
+ * RENDER_BLUR requests cost without a source rect, vs one batched
+ * wlblur_kawase_blur_regions()
+ */
+static int bench_regions(const struct backends *b, GLuint input,
+                         int width, int height, int iterations) {
+	enum { MAX_WINDOWS = 5 };
+	struct wlblur_rect windows[MAX_WINDOWS];
+	for (int i = 0; i < MAX_WINDOWS; i++) {
+		int x = 40 + i * (width - 80) / MAX_WINDOWS;
+		int y = 40 + (i % 2) * (height / 2);
+		windows[i] = (struct wlblur_rect){ x, y, x + 400, y + 300 };
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+
+	printf("=== Window regions @ %dx%d (%d iterations, ms) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s %14s %14s\n", "windows", "per window", "batched");
+
+	double full = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+	                        &params, iterations);
+	if (full < 0.0) {
+		fprintf(stderr, "[bench] Blur failed\n");
+		return 1;
+	}
+
+	for (int n = 1; n <= MAX_WINDOWS; n++) {
+		double start = 0.0;
+		for (int i = -1; i < iterations; i++) {
+			/* Iteration -1 is the warm-up */
+			if (i == 0) {
+				start = now_ms();
+			}
+			GLuint output = wlblur_kawase_blur_regions(
+				b->kawase, input, width, height, &params, windows, n);
+			if (!output) {
+				fprintf(stderr, "[bench] Region blur failed\n");
+				return 1;
+			}
+			glFinish();
+			release_output(b->kawase, output);
+		}
+		double batched = (now_ms() - start) / iterations;
+
+		printf("%-8d %14.3f %14.3f\n", n, full * n, batched);
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * N presets of one radius (2, 3 and 4 passes, then a finish-only
+ * variant): N separate blurs vs one wlblur_kawase_blur_shared()
+ */
+static int bench_shared(const struct backends *b, GLuint input,
+                        int width, int height, int iterations) {
+	enum { MAX_PRESETS = 4 };
+	struct wlblur_blur_params params[MAX_PRESETS];
+	static const int passes[MAX_PRESETS] = { 3, 2, 4, 3 };
+	for (int i = 0; i < MAX_PRESETS; i++) {
+		params[i] = wlblur_params_default();
+		params[i].num_passes = passes[i];
+	}
+	params[3].brightness = 1.1f;
+
+	printf("=== Presets sharing a pyramid @ %dx%d (%d iterations, ms) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s %14s %14s\n", "presets", "separate", "shared");
+
+	for (int n = 1; n <= MAX_PRESETS; n++) {
+		double separate = 0.0;
+		for (int i = 0; i < n; i++) {
+			double ms = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+			                      &params[i], iterations);
+			if (ms < 0.0) {
+				fprintf(stderr, "[bench] Blur failed\n");
+				return 1;
+			}
+			separate += ms;
+		}
+
+		double start = 0.0;
+		for (int i = -1; i < iterations; i++) {
+			/* Iteration -1 is the warm-up */
+			if (i == 0) {
+				start = now_ms();
+			}
+			GLuint outputs[MAX_PRESETS];
+			if (!wlblur_kawase_blur_shared(b->kawase, input, width, height,
+			                               params, n, outputs)) {
+				fprintf(stderr, "[bench] Shared blur failed\n");
+				return 1;
+			}
+			glFinish();
+			for (int o = 0; o < n; o++) {
+				release_output(b->kawase, outputs[o]);
+			}
+		}
+		double shared = (now_ms() - start) / iterations;
+
+		printf("%-8d %14.3f %14.3f\n", n, separate, shared);
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * Kawase fragment path for each post-processing kind: the generic finish
+ * pass, as before its variants are ready, vs the specialized variants,
+ * where a no-op finish leaves only the pyramid
+ */
+static int bench_finishes(const struct backends *b, GLuint input,
+                          int width, int height, int iterations) {
+	static const char *const names[WLBLUR_FINISH_COUNT] = {
+		[WLBLUR_FINISH_FULL] = "full",
+		[WLBLUR_FINISH_COLOR] = "color",
+		[WLBLUR_FINISH_NOISE] = "noise",
+		[WLBLUR_FINISH_NONE] = "none",
+	};
+	struct wlblur_kawase_renderer *kawase = b->kawase;
+
+	printf("=== Finish variants @ %dx%d (%d iterations, 3 passes) ===\n\n",
+	       width, height, iterations);
+	printf("%-8s %13s %6s %13s %6s\n", "finish", "generic (ms)", "MiB",
+	       "special (ms)", "MiB");
+
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT; kind++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		if (kind == WLBLUR_FINISH_COLOR || kind == WLBLUR_FINISH_NONE) {
+			params.noise = 0.0f;
+		}
+		if (kind == WLBLUR_FINISH_NOISE || kind == WLBLUR_FINISH_NONE) {
+			params.brightness = 1.0f;
+			params.contrast = 1.0f;
+			params.saturation = 1.0f;
+		}
+
+		printf("%-8s", names[kind]);
+		for (int special = 0; special < 2; special++) {
+			/* Hide the variants: the generic finish pass runs */
+			struct wlblur_shader_variant saved[WLBLUR_FINISH_COUNT];
+			memcpy(saved, kawase->finish_variants, sizeof(saved));
+			struct wlblur_blur_params run = params;
+			if (!special) {
+				for (int i = 0; i < WLBLUR_FINISH_COUNT; i++) {
+					kawase->finish_variants[i] =
+						(struct wlblur_shader_variant){ .failed = true };
+				}
+				kawase->fuse_finish = false;
+				/* The generic pass also ran for a no-op finish */
+				if (kind == WLBLUR_FINISH_NONE) {
+					run.noise = 1e-6f;
+				}
+			}
+
+			double ms = time_blur(b, BACKEND_FRAGMENT, input, width, height,
+			                      &run, iterations);
+			double mib = ms < 0.0 ? -1.0 :
+				peak_blur(b, BACKEND_FRAGMENT, input, width, height, &run);
+
+			memcpy(kawase->finish_variants, saved, sizeof(saved));
+			kawase->fuse_finish = true;
+			if (ms < 0.0 || mib < 0.0) {
+				fprintf(stderr, "\n[bench] %s finish blur failed\n",
+				        names[kind]);
+				return 1;
+			}
+			printf(" %13.3f %6.1f", ms, mib);
+		}
+		printf("\n");
+	}
+	printf("\n");
+	return 0;
+}
+
+/**
+ * Every algorithm at the strengths of the wlblurd standard presets
+ *
+ * Each algorithm gets fresh renderers: the shared FBO pool holds a fixed
+ * number of sizes, and the pyramids of all algorithms together exceed it.
+ */
+static int bench_algorithms(struct wlblur_egl_context *egl_ctx, GLuint input,
+                            int width, int height, int iterations) {
+	static const struct {
+		const char *name;
+		int num_passes;
+		float radius;
+	} presets[] = {
+		{ "tooltip", 1, 2.0f },
+		{ "panel", 2, 4.0f },
+		{ "window", 3, 8.0f },
+		{ "hud", 4, 12.0f },
+	};
+
+	static const struct {
+		const char *name;
+		enum backend backend;
+		enum wlblur_algorithm algorithm;
+		int box_iterations;
+	} columns[] = {
+		{ "kawase", BACKEND_FRAGMENT, WLBLUR_ALGO_KAWASE, 1 },
+		{ "gaussian", BACKEND_GAUSSIAN, WLBLUR_ALGO_GAUSSIAN, 1 },
+		{ "box", BACKEND_BOX, WLBLUR_ALGO_BOX, 1 },
+		{ "box x3", BACKEND_BOX, WLBLUR_ALGO_BOX, 3 },
+		{ "bokeh", BACKEND_BOKEH, WLBLUR_ALGO_BOKEH, 1 },
+		{ "iir", BACKEND_IIR, WLBLUR_ALGO_IIR, 1 },
+	};
+	enum {
+		NUM_PRESETS = sizeof(presets) / sizeof(presets[0]),
+		NUM_COLUMNS = sizeof(columns) / sizeof(columns[0]),
+	};
+
+	/* Negative: not built */
+	double ms[NUM_PRESETS][NUM_COLUMNS];
+	double mib[NUM_PRESETS][NUM_COLUMNS];
+
+	for (int c = 0; c < NUM_COLUMNS; c++) {
+		struct backends b;
+		if (!create_backends(egl_ctx, &b)) {
+			return 1;
+		}
+		build_variants(b.kawase);
+
+		for (int p = 0; p < NUM_PRESETS; p++) {
+			ms[p][c] = mib[p][c] = -1.0;
+			if (!backend_available(&b, columns[c].backend)) {
+				continue;
+			}
+
+			struct wlblur_blur_params params = wlblur_params_default();
+			params.algorithm = columns[c].algorithm;
+			params.num_passes = presets[p].num_passes;
+			params.radius = presets[p].radius;
+			params.box_iterations = columns[c].box_iterations;
+
+			ms[p][c] = time_blur(&b, columns[c].backend, input, width, height,
+			                     &params, iterations);
+			if (ms[p][c] >= 0.0) {
+				mib[p][c] = peak_blur(&b, columns[c].backend, input,
+				                      width, height, &params);
+			}
+			if (ms[p][c] < 0.0 || mib[p][c] < 0.0) {
+				fprintf(stderr, "[bench] %s blur failed (%s)\n",
+				        columns[c].name, presets[p].name);
+				destroy_backends(&b);
+				return 1;
+			}
+		}
+
+		destroy_backends(&b);
+	}
+
+	for (int t = 0; t < 2; t++) {
+		double (*values)[NUM_COLUMNS] = t == 0 ? ms : mib;
+		if (t == 0) {
+			printf("=== Algorithms @ %dx%d (%d iterations, ms) ===\n\n",
+			       width, height, iterations);
+		} else {
+			printf("=== Peak pooled memory per blur @ %dx%d (MiB) ===\n\n",
+			       width, height);
+		}
+		printf("%-8s %6s", "preset", "sigma");
+		for (int c = 0; c < NUM_COLUMNS; c++) {
+			printf(" %10s", columns[c].name);
+		}
+		printf("\n");
+
+		for (int p = 0; p < NUM_PRESETS; p++) {
+			struct wlblur_blur_params params = wlblur_params_default();
+			params.num_passes = presets[p].num_passes;
+			params.radius = presets[p].radius;
+
+			printf("%-8s %6.1f", presets[p].name,
+			       wlblur_params_compute(&params).sigma);
+			for (int c = 0; c < NUM_COLUMNS; c++) {
+				if (values[p][c] < 0.0) {
+					printf(" %10s", "n/a");
+				} else {
+					printf(" %10.3f", values[p][c]);
+				}
+			}
+			printf("\n");
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+/**
+ * Milliseconds from creating every renderer to the first blur's result,
+ * as at daemon startup, or -1 on failure
+ */
+static double time_startup(struct wlblur_egl_context *egl_ctx, GLuint input,
+                           int width, int height) {
+	struct wlblur_blur_params params = wlblur_params_default();
+	struct backends b;
+
+	double start = now_ms();
+	if (!create_backends(egl_ctx, &b)) {
+		return -1.0;
+	}
+	bool ok = run_blur(&b, BACKEND_FRAGMENT, input, width, height, &params);
+	double ms = now_ms() - start;
+
+	destroy_backends(&b);
+	return ok ? ms : -1.0;
+}
+
+/**
+ * Delete the cache files of a temporary XDG_CACHE_HOME, then the directory
+ */
+static void remove_cache(const char *base) {
+	char dir[256];
+	snprintf(dir, sizeof(dir), "%s/wlblur", base);
+
+	DIR *d = opendir(dir);
+	if (d) {
+		struct dirent *entry;
+		while ((entry = readdir(d))) {
+			char path[512];
+			snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+			if (entry->d_name[0] != '.') {
+				unlink(path);
+			}
+		}
+		closedir(d);
+	}
+	rmdir(dir);
+	rmdir(base);
+}
+
+/**
+ * Startup with the program binary cache disabled, empty (compiles and
+ * writes it) and filled. The driver's own shader cache, if any, stays on.
+ */
+static int bench_startup(struct wlblur_egl_context *egl_ctx, GLuint input,
+                         int width, int height, int iterations) {
+	char base[] = "/tmp/wlblur-bench-XXXXXX";
+	if (!mkdtemp(base)) {
+		fprintf(stderr, "[bench] Failed to create cache directory\n");
+		return 1;
+	}
+
+	char *saved = getenv("XDG_CACHE_HOME");
+	saved = saved ? strdup(saved) : NULL;
+	setenv("XDG_CACHE_HOME", base, 1);
+
+	setenv("WLBLUR_SHADER_CACHE", "0", 1);
+	double off = 0.0;
+	for (int i = 0; i < iterations && off >= 0.0; i++) {
+		double ms = time_startup(egl_ctx, input, width, height);
+		off = ms < 0.0 ? -1.0 : off + ms / iterations;
+	}
+	unsetenv("WLBLUR_SHADER_CACHE");
+
+	double cold = time_startup(egl_ctx, input, width, height);
+	double warm = 0.0;
+	for (int i = 0; i < iterations && warm >= 0.0; i++) {
+		double ms = time_startup(egl_ctx, input, width, height);
+		warm = ms < 0.0 ? -1.0 : warm + ms / iterations;
+	}
+
+	remove_cache(base);
+	if (saved) {
+		setenv("XDG_CACHE_HOME", saved, 1);
+		free(saved);
+	} else {
+		unsetenv("XDG_CACHE_HOME");
+	}
+
+	if (off < 0.0 || cold < 0.0 || warm < 0.0) {
+		fprintf(stderr, "[bench] Startup blur failed\n");
+		return 1;
+	}
+
+	printf("=== Startup to first blur @ %dx%d (%d iterations, ms) ===\n\n",
+	       width, height, iterations);
+	printf("%-16s %10s\n", "program cache", "ms");
+	printf("%-16s %10.3f\n", "off", off);
+	printf("%-16s %10.3f\n", "empty", cold);
+	printf("%-16s %10.3f\n", "filled", warm);
+	printf("\n");
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int width = argc > 2 ? atoi(argv[1]) : 1920;
+	int height = argc > 2 ? atoi(argv[2]) : 1080;
+	int iterations = argc > 3 ? atoi(argv[3]) : 10;
+
+	if (width <= 0 || height <= 0 || iterations <= 0) {
+		fprintf(stderr, "usage: %s [width height [iterations]]\n", argv[0]);
+		return 1;
+	}
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[bench] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	struct backends b;
+	if (!create_backends(egl_ctx, &b)) {
+		wlblur_egl_destroy(egl_ctx);
+		return 1;
+	}
+	build_variants(b.kawase);
+
+	/* Input content does not affect timing */
+	GLuint input;
+	glGenTextures(1, &input);
+	glBindTexture(GL_TEXTURE_2D, input);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	int status = bench_backends(&b, input, width, height, iterations);
+	if (status == 0) {
+		status = bench_formats(&b, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_layouts(&b, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_finishes(&b, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_algorithms(egl_ctx, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_regions(&b, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_shared(&b, input, width, height, iterations);
+	}
+	if (status == 0) {
+		status = bench_startup(egl_ctx, input, width, height, iterations);
+	}
+
+	glDeleteTextures(1, &input);
+	destroy_backends(&b);
+	wlblur_egl_destroy(egl_ctx);
+	return status;
+}
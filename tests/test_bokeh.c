@@ -0,0 +1,387 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * test_bokeh.c - Hexagonal bokeh algorithm unit tests
+ *
+ * Compares the renderer against a CPU hexagon average of the same size,
+ * and checks that a bright spot spreads into a hexagon.
+ * Exits 77 (skip) when no EGL context can be created.
+ */
+
+#include "wlblur/wlblur.h"
+#include "wlblur/blur_params.h"
+#include "../libwlblur/private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 200
+
+/**
+ * Fill buffer with a deterministic pattern (checkerboard + gradients)
+ */
+static void fill_pattern(unsigned char *pixels, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			unsigned char *p = &pixels[(y * width + x) * 4];
+			bool white = ((x / 16) + (y / 16)) % 2 == 0;
+			p[0] = white ? 240 : (unsigned char)(x * 255 / width);
+			p[1] = white ? 240 : (unsigned char)(y * 255 / height);
+			p[2] = white ? 240 : 32;
+			p[3] = 255;
+		}
+	}
+}
+
+/**
+ * Upload RGBA pixels as a new texture
+ */
+static GLuint upload_texture(const unsigned char *pixels, int width, int height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+/**
+ * Read back a texture's contents through a temporary FBO
+ */
+static void read_texture(GLuint texture, int width, int height,
+                         unsigned char *pixels) {
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+/**
+ * Hand a pooled blur result back to the renderer's FBO pool
+ */
+static void release_output(struct wlblur_kawase_renderer *renderer,
+                           GLuint texture) {
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+		}
+	}
+}
+
+/**
+ * Half-width of the CPU hexagon (pointy top, circumradius r) in row dy
+ */
+static int hexagon_half_width(float r, int dy) {
+	float by_side = 0.8660254f * r;
+	float by_slope = 1.7320508f * (r - (float)abs(dy));
+	return (int)floorf(by_side < by_slope ? by_side : by_slope);
+}
+
+/**
+ * CPU average over a hexagon of circumradius r (clamp to edge), one
+ * channel at a time through per-row prefix sums
+ */
+static void cpu_hexagon(const unsigned char *src, float *dst, int width,
+                        int height, float r) {
+	int rows = (int)floorf(r);
+	double *prefix = malloc((size_t)height * (width + 1) * sizeof(double));
+
+	for (int c = 0; c < 4; c++) {
+		for (int y = 0; y < height; y++) {
+			double *row = &prefix[(size_t)y * (width + 1)];
+			row[0] = 0.0;
+			for (int x = 0; x < width; x++) {
+				row[x + 1] = row[x] + src[(y * width + x) * 4 + c];
+			}
+		}
+
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				double sum = 0.0;
+				int count = 0;
+				for (int dy = -rows; dy <= rows; dy++) {
+					int sy = y + dy;
+					sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+					const double *row = &prefix[(size_t)sy * (width + 1)];
+					const unsigned char *line = &src[sy * width * 4];
+
+					int half = hexagon_half_width(r, dy);
+					int x0 = x - half, x1 = x + half;
+					count += x1 - x0 + 1;
+
+					/* Texels left and right of the image repeat the edge */
+					if (x0 < 0) {
+						sum += (double)-x0 * line[c];
+						x0 = 0;
+					}
+					if (x1 >= width) {
+						sum += (double)(x1 - width + 1) *
+						       line[(width - 1) * 4 + c];
+						x1 = width - 1;
+					}
+					if (x0 <= x1) {
+						sum += row[x1 + 1] - row[x0];
+					}
+				}
+				dst[(y * width + x) * 4 + c] = (float)(sum / count);
+			}
+		}
+	}
+
+	free(prefix);
+}
+
+/**
+ * Blur with identity post-processing
+ *
+ * @return Pixels (caller frees) or NULL on failure
+ */
+static unsigned char* render_bokeh(struct wlblur_bokeh_renderer *renderer,
+                                   const unsigned char *pixels,
+                                   int num_passes, float radius) {
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	unsigned char *result = malloc((size_t)w * h * 4);
+	if (!result) {
+		return NULL;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.algorithm = WLBLUR_ALGO_BOKEH;
+	params.num_passes = num_passes;
+	params.radius = radius;
+	params.brightness = 1.0f;
+	params.contrast = 1.0f;
+	params.saturation = 1.0f;
+	params.noise = 0.0f;
+
+	GLuint input = upload_texture(pixels, w, h);
+	GLuint output = wlblur_bokeh_blur(renderer, input, w, h, &params);
+	glDeleteTextures(1, &input);
+	if (!output) {
+		fprintf(stderr, "[test] ✗ Bokeh blur failed\n");
+		free(result);
+		return NULL;
+	}
+
+	read_texture(output, w, h, result);
+	release_output(renderer->kawase, output);
+	return result;
+}
+
+/**
+ * Circumradius of the hexagon for the given passes/radius
+ */
+static float hexagon_radius(int num_passes, float radius) {
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = num_passes;
+	params.radius = radius;
+	return sqrtf(24.0f / 5.0f) * wlblur_params_compute(&params).sigma;
+}
+
+/**
+ * Compare against the CPU hexagon average of the same size
+ */
+static bool check_against_reference(struct wlblur_bokeh_renderer *renderer,
+                                    int num_passes, float radius,
+                                    int max_allowed, double mean_allowed) {
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t count = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(count);
+	float *expected = malloc(count * sizeof(float));
+	unsigned char *result = NULL;
+	bool ok = false;
+
+	if (!pixels || !expected) {
+		goto out;
+	}
+
+	fill_pattern(pixels, w, h);
+	result = render_bokeh(renderer, pixels, num_passes, radius);
+	if (!result) {
+		goto out;
+	}
+
+	float r = hexagon_radius(num_passes, radius);
+	cpu_hexagon(pixels, expected, w, h, r);
+
+	/* Lines that leave the image clamp one by one, so the skewed passes
+	 * repeat edge texels along different paths than the 2D reference:
+	 * only compare where the whole hexagon is inside */
+	int border = (int)ceilf(r);
+	int max_diff = 0;
+	double total = 0.0;
+	size_t compared = 0;
+	for (int y = border; y < h - border; y++) {
+		for (int x = border; x < w - border; x++) {
+			for (int c = 0; c < 4; c++) {
+				size_t i = (size_t)(y * w + x) * 4 + c;
+				int diff = abs((int)result[i] - (int)lroundf(expected[i]));
+				total += diff;
+				compared++;
+				if (diff > max_diff) {
+					max_diff = diff;
+				}
+			}
+		}
+	}
+	double mean = total / compared;
+
+	ok = max_diff <= max_allowed && mean <= mean_allowed;
+	printf("[test] %s passes=%d radius=%.0f (hexagon %.1f): max %d, mean %.2f\n",
+	       ok ? "✓" : "✗", num_passes, radius, r, max_diff, mean);
+
+out:
+	free(pixels);
+	free(expected);
+	free(result);
+	return ok;
+}
+
+/**
+ * Quarter resolution, taps one texel apart
+ */
+static bool test_quarter_resolution(struct wlblur_bokeh_renderer *renderer) {
+	printf("[test] Testing quarter-resolution bokeh...\n");
+
+	/* The 2x2 reduction and the upsample soften the hexagon's edges by
+	 * about a level texel, which shows on small hexagons */
+	bool ok = check_against_reference(renderer, 1, 5.0f, 20, 1.5);
+	ok &= check_against_reference(renderer, 3, 5.0f, 4, 0.5);
+	return ok;
+}
+
+/**
+ * Large apertures drop below quarter resolution
+ */
+static bool test_reduced_resolution(struct wlblur_bokeh_renderer *renderer) {
+	printf("[test] Testing reduced-resolution bokeh...\n");
+	return check_against_reference(renderer, 3, 8.0f, 4, 0.5);
+}
+
+/**
+ * Half extents of the lit area through the center, along each axis
+ */
+static void lit_extent(const unsigned char *red, size_t stride, int width,
+                       int height, int *half_x, int *half_y) {
+	*half_x = *half_y = 0;
+	for (int x = width / 2; x < width &&
+	     red[(height / 2 * width + x) * stride] > 4; x++) {
+		*half_x = x - width / 2;
+	}
+	for (int y = height / 2; y < height &&
+	     red[(y * width + width / 2) * stride] > 4; y++) {
+		*half_y = y - height / 2;
+	}
+}
+
+/**
+ * A bright square spreads into a hexagon with vertices up and down: it
+ * reaches further vertically (R) than horizontally (R × sqrt(3) / 2)
+ */
+static bool test_hexagon_shape(struct wlblur_bokeh_renderer *renderer) {
+	printf("[test] Testing hexagonal aperture...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	const int spot = 16;
+	unsigned char *pixels = calloc((size_t)w * h, 4);
+	float *expected = malloc((size_t)w * h * 4 * sizeof(float));
+	unsigned char *reference = malloc((size_t)w * h);
+	unsigned char *result = NULL;
+	bool ok = false;
+
+	if (!pixels || !expected || !reference) {
+		goto out;
+	}
+
+	for (int y = h / 2 - spot / 2; y < h / 2 + spot / 2; y++) {
+		for (int x = w / 2 - spot / 2; x < w / 2 + spot / 2; x++) {
+			memset(&pixels[(y * w + x) * 4], 255, 4);
+		}
+	}
+
+	result = render_bokeh(renderer, pixels, 2, 5.0f);
+	if (!result) {
+		goto out;
+	}
+
+	float r = hexagon_radius(2, 5.0f);
+	cpu_hexagon(pixels, expected, w, h, r);
+	for (int i = 0; i < w * h; i++) {
+		reference[i] = (unsigned char)lroundf(expected[i * 4]);
+	}
+
+	/* The hexagon's sides are vertical, so the lit area ends abruptly
+	 * left and right but tapers towards the vertices above and below */
+	int half_x, half_y, ref_x, ref_y;
+	lit_extent(result, 4, w, h, &half_x, &half_y);
+	lit_extent(reference, 1, w, h, &ref_x, &ref_y);
+
+	/* Flat top: halfway out is as bright as the center, unlike a
+	 * Gaussian, which has fallen to about a third there */
+	unsigned char center = result[(h / 2 * w + w / 2) * 4];
+	unsigned char halfway = result[(h / 2 * w + w / 2 + half_x / 2) * 4];
+
+	ok = abs(half_x - ref_x) <= 1 && abs(half_y - ref_y) <= 1 &&
+	     abs((int)halfway - (int)center) <= center / 8;
+	printf("[test] %s hexagon %.1f: extent %d x %d (expected %d x %d), "
+	       "center %d, halfway %d\n", ok ? "✓" : "✗", r, 2 * half_x,
+	       2 * half_y, 2 * ref_x, 2 * ref_y, center, halfway);
+
+out:
+	free(pixels);
+	free(expected);
+	free(reference);
+	free(result);
+	return ok;
+}
+
+int main(void) {
+	printf("\n=== wlblur Bokeh Test Suite ===\n\n");
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[test] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	struct wlblur_kawase_renderer *kawase = wlblur_kawase_create(egl_ctx);
+	struct wlblur_bokeh_renderer *renderer =
+		kawase ? wlblur_bokeh_create(kawase) : NULL;
+	if (!renderer) {
+		fprintf(stderr, "[test] ✗ Failed to create bokeh renderer\n");
+		wlblur_kawase_destroy(kawase);
+		wlblur_egl_destroy(egl_ctx);
+		return 1;
+	}
+
+	bool all_passed = true;
+	all_passed &= test_quarter_resolution(renderer);
+	all_passed &= test_reduced_resolution(renderer);
+	all_passed &= test_hexagon_shape(renderer);
+
+	wlblur_bokeh_destroy(renderer);
+	wlblur_kawase_destroy(kawase);
+	wlblur_egl_destroy(egl_ctx);
+
+	printf("\n=== Test Results ===\n");
+	if (all_passed) {
+		printf("✓ All tests passed!\n\n");
+		return 0;
+	} else {
+		printf("✗ Some tests failed\n\n");
+		return 1;
+	}
+}
@@ -0,0 +1,268 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * test_box.c - Summed-area table box blur unit tests
+ *
+ * Compares the renderer against a CPU box filter with the same box sizes.
+ * Exits 77 (skip) when no EGL context can be created.
+ */
+
+#include "wlblur/wlblur.h"
+#include "wlblur/blur_params.h"
+#include "../libwlblur/private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 200
+
+/**
+ * Fill buffer with a deterministic pattern (checkerboard + gradients)
+ */
+static void fill_pattern(unsigned char *pixels, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			unsigned char *p = &pixels[(y * width + x) * 4];
+			bool white = ((x / 16) + (y / 16)) % 2 == 0;
+			p[0] = white ? 240 : (unsigned char)(x * 255 / width);
+			p[1] = white ? 240 : (unsigned char)(y * 255 / height);
+			p[2] = white ? 240 : 32;
+			p[3] = 255;
+		}
+	}
+}
+
+/**
+ * Upload RGBA pixels as a new texture
+ */
+static GLuint upload_texture(const unsigned char *pixels, int width, int height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+/**
+ * Read back a texture's contents through a temporary FBO
+ */
+static void read_texture(GLuint texture, int width, int height,
+                         unsigned char *pixels) {
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+/**
+ * Hand a pooled blur result back to the renderer's FBO pool
+ */
+static void release_output(struct wlblur_kawase_renderer *renderer,
+                           GLuint texture) {
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+		}
+	}
+}
+
+/**
+ * Box half-widths for sigma, as chosen by blur_box.c (Kovesi 2010)
+ *
+ * For reduced-size tables the renderer's boxes are smaller and on a
+ * coarser grid; these full-size boxes have the same total variance.
+ */
+static void box_radii(float sigma, int n, int *radii) {
+	float ideal = sqrtf(12.0f * sigma * sigma / n + 1.0f);
+	int lower = (int)floorf(ideal);
+	if (lower % 2 == 0) {
+		lower--;
+	}
+
+	float m = (12.0f * sigma * sigma - n * lower * lower - 4.0f * n * lower -
+	           3.0f * n) / (-4.0f * lower - 4.0f);
+	int num_lower = (int)lroundf(m);
+
+	for (int i = 0; i < n; i++) {
+		int width = i < num_lower ? lower : lower + 2;
+		radii[i] = (width - 1) / 2;
+	}
+}
+
+/**
+ * CPU box filter, clipped at the edges and rounded to 8 bits like the
+ * renderer's RGBA8 intermediates
+ */
+static void cpu_box(const unsigned char *src, unsigned char *dst,
+                    int width, int height, int radius) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int x1 = x - radius < 0 ? 0 : x - radius;
+			int y1 = y - radius < 0 ? 0 : y - radius;
+			int x2 = x + radius >= width ? width - 1 : x + radius;
+			int y2 = y + radius >= height ? height - 1 : y + radius;
+			int area = (x2 - x1 + 1) * (y2 - y1 + 1);
+
+			for (int c = 0; c < 4; c++) {
+				long sum = 0;
+				for (int sy = y1; sy <= y2; sy++) {
+					for (int sx = x1; sx <= x2; sx++) {
+						sum += src[(sy * width + sx) * 4 + c];
+					}
+				}
+				dst[(y * width + x) * 4 + c] =
+					(unsigned char)lround((double)sum / area);
+			}
+		}
+	}
+}
+
+/**
+ * Blur with identity post-processing and compare against the CPU boxes
+ */
+static bool check_against_reference(struct wlblur_box_renderer *renderer,
+                                    int num_passes, float radius,
+                                    int iterations, int max_allowed,
+                                    double mean_allowed) {
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t count = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(count);
+	unsigned char *result = malloc(count);
+	unsigned char *a = malloc(count);
+	unsigned char *b = malloc(count);
+	bool ok = false;
+
+	if (!pixels || !result || !a || !b) {
+		goto out;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.algorithm = WLBLUR_ALGO_BOX;
+	params.num_passes = num_passes;
+	params.radius = radius;
+	params.box_iterations = iterations;
+	params.brightness = 1.0f;
+	params.contrast = 1.0f;
+	params.saturation = 1.0f;
+	params.noise = 0.0f;
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	GLuint output = wlblur_box_blur(renderer, input, w, h, &params);
+	if (!output) {
+		fprintf(stderr, "[test] ✗ Box blur failed\n");
+		glDeleteTextures(1, &input);
+		goto out;
+	}
+	read_texture(output, w, h, result);
+	release_output(renderer->kawase, output);
+	glDeleteTextures(1, &input);
+
+	int radii[4];
+	box_radii(wlblur_params_compute(&params).sigma, iterations, radii);
+
+	memcpy(a, pixels, count);
+	for (int i = 0; i < iterations; i++) {
+		cpu_box(a, b, w, h, radii[i]);
+		memcpy(a, b, count);
+	}
+
+	int max_diff = 0;
+	double total = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		int diff = abs((int)result[i] - (int)a[i]);
+		total += diff;
+		if (diff > max_diff) {
+			max_diff = diff;
+		}
+	}
+	double mean = total / count;
+
+	ok = max_diff <= max_allowed && mean <= mean_allowed;
+	printf("[test] %s passes=%d radius=%.0f, %d box(es) of radius %d..%d: "
+	       "max %d, mean %.2f\n", ok ? "✓" : "✗", num_passes, radius,
+	       iterations, radii[0], radii[iterations - 1], max_diff, mean);
+
+out:
+	free(pixels);
+	free(result);
+	free(a);
+	free(b);
+	return ok;
+}
+
+/**
+ * Full-size tables: sums are exact integers, so only the final rounding
+ * may differ
+ */
+static bool test_full_size(struct wlblur_box_renderer *renderer) {
+	printf("[test] Testing full-size boxes...\n");
+
+	bool ok = check_against_reference(renderer, 1, 2.0f, 1, 1, 0.5);
+	ok &= check_against_reference(renderer, 1, 5.0f, 1, 1, 0.5);
+	ok &= check_against_reference(renderer, 1, 5.0f, 3, 1, 0.5);
+	return ok;
+}
+
+/**
+ * Large sigma: boxes on a block-averaged table, then upsampled
+ */
+static bool test_reduced_size(struct wlblur_box_renderer *renderer) {
+	printf("[test] Testing reduced-size boxes...\n");
+
+	/* Block averaging and the bilinear upsample soften the box edges */
+	bool ok = check_against_reference(renderer, 2, 5.0f, 1, 12, 1.0);
+	ok &= check_against_reference(renderer, 3, 5.0f, 3, 12, 1.0);
+	return ok;
+}
+
+int main(void) {
+	printf("\n=== wlblur Box Test Suite ===\n\n");
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[test] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	struct wlblur_kawase_renderer *kawase = wlblur_kawase_create(egl_ctx);
+	struct wlblur_box_renderer *renderer =
+		kawase ? wlblur_box_create(kawase) : NULL;
+	if (!renderer) {
+		fprintf(stderr, "[test] ✗ Failed to create box renderer\n");
+		wlblur_kawase_destroy(kawase);
+		wlblur_egl_destroy(egl_ctx);
+		return 1;
+	}
+
+	bool all_passed = true;
+	all_passed &= test_full_size(renderer);
+	all_passed &= test_reduced_size(renderer);
+
+	wlblur_box_destroy(renderer);
+	wlblur_kawase_destroy(kawase);
+	wlblur_egl_destroy(egl_ctx);
+
+	printf("\n=== Test Results ===\n");
+	if (all_passed) {
+		printf("✓ All tests passed!\n\n");
+		return 0;
+	} else {
+		printf("✗ Some tests failed\n\n");
+		return 1;
+	}
+}
@@ -0,0 +1,355 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * test_daemon.c - In-process wlblurd request handling tests
+ *
+ * Links the daemon's sources and drives handle_client_request() over a
+ * socketpair, so FD handling is checked without a running daemon. Tests
+ * that render need a blur context (DMA-BUF import and export) and are
+ * skipped without one.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include "protocol.h"
+#include "config.h"
+#include <wlblur/wlblur.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static struct daemon_config *config;
+
+/* Provided by main.c in wlblurd */
+struct daemon_config* get_global_config(void) {
+    return config;
+}
+
+/**
+ * Number of FDs open in this process
+ */
+static int count_open_fds(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return -1;
+    }
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count - 1;  // The directory's own FD
+}
+
+/**
+ * Send a request with fds attached, let the daemon handle it and read
+ * its response
+ *
+ * @param resp_fd Set to the response's first FD, or -1 (NULL closes it)
+ */
+static bool round_trip(int sock, int daemon_fd,
+                       const struct wlblur_request *req,
+                       const int *fds, int num_fds,
+                       struct wlblur_response *resp, int *resp_fd) {
+    struct iovec iov = {
+        .iov_base = (void*)req,
+        .iov_len = sizeof(*req),
+    };
+    char control_buf[CMSG_SPACE(4 * sizeof(int))];
+    struct msghdr msg = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (num_fds > 0) {
+        msg.msg_control = control_buf;
+        msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, num_fds * sizeof(int));
+    }
+
+    if (sendmsg(sock, &msg, 0) != (ssize_t)sizeof(*req)) {
+        perror("[test] sendmsg");
+        return false;
+    }
+
+    handle_client_request(daemon_fd);
+
+    int fd = -1;
+    int fence_fd = -1;
+    bool dropped;
+    ssize_t n = recv_with_fd(sock, resp, sizeof(*resp), &fd, &fence_fd,
+                             &dropped);
+    if (fence_fd >= 0) {
+        close(fence_fd);
+    }
+    if (resp_fd) {
+        *resp_fd = fd;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+    return n == (ssize_t)sizeof(*resp);
+}
+
+/**
+ * A request with more FDs than the protocol allows must be rejected,
+ * and the daemon must close the FDs it received
+ */
+static bool test_extra_fds_rejected(int sock, int daemon_fd) {
+    printf("[test] Testing request with too many FDs...\n");
+
+    int before = count_open_fds();
+
+    int fds[3];
+    for (int i = 0; i < 3; i++) {
+        fds[i] = eventfd(0, EFD_CLOEXEC);
+    }
+
+    struct wlblur_request req = {0};
+    req.protocol_version = WLBLUR_PROTOCOL_VERSION;
+    req.op = WLBLUR_OP_RENDER_BLUR;
+    req.width = 64;
+    req.height = 64;
+    req.acquire_fence_type = WLBLUR_FENCE_EVENTFD;
+
+    struct wlblur_response resp = {0};
+    bool sent = round_trip(sock, daemon_fd, &req, fds, 3, &resp, NULL);
+    for (int i = 0; i < 3; i++) {
+        close(fds[i]);
+    }
+
+    if (!sent) {
+        fprintf(stderr, "[test] ✗ No response to the request\n");
+        return false;
+    }
+    if (resp.status != WLBLUR_STATUS_INVALID_PARAMS) {
+        fprintf(stderr, "[test] ✗ Expected INVALID_PARAMS, got status %u\n",
+                resp.status);
+        return false;
+    }
+
+    int after = count_open_fds();
+    if (after != before) {
+        fprintf(stderr, "[test] ✗ %d FDs leaked\n", after - before);
+        return false;
+    }
+
+    printf("[test] ✓ Request with 3 FDs rejected, its FDs closed\n");
+    return true;
+}
+
+/**
+ * A registered-buffer render sends its fence as the only FD; the daemon
+ * must not take it for a DMA-BUF. The buffer is unknown, so the request
+ * fails for lack of input, not for its node.
+ */
+static bool test_fence_only_render(int sock, int daemon_fd) {
+    printf("[test] Testing registered-buffer render with a lone fence...\n");
+
+    int before = count_open_fds();
+    int fence = eventfd(1, EFD_CLOEXEC);
+
+    struct wlblur_request req = {0};
+    req.protocol_version = WLBLUR_PROTOCOL_VERSION;
+    req.op = WLBLUR_OP_RENDER_BLUR;
+    req.buffer_id = 42;
+    req.acquire_fence_type = WLBLUR_FENCE_EVENTFD;
+
+    struct wlblur_response resp = {0};
+    bool sent = round_trip(sock, daemon_fd, &req, &fence, 1, &resp, NULL);
+    close(fence);
+
+    if (!sent) {
+        fprintf(stderr, "[test] ✗ No response to the request\n");
+        return false;
+    }
+    if (resp.status != WLBLUR_STATUS_INVALID_PARAMS) {
+        fprintf(stderr, "[test] ✗ Expected INVALID_PARAMS, got status %u\n",
+                resp.status);
+        return false;
+    }
+
+    int after = count_open_fds();
+    if (after != before) {
+        fprintf(stderr, "[test] ✗ %d FDs leaked\n", after - before);
+        return false;
+    }
+
+    printf("[test] ✓ Lone FD taken as the fence, not as a DMA-BUF\n");
+    return true;
+}
+
+/**
+ * Render a registered buffer, fenced by an eventfd sent as the only FD
+ */
+static bool test_registered_buffer_fence(int sock, int daemon_fd,
+                                         struct wlblur_context *ctx) {
+    printf("[test] Testing fenced render of a registered buffer...\n");
+
+    const int size = 64;
+    uint32_t *pixels = malloc(size * size * 4);
+    if (!pixels) {
+        return false;
+    }
+    for (int i = 0; i < size * size; i++) {
+        pixels[i] = (i / size + i % size) % 2 ? 0xffffffff : 0xff000000;
+    }
+
+    struct wlblur_dmabuf_attribs attribs = {0};
+    bool uploaded = wlblur_upload_pixels(ctx, pixels, size, size, &attribs);
+    free(pixels);
+    if (!uploaded) {
+        fprintf(stderr, "[test] ✗ Cannot create input buffer: %s\n",
+                wlblur_error_string(wlblur_get_error()));
+        return false;
+    }
+
+    // Register the buffer
+    struct wlblur_request req = {0};
+    req.protocol_version = WLBLUR_PROTOCOL_VERSION;
+    req.op = WLBLUR_OP_IMPORT_DMABUF;
+    req.width = attribs.width;
+    req.height = attribs.height;
+    req.format = attribs.format;
+    req.modifier = attribs.modifier;
+    req.stride = attribs.planes[0].stride;
+    req.offset = attribs.planes[0].offset;
+
+    struct wlblur_response resp = {0};
+    bool sent = round_trip(sock, daemon_fd, &req, &attribs.planes[0].fd, 1,
+                           &resp, NULL);
+    wlblur_dmabuf_close(&attribs);
+    if (!sent || resp.status != WLBLUR_STATUS_SUCCESS) {
+        fprintf(stderr, "[test] ✗ IMPORT_DMABUF failed (status %u)\n",
+                resp.status);
+        return false;
+    }
+    uint32_t buffer_id = resp.buffer_id;
+
+    // Create the node
+    req.op = WLBLUR_OP_CREATE_NODE;
+    req.params = wlblur_params_default();
+    if (!round_trip(sock, daemon_fd, &req, NULL, 0, &resp, NULL) ||
+        resp.status != WLBLUR_STATUS_SUCCESS) {
+        fprintf(stderr, "[test] ✗ CREATE_NODE failed (status %u)\n",
+                resp.status);
+        return false;
+    }
+    uint32_t node_id = resp.node_id;
+
+    // Signalled fence: the render goes through
+    req.op = WLBLUR_OP_RENDER_BLUR;
+    req.node_id = node_id;
+    req.buffer_id = buffer_id;
+    req.acquire_fence_type = WLBLUR_FENCE_EVENTFD;
+
+    int fence = eventfd(1, EFD_CLOEXEC);
+    int output_fd = -1;
+    sent = round_trip(sock, daemon_fd, &req, &fence, 1, &resp, &output_fd);
+    close(fence);
+    if (output_fd >= 0) {
+        close(output_fd);
+    }
+
+    bool passed = true;
+    if (!sent || resp.status != WLBLUR_STATUS_SUCCESS || output_fd < 0) {
+        fprintf(stderr, "[test] ✗ Signalled render failed (status %u)\n",
+                resp.status);
+        passed = false;
+    }
+
+    // Unsignalled fence: the daemon times out waiting on it
+    if (passed) {
+        fence = eventfd(0, EFD_CLOEXEC);
+        sent = round_trip(sock, daemon_fd, &req, &fence, 1, &resp, NULL);
+        close(fence);
+        if (!sent || resp.status != WLBLUR_STATUS_RENDER_FAILED) {
+            fprintf(stderr, "[test] ✗ Expected RENDER_FAILED for an "
+                    "unsignalled fence, got status %u\n", resp.status);
+            passed = false;
+        }
+    }
+
+    memset(&req, 0, sizeof(req));
+    req.protocol_version = WLBLUR_PROTOCOL_VERSION;
+    req.op = WLBLUR_OP_DESTROY_NODE;
+    req.node_id = node_id;
+    round_trip(sock, daemon_fd, &req, NULL, 0, &resp, NULL);
+
+    req.op = WLBLUR_OP_RELEASE_BUFFER;
+    req.buffer_id = buffer_id;
+    round_trip(sock, daemon_fd, &req, NULL, 0, &resp, NULL);
+
+    if (passed) {
+        printf("[test] ✓ Registered buffer rendered after its fence\n");
+    }
+    return passed;
+}
+
+int main(void) {
+    printf("\n=== wlblurd Request Handling Test Suite ===\n\n");
+
+    config = config_load("/nonexistent/wlblur-test.toml");
+    if (!config) {
+        fprintf(stderr, "[test] ✗ Cannot create default config\n");
+        return 1;
+    }
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+        perror("[test] socketpair");
+        config_free(config);
+        return 1;
+    }
+    if (client_register(sv[1]) == 0) {
+        fprintf(stderr, "[test] ✗ Cannot register client\n");
+        close(sv[0]);
+        close(sv[1]);
+        config_free(config);
+        return 1;
+    }
+
+    // Rendering needs DMA-BUF import and export
+    bool can_render = ipc_protocol_init();
+    struct wlblur_context *ctx = can_render ? wlblur_context_create() : NULL;
+
+    bool all_passed = true;
+    all_passed &= test_extra_fds_rejected(sv[0], sv[1]);
+    all_passed &= test_fence_only_render(sv[0], sv[1]);
+    if (ctx) {
+        all_passed &= test_registered_buffer_fence(sv[0], sv[1], ctx);
+    } else {
+        printf("[test] Skipping render tests: no blur context\n");
+    }
+
+    client_unregister(sv[1]);
+    close(sv[0]);
+    ipc_protocol_cleanup();
+    if (ctx) {
+        wlblur_context_destroy(ctx);
+    }
+    config_free(config);
+
+    printf("\n=== Test Results ===\n");
+    if (all_passed) {
+        printf("✓ All tests passed!\n\n");
+        return 0;
+    } else {
+        printf("✗ Some tests failed\n\n");
+        return 1;
+    }
+}
@@ -0,0 +1,203 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * test_fence.c - Explicit synchronization tests
+ *
+ * Exercises the EGL_KHR_fence_sync + eventfd fallback, which Mesa
+ * llvmpipe supports, and sync_file export where the driver has it.
+ * Exits 77 (skip) when no EGL context or fence support is available.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "wlblur/wlblur.h"
+#include "../libwlblur/private/internal.h"
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Queue some GL work for a fence to cover
+ */
+static void submit_work(void) {
+	GLuint texture, fbo;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 512, 512);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+	glClearColor(0.25f, 0.5f, 0.75f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+	glDeleteTextures(1, &texture);
+}
+
+/**
+ * Whether a fence FD signals within timeout_ms
+ */
+static bool fence_signals(int fd, int timeout_ms) {
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	return poll(&pfd, 1, timeout_ms) == 1 && (pfd.revents & POLLIN);
+}
+
+static double now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static bool test_eventfd_export(struct wlblur_egl_context *egl) {
+	printf("[test] Testing eventfd release fence...\n");
+
+	submit_work();
+	enum wlblur_fence_type type;
+	int fd = wlblur_fence_export(egl, false, &type);
+	if (fd < 0 || type != WLBLUR_FENCE_EVENTFD) {
+		fprintf(stderr, "[test] ✗ Export failed (fd %d, type %d)\n", fd, type);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	bool ok = fence_signals(fd, 5000);
+	uint64_t value = 0;
+	if (ok && read(fd, &value, sizeof(value)) != sizeof(value)) {
+		ok = false;
+	}
+	close(fd);
+
+	if (!ok || value != 1) {
+		fprintf(stderr, "[test] ✗ Fence did not signal (value %llu)\n",
+		        (unsigned long long)value);
+		return false;
+	}
+
+	// Fences signal in submission order, with the worker already running
+	int fds[4];
+	for (int i = 0; i < 4; i++) {
+		submit_work();
+		fds[i] = wlblur_fence_export(egl, false, &type);
+	}
+	for (int i = 0; i < 4; i++) {
+		ok &= fds[i] >= 0 && fence_signals(fds[i], 5000);
+		if (fds[i] >= 0) {
+			close(fds[i]);
+		}
+	}
+	if (!ok) {
+		fprintf(stderr, "[test] ✗ Back-to-back fences did not signal\n");
+		return false;
+	}
+
+	printf("[test] ✓ Eventfd fences signal after the GPU work\n");
+	return true;
+}
+
+static bool test_native_export(struct wlblur_egl_context *egl) {
+	printf("[test] Testing sync_file release fence...\n");
+
+	if (!egl->has_native_fence) {
+		printf("[test] - EGL_ANDROID_native_fence_sync unavailable, skipped\n");
+		return true;
+	}
+
+	submit_work();
+	enum wlblur_fence_type type;
+	int fd = wlblur_fence_export(egl, true, &type);
+	if (fd < 0 || type != WLBLUR_FENCE_SYNC_FILE) {
+		fprintf(stderr, "[test] ✗ Export failed (fd %d, type %d)\n", fd, type);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return false;
+	}
+
+	bool ok = fence_signals(fd, 5000);
+	close(fd);
+	if (!ok) {
+		fprintf(stderr, "[test] ✗ sync_file did not signal\n");
+		return false;
+	}
+
+	printf("[test] ✓ sync_file fences signal after the GPU work\n");
+	return true;
+}
+
+static bool test_acquire_wait(struct wlblur_egl_context *egl) {
+	printf("[test] Testing acquire fence waits...\n");
+
+	// Already signalled: returns at once
+	int fd = eventfd(1, EFD_CLOEXEC);
+	double start = now_ms();
+	if (!wlblur_fence_wait(egl, fd, WLBLUR_FENCE_EVENTFD) ||
+	    now_ms() - start > 100.0) {
+		fprintf(stderr, "[test] ✗ Signalled eventfd did not pass\n");
+		return false;
+	}
+
+	// One of our own release fences
+	submit_work();
+	enum wlblur_fence_type type;
+	fd = wlblur_fence_export(egl, true, &type);
+	if (fd < 0 || !wlblur_fence_wait(egl, fd, type)) {
+		fprintf(stderr, "[test] ✗ Release fence did not pass as acquire\n");
+		return false;
+	}
+
+	// Never signalled: gives up after the timeout instead of hanging
+	fd = eventfd(0, EFD_CLOEXEC);
+	start = now_ms();
+	bool waited = wlblur_fence_wait(egl, fd, WLBLUR_FENCE_EVENTFD);
+	double elapsed = now_ms() - start;
+	if (waited || elapsed < WLBLUR_FENCE_TIMEOUT_MS * 0.9) {
+		fprintf(stderr, "[test] ✗ Unsignalled fence passed after %.0f ms\n",
+		        elapsed);
+		return false;
+	}
+
+	printf("[test] ✓ Acquire fences wait, and time out after %.0f ms\n",
+	       elapsed);
+	return true;
+}
+
+int main(void) {
+	printf("\n=== wlblur Fence Test Suite ===\n\n");
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[test] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	if (!egl_ctx->has_fence_sync) {
+		fprintf(stderr, "[test] EGL_KHR_fence_sync unavailable, skipping\n");
+		wlblur_egl_destroy(egl_ctx);
+		return 77;
+	}
+
+	bool all_passed = true;
+	all_passed &= test_eventfd_export(egl_ctx);
+	all_passed &= test_native_export(egl_ctx);
+	all_passed &= test_acquire_wait(egl_ctx);
+
+	// Joins the fence worker
+	wlblur_egl_destroy(egl_ctx);
+
+	printf("\n=== Test Results ===\n");
+	if (all_passed) {
+		printf("✓ All tests passed!\n\n");
+		return 0;
+	} else {
+		printf("✗ Some tests failed\n\n");
+		return 1;
+	}
+}
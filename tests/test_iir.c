@@ -0,0 +1,314 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * test_iir.c - Recursive Gaussian algorithm unit tests
+ *
+ * Compares the renderer against a CPU Gaussian with the same sigma.
+ * Exits 77 (skip) when no EGL context or no GLES 3.1 is available.
+ */
+
+#include "wlblur/wlblur.h"
+#include "wlblur/blur_params.h"
+#include "../libwlblur/private/internal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 200
+
+/**
+ * Fill buffer with a deterministic pattern (checkerboard + gradients)
+ */
+static void fill_pattern(unsigned char *pixels, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			unsigned char *p = &pixels[(y * width + x) * 4];
+			bool white = ((x / 16) + (y / 16)) % 2 == 0;
+			p[0] = white ? 240 : (unsigned char)(x * 255 / width);
+			p[1] = white ? 240 : (unsigned char)(y * 255 / height);
+			p[2] = white ? 240 : 32;
+			p[3] = 255;
+		}
+	}
+}
+
+/**
+ * Upload RGBA pixels as a new texture
+ */
+static GLuint upload_texture(const unsigned char *pixels, int width, int height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+/**
+ * Read back a texture's contents through a temporary FBO
+ */
+static void read_texture(GLuint texture, int width, int height,
+                         unsigned char *pixels) {
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+/**
+ * Hand a pooled blur result back to the renderer's FBO pool
+ */
+static void release_output(struct wlblur_kawase_renderer *renderer,
+                           GLuint texture) {
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+		}
+	}
+}
+
+/**
+ * Separable CPU Gaussian (3 sigma, clamp to edge) of one axis
+ */
+static void cpu_gaussian_axis(const float *src, float *dst, int width,
+                              int height, float sigma, bool vertical) {
+	int radius = (int)ceilf(3.0f * sigma);
+	float *kernel = malloc((radius + 1) * sizeof(float));
+	float total = 0.0f;
+	for (int i = 0; i <= radius; i++) {
+		kernel[i] = expf(-(float)(i * i) / (2.0f * sigma * sigma));
+		total += i == 0 ? kernel[i] : 2.0f * kernel[i];
+	}
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			for (int c = 0; c < 4; c++) {
+				float sum = 0.0f;
+				for (int i = -radius; i <= radius; i++) {
+					int sx = vertical ? x : x + i;
+					int sy = vertical ? y + i : y;
+					sx = sx < 0 ? 0 : (sx >= width ? width - 1 : sx);
+					sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+					sum += src[(sy * width + sx) * 4 + c] * kernel[abs(i)];
+				}
+				dst[(y * width + x) * 4 + c] = sum / total;
+			}
+		}
+	}
+
+	free(kernel);
+}
+
+/**
+ * Blur with identity post-processing and compare against the CPU
+ * reference for the same sigma
+ */
+static bool check_against_reference(struct wlblur_iir_renderer *renderer,
+                                    int num_passes, float radius,
+                                    int max_allowed, double mean_allowed) {
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t count = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(count);
+	unsigned char *result = malloc(count);
+	float *a = malloc(count * sizeof(float));
+	float *b = malloc(count * sizeof(float));
+	bool ok = false;
+
+	if (!pixels || !result || !a || !b) {
+		goto out;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.algorithm = WLBLUR_ALGO_IIR;
+	params.num_passes = num_passes;
+	params.radius = radius;
+	params.brightness = 1.0f;
+	params.contrast = 1.0f;
+	params.saturation = 1.0f;
+	params.noise = 0.0f;
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	GLuint output = wlblur_iir_blur(renderer, input, w, h, &params);
+	if (!output) {
+		fprintf(stderr, "[test] ✗ IIR blur failed\n");
+		glDeleteTextures(1, &input);
+		goto out;
+	}
+	read_texture(output, w, h, result);
+	release_output(renderer->kawase, output);
+	glDeleteTextures(1, &input);
+
+	float sigma = wlblur_params_compute(&params).sigma;
+	for (size_t i = 0; i < count; i++) {
+		a[i] = pixels[i];
+	}
+	cpu_gaussian_axis(a, b, w, h, sigma, false);
+	cpu_gaussian_axis(b, a, w, h, sigma, true);
+
+	int max_diff = 0;
+	double total = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		int diff = abs((int)result[i] - (int)lroundf(a[i]));
+		total += diff;
+		if (diff > max_diff) {
+			max_diff = diff;
+		}
+	}
+	double mean = total / count;
+
+	ok = max_diff <= max_allowed && mean <= mean_allowed;
+	printf("[test] %s passes=%d radius=%.0f (sigma %.1f): max %d, mean %.2f\n",
+	       ok ? "✓" : "✗", num_passes, radius, sigma, max_diff, mean);
+
+out:
+	free(pixels);
+	free(result);
+	free(a);
+	free(b);
+	return ok;
+}
+
+/**
+ * Small sigma: the recursion runs on the input directly
+ */
+static bool test_small_sigma(struct wlblur_iir_renderer *renderer) {
+	printf("[test] Testing full-resolution recursive Gaussian...\n");
+
+	/* The third-order recursion is only approximately Gaussian, and
+	 * least so at small sigma: sharp checkerboard edges peak near 9
+	 * levels off at sigma 4.7, 4 at sigma 8 */
+	bool ok = check_against_reference(renderer, 1, 5.0f, 12, 2.0);
+	ok &= check_against_reference(renderer, 2, 3.0f, 6, 0.5);
+	return ok;
+}
+
+/**
+ * Large sigma: the recursion runs on a block-averaged input
+ */
+static bool test_large_sigma(struct wlblur_iir_renderer *renderer) {
+	printf("[test] Testing reduced-resolution recursive Gaussian...\n");
+
+	/* Block averaging and the bilinear upsample add a few levels */
+	bool ok = check_against_reference(renderer, 3, 5.0f, 8, 0.75);
+	ok &= check_against_reference(renderer, 4, 12.0f, 8, 0.75);
+	return ok;
+}
+
+/**
+ * A flat image must stay flat up to the edges: both recursions start
+ * from the clamped edge's steady state
+ */
+static bool test_flat_edges(struct wlblur_iir_renderer *renderer) {
+	printf("[test] Testing edge handling on a flat image...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t count = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(count);
+	unsigned char *result = malloc(count);
+	if (!pixels || !result) {
+		free(pixels);
+		free(result);
+		return false;
+	}
+
+	static const unsigned char color[4] = { 200, 100, 30, 255 };
+	for (size_t i = 0; i < count; i++) {
+		pixels[i] = color[i % 4];
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.algorithm = WLBLUR_ALGO_IIR;
+	params.num_passes = 1;
+	params.radius = 5.0f;
+	params.brightness = 1.0f;
+	params.contrast = 1.0f;
+	params.saturation = 1.0f;
+	params.noise = 0.0f;
+
+	GLuint input = upload_texture(pixels, w, h);
+	GLuint output = wlblur_iir_blur(renderer, input, w, h, &params);
+	int max_diff = 255;
+	if (output) {
+		read_texture(output, w, h, result);
+		release_output(renderer->kawase, output);
+		max_diff = 0;
+		for (size_t i = 0; i < count; i++) {
+			int diff = abs((int)result[i] - (int)color[i % 4]);
+			if (diff > max_diff) {
+				max_diff = diff;
+			}
+		}
+	}
+	glDeleteTextures(1, &input);
+	free(pixels);
+	free(result);
+
+	bool ok = max_diff <= 1;
+	printf("[test] %s Flat image: max %d\n", ok ? "✓" : "✗", max_diff);
+	return ok;
+}
+
+int main(void) {
+	printf("\n=== wlblur Recursive Gaussian Test Suite ===\n\n");
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[test] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	struct wlblur_kawase_renderer *kawase = wlblur_kawase_create(egl_ctx);
+	if (!kawase) {
+		fprintf(stderr, "[test] ✗ Failed to create Kawase renderer\n");
+		wlblur_egl_destroy(egl_ctx);
+		return 1;
+	}
+
+	struct wlblur_iir_renderer *renderer = wlblur_iir_create(kawase);
+	if (!renderer) {
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		wlblur_kawase_destroy(kawase);
+		wlblur_egl_destroy(egl_ctx);
+		if (major > 3 || (major == 3 && minor >= 1)) {
+			fprintf(stderr, "[test] ✗ IIR renderer failed on GLES %d.%d\n",
+			        major, minor);
+			return 1;
+		}
+		fprintf(stderr, "[test] GLES %d.%d has no compute shaders, skipping\n",
+		        major, minor);
+		return 77;
+	}
+
+	bool all_passed = true;
+	all_passed &= test_small_sigma(renderer);
+	all_passed &= test_large_sigma(renderer);
+	all_passed &= test_flat_edges(renderer);
+
+	wlblur_iir_destroy(renderer);
+	wlblur_kawase_destroy(kawase);
+	wlblur_egl_destroy(egl_ctx);
+
+	printf("\n=== Test Results ===\n");
+	if (all_passed) {
+		printf("✓ All tests passed!\n\n");
+		return 0;
+	} else {
+		printf("✗ Some tests failed\n\n");
+		return 1;
+	}
+}
@@ -15,10 +15,13 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <wlblur/blur_params.h>
+#include <wlblur/wlblur.h>
 
 // Import protocol definitions from wlblurd
-#define WLBLUR_PROTOCOL_VERSION 1
+#define WLBLUR_PROTOCOL_VERSION 2
+#define WLBLUR_MAX_REGIONS 16
 
 enum wlblur_op {
     WLBLUR_OP_CREATE_NODE = 1,
@@ -34,6 +37,8 @@ enum wlblur_status {
     WLBLUR_STATUS_DMABUF_EXPORT_FAILED = 4,
     WLBLUR_STATUS_RENDER_FAILED = 5,
     WLBLUR_STATUS_OUT_OF_MEMORY = 6,
+    WLBLUR_STATUS_BUFFERS_BUSY = 7,
+    WLBLUR_STATUS_UNSUPPORTED_VERSION = 8,
 };
 
 struct wlblur_request {
@@ -46,7 +51,23 @@ struct wlblur_request {
     uint64_t modifier;
     uint32_t stride;
     uint32_t offset;
+    char preset_name[32];
+    uint32_t use_preset;
     struct wlblur_blur_params params;
+    // Version 2
+    uint32_t num_damage_rects;
+    struct wlblur_rect damage_rects[WLBLUR_MAX_DAMAGE_RECTS];
+    struct wlblur_rect source_rect;
+    uint32_t num_regions;
+    struct wlblur_rect regions[WLBLUR_MAX_REGIONS];
+    uint32_t num_presets;
+    char preset_names[WLBLUR_MAX_PARAM_SETS][32];
+    uint32_t flags;
+    uint32_t acquire_fence_type;
+    uint32_t buffer_index;
+    uint32_t buffer_id;
+    uint32_t output_buffer_id;
+    uint64_t content_id;
 } __attribute__((packed));
 
 struct wlblur_response {
@@ -58,8 +79,20 @@ struct wlblur_response {
     uint64_t modifier;
     uint32_t stride;
     uint32_t offset;
+    // Version 2
+    uint32_t release_fence_type;
+    uint32_t buffer_index;
+    uint32_t buffer_is_new;
+    uint32_t buffer_id;
 } __attribute__((packed));
 
+// Version 1 messages end before these fields
+#define WLBLUR_REQUEST_V1_SIZE \
+    (offsetof(struct wlblur_request, params) + \
+     offsetof(struct wlblur_blur_params, box_iterations))
+#define WLBLUR_RESPONSE_V1_SIZE \
+    offsetof(struct wlblur_response, release_fence_type)
+
 /**
  * Connect to daemon
  */
@@ -93,20 +126,20 @@ static int connect_to_daemon(void) {
 }
 
 /**
- * Send request and receive response
+ * Send the first len bytes of a request and receive a response of
+ * resp_len bytes
  */
-static bool send_request(int sock, const struct wlblur_request *req,
-                         struct wlblur_response *resp) {
-    // Send request
-    ssize_t sent = send(sock, req, sizeof(*req), 0);
-    if (sent != sizeof(*req)) {
+static bool send_request_sized(int sock, const struct wlblur_request *req,
+                               size_t len, struct wlblur_response *resp,
+                               size_t resp_len) {
+    ssize_t sent = send(sock, req, len, 0);
+    if (sent != (ssize_t)len) {
         perror("send");
         return false;
     }
 
-    // Receive response
-    ssize_t received = recv(sock, resp, sizeof(*resp), 0);
-    if (received != sizeof(*resp)) {
+    ssize_t received = recv(sock, resp, resp_len, 0);
+    if (received != (ssize_t)resp_len) {
         perror("recv");
         return false;
     }
@@ -114,6 +147,14 @@ static bool send_request(int sock, const struct wlblur_request *req,
     return true;
 }
 
+/**
+ * Send request and receive response
+ */
+static bool send_request(int sock, const struct wlblur_request *req,
+                         struct wlblur_response *resp) {
+    return send_request_sized(sock, req, sizeof(*req), resp, sizeof(*resp));
+}
+
 /**
  * Test CREATE_NODE operation
  */
@@ -200,6 +241,52 @@ static bool test_invalid_node(int sock) {
     return true;
 }
 
+/**
+ * Test that version 1 clients are still served with version 1 messages,
+ * and that unknown versions get an error reply instead of silence
+ */
+static bool test_protocol_versions(int sock) {
+    printf("[test] Testing protocol version handling...\n");
+
+    struct wlblur_request req = {0};
+    req.protocol_version = 1;
+    req.op = WLBLUR_OP_CREATE_NODE;
+    req.width = 640;
+    req.height = 480;
+    req.params = wlblur_params_default();
+
+    struct wlblur_response resp = {0};
+    if (!send_request_sized(sock, &req, WLBLUR_REQUEST_V1_SIZE, &resp,
+                            WLBLUR_RESPONSE_V1_SIZE) ||
+        resp.status != WLBLUR_STATUS_SUCCESS || resp.node_id == 0) {
+        fprintf(stderr, "[test] Version 1 CREATE_NODE failed (status %u)\n",
+                resp.status);
+        return false;
+    }
+
+    req.op = WLBLUR_OP_DESTROY_NODE;
+    req.node_id = resp.node_id;
+    if (!send_request_sized(sock, &req, WLBLUR_REQUEST_V1_SIZE, &resp,
+                            WLBLUR_RESPONSE_V1_SIZE) ||
+        resp.status != WLBLUR_STATUS_SUCCESS) {
+        fprintf(stderr, "[test] Version 1 DESTROY_NODE failed (status %u)\n",
+                resp.status);
+        return false;
+    }
+
+    req.protocol_version = WLBLUR_PROTOCOL_VERSION + 1;
+    if (!send_request_sized(sock, &req, sizeof(req), &resp,
+                            WLBLUR_RESPONSE_V1_SIZE) ||
+        resp.status != WLBLUR_STATUS_UNSUPPORTED_VERSION) {
+        fprintf(stderr, "[test] Expected UNSUPPORTED_VERSION, got status %u\n",
+                resp.status);
+        return false;
+    }
+
+    printf("[test] ✓ Version 1 requests served, unknown version rejected\n");
+    return true;
+}
+
 /**
  * Main test suite
  */
@@ -231,6 +318,13 @@ int main(void) {
         goto cleanup;
     }
 
+    // Test version 1 clients and unknown versions
+    if (!test_protocol_versions(sock)) {
+        fprintf(stderr, "[test] ✗ Protocol version test failed\n");
+        all_passed = false;
+        goto cleanup;
+    }
+
     // Test DESTROY_NODE
     if (!test_destroy_node(sock, node_id)) {
         fprintf(stderr, "[test] ✗ DESTROY_NODE test failed\n");
@@ -4,8 +4,1691 @@
  * SPDX-License-Identifier: MIT
  *
  * test_kawase.c - Kawase algorithm unit tests
+ *
+ * Runs against the internal renderer so it works on any GLES 3.0 driver
+ * (including Mesa llvmpipe). Exits 77 (skip) when no EGL context can be
+ * created.
  */
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "wlblur/wlblur.h"
+#include "wlblur/blur_params.h"
+#include "../libwlblur/private/internal.h"
+#include <dirent.h>
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TEST_WIDTH 320
+#define TEST_HEIGHT 200
+
+/**
+ * Fill buffer with a deterministic pattern (checkerboard + gradients)
+ */
+static void fill_pattern(unsigned char *pixels, int width, int height) {
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			unsigned char *p = &pixels[(y * width + x) * 4];
+			bool white = ((x / 16) + (y / 16)) % 2 == 0;
+			p[0] = white ? 240 : (unsigned char)(x * 255 / width);
+			p[1] = white ? 240 : (unsigned char)(y * 255 / height);
+			p[2] = white ? 240 : 32;
+			p[3] = 255;
+		}
+	}
+}
+
+/**
+ * Upload RGBA pixels as a new texture
+ */
+static GLuint upload_texture(const unsigned char *pixels, int width, int height) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+	             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+/**
+ * Read back a texture's contents through a temporary FBO
+ */
+static void read_texture(GLuint texture, int width, int height,
+                         unsigned char *pixels) {
+	GLuint fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+	                       GL_TEXTURE_2D, texture, 0);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &fbo);
+}
+
+/**
+ * Largest per-channel difference between two RGBA buffers
+ */
+static int max_difference(const unsigned char *a, const unsigned char *b,
+                          int width, int height) {
+	int max_diff = 0;
+	for (int i = 0; i < width * height * 4; i++) {
+		int diff = abs((int)a[i] - (int)b[i]);
+		if (diff > max_diff) {
+			max_diff = diff;
+		}
+	}
+	return max_diff;
+}
+
+/**
+ * Hand a pooled blur result back to the renderer's FBO pool
+ */
+static void release_output(struct wlblur_kawase_renderer *renderer,
+                           GLuint texture) {
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	for (int i = 0; i < pool->count; i++) {
+		if (pool->fbos[i]->texture == texture) {
+			wlblur_fbo_pool_release(pool, pool->fbos[i]);
+		}
+	}
+}
+
+/**
+ * Damage re-blur must match a full re-blur of the modified input
+ */
+static bool test_damage_matches_full(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing damage-aware re-blur...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *partial = malloc(size);
+	unsigned char *full = malloc(size);
+	bool ok = false;
+
+	struct wlblur_kawase_chain *retained = wlblur_kawase_chain_create();
+	struct wlblur_kawase_chain *fresh = wlblur_kawase_chain_create();
+	if (!pixels || !partial || !full || !retained || !fresh) {
+		goto out;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 2;
+	params.radius = 3.0f;
+
+	/* Frame 1: full render of the original input */
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	if (!wlblur_kawase_blur_damage(renderer, retained, input, w, h,
+	                               &params, NULL, 0)) {
+		fprintf(stderr, "[test] Initial render failed\n");
+		glDeleteTextures(1, &input);
+		goto out;
+	}
+
+	/* Frame 2: change a 12x12 "cursor" and re-blur only that rect */
+	struct wlblur_rect damage = { 150, 90, 162, 102 };
+	for (int y = damage.y1; y < damage.y2; y++) {
+		for (int x = damage.x1; x < damage.x2; x++) {
+			unsigned char *p = &pixels[(y * w + x) * 4];
+			p[0] = 255;
+			p[1] = 0;
+			p[2] = 255;
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, input);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, w, h,
+	                GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	GLuint partial_tex = wlblur_kawase_blur_damage(
+		renderer, retained, input, w, h, &params, &damage, 1);
+	GLuint full_tex = wlblur_kawase_blur_damage(
+		renderer, fresh, input, w, h, &params, NULL, 0);
+	glDeleteTextures(1, &input);
+
+	if (!partial_tex || !full_tex) {
+		fprintf(stderr, "[test] Damage render failed\n");
+		goto out;
+	}
+
+	read_texture(partial_tex, w, h, partial);
+	read_texture(full_tex, w, h, full);
+
+	int diff = max_difference(partial, full, w, h);
+	if (diff > 1) {
+		fprintf(stderr, "[test] Damage render differs from full render "
+		        "(max diff %d)\n", diff);
+		goto out;
+	}
+
+	printf("[test] ✓ Damage re-blur matches full re-blur (max diff %d)\n",
+	       diff);
+	ok = true;
+
+out:
+	wlblur_kawase_chain_destroy(retained);
+	wlblur_kawase_chain_destroy(fresh);
+	free(pixels);
+	free(partial);
+	free(full);
+	return ok;
+}
+
+/**
+ * Blurring a cropped region must match the same area of a full blur
+ *
+ * Noise is seeded by output position, so it is turned off.
+ */
+static bool test_region_matches_full(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing region-of-interest blur...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	unsigned char *full = malloc((size_t)w * h * 4);
+	unsigned char *region_pixels = NULL;
+	unsigned char *expected = NULL;
+	bool ok = false;
+
+	if (!pixels || !full) {
+		goto out;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 2;
+	params.radius = 3.0f;
+	params.noise = 0.0f;
+
+	struct wlblur_rect source = { 121, 83, 181, 121 };
+	struct wlblur_region region;
+	if (!wlblur_region_compute(&source, w, h, &params, &region)) {
+		fprintf(stderr, "[test] ✗ Region rejected\n");
+		goto out;
+	}
+
+	int expand = wlblur_params_compute(&params).damage_expand;
+	if (region.crop.x1 > source.x1 - expand ||
+	    region.crop.x2 < source.x2 + expand ||
+	    wlblur_rect_is_full(&region.crop, w, h)) {
+		fprintf(stderr, "[test] ✗ Crop (%d,%d)-(%d,%d) does not fit "
+		        "the source margin\n", region.crop.x1, region.crop.y1,
+		        region.crop.x2, region.crop.y2);
+		goto out;
+	}
+
+	struct wlblur_rect outside = { w + 10, 0, w + 20, 10 };
+	if (wlblur_region_compute(&outside, w, h, &params, &region) ||
+	    !wlblur_region_compute(&source, w, h, &params, &region)) {
+		fprintf(stderr, "[test] ✗ Source outside the input accepted\n");
+		goto out;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	GLuint full_tex = wlblur_kawase_blur(renderer, input, w, h, &params);
+	if (full_tex) {
+		read_texture(full_tex, w, h, full);
+		release_output(renderer, full_tex);
+	}
+
+	/* Same steps as apply_blur(): crop, blur the crop, cut the source */
+	int cw = region.crop.x2 - region.crop.x1;
+	int ch = region.crop.y2 - region.crop.y1;
+	struct wlblur_fbo *crop = wlblur_region_copy(renderer->fbo_pool, input,
+	                                             &region.crop);
+	GLuint crop_tex = crop ?
+		wlblur_kawase_blur(renderer, crop->texture, cw, ch, &params) : 0;
+	wlblur_fbo_pool_release(renderer->fbo_pool, crop);
+	glDeleteTextures(1, &input);
+
+	struct wlblur_rect local = {
+		source.x1 - region.crop.x1, source.y1 - region.crop.y1,
+		source.x2 - region.crop.x1, source.y2 - region.crop.y1,
+	};
+	struct wlblur_fbo *output = crop_tex ?
+		wlblur_region_copy(renderer->fbo_pool, crop_tex, &local) : NULL;
+	release_output(renderer, crop_tex);
+
+	if (!full_tex || !output) {
+		fprintf(stderr, "[test] Blur failed\n");
+		goto out;
+	}
+
+	int sw = source.x2 - source.x1, sh = source.y2 - source.y1;
+	region_pixels = malloc((size_t)sw * sh * 4);
+	expected = malloc((size_t)sw * sh * 4);
+	if (!region_pixels || !expected) {
+		wlblur_fbo_pool_release(renderer->fbo_pool, output);
+		goto out;
+	}
+
+	read_texture(output->texture, sw, sh, region_pixels);
+	wlblur_fbo_pool_release(renderer->fbo_pool, output);
+	for (int y = 0; y < sh; y++) {
+		memcpy(&expected[(size_t)y * sw * 4],
+		       &full[((size_t)(source.y1 + y) * w + source.x1) * 4],
+		       (size_t)sw * 4);
+	}
+
+	int diff = max_difference(region_pixels, expected, sw, sh);
+	if (diff > 1) {
+		fprintf(stderr, "[test] Region differs from full blur "
+		        "(max diff %d)\n", diff);
+		goto out;
+	}
+
+	printf("[test] ✓ Region blur over %dx%d of %dx%d matches full blur "
+	       "(max diff %d)\n", cw, ch, w, h, diff);
+	ok = true;
+
+out:
+	free(pixels);
+	free(full);
+	free(region_pixels);
+	free(expected);
+	return ok;
+}
+
+/**
+ * Rendering the last pass into a target at an offset must match blurring
+ * into the pool and copying the area out
+ *
+ * Noise stays off: its hash of the texture coordinates amplifies the
+ * last-bit differences the offset viewport interpolates.
+ */
+static bool test_blur_into_matches_copy(
+	struct wlblur_kawase_renderer *renderer
+) {
+	printf("[test] Testing blur into a target buffer...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	const struct wlblur_rect local = { 37, 21, 237, 141 };
+	const int tw = local.x2 - local.x1, th = local.y2 - local.y1;
+
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	unsigned char *direct = malloc((size_t)tw * th * 4);
+	unsigned char *copied = malloc((size_t)tw * th * 4);
+	struct wlblur_fbo *target = wlblur_fbo_create(tw, th);
+	bool ok = pixels && direct && copied && target;
+	if (!ok) {
+		goto out;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	struct wlblur_blur_params with_finish = wlblur_params_default();
+	with_finish.num_passes = 3;
+	with_finish.brightness = 1.1f;
+	with_finish.saturation = 1.3f;
+	with_finish.noise = 0.0f;
+	struct wlblur_blur_params without_finish = with_finish;
+	without_finish.brightness = 1.0f;
+	without_finish.contrast = 1.0f;
+	without_finish.saturation = 1.0f;
+
+	const struct wlblur_blur_params *sets[] = {
+		&with_finish, &without_finish,
+	};
+	bool fuse = renderer->fuse_finish;
+	size_t in_use = renderer->fbo_pool->in_use;
+	int max_diff = 0;
+
+	for (int i = 0; i < 4 && ok; i++) {
+		const struct wlblur_blur_params *params = sets[i / 2];
+		renderer->fuse_finish = i % 2 == 0;
+
+		GLuint pooled = wlblur_kawase_blur(renderer, input, w, h, params);
+		struct wlblur_fbo *cut = pooled ?
+			wlblur_region_copy(renderer->fbo_pool, pooled, &local) : NULL;
+		release_output(renderer, pooled);
+
+		bool rendered = wlblur_kawase_blur_into(renderer, input, w, h,
+		                                        params, target,
+		                                        local.x1, local.y1);
+		if (!cut || !rendered) {
+			fprintf(stderr, "[test] ✗ Blur failed\n");
+			wlblur_fbo_pool_release(renderer->fbo_pool, cut);
+			ok = false;
+			break;
+		}
+
+		read_texture(cut->texture, tw, th, copied);
+		read_texture(target->texture, tw, th, direct);
+		wlblur_fbo_pool_release(renderer->fbo_pool, cut);
+
+		int diff = max_difference(direct, copied, tw, th);
+		if (diff > max_diff) {
+			max_diff = diff;
+		}
+		if (diff > 1) {
+			fprintf(stderr, "[test] ✗ Direct blur differs from copy "
+			        "(%s finish, %s, max diff %d)\n",
+			        params == &with_finish ? "with" : "without",
+			        renderer->fuse_finish ? "fused" : "separate", diff);
+			ok = false;
+		}
+	}
+
+	renderer->fuse_finish = fuse;
+	glDeleteTextures(1, &input);
+
+	if (ok && renderer->fbo_pool->in_use != in_use) {
+		fprintf(stderr, "[test] ✗ %zu bytes of pooled FBOs still in use\n",
+		        renderer->fbo_pool->in_use - in_use);
+		ok = false;
+	}
+
+	if (ok) {
+		printf("[test] ✓ Blur into a %dx%d target matches a copy "
+		       "(max diff %d)\n", tw, th, max_diff);
+	}
+
+out:
+	wlblur_fbo_destroy(target);
+	free(pixels);
+	free(direct);
+	free(copied);
+	return ok;
+}
+
+/**
+ * A batched multi-region blur must match a full blur inside every region
+ */
+static bool test_regions_match_full(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing multi-region blur...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *full = malloc(size);
+	unsigned char *batched = malloc(size);
+	bool ok = false;
+
+	if (!pixels || !full || !batched) {
+		goto out;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 2;
+	params.radius = 3.0f;
+
+	/* Three tiled windows, one touching the input's edge */
+	const struct wlblur_rect regions[] = {
+		{ 10, 20, 90, 80 },
+		{ 110, 20, 190, 80 },
+		{ 240, 120, 320, 200 },
+	};
+	const int num_regions = sizeof(regions) / sizeof(regions[0]);
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	GLuint full_tex = wlblur_kawase_blur(renderer, input, w, h, &params);
+	if (full_tex) {
+		read_texture(full_tex, w, h, full);
+		release_output(renderer, full_tex);
+	}
+	GLuint batched_tex = wlblur_kawase_blur_regions(
+		renderer, input, w, h, &params, regions, num_regions);
+	if (batched_tex) {
+		read_texture(batched_tex, w, h, batched);
+		release_output(renderer, batched_tex);
+	}
+	glDeleteTextures(1, &input);
+
+	if (!full_tex || !batched_tex) {
+		fprintf(stderr, "[test] Blur failed\n");
+		goto out;
+	}
+
+	int max_diff = 0;
+	for (int i = 0; i < num_regions; i++) {
+		for (int y = regions[i].y1; y < regions[i].y2; y++) {
+			size_t row = ((size_t)y * w + regions[i].x1) * 4;
+			int diff = max_difference(&batched[row], &full[row],
+			                          regions[i].x2 - regions[i].x1, 1);
+			if (diff > max_diff) {
+				max_diff = diff;
+			}
+		}
+	}
+
+	if (max_diff > 0) {
+		fprintf(stderr, "[test] Regions differ from full blur "
+		        "(max diff %d)\n", max_diff);
+		goto out;
+	}
+
+	printf("[test] ✓ %d batched regions match full blur\n", num_regions);
+	ok = true;
+
+out:
+	free(pixels);
+	free(full);
+	free(batched);
+	return ok;
+}
+
+/**
+ * Blurs sharing a pyramid must match separate blurs
+ *
+ * Sets with the same radius and pass count share an unfused upsample, so
+ * they may differ from the fused separate blur like the two-pass finish.
+ */
+static bool test_shared_matches_separate(
+	struct wlblur_kawase_renderer *renderer
+) {
+	printf("[test] Testing shared pyramid...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *shared = malloc(size);
+	unsigned char *separate = malloc(size);
+	bool ok = false;
+
+	if (!pixels || !shared || !separate) {
+		goto out;
+	}
+
+	/* Three depths of one radius, a finish-only variant and a second
+	 * radius, in mixed order */
+	struct wlblur_blur_params params[5];
+	for (int i = 0; i < 5; i++) {
+		params[i] = wlblur_params_default();
+	}
+	params[0].num_passes = 3;
+	params[1].num_passes = 2;
+	params[2].num_passes = 4;
+	params[3].num_passes = 3;
+	params[3].brightness = 1.1f;
+	params[3].saturation = 1.3f;
+	params[4].radius = 3.0f;
+	params[4].num_passes = 2;
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	GLuint outputs[5];
+	if (!wlblur_kawase_blur_shared(renderer, input, w, h, params, 5,
+	                               outputs)) {
+		fprintf(stderr, "[test] Shared blur failed\n");
+		glDeleteTextures(1, &input);
+		goto out;
+	}
+
+	ok = true;
+	for (int i = 0; i < 5; i++) {
+		read_texture(outputs[i], w, h, shared);
+		release_output(renderer, outputs[i]);
+
+		GLuint single = wlblur_kawase_blur(renderer, input, w, h, &params[i]);
+		if (!single) {
+			fprintf(stderr, "[test] Blur failed\n");
+			ok = false;
+			break;
+		}
+		read_texture(single, w, h, separate);
+		release_output(renderer, single);
+
+		int allowed = i == 0 || i == 3 ? 2 : 0;
+		int diff = max_difference(shared, separate, w, h);
+		if (diff > allowed) {
+			fprintf(stderr, "[test] ✗ Set %d (%d passes, radius %.0f) differs "
+			        "from separate blur (max diff %d)\n", i,
+			        params[i].num_passes, params[i].radius, diff);
+			ok = false;
+		}
+	}
+	glDeleteTextures(1, &input);
+
+	if (ok) {
+		printf("[test] ✓ Shared pyramid matches separate blurs\n");
+	}
+
+out:
+	free(pixels);
+	free(shared);
+	free(separate);
+	return ok;
+}
+
+/**
+ * A non-Kawase set failing after the shared Kawase pyramid must release
+ * the Kawase outputs of the sets after it too
+ */
+static bool test_blur_sets_failure(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing partial failure of a multi-set blur...\n");
+
+	/* No Gaussian renderer: its set fails after the Kawase sets ran */
+	struct wlblur_context ctx = {
+		.egl_ctx = renderer->egl_ctx,
+		.kawase = renderer,
+		.tried = ~0u,
+	};
+
+	struct wlblur_blur_params params[4];
+	for (int i = 0; i < 4; i++) {
+		params[i] = wlblur_params_default();
+	}
+	params[1].algorithm = WLBLUR_ALGO_GAUSSIAN;
+	params[2].num_passes = 2;
+	params[3].num_passes = 4;
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	if (!pixels) {
+		return false;
+	}
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	free(pixels);
+
+	size_t in_use = renderer->fbo_pool->in_use;
+	GLuint blurred[4];
+	bool blurred_ok = wlblur_context_blur_sets(&ctx, input, w, h, params, 4,
+	                                           blurred);
+	glDeleteTextures(1, &input);
+
+	if (blurred_ok) {
+		fprintf(stderr, "[test] ✗ Blur with a failing set succeeded\n");
+		for (int i = 0; i < 4; i++) {
+			release_output(renderer, blurred[i]);
+		}
+		return false;
+	}
+	for (int i = 0; i < 4; i++) {
+		if (blurred[i] != 0) {
+			fprintf(stderr, "[test] ✗ Set %d kept output %u\n", i, blurred[i]);
+			return false;
+		}
+	}
+	if (renderer->fbo_pool->in_use != in_use) {
+		fprintf(stderr, "[test] ✗ %zu bytes of pool FBOs leaked\n",
+		        renderer->fbo_pool->in_use - in_use);
+		return false;
+	}
+
+	printf("[test] ✓ Failed multi-set blur released every output\n");
+	return true;
+}
+
+/**
+ * Wait for every finish variant to build
+ */
+static void build_variants(struct wlblur_kawase_renderer *renderer) {
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT; kind++) {
+		if (kind != WLBLUR_FINISH_FULL) {
+			wlblur_shader_variant_get(renderer->egl_ctx,
+			                          &renderer->finish_variants[kind], true);
+		}
+		if (kind != WLBLUR_FINISH_NONE) {
+			wlblur_shader_variant_get(renderer->egl_ctx,
+			                          &renderer->upsample_finish[kind], true);
+		}
+	}
+}
+
+/**
+ * Fused upsample+finish must match the separate finish pass
+ *
+ * The two-pass path rounds the last upsample to 8 bits before
+ * post-processing; with the saturation gain that rounding can move a
+ * channel by up to 2 levels.
+ */
+static bool test_fused_finish_matches_two_pass(
+	struct wlblur_kawase_renderer *renderer
+) {
+	printf("[test] Testing fused finish pass...\n");
+
+	/* Earlier blurs may have left it compiling in the background */
+	if (!wlblur_shader_variant_get(
+		renderer->egl_ctx,
+		&renderer->upsample_finish[WLBLUR_FINISH_FULL], true)) {
+		fprintf(stderr, "[test] ✗ Fused finish shader not loaded\n");
+		return false;
+	}
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *fused = malloc(size);
+	unsigned char *two_pass = malloc(size);
+	bool ok = false;
+
+	if (!pixels || !fused || !two_pass) {
+		goto out;
+	}
+
+	/* Default params exercise every post-processing term */
+	struct wlblur_blur_params params = wlblur_params_default();
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	bool fuse_finish = renderer->fuse_finish;
+
+	renderer->fuse_finish = true;
+	GLuint fused_tex = wlblur_kawase_blur(renderer, input, w, h, &params);
+	if (fused_tex) {
+		read_texture(fused_tex, w, h, fused);
+	}
+
+	renderer->fuse_finish = false;
+	GLuint two_pass_tex = wlblur_kawase_blur(renderer, input, w, h, &params);
+	if (two_pass_tex) {
+		read_texture(two_pass_tex, w, h, two_pass);
+	}
+
+	renderer->fuse_finish = fuse_finish;
+	glDeleteTextures(1, &input);
+
+	if (!fused_tex || !two_pass_tex) {
+		fprintf(stderr, "[test] Blur failed\n");
+		goto out;
+	}
+
+	int diff = max_difference(fused, two_pass, w, h);
+	if (diff > 2) {
+		fprintf(stderr, "[test] Fused output differs from two-pass output "
+		        "(max diff %d)\n", diff);
+		goto out;
+	}
+
+	printf("[test] ✓ Fused finish matches two-pass finish (max diff %d)\n",
+	       diff);
+	ok = true;
+
+out:
+	free(pixels);
+	free(fused);
+	free(two_pass);
+	return ok;
+}
+
+/**
+ * Each specialized finish, and skipping a no-op finish, must match the
+ * generic finish shader with the same params
+ */
+static bool test_finish_variants(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing specialized finish variants...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *special = malloc(size);
+	unsigned char *generic = malloc(size);
+	if (!pixels || !special || !generic) {
+		free(pixels);
+		free(special);
+		free(generic);
+		return false;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	bool fuse_finish = renderer->fuse_finish;
+	bool ok = true;
+
+	for (int kind = 0; kind < WLBLUR_FINISH_COUNT && ok; kind++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		if (kind == WLBLUR_FINISH_COLOR || kind == WLBLUR_FINISH_NONE) {
+			params.noise = 0.0f;
+		}
+		if (kind == WLBLUR_FINISH_NOISE || kind == WLBLUR_FINISH_NONE) {
+			params.brightness = 1.0f;
+			params.contrast = 1.0f;
+			params.saturation = 1.0f;
+		}
+		if ((int)wlblur_finish_pick(&params) != kind) {
+			fprintf(stderr, "[test] ✗ Params picked finish %d, not %d\n",
+			        wlblur_finish_pick(&params), kind);
+			ok = false;
+			break;
+		}
+
+		/* Fused variant, or no finish pass at all */
+		renderer->fuse_finish = true;
+		GLuint special_tex = wlblur_kawase_blur(renderer, input, w, h,
+		                                        &params);
+		if (special_tex) {
+			read_texture(special_tex, w, h, special);
+			release_output(renderer, special_tex);
+		}
+
+		/* Generic two-pass finish, as before the variant is ready */
+		struct wlblur_shader_variant variant = renderer->finish_variants[kind];
+		renderer->finish_variants[kind] =
+			(struct wlblur_shader_variant){ .failed = true };
+		renderer->fuse_finish = false;
+		GLuint generic_tex = wlblur_kawase_blur(renderer, input, w, h,
+		                                        &params);
+		if (generic_tex) {
+			read_texture(generic_tex, w, h, generic);
+			release_output(renderer, generic_tex);
+		}
+		renderer->finish_variants[kind] = variant;
+
+		if (!special_tex || !generic_tex) {
+			fprintf(stderr, "[test] ✗ Blur failed for finish %d\n", kind);
+			ok = false;
+			break;
+		}
+
+		/* Same 8-bit rounding allowance as the fused finish */
+		int diff = max_difference(special, generic, w, h);
+		if (diff > 2) {
+			fprintf(stderr, "[test] ✗ Finish %d differs from the generic "
+			        "finish (max diff %d)\n", kind, diff);
+			ok = false;
+		}
+	}
+
+	renderer->fuse_finish = fuse_finish;
+	glDeleteTextures(1, &input);
+	free(pixels);
+	free(special);
+	free(generic);
+
+	if (ok) {
+		printf("[test] ✓ Specialized finishes match the generic finish\n");
+	}
+	return ok;
+}
+
+/**
+ * The atlas layout must render exactly what separate levels render, for
+ * odd sizes, deep pyramids and scissored regions
+ */
+static bool test_atlas_matches_levels(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing atlas pyramid layout...\n");
+
+	const int w = TEST_WIDTH - 3, h = TEST_HEIGHT - 1;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *atlas = malloc(size);
+	unsigned char *levels = malloc(size);
+	if (!pixels || !atlas || !levels) {
+		free(pixels);
+		free(atlas);
+		free(levels);
+		return false;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	static const int passes[] = { 1, 3, 8 };
+	struct wlblur_rect region = { 40, 30, 200, 150 };
+	bool ok = true;
+	int max_diff = 0;
+
+	for (int i = 0; i < 6 && ok; i++) {
+		struct wlblur_blur_params params = wlblur_params_default();
+		params.num_passes = passes[i % 3];
+		bool clipped = i >= 3;
+
+		GLuint out[2];
+		for (int l = 0; l < 2; l++) {
+			renderer->layout = l ? WLBLUR_KAWASE_LAYOUT_ATLAS :
+			                       WLBLUR_KAWASE_LAYOUT_LEVELS;
+			out[l] = clipped ?
+				wlblur_kawase_blur_regions(renderer, input, w, h, &params,
+				                           &region, 1) :
+				wlblur_kawase_blur(renderer, input, w, h, &params);
+		}
+		renderer->layout = WLBLUR_KAWASE_LAYOUT_LEVELS;
+
+		if (!out[0] || !out[1]) {
+			fprintf(stderr, "[test] ✗ Blur failed (%d passes)\n",
+			        params.num_passes);
+			ok = false;
+		} else {
+			read_texture(out[0], w, h, levels);
+			read_texture(out[1], w, h, atlas);
+
+			/* Outside a region the output is undefined */
+			int diff = clipped ? 0 : max_difference(atlas, levels, w, h);
+			for (int y = region.y1; clipped && y < region.y2; y++) {
+				size_t row = ((size_t)y * w + region.x1) * 4;
+				int d = max_difference(atlas + row, levels + row,
+				                       region.x2 - region.x1, 1);
+				if (d > diff) diff = d;
+			}
+			if (diff > max_diff) max_diff = diff;
+			/* Level FBOs and atlas mips are padded to different size
+			 * classes, so texture coordinates round differently */
+			if (diff > 1) {
+				fprintf(stderr, "[test] ✗ Atlas differs (%d passes%s, "
+				        "max diff %d)\n", params.num_passes,
+				        clipped ? ", region" : "", diff);
+				ok = false;
+			}
+		}
+		release_output(renderer, out[0]);
+		release_output(renderer, out[1]);
+	}
+
+	glDeleteTextures(1, &input);
+	free(pixels);
+	free(atlas);
+	free(levels);
+
+	if (ok) {
+		printf("[test] ✓ Atlas matches separate levels (max diff %d)\n",
+		       max_diff);
+	}
+	return ok;
+}
+
+/**
+ * Reduced-precision pyramids must stay close to the RGBA8 pyramid
+ *
+ * Every level is rounded to the format again. Bounds are set for
+ * llvmpipe, which rounds worse than GPUs: it stores RGB565 by truncating
+ * the 8-bit value (240 reads back as 247) and rounds small floats toward
+ * zero, so its errors add up instead of averaging out.
+ */
+static bool test_intermediate_formats(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing reduced-precision intermediates...\n");
+
+	static const struct {
+		uint32_t drm_format;
+		GLenum expected;
+	} picks[] = {
+		{ DRM_FORMAT_ARGB8888, GL_RGBA8 },
+		{ DRM_FORMAT_XRGB8888, GL_RGB565 },
+		{ DRM_FORMAT_XBGR8888, GL_RGB565 },
+	};
+	for (size_t i = 0; i < sizeof(picks) / sizeof(picks[0]); i++) {
+		GLenum format = wlblur_kawase_pick_format(renderer,
+		                                          picks[i].drm_format);
+		if (format != picks[i].expected) {
+			fprintf(stderr, "[test] ✗ DRM format 0x%08x picked 0x%x, "
+			        "expected 0x%x\n", picks[i].drm_format, format,
+			        picks[i].expected);
+			return false;
+		}
+	}
+
+	/* Half-float input keeps more than 8 bits where it can */
+	GLenum hdr = wlblur_kawase_pick_format(renderer, DRM_FORMAT_ABGR16161616F);
+	if (renderer->has_half_float_targets ? hdr != GL_RGBA16F : hdr != GL_RGBA8) {
+		fprintf(stderr, "[test] ✗ Half-float input picked 0x%x\n", hdr);
+		return false;
+	}
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *reference = malloc(size);
+	unsigned char *result = malloc(size);
+	bool ok = false;
+
+	if (!pixels || !reference || !result) {
+		goto out;
+	}
+
+	static const struct {
+		GLenum format;
+		const char *name;
+		int max_allowed;
+		double mean_allowed;
+	} formats[] = {
+		{ GL_RGB565, "RGB565", 24, 4.0 },
+		{ GL_R11F_G11F_B10F, "R11F_G11F_B10F", 12, 5.0 },
+		{ GL_RGBA16F, "RGBA16F", 3, 1.0 },
+	};
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.brightness = 1.0f;
+	params.contrast = 1.0f;
+	params.saturation = 1.0f;
+	params.noise = 0.0f;
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	GLenum intermediate_format = renderer->intermediate_format;
+	renderer->intermediate_format = GL_RGBA8;
+	GLuint output = wlblur_kawase_blur(renderer, input, w, h, &params);
+	if (!output) {
+		fprintf(stderr, "[test] ✗ RGBA8 blur failed\n");
+		glDeleteTextures(1, &input);
+		goto out;
+	}
+	read_texture(output, w, h, reference);
+	release_output(renderer, output);
+
+	ok = true;
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+		GLenum format = formats[f].format;
+		if ((format == GL_R11F_G11F_B10F && !renderer->has_float_targets) ||
+		    (format == GL_RGBA16F && !renderer->has_half_float_targets)) {
+			printf("[test] - %s not renderable, skipped\n", formats[f].name);
+			continue;
+		}
+
+		renderer->intermediate_format = format;
+		output = wlblur_kawase_blur(renderer, input, w, h, &params);
+		if (!output) {
+			fprintf(stderr, "[test] ✗ %s blur failed\n", formats[f].name);
+			ok = false;
+			continue;
+		}
+		read_texture(output, w, h, result);
+		release_output(renderer, output);
+
+		int max_diff = 0;
+		double total = 0.0;
+		for (size_t i = 0; i < size; i++) {
+			int diff = abs((int)result[i] - (int)reference[i]);
+			total += diff;
+			if (diff > max_diff) {
+				max_diff = diff;
+			}
+		}
+		double mean = total / size;
+
+		bool pass = max_diff <= formats[f].max_allowed &&
+		            mean <= formats[f].mean_allowed;
+		printf("[test] %s %s: max %d, mean %.2f\n", pass ? "✓" : "✗",
+		       formats[f].name, max_diff, mean);
+		ok &= pass;
+	}
+
+	renderer->intermediate_format = intermediate_format;
+	glDeleteTextures(1, &input);
+
+out:
+	free(pixels);
+	free(reference);
+	free(result);
+	return ok;
+}
+
+/**
+ * Compute backend must match the fragment path for every pass count
+ *
+ * Manual bilinear filtering rounds differently from the texture unit's
+ * fixed-point weights, so allow a few levels per channel and require the
+ * average to stay below one level. Noise is disabled: its hash amplifies
+ * the last bit of the texture coordinate, so it only matches
+ * statistically.
+ */
+static bool test_compute_matches_fragment(
+	struct wlblur_kawase_renderer *renderer
+) {
+	printf("[test] Testing compute backend...\n");
+
+	struct wlblur_kawase_compute *compute =
+		wlblur_kawase_compute_create(renderer);
+	if (!compute) {
+		GLint major = 0, minor = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &major);
+		glGetIntegerv(GL_MINOR_VERSION, &minor);
+		if (major > 3 || (major == 3 && minor >= 1)) {
+			fprintf(stderr, "[test] ✗ Compute backend failed on GLES %d.%d\n",
+			        major, minor);
+			return false;
+		}
+		printf("[test] ✓ Compute backend unavailable (GLES %d.%d), skipped\n",
+		       major, minor);
+		return true;
+	}
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *fragment = malloc(size);
+	unsigned char *result = malloc(size);
+	bool ok = false;
+
+	if (!pixels || !fragment || !result) {
+		goto out;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+
+	/* 1-8 passes at the default radius, then the largest radius, which
+	 * forces smaller compute tiles */
+	ok = true;
+	for (int run = 0; run < 9 && ok; run++) {
+		int passes = run < 8 ? run + 1 : 8;
+		struct wlblur_blur_params params = wlblur_params_default();
+		params.num_passes = passes;
+		params.radius = run < 8 ? params.radius : 20.0f;
+		params.noise = 0.0f;
+
+		GLuint fragment_tex = wlblur_kawase_blur(renderer, input, w, h, &params);
+		if (fragment_tex) {
+			read_texture(fragment_tex, w, h, fragment);
+		}
+		GLuint compute_tex = wlblur_kawase_compute_blur(compute, input, w, h,
+		                                                &params);
+		if (compute_tex) {
+			read_texture(compute_tex, w, h, result);
+		}
+
+		release_output(renderer, fragment_tex);
+		release_output(renderer, compute_tex);
+
+		if (!fragment_tex || !compute_tex) {
+			fprintf(stderr, "[test] Blur failed (%d passes)\n", passes);
+			ok = false;
+			break;
+		}
+
+		long total = 0;
+		for (size_t i = 0; i < size; i++) {
+			total += abs((int)fragment[i] - (int)result[i]);
+		}
+		double mean = (double)total / (double)size;
+		int diff = max_difference(fragment, result, w, h);
+
+		if (diff > 4 || mean > 1.0) {
+			fprintf(stderr, "[test] Compute output differs from fragment "
+			        "output (%d passes, max diff %d, mean %.3f)\n",
+			        passes, diff, mean);
+			ok = false;
+		} else {
+			printf("[test]   %d passes, radius %.0f: max diff %d, mean %.3f\n",
+			       passes, params.radius, diff, mean);
+		}
+	}
+
+	glDeleteTextures(1, &input);
+
+	if (ok) {
+		printf("[test] ✓ Compute backend matches fragment path\n");
+	}
+
+out:
+	wlblur_kawase_compute_destroy(compute);
+	free(pixels);
+	free(fragment);
+	free(result);
+	return ok;
+}
+
+/**
+ * Texture memory of the pool's idle FBOs
+ */
+static size_t idle_bytes(const struct wlblur_fbo_pool *pool) {
+	return pool->bytes - pool->in_use;
+}
+
+/**
+ * Blurring through many sizes (an interactive resize) must keep working
+ * and keep the pool's idle memory within its budget
+ */
+static bool test_pool_resize_churn(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing FBO pool under resize churn...\n");
+
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	const size_t budget = 4 << 20;
+	wlblur_fbo_pool_set_budget(pool, budget);
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 3;
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	if (!pixels) {
+		return false;
+	}
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	free(pixels);
+
+	/* 40 sizes: with exact-size reuse only, far more than 16 FBOs */
+	bool ok = true;
+	for (int i = 0; i < 40 && ok; i++) {
+		int width = w - i * 4;
+		int height = h - i * 3;
+		GLuint output = wlblur_kawase_blur(renderer, input, width, height,
+		                                   &params);
+		if (!output) {
+			fprintf(stderr, "[test] ✗ Blur failed at %dx%d\n",
+			        width, height);
+			ok = false;
+			break;
+		}
+		release_output(renderer, output);
+
+		if (idle_bytes(pool) > budget) {
+			fprintf(stderr, "[test] ✗ Pool keeps %zu bytes idle, budget %zu\n",
+			        idle_bytes(pool), budget);
+			ok = false;
+		}
+	}
+	glDeleteTextures(1, &input);
+
+	/* Shrinking the budget frees every idle FBO */
+	wlblur_fbo_pool_set_budget(pool, 0);
+	if (ok && idle_bytes(pool) != 0) {
+		fprintf(stderr, "[test] ✗ Idle FBOs left after dropping the budget\n");
+		ok = false;
+	}
+	wlblur_fbo_pool_set_budget(pool, WLBLUR_FBO_POOL_BUDGET);
+
+	if (ok) {
+		printf("[test] ✓ 40 sizes blurred, idle memory within budget\n");
+	}
+	return ok;
+}
+
+/**
+ * Sizes within one size class must reuse the pyramid: a retained chain
+ * keeps its levels and replaces only its output, and a pooled blur
+ * allocates only its exact-size output. The levels' padding then holds
+ * the larger image, which must not leak into the edges.
+ */
+static bool test_size_classes(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing size-class reuse across a resize...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	const int w2 = w - 10, h2 = h - 5;
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 3;
+
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	unsigned char *retained = malloc((size_t)w2 * h2 * 4);
+	unsigned char *pooled = malloc((size_t)w2 * h2 * 4);
+	unsigned char *fresh = malloc((size_t)w2 * h2 * 4);
+	struct wlblur_kawase_chain *chain = wlblur_kawase_chain_create();
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+	struct wlblur_fbo_pool *fresh_pool = wlblur_fbo_pool_create();
+	bool ok = pixels && retained && pooled && fresh && chain && fresh_pool;
+	GLuint input = 0;
+	if (!ok) {
+		goto out;
+	}
+
+	fill_pattern(pixels, w, h);
+	input = upload_texture(pixels, w, h);
+
+	/* Retained chain: render at w x h, then resize */
+	struct wlblur_fbo *levels[8];
+	ok = wlblur_kawase_blur_damage(renderer, chain, input, w, h, &params,
+	                               NULL, 0) != 0;
+	memcpy(levels, chain->down, sizeof(levels));
+	GLuint blurred = ok ? wlblur_kawase_blur_damage(
+		renderer, chain, input, w2, h2, &params, NULL, 0) : 0;
+	for (int i = 0; i < params.num_passes && blurred; i++) {
+		if (chain->down[i] != levels[i] ||
+		    chain->down[i]->width != w2 >> (i + 1)) {
+			fprintf(stderr, "[test] ✗ Resize reallocated level %d\n", i);
+			ok = false;
+		}
+	}
+	if (!blurred) {
+		fprintf(stderr, "[test] ✗ Retained blur failed\n");
+		ok = false;
+		goto out;
+	}
+	read_texture(blurred, w2, h2, retained);
+
+	/* Pooled: the second size allocates only its output */
+	GLuint first = wlblur_kawase_blur(renderer, input, w, h, &params);
+	release_output(renderer, first);
+	int count = pool->count;
+	blurred = wlblur_kawase_blur(renderer, input, w2, h2, &params);
+	int allocated = pool->count - count;
+	if (blurred) {
+		read_texture(blurred, w2, h2, pooled);
+		release_output(renderer, blurred);
+	}
+
+	/* Reference from a pool whose padding was never written */
+	renderer->fbo_pool = fresh_pool;
+	GLuint reference = wlblur_kawase_blur(renderer, input, w2, h2, &params);
+	if (reference) {
+		read_texture(reference, w2, h2, fresh);
+		release_output(renderer, reference);
+	}
+	renderer->fbo_pool = pool;
+
+	if (!first || !blurred || !reference) {
+		fprintf(stderr, "[test] ✗ Pooled blur failed\n");
+		ok = false;
+		goto out;
+	}
+	if (allocated > 1) {
+		fprintf(stderr, "[test] ✗ Resize allocated %d pooled FBOs\n",
+		        allocated);
+		ok = false;
+	}
+
+	int diff = max_difference(pooled, fresh, w2, h2);
+	int retained_diff = max_difference(retained, fresh, w2, h2);
+	if (diff != 0 || retained_diff != 0) {
+		fprintf(stderr, "[test] ✗ Stale padding changed the blur (pooled "
+		        "max diff %d, retained %d)\n", diff, retained_diff);
+		ok = false;
+	}
+
+	if (ok) {
+		printf("[test] ✓ %dx%d to %dx%d reused the pyramid, padding "
+		       "ignored\n", w, h, w2, h2);
+	}
+
+out:
+	glDeleteTextures(1, &input);
+	wlblur_kawase_chain_destroy(chain);
+	wlblur_fbo_pool_destroy(fresh_pool);
+	free(pixels);
+	free(retained);
+	free(pooled);
+	free(fresh);
+	return ok;
+}
+
+/**
+ * A reserved chain must be rendered into as allocated, without
+ * reallocating on the first frame or allocating from the pool
+ */
+static bool test_reserved_chain(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing pre-allocated retained chain...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	struct wlblur_blur_params params = wlblur_params_default();
+	params.num_passes = 3;
+
+	struct wlblur_kawase_chain *chain = wlblur_kawase_chain_create();
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	if (!chain || !pixels ||
+	    !wlblur_kawase_chain_reserve(renderer, chain, w, h, &params)) {
+		fprintf(stderr, "[test] ✗ Reserve failed\n");
+		wlblur_kawase_chain_destroy(chain);
+		free(pixels);
+		return false;
+	}
+
+	struct wlblur_fbo *output = chain->output;
+	struct wlblur_fbo *deepest = chain->down[params.num_passes - 1];
+	int pool_count = renderer->fbo_pool->count;
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	free(pixels);
+
+	bool ok = true;
+	for (int frame = 0; frame < 3 && ok; frame++) {
+		GLuint blurred = wlblur_kawase_blur_damage(renderer, chain, input,
+		                                           w, h, &params, NULL, 0);
+		ok = blurred == output->texture && chain->output == output &&
+		     chain->down[params.num_passes - 1] == deepest &&
+		     renderer->fbo_pool->count == pool_count;
+	}
+	glDeleteTextures(1, &input);
+	wlblur_kawase_chain_destroy(chain);
+
+	if (!ok) {
+		fprintf(stderr, "[test] ✗ Render reallocated the reserved chain\n");
+		return false;
+	}
+
+	printf("[test] ✓ Reserved chain reused as allocated\n");
+	return true;
+}
+
+/**
+ * Copy the source through the finish shader with neutral parameters
+ */
+static void draw_copy(void *data, const struct wlblur_rg_pass *pass,
+                      const struct wlblur_fbo *target) {
+	struct wlblur_kawase_renderer *renderer = data;
+	(void)target;
+
+	glUniform1i(pass->shader->u_tex, 0);
+	glUniform1f(pass->shader->u_brightness, 1.0f);
+	glUniform1f(pass->shader->u_contrast, 1.0f);
+	glUniform1f(pass->shader->u_saturation, 1.0f);
+	glUniform1f(pass->shader->u_noise, 0.0f);
+	glBindVertexArray(renderer->vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	glBindVertexArray(0);
+}
+
+/**
+ * Resources whose lifetimes do not overlap must share FBOs without
+ * corrupting each other, and the two-pass finish must not keep the
+ * pyramid alive next to both full-size targets
+ */
+static bool test_graph_aliasing(struct wlblur_kawase_renderer *renderer) {
+	printf("[test] Testing render graph aliasing...\n");
+
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	size_t size = (size_t)w * h * 4;
+	unsigned char *pixels = malloc(size);
+	unsigned char *copied = malloc(size);
+	if (!pixels || !copied) {
+		free(pixels);
+		free(copied);
+		return false;
+	}
+
+	fill_pattern(pixels, w, h);
+	GLuint input = upload_texture(pixels, w, h);
+	struct wlblur_fbo_pool *pool = renderer->fbo_pool;
+
+	/* input -> a -> b -> c -> d: c reuses a, d reuses b */
+	struct wlblur_render_graph graph;
+	wlblur_rg_init(&graph, pool, input, renderer);
+	int res[4];
+	for (int i = 0; i < 4; i++) {
+		res[i] = wlblur_rg_resource(&graph, w, h, GL_RGBA8, 1);
+		wlblur_rg_pass(&graph, renderer->finish_shader, draw_copy,
+		               i > 0 ? res[i - 1] : WLBLUR_RG_INPUT, 0,
+		               res[i], 0, 0);
+	}
+
+	uint64_t clock = pool->clock;
+	struct wlblur_fbo *output = wlblur_rg_execute(&graph, res[3]);
+	uint64_t acquires = pool->clock - clock;
+	bool ok = output != NULL;
+	int diff = -1;
+	if (output) {
+		read_texture(output->texture, w, h, copied);
+		diff = max_difference(pixels, copied, w, h);
+		wlblur_fbo_pool_release(pool, output);
+	}
+
+	if (!ok || acquires != 2 || diff != 0) {
+		fprintf(stderr, "[test] ✗ Graph used %llu FBOs for 4 resources "
+		        "(max diff %d)\n", (unsigned long long)acquires, diff);
+		ok = false;
+	}
+
+	/* Two-pass finish: the upsampled and output targets are the peak */
+	struct wlblur_blur_params params = wlblur_params_default();
+	bool fuse_finish = renderer->fuse_finish;
+	GLenum format = renderer->intermediate_format;
+	renderer->fuse_finish = false;
+	renderer->intermediate_format = GL_RGBA8;
+
+	size_t in_use = pool->in_use;
+	pool->peak = in_use;
+	GLuint blurred = wlblur_kawase_blur(renderer, input, w, h, &params);
+	size_t peak = pool->peak - in_use;
+	release_output(renderer, blurred);
+
+	renderer->fuse_finish = fuse_finish;
+	renderer->intermediate_format = format;
+	glDeleteTextures(1, &input);
+	free(pixels);
+	free(copied);
+
+	/* The upsampled target is padded to its size class */
+	size_t upsampled = (size_t)wlblur_fbo_size_class(w) *
+	                   wlblur_fbo_size_class(h) * 4;
+	if (!blurred || peak > upsampled + size) {
+		fprintf(stderr, "[test] ✗ Two-pass blur peaked at %zu bytes, "
+		        "expected at most %zu\n", peak, upsampled + size);
+		ok = false;
+	}
+
+	if (ok) {
+		printf("[test] ✓ Graph aliases dead resources (blur peak %zu KiB)\n",
+		       peak >> 10);
+	}
+	return ok;
+}
+
+/**
+ * The fused finish must not be compiled until requested, and blurs must
+ * render with the separate finish pass while it is compiling
+ */
+static bool test_lazy_variants(struct wlblur_egl_context *egl_ctx) {
+	printf("[test] Testing lazily compiled shader variants...\n");
+
+	struct wlblur_kawase_renderer *renderer = wlblur_kawase_create(egl_ctx);
+	if (!renderer) {
+		fprintf(stderr, "[test] ✗ Failed to create Kawase renderer\n");
+		return false;
+	}
+
+	struct wlblur_shader_variant *fused =
+		&renderer->upsample_finish[WLBLUR_FINISH_FULL];
+	bool ok = true;
+	if (fused->program) {
+		fprintf(stderr, "[test] ✗ Fused finish compiled before use\n");
+		ok = false;
+	}
+
+	struct wlblur_blur_params params = wlblur_params_default();
+	wlblur_kawase_prepare(renderer, &params);
+	if (!fused->program) {
+		fprintf(stderr, "[test] ✗ Prepare did not start the fused finish\n");
+		ok = false;
+	}
+
+	/* Ready or not, the blur must not fail or wait */
+	const int w = TEST_WIDTH, h = TEST_HEIGHT;
+	unsigned char *pixels = malloc((size_t)w * h * 4);
+	if (pixels) {
+		fill_pattern(pixels, w, h);
+		GLuint input = upload_texture(pixels, w, h);
+		GLuint output = wlblur_kawase_blur(renderer, input, w, h, &params);
+		if (!output) {
+			fprintf(stderr, "[test] ✗ Blur failed while compiling\n");
+			ok = false;
+		}
+		release_output(renderer, output);
+		glDeleteTextures(1, &input);
+		free(pixels);
+	}
+
+	if (!wlblur_shader_variant_get(egl_ctx, fused, true)) {
+		fprintf(stderr, "[test] ✗ Fused finish did not build\n");
+		ok = false;
+	}
+
+	/* Defines go after #version, which must stay the first line */
+	struct wlblur_shader_variant variant = {
+		.name = "blur_finish.frag.glsl",
+		.defines = "#define WLBLUR_TEST_VARIANT 1\n",
+	};
+	if (!wlblur_shader_variant_get(egl_ctx, &variant, true)) {
+		fprintf(stderr, "[test] ✗ Variant with defines did not build\n");
+		ok = false;
+	}
+	wlblur_shader_variant_reset(&variant);
+
+	wlblur_kawase_destroy(renderer);
+
+	if (ok) {
+		printf("[test] ✓ Variants compile on request (parallel: %s)\n",
+		       egl_ctx->has_parallel_compile ? "yes" : "no");
+	}
+	return ok;
+}
+
+/**
+ * Shaders must load without shader files, and WLBLUR_SHADER_PATH
+ * overrides must have their includes resolved, falling back to the
+ * embedded copy of files the directory lacks
+ */
+static bool test_embedded_shaders(void) {
+	printf("[test] Testing embedded shader sources...\n");
+
+	char *shader_path = getenv("WLBLUR_SHADER_PATH");
+	shader_path = shader_path ? strdup(shader_path) : NULL;
+	unsetenv("WLBLUR_SHADER_PATH");
+
+	char *embedded = wlblur_shader_read_source("kawase_downsample.frag.glsl");
+	bool ok = embedded && strstr(embedded, "#version 300 es");
+	free(embedded);
+
+	char dir[] = "/tmp/wlblur-shaders-XXXXXX";
+	char path[64];
+	char *resolved = NULL;
+	if (ok && mkdtemp(dir)) {
+		snprintf(path, sizeof(path), "%s/include.frag.glsl", dir);
+		FILE *file = fopen(path, "w");
+		if (file) {
+			fputs("#version 300 es\n#include \"common.glsl\"\n"
+			      "void main() {}\n", file);
+			fclose(file);
+		}
+
+		setenv("WLBLUR_SHADER_PATH", dir, 1);
+		resolved = wlblur_shader_read_source("include.frag.glsl");
+		unlink(path);
+		rmdir(dir);
+	}
+	ok = ok && resolved && !strstr(resolved, "#include") &&
+	     strstr(resolved, "float rand(vec2 co)") &&
+	     strstr(resolved, "void main() {}");
+	free(resolved);
+
+	if (shader_path) {
+		setenv("WLBLUR_SHADER_PATH", shader_path, 1);
+		free(shader_path);
+	} else {
+		unsetenv("WLBLUR_SHADER_PATH");
+	}
+
+	if (!ok) {
+		fprintf(stderr, "[test] ✗ Shader source lookup failed\n");
+		return false;
+	}
+
+	printf("[test] ✓ Embedded shaders load, overrides resolve includes\n");
+	return true;
+}
+
+/**
+ * A program loaded twice must come from the binary cache the second time
+ */
+static bool test_program_cache(void) {
+	printf("[test] Testing program binary cache...\n");
+
+	GLint num_formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+	if (num_formats <= 0) {
+		printf("[test] - No program binary formats, skipped\n");
+		return true;
+	}
+
+	char base[] = "/tmp/wlblur-cache-XXXXXX";
+	if (!mkdtemp(base)) {
+		fprintf(stderr, "[test] ✗ Failed to create cache directory\n");
+		return false;
+	}
+	char *saved = getenv("XDG_CACHE_HOME");
+	saved = saved ? strdup(saved) : NULL;
+	setenv("XDG_CACHE_HOME", base, 1);
+
+	char *source = wlblur_shader_read_source("blur_finish.frag.glsl");
+	struct wlblur_shader_program *compiled =
+		source ? wlblur_shader_load_from_source(NULL, source) : NULL;
+	struct wlblur_shader_program *cached =
+		source ? wlblur_shader_load_from_source(NULL, source) : NULL;
+
+	/* Compiled programs keep their shader objects, cached ones have none */
+	bool ok = compiled && compiled->fragment_shader &&
+	          cached && !cached->fragment_shader &&
+	          cached->u_tex == compiled->u_tex &&
+	          cached->u_noise == compiled->u_noise;
+
+	wlblur_shader_destroy(compiled);
+	wlblur_shader_destroy(cached);
+	free(source);
+
+	if (saved) {
+		setenv("XDG_CACHE_HOME", saved, 1);
+		free(saved);
+	} else {
+		unsetenv("XDG_CACHE_HOME");
+	}
+
+	char dir[64];
+	snprintf(dir, sizeof(dir), "%s/wlblur", base);
+	DIR *d = opendir(dir);
+	if (d) {
+		struct dirent *entry;
+		while ((entry = readdir(d))) {
+			char path[384];
+			snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+			if (entry->d_name[0] != '.') {
+				unlink(path);
+			}
+		}
+		closedir(d);
+	}
+	rmdir(dir);
+	rmdir(base);
+
+	if (!ok) {
+		fprintf(stderr, "[test] ✗ Second load did not use the cache\n");
+		return false;
+	}
+
+	printf("[test] ✓ Program reloaded from its cached binary\n");
+	return true;
+}
+
+int main(void) {
+	printf("\n=== wlblur Kawase Test Suite ===\n\n");
+
+	struct wlblur_egl_context *egl_ctx = wlblur_egl_create();
+	if (!egl_ctx) {
+		fprintf(stderr, "[test] No EGL context available, skipping\n");
+		return 77;
+	}
+
+	struct wlblur_kawase_renderer *renderer = wlblur_kawase_create(egl_ctx);
+	if (!renderer) {
+		fprintf(stderr, "[test] ✗ Failed to create Kawase renderer\n");
+		wlblur_egl_destroy(egl_ctx);
+		return 1;
+	}
+
+	bool all_passed = true;
+	all_passed &= test_lazy_variants(egl_ctx);
+
+	/* The tests below compare paths rendered at different times, so no
+	 * variant may become ready between them */
+	build_variants(renderer);
+
+	all_passed &= test_damage_matches_full(renderer);
+	all_passed &= test_region_matches_full(renderer);
+	all_passed &= test_regions_match_full(renderer);
+	all_passed &= test_blur_into_matches_copy(renderer);
+	all_passed &= test_shared_matches_separate(renderer);
+	all_passed &= test_blur_sets_failure(renderer);
+	all_passed &= test_fused_finish_matches_two_pass(renderer);
+	all_passed &= test_finish_variants(renderer);
+	all_passed &= test_atlas_matches_levels(renderer);
+	all_passed &= test_compute_matches_fragment(renderer);
+	all_passed &= test_intermediate_formats(renderer);
+	all_passed &= test_pool_resize_churn(renderer);
+	all_passed &= test_size_classes(renderer);
+	all_passed &= test_reserved_chain(renderer);
+	all_passed &= test_graph_aliasing(renderer);
+	all_passed &= test_embedded_shaders();
+	all_passed &= test_program_cache();
+
+	wlblur_kawase_destroy(renderer);
+	wlblur_egl_destroy(egl_ctx);
 
-// TODO: Implementation
+	printf("\n=== Test Results ===\n");
+	if (all_passed) {
+		printf("✓ All tests passed!\n\n");
+		return 0;
+	} else {
+		printf("✗ Some tests failed\n\n");
+		return 1;
+	}
+}
@@ -60,6 +60,7 @@ struct daemon_config {
     char socket_path[256];              // Unix socket path
     char log_level[16];                 // Log level: debug, info, warn, error
     uint32_t max_nodes_per_client;      // Resource limit
+    uint32_t gpu_memory_budget_mb;      // Idle FBO pool budget, 0 = library default
 
     /* Default blur parameters */
     bool has_defaults;                  // true if [defaults] section present
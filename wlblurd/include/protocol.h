@@ -14,13 +14,28 @@
 #include <sys/types.h>
 #include <stdbool.h>
 #include <wlblur/blur_params.h>
+#include <wlblur/wlblur.h>
 
 /*
  * IPC Protocol Definitions
  * See: docs/api/ipc-protocol.md
  */
 
-#define WLBLUR_PROTOCOL_VERSION 1
+#define WLBLUR_PROTOCOL_VERSION 2
+
+/*
+ * Version 1 messages are a prefix of version 2 ones: a version 1 request
+ * ends before params.box_iterations and a version 1 response before
+ * release_fence_type. wlblurd still serves version 1 clients, zeroing the
+ * fields they do not send and replying with version 1 responses. New
+ * fields are only ever appended, to these structs and to
+ * struct wlblur_blur_params.
+ */
+#define WLBLUR_REQUEST_V1_SIZE \
+    (offsetof(struct wlblur_request, params) + \
+     offsetof(struct wlblur_blur_params, box_iterations))
+#define WLBLUR_RESPONSE_V1_SIZE \
+    offsetof(struct wlblur_response, release_fence_type)
 
 /**
  * Operation codes
@@ -29,8 +44,32 @@ enum wlblur_op {
     WLBLUR_OP_CREATE_NODE = 1,
     WLBLUR_OP_DESTROY_NODE = 2,
     WLBLUR_OP_RENDER_BLUR = 3,
+    WLBLUR_OP_RELEASE_BUFFER = 4,
+    WLBLUR_OP_RENDER_BLUR_REGIONS = 10,
+    WLBLUR_OP_RENDER_BLUR_PRESETS = 11,
+    WLBLUR_OP_INVALIDATE_NODE = 12,
+    WLBLUR_OP_IMPORT_DMABUF = 13,
+    WLBLUR_OP_RESIZE_NODE = 14,
+};
+
+/**
+ * Render flags (RENDER_BLUR)
+ */
+enum wlblur_render_flags {
+    // Backdrop does not change until INVALIDATE_NODE: blur it once, keep
+    // the result resident and cache it on disk
+    WLBLUR_RENDER_STATIC = 1 << 0,
+    // Reply with a release fence instead of relying on implicit sync
+    WLBLUR_RENDER_RELEASE_FENCE = 1 << 1,
+    // Render into the node's output ring; see buffer_index in the response
+    WLBLUR_RENDER_BUFFER_RING = 1 << 2,
 };
 
+/**
+ * Maximum number of regions per RENDER_BLUR_REGIONS request
+ */
+#define WLBLUR_MAX_REGIONS 16
+
 /**
  * Status codes
  */
@@ -42,6 +81,8 @@ enum wlblur_status {
     WLBLUR_STATUS_DMABUF_EXPORT_FAILED = 4,
     WLBLUR_STATUS_RENDER_FAILED = 5,
     WLBLUR_STATUS_OUT_OF_MEMORY = 6,
+    WLBLUR_STATUS_BUFFERS_BUSY = 7,  // Output ring full: release a buffer
+    WLBLUR_STATUS_UNSUPPORTED_VERSION = 8,  // Unknown protocol_version
 };
 
 /**
@@ -70,6 +111,59 @@ struct wlblur_request {
 
     // Blur parameters (optional override)
     struct wlblur_blur_params params;
+
+    // === Version 2: append only ===
+
+    // Damage tracking (RENDER_BLUR)
+    // Input rects that changed since the node's last render. The daemon
+    // expands them by damage_expand and re-blurs only that region of the
+    // node's retained output. 0 = full re-blur.
+    uint32_t num_damage_rects;
+    struct wlblur_rect damage_rects[WLBLUR_MAX_DAMAGE_RECTS];
+
+    // Source region (RENDER_BLUR)
+    // Input rect to blur; the output buffer has its size. The daemon
+    // builds the pyramid only over the rect plus damage_expand.
+    // Empty (all zero) = whole buffer. Damage stays in buffer coordinates.
+    struct wlblur_rect source_rect;
+
+    // Region list (RENDER_BLUR_REGIONS)
+    // Rects blurred from the one input buffer with shared params; the
+    // daemon sends one response + FD per rect, in order.
+    uint32_t num_regions;
+    struct wlblur_rect regions[WLBLUR_MAX_REGIONS];
+
+    // Preset list (RENDER_BLUR_PRESETS)
+    // Presets applied to source_rect of the one input buffer, sharing the
+    // blur pyramid; the daemon sends one response + FD per preset, in order.
+    uint32_t num_presets;
+    char preset_names[WLBLUR_MAX_PARAM_SETS][32];
+
+    // Render flags (RENDER_BLUR), WLBLUR_RENDER_*
+    uint32_t flags;
+
+    // Acquire fence (render ops)
+    // Kind of the optional second FD, enum wlblur_fence_type. The daemon
+    // waits for it before reading the input.
+    uint32_t acquire_fence_type;
+
+    // Output ring buffer to return (RELEASE_BUFFER)
+    uint32_t buffer_index;
+
+    // Registered input (IMPORT_DMABUF result): render ops sent without an
+    // FD blur it; RELEASE_BUFFER drops it. 0 = none
+    uint32_t buffer_id;
+
+    // Registered buffer RENDER_BLUR renders into instead of exporting one
+    // (no FD in the reply). Must be the output size. 0 = daemon-allocated
+    uint32_t output_buffer_id;
+
+    // Static backdrop contents (WLBLUR_RENDER_STATIC)
+    // Compositor-chosen ID of what the input shows, e.g. a hash of the
+    // wallpaper path and its generation; a new ID means new contents.
+    // Keys the on-disk cache, so a restarted daemon serves the backdrop
+    // without reading the input. 0 = no disk cache
+    uint64_t content_id;
 } __attribute__((packed));
 
 /**
@@ -88,6 +182,23 @@ struct wlblur_response {
     uint64_t modifier;
     uint32_t stride;
     uint32_t offset;
+
+    // === Version 2: append only ===
+
+    // Release fence (WLBLUR_RENDER_RELEASE_FENCE)
+    // Kind of the second FD, enum wlblur_fence_type; NONE = no fence was
+    // created and the buffer relies on implicit sync
+    uint32_t release_fence_type;
+
+    // Output ring (WLBLUR_RENDER_BUFFER_RING)
+    // Node buffer holding the result, until RELEASE_BUFFER. Its DMA-BUF
+    // FD is only sent when buffer_is_new (first use of the index, or a
+    // size change); otherwise the client reuses the buffer it holds.
+    uint32_t buffer_index;
+    uint32_t buffer_is_new;
+
+    // Registered input buffer (for IMPORT_DMABUF)
+    uint32_t buffer_id;
 } __attribute__((packed));
 
 /*
@@ -95,28 +206,35 @@ struct wlblur_response {
  */
 
 /**
- * Receive message with optional file descriptor
+ * Receive message with optional file descriptors
  *
- * Uses SCM_RIGHTS ancillary data to receive FD alongside message.
+ * Uses SCM_RIGHTS ancillary data to receive FDs alongside message.
  *
  * @param sockfd Socket file descriptor
  * @param buf Buffer to receive message data
  * @param len Length of buffer
  * @param fd_out Output parameter for received FD (set to -1 if none)
+ * @param fence_out Output parameter for a second, fence FD (set to -1 if
+ *                  none); NULL closes any fence received
+ * @param fds_dropped Set when the sender attached more than two FDs: every
+ *                    FD received is closed and both outputs are -1
  * @return Number of bytes received, or -1 on error
  */
-ssize_t recv_with_fd(int sockfd, void *buf, size_t len, int *fd_out);
+ssize_t recv_with_fd(int sockfd, void *buf, size_t len, int *fd_out,
+                     int *fence_out, bool *fds_dropped);
 
 /**
- * Send message with optional file descriptor
+ * Send message with optional file descriptors
  *
  * @param sockfd Socket file descriptor
  * @param buf Buffer containing message data
  * @param len Length of message
  * @param fd File descriptor to send (or -1 for none)
+ * @param fence_fd Fence sent after fd, or alone (or -1 for none)
  * @return Number of bytes sent, or -1 on error
  */
-ssize_t send_with_fd(int sockfd, const void *buf, size_t len, int fd);
+ssize_t send_with_fd(int sockfd, const void *buf, size_t len, int fd,
+                     int fence_fd);
 
 /*
  * Client connection management
@@ -209,6 +327,219 @@ void blur_node_destroy_client(uint32_t client_id);
  */
 uint32_t blur_node_get_client(const struct blur_node *node);
 
+/**
+ * Set a node's size and parameters, allocating its retained chain
+ *
+ * The pyramid and output are sized for whole-buffer renders of this
+ * size and DRM format, so steady-state renders allocate nothing. Skipped
+ * while params are invalid (a node rendered only with presets) or
+ * there is no blur context. Drops the resident static result.
+ *
+ * @param node Node pointer
+ * @param ctx Blur context, or NULL
+ * @param width Input width
+ * @param height Input height
+ * @param format Input DRM format
+ * @param params Blur parameters renders default to
+ * @return false if the chain could not be allocated
+ */
+bool blur_node_resize(struct blur_node *node, struct wlblur_context *ctx,
+                      uint32_t width, uint32_t height, uint32_t format,
+                      const struct wlblur_blur_params *params);
+
+/**
+ * Get the parameters the node was created or last resized with
+ *
+ * @param node Node pointer
+ * @return Node parameters
+ */
+const struct wlblur_blur_params* blur_node_get_params(
+    const struct blur_node *node);
+
+/**
+ * Get the node's retained blur state, creating it on first use
+ *
+ * @param node Node pointer
+ * @param ctx Blur context used to create the state
+ * @return Retained state or NULL on failure
+ */
+struct wlblur_node* blur_node_get_retained(struct blur_node *node,
+                                           struct wlblur_context *ctx);
+
+/**
+ * Get the node's output ring, creating it on first use
+ *
+ * @param node Node pointer
+ * @param ctx Blur context used to create the ring
+ * @return Output ring or NULL on failure
+ */
+struct wlblur_output_ring* blur_node_get_ring(struct blur_node *node,
+                                              struct wlblur_context *ctx);
+
+/**
+ * Return an output ring buffer to the node
+ *
+ * Unknown or free indices are ignored.
+ *
+ * @param node Node pointer
+ * @param index Buffer index from a RENDER_BLUR response
+ */
+void blur_node_release_buffer(struct blur_node *node, uint32_t index);
+
+/**
+ * Get the node's resident static result, if it was rendered with the
+ * same input size, parameters, source rect and content ID
+ *
+ * @param node Node pointer
+ * @param width Input width
+ * @param height Input height
+ * @param params Blur parameters
+ * @param source Source rect of the request
+ * @param content_id Content ID of the request
+ * @return Resident buffer (node keeps the FDs) or NULL
+ */
+const struct wlblur_dmabuf_attribs* blur_node_get_static(
+    const struct blur_node *node, int width, int height,
+    const struct wlblur_blur_params *params,
+    const struct wlblur_rect *source, uint64_t content_id);
+
+/**
+ * Make a buffer the node's resident static result
+ *
+ * Takes ownership of the buffer's FDs and drops any previous result.
+ */
+void blur_node_set_static(struct blur_node *node, int width, int height,
+                          const struct wlblur_blur_params *params,
+                          const struct wlblur_rect *source,
+                          uint64_t content_id,
+                          const struct wlblur_dmabuf_attribs *output);
+
+/**
+ * Drop the node's resident static result
+ *
+ * @param node Node pointer
+ */
+void blur_node_invalidate(struct blur_node *node);
+
+/*
+ * Input buffer registry
+ *
+ * DMA-BUFs a client imported once with IMPORT_DMABUF (e.g. its swapchain
+ * backdrops, or output buffers it allocated), kept until released.
+ */
+
+/**
+ * Import a client buffer and register it
+ *
+ * @param client_id Client that owns the buffer
+ * @param ctx Blur context to import with
+ * @param attribs Buffer attributes (caller keeps the FDs)
+ * @return Buffer ID, or 0 on error
+ */
+uint32_t buffer_registry_import(uint32_t client_id,
+                                struct wlblur_context *ctx,
+                                const struct wlblur_dmabuf_attribs *attribs);
+
+/**
+ * Lookup a client's registered buffer
+ *
+ * Pass its wlblur_buffer_get_attribs() to libwlblur unchanged: the
+ * imported buffer is recognized by the address of its attributes.
+ *
+ * @param client_id Client making the request
+ * @param buffer_id Buffer ID from buffer_registry_import()
+ * @return Imported buffer, or NULL if not found or not the client's
+ */
+struct wlblur_buffer* buffer_registry_lookup(uint32_t client_id,
+                                             uint32_t buffer_id);
+
+/**
+ * Release a client's registered buffer
+ *
+ * @param client_id Client making the request
+ * @param buffer_id Buffer ID (unknown IDs are ignored)
+ */
+void buffer_registry_release(uint32_t client_id, uint32_t buffer_id);
+
+/**
+ * Release all buffers registered by a client
+ *
+ * @param client_id Client ID
+ */
+void buffer_registry_destroy_client(uint32_t client_id);
+
+/*
+ * Static backdrop cache
+ *
+ * Blurred static backdrops, stored under $XDG_CACHE_HOME/wlblur so they
+ * survive daemon restarts.
+ */
+
+/**
+ * Cached result mapped from disk
+ */
+struct blur_cache_entry {
+    void *map;
+    size_t map_size;
+    const void *pixels;  // Tightly packed RGBA8 (wlblur_read_pixels())
+    int width;
+    int height;
+};
+
+/**
+ * Compute the cache key of a blurred backdrop
+ *
+ * @param content_id Compositor-supplied content ID (nonzero)
+ * @param width Input width
+ * @param height Input height
+ * @param params Blur parameters
+ * @param source Source rect of the request
+ * @return Key for blur_cache_load() / blur_cache_store()
+ */
+uint64_t blur_cache_key(uint64_t content_id, int width, int height,
+                        const struct wlblur_blur_params *params,
+                        const struct wlblur_rect *source);
+
+/**
+ * Map a cached result
+ *
+ * @param key Cache key
+ * @param entry Filled on a hit; release with blur_cache_unmap()
+ * @return true on a hit, false on a miss or unreadable file
+ */
+bool blur_cache_load(uint64_t key, struct blur_cache_entry *entry);
+
+/**
+ * Unmap a result mapped by blur_cache_load()
+ *
+ * @param entry Mapped entry
+ */
+void blur_cache_unmap(struct blur_cache_entry *entry);
+
+/**
+ * Export a mapped result as a linear DMA-BUF without the GPU
+ *
+ * Needs /dev/udmabuf; returns false (once logged) when it is missing.
+ *
+ * @param entry Mapped entry from blur_cache_load()
+ * @param attribs Filled on success; caller owns the FD
+ * @return true on success
+ */
+bool blur_cache_export(const struct blur_cache_entry *entry,
+                       struct wlblur_dmabuf_attribs *attribs);
+
+/**
+ * Store a blurred result
+ *
+ * @param key Cache key
+ * @param pixels Tightly packed RGBA8 output pixels
+ * @param width Output width
+ * @param height Output height
+ * @return true on success, false on failure
+ */
+bool blur_cache_store(uint64_t key, const void *pixels, int width,
+                      int height);
+
 /*
  * Protocol initialization
  */
@@ -258,4 +589,22 @@ struct daemon_config;
  */
 struct daemon_config* get_global_config(void);
 
+/**
+ * Apply a loaded configuration to the blur context
+ *
+ * Called at startup and after each reload; starts compiling the shaders
+ * of the defaults and every preset.
+ *
+ * @param config Configuration (NULL-safe)
+ */
+void ipc_protocol_apply_config(const struct daemon_config *config);
+
+/**
+ * Release what the blur context keeps between requests
+ *
+ * Called when the event loop has been idle for a second; drops the
+ * cached input imports so buffers clients freed are released.
+ */
+void ipc_protocol_idle(void);
+
 #endif /* WLBLURD_PROTOCOL_H */
@@ -0,0 +1,299 @@
+/*
+ * wlblur - Compositor-agnostic blur for Wayland
+ * Copyright (C) 2025 mecattaf
+ * SPDX-License-Identifier: MIT
+ *
+ * blur_cache.c - On-disk cache of blurred static backdrops
+ */
+
+#define _GNU_SOURCE  // memfd_create()
+
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <drm_fourcc.h>
+#include <linux/udmabuf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BLUR_CACHE_MAGIC 0x43424c57  // "WLBC"
+#define BLUR_CACHE_VERSION 1
+
+/**
+ * Cache file header, followed by width * height RGBA8 pixels
+ */
+struct blur_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+};
+
+/**
+ * 64-bit FNV-1a, continuing from hash
+ */
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Get cache directory, creating it on first use
+ *
+ * Priority:
+ * 1. $XDG_CACHE_HOME/wlblur
+ * 2. ~/.cache/wlblur
+ */
+static const char* get_cache_dir(void) {
+    static char path[512];
+
+    if (path[0] != '\0') {
+        return path;
+    }
+
+    char base[480];
+    const char *xdg_cache = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    if (xdg_cache && xdg_cache[0] != '\0') {
+        snprintf(base, sizeof(base), "%s", xdg_cache);
+    } else if (home) {
+        snprintf(base, sizeof(base), "%s/.cache", home);
+    } else {
+        return NULL;
+    }
+
+    if (mkdir(base, 0700) < 0 && errno != EEXIST) {
+        fprintf(stderr, "[wlblurd] Failed to create %s: %s\n",
+                base, strerror(errno));
+        return NULL;
+    }
+
+    snprintf(path, sizeof(path), "%s/wlblur", base);
+    if (mkdir(path, 0700) < 0 && errno != EEXIST) {
+        fprintf(stderr, "[wlblurd] Failed to create %s: %s\n",
+                path, strerror(errno));
+        path[0] = '\0';
+        return NULL;
+    }
+
+    return path;
+}
+
+static bool get_cache_path(uint64_t key, char *path, size_t size) {
+    const char *dir = get_cache_dir();
+    if (!dir) {
+        return false;
+    }
+
+    snprintf(path, size, "%s/%016llx.blur", dir, (unsigned long long)key);
+    return true;
+}
+
+/**
+ * Compute the cache key of a blurred backdrop
+ */
+uint64_t blur_cache_key(uint64_t content_id, int width, int height,
+                        const struct wlblur_blur_params *params,
+                        const struct wlblur_rect *source) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    // Library version, so shader changes do not serve stale results
+    struct wlblur_version version = wlblur_version();
+    hash = fnv1a(hash, version.string, strlen(version.string));
+
+    int32_t size[2] = { width, height };
+    hash = fnv1a(hash, size, sizeof(size));
+    hash = fnv1a(hash, params, sizeof(*params));
+    hash = fnv1a(hash, source, sizeof(*source));
+    hash = fnv1a(hash, &content_id, sizeof(content_id));
+
+    return hash;
+}
+
+/**
+ * Map a cached result
+ */
+bool blur_cache_load(uint64_t key, struct blur_cache_entry *entry) {
+    char path[576];
+    if (!get_cache_path(key, path, sizeof(path))) {
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;  // Miss
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 ||
+        (size_t)st.st_size < sizeof(struct blur_cache_header)) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const struct blur_cache_header *header = map;
+    size_t expected = sizeof(*header) +
+                      (size_t)header->width * header->height * 4;
+    if (header->magic != BLUR_CACHE_MAGIC ||
+        header->version != BLUR_CACHE_VERSION ||
+        header->width == 0 || header->height == 0 ||
+        (size_t)st.st_size != expected) {
+        fprintf(stderr, "[wlblurd] Ignoring invalid cache file %s\n", path);
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    entry->map = map;
+    entry->map_size = st.st_size;
+    entry->pixels = header + 1;
+    entry->width = header->width;
+    entry->height = header->height;
+    return true;
+}
+
+/**
+ * Unmap a result mapped by blur_cache_load()
+ */
+void blur_cache_unmap(struct blur_cache_entry *entry) {
+    if (entry->map) {
+        munmap(entry->map, entry->map_size);
+        entry->map = NULL;
+    }
+}
+
+/**
+ * Export a mapped result as a linear DMA-BUF without the GPU
+ *
+ * udmabuf only wraps shmem, so the mapped file is copied into a sealed
+ * memfd first; that is a CPU copy from the page cache, with no upload.
+ */
+bool blur_cache_export(const struct blur_cache_entry *entry,
+                       struct wlblur_dmabuf_attribs *attribs) {
+    static bool udmabuf_missing = false;
+    if (udmabuf_missing) {
+        return false;
+    }
+
+    int dev = open("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+    if (dev < 0) {
+        fprintf(stderr, "[wlblurd] /dev/udmabuf unavailable (%s), "
+                "uploading cached backdrops instead\n", strerror(errno));
+        udmabuf_missing = true;
+        return false;
+    }
+
+    size_t stride = (size_t)entry->width * 4;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (stride * entry->height + page - 1) / page * page;
+
+    int memfd = memfd_create("wlblur-cache", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0 || ftruncate(memfd, size) < 0) {
+        fprintf(stderr, "[wlblurd] Failed to create cache memfd: %s\n",
+                strerror(errno));
+        if (memfd >= 0) {
+            close(memfd);
+        }
+        close(dev);
+        return false;
+    }
+
+    void *map = mmap(NULL, size, PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (map == MAP_FAILED) {
+        close(memfd);
+        close(dev);
+        return false;
+    }
+    memcpy(map, entry->pixels, stride * entry->height);
+    munmap(map, size);
+
+    // udmabuf requires the memfd to be unable to shrink
+    struct udmabuf_create create = {
+        .memfd = memfd,
+        .flags = UDMABUF_FLAGS_CLOEXEC,
+        .offset = 0,
+        .size = size,
+    };
+    int fd = -1;
+    if (fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK) == 0) {
+        fd = ioctl(dev, UDMABUF_CREATE, &create);
+    }
+    int err = errno;
+    close(memfd);  // The DMA-BUF keeps the pages
+    close(dev);
+    if (fd < 0) {
+        fprintf(stderr, "[wlblurd] Failed to create udmabuf: %s\n",
+                strerror(err));
+        return false;
+    }
+
+    memset(attribs, 0, sizeof(*attribs));
+    attribs->width = entry->width;
+    attribs->height = entry->height;
+    attribs->format = DRM_FORMAT_ABGR8888;  // RGBA8 byte order
+    attribs->modifier = DRM_FORMAT_MOD_LINEAR;
+    attribs->num_planes = 1;
+    attribs->planes[0].fd = fd;
+    attribs->planes[0].offset = 0;
+    attribs->planes[0].stride = stride;
+    for (int i = 1; i < 4; i++) {
+        attribs->planes[i].fd = -1;
+    }
+    return true;
+}
+
+/**
+ * Store a blurred result
+ *
+ * Written to a temporary file and renamed into place, so readers never
+ * map a partial file.
+ */
+bool blur_cache_store(uint64_t key, const void *pixels, int width,
+                      int height) {
+    char path[576];
+    char tmp_path[600];
+    if (!get_cache_path(key, path, sizeof(path))) {
+        return false;
+    }
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid());
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        fprintf(stderr, "[wlblurd] Failed to create %s: %s\n",
+                tmp_path, strerror(errno));
+        return false;
+    }
+
+    struct blur_cache_header header = {
+        .magic = BLUR_CACHE_MAGIC,
+        .version = BLUR_CACHE_VERSION,
+        .width = width,
+        .height = height,
+    };
+    size_t pixel_bytes = (size_t)width * height * 4;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(pixels, pixel_bytes, 1, file) == 1;
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(tmp_path, path) < 0) {
+        fprintf(stderr, "[wlblurd] Failed to write cache file %s\n", path);
+        unlink(tmp_path);
+        return false;
+    }
+
+    return true;
+}
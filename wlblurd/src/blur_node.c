@@ -7,12 +7,16 @@
  */
 
 #include "protocol.h"
+#include <wlblur/dmabuf.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #define MAX_NODES_PER_CLIENT 100
 
+// Output buffers per node: one being read, one being blurred, one queued
+#define NODE_RING_DEPTH 3
+
 /**
  * Blur node structure
  */
@@ -20,13 +24,29 @@ struct blur_node {
     uint32_t node_id;
     uint32_t client_id;
 
-    // Dimensions
+    // Dimensions and DRM format the retained chain is sized for
     int width;
     int height;
+    uint32_t format;
 
     // Parameters
     struct wlblur_blur_params params;
 
+    // Retained pyramid + output for damage-aware re-blur (lazy)
+    struct wlblur_node *retained;
+
+    // Output buffers, each exported once (lazy)
+    struct wlblur_output_ring *ring;
+
+    // Resident result of a static backdrop and what it was rendered from
+    bool has_static;
+    struct wlblur_dmabuf_attribs static_output;
+    int static_width;
+    int static_height;
+    struct wlblur_blur_params static_params;
+    struct wlblur_rect static_source;
+    uint64_t static_content_id;
+
     // Statistics
     uint64_t render_count;
     uint64_t last_render_time_us;
@@ -109,6 +129,9 @@ void blur_node_destroy(uint32_t node_id) {
         if (n->node_id == node_id) {
             *prev = n->next;
             printf("[wlblurd] Destroyed blur node %u\n", node_id);
+            blur_node_invalidate(n);
+            wlblur_output_ring_destroy(n->ring);
+            wlblur_node_destroy(n->retained);
             free(n);
             return;
         }
@@ -127,6 +150,9 @@ void blur_node_destroy_client(uint32_t client_id) {
         struct blur_node *n = *prev;
         if (n->client_id == client_id) {
             *prev = n->next;
+            blur_node_invalidate(n);
+            wlblur_output_ring_destroy(n->ring);
+            wlblur_node_destroy(n->retained);
             free(n);
             count++;
         } else {
@@ -148,3 +174,137 @@ uint32_t blur_node_get_client(const struct blur_node *node) {
     }
     return 0;
 }
+
+/**
+ * Set a node's size and parameters, allocating its retained chain
+ */
+bool blur_node_resize(struct blur_node *node, struct wlblur_context *ctx,
+                      uint32_t width, uint32_t height, uint32_t format,
+                      const struct wlblur_blur_params *params) {
+    node->width = width;
+    node->height = height;
+    node->format = format;
+    node->params = *params;
+
+    // Resident result is for the old size
+    blur_node_invalidate(node);
+
+    if (!ctx || width == 0 || height == 0 || !wlblur_params_validate(params)) {
+        return true;
+    }
+
+    struct wlblur_node *retained = blur_node_get_retained(node, ctx);
+    if (!retained ||
+        !wlblur_node_reserve(retained, width, height, format, params)) {
+        fprintf(stderr, "[wlblurd] Failed to allocate node %u (%ux%u): %s\n",
+                node->node_id, width, height,
+                wlblur_error_string(wlblur_get_error()));
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Get the parameters the node was created or last resized with
+ */
+const struct wlblur_blur_params* blur_node_get_params(
+    const struct blur_node *node) {
+    return &node->params;
+}
+
+/**
+ * Get the node's retained blur state, creating it on first use
+ */
+struct wlblur_node* blur_node_get_retained(struct blur_node *node,
+                                           struct wlblur_context *ctx) {
+    if (!node || !ctx) {
+        return NULL;
+    }
+
+    if (!node->retained) {
+        node->retained = wlblur_node_create(ctx);
+        if (!node->retained) {
+            fprintf(stderr, "[wlblurd] Failed to create retained state for node %u\n",
+                    node->node_id);
+        }
+    }
+
+    return node->retained;
+}
+
+/**
+ * Get the node's output ring, creating it on first use
+ */
+struct wlblur_output_ring* blur_node_get_ring(struct blur_node *node,
+                                              struct wlblur_context *ctx) {
+    if (!node || !ctx) {
+        return NULL;
+    }
+
+    if (!node->ring) {
+        node->ring = wlblur_output_ring_create(ctx, NODE_RING_DEPTH);
+        if (!node->ring) {
+            fprintf(stderr, "[wlblurd] Failed to create output ring for node %u\n",
+                    node->node_id);
+        }
+    }
+
+    return node->ring;
+}
+
+/**
+ * Return an output ring buffer the client has finished reading
+ */
+void blur_node_release_buffer(struct blur_node *node, uint32_t index) {
+    if (node && node->ring) {
+        wlblur_output_ring_release(node->ring, (int)index);
+    }
+}
+
+/**
+ * Get the node's resident static result if its key matches
+ */
+const struct wlblur_dmabuf_attribs* blur_node_get_static(
+    const struct blur_node *node, int width, int height,
+    const struct wlblur_blur_params *params,
+    const struct wlblur_rect *source, uint64_t content_id) {
+    if (!node || !node->has_static ||
+        node->static_width != width || node->static_height != height ||
+        node->static_content_id != content_id ||
+        memcmp(&node->static_params, params, sizeof(*params)) != 0 ||
+        memcmp(&node->static_source, source, sizeof(*source)) != 0) {
+        return NULL;
+    }
+
+    return &node->static_output;
+}
+
+/**
+ * Make a buffer the node's resident static result
+ */
+void blur_node_set_static(struct blur_node *node, int width, int height,
+                          const struct wlblur_blur_params *params,
+                          const struct wlblur_rect *source,
+                          uint64_t content_id,
+                          const struct wlblur_dmabuf_attribs *output) {
+    blur_node_invalidate(node);
+
+    node->has_static = true;
+    node->static_output = *output;
+    node->static_width = width;
+    node->static_height = height;
+    node->static_params = *params;
+    node->static_source = *source;
+    node->static_content_id = content_id;
+}
+
+/**
+ * Drop the node's resident static result
+ */
+void blur_node_invalidate(struct blur_node *node) {
+    if (node && node->has_static) {
+        wlblur_dmabuf_close(&node->static_output);
+        node->has_static = false;
+    }
+}
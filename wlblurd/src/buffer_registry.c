@@ -7,5 +7,138 @@
  */
 
 #include "protocol.h"
+#include <stdlib.h>
+#include <stdio.h>
 
-// TODO: Implementation
+// A swapchain or two of backdrops, with room to spare
+#define MAX_BUFFERS_PER_CLIENT 32
+
+/**
+ * Registered input buffer
+ */
+struct registered_buffer {
+    uint32_t buffer_id;
+    uint32_t client_id;
+
+    // Imported texture, kept until release
+    struct wlblur_buffer *buffer;
+
+    struct registered_buffer *next;  // Linked list
+};
+
+static struct registered_buffer *buffer_list = NULL;
+static uint32_t next_buffer_id = 1;
+
+/**
+ * Count buffers registered by a client
+ */
+static int count_client_buffers(uint32_t client_id) {
+    int count = 0;
+    for (struct registered_buffer *b = buffer_list; b; b = b->next) {
+        if (b->client_id == client_id) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Import a client buffer and register it
+ */
+uint32_t buffer_registry_import(uint32_t client_id,
+                                struct wlblur_context *ctx,
+                                const struct wlblur_dmabuf_attribs *attribs) {
+    // Check resource limits
+    int client_buffer_count = count_client_buffers(client_id);
+    if (client_buffer_count >= MAX_BUFFERS_PER_CLIENT) {
+        fprintf(stderr, "[wlblurd] Client %u exceeds buffer limit (%d/%d)\n",
+                client_id, client_buffer_count, MAX_BUFFERS_PER_CLIENT);
+        return 0;
+    }
+
+    struct registered_buffer *reg = calloc(1, sizeof(*reg));
+    if (!reg) {
+        fprintf(stderr, "[wlblurd] Failed to allocate buffer\n");
+        return 0;
+    }
+
+    reg->buffer = wlblur_buffer_import(ctx, attribs);
+    if (!reg->buffer) {
+        fprintf(stderr, "[wlblurd] Failed to import buffer for client %u: %s\n",
+                client_id, wlblur_error_string(wlblur_get_error()));
+        free(reg);
+        return 0;
+    }
+
+    reg->buffer_id = next_buffer_id++;
+    reg->client_id = client_id;
+
+    // Add to head of list
+    reg->next = buffer_list;
+    buffer_list = reg;
+
+    printf("[wlblurd] Imported buffer %u for client %u (%dx%d)\n",
+           reg->buffer_id, client_id, attribs->width, attribs->height);
+
+    return reg->buffer_id;
+}
+
+/**
+ * Lookup a client's registered buffer
+ */
+struct wlblur_buffer* buffer_registry_lookup(uint32_t client_id,
+                                             uint32_t buffer_id) {
+    for (struct registered_buffer *b = buffer_list; b; b = b->next) {
+        if (b->buffer_id == buffer_id) {
+            if (b->client_id != client_id) {
+                return NULL;
+            }
+            return b->buffer;
+        }
+    }
+
+    fprintf(stderr, "[wlblurd] Unknown buffer %u\n", buffer_id);
+    return NULL;
+}
+
+/**
+ * Release a client's registered buffer
+ */
+void buffer_registry_release(uint32_t client_id, uint32_t buffer_id) {
+    struct registered_buffer **prev = &buffer_list;
+
+    for (struct registered_buffer *b = buffer_list; b; b = b->next) {
+        if (b->buffer_id == buffer_id && b->client_id == client_id) {
+            *prev = b->next;
+            printf("[wlblurd] Released buffer %u\n", buffer_id);
+            wlblur_buffer_destroy(b->buffer);
+            free(b);
+            return;
+        }
+        prev = &b->next;
+    }
+}
+
+/**
+ * Release all buffers registered by a client
+ */
+void buffer_registry_destroy_client(uint32_t client_id) {
+    struct registered_buffer **prev = &buffer_list;
+    int count = 0;
+
+    while (*prev) {
+        struct registered_buffer *b = *prev;
+        if (b->client_id == client_id) {
+            *prev = b->next;
+            wlblur_buffer_destroy(b->buffer);
+            free(b);
+            count++;
+        } else {
+            prev = &b->next;
+        }
+    }
+
+    if (count > 0) {
+        printf("[wlblurd] Released %d buffers for client %u\n", count, client_id);
+    }
+}
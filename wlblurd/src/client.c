@@ -63,6 +63,7 @@ void client_unregister(int client_fd) {
 
             // Cleanup all blur nodes owned by this client
             blur_node_destroy_client(clients[i].client_id);
+            buffer_registry_destroy_client(clients[i].client_id);
 
             clients[i].active = false;
             clients[i].fd = -1;
@@ -61,11 +61,21 @@ static bool parse_algorithm(const char *str, enum wlblur_algorithm *out) {
         *out = WLBLUR_ALGO_KAWASE;
         return true;
     }
-    // Future algorithms (not supported in m-3)
-    if (strcmp(str, "gaussian") == 0 || strcmp(str, "box") == 0 ||
-        strcmp(str, "bokeh") == 0) {
-        fprintf(stderr, "[config] Algorithm '%s' not yet supported (coming in v2.0)\n", str);
-        return false;
+    if (strcmp(str, "gaussian") == 0) {
+        *out = WLBLUR_ALGO_GAUSSIAN;
+        return true;
+    }
+    if (strcmp(str, "box") == 0) {
+        *out = WLBLUR_ALGO_BOX;
+        return true;
+    }
+    if (strcmp(str, "bokeh") == 0) {
+        *out = WLBLUR_ALGO_BOKEH;
+        return true;
+    }
+    if (strcmp(str, "iir") == 0) {
+        *out = WLBLUR_ALGO_IIR;
+        return true;
     }
     fprintf(stderr, "[config] Unknown algorithm: %s\n", str);
     return false;
@@ -90,6 +100,7 @@ static bool parse_blur_params(toml_table_t *table, struct wlblur_blur_params *pa
         .tint_g = 0.0,
         .tint_b = 0.0,
         .tint_a = 0.0,
+        .box_iterations = 1,
     };
 
     // Parse algorithm
@@ -114,6 +125,12 @@ static bool parse_blur_params(toml_table_t *table, struct wlblur_blur_params *pa
         params->radius = radius.u.d;
     }
 
+    // Parse box_iterations
+    toml_datum_t box_iterations = toml_int_in(table, "box_iterations");
+    if (box_iterations.ok) {
+        params->box_iterations = box_iterations.u.i;
+    }
+
     // Parse brightness
     toml_datum_t brightness = toml_double_in(table, "brightness");
     if (brightness.ok) {
@@ -151,9 +168,10 @@ static bool parse_blur_params(toml_table_t *table, struct wlblur_blur_params *pa
  * Validate blur parameters
  */
 static bool validate_blur_params(const struct wlblur_blur_params *params, const char *context) {
-    // Algorithm (m-3: only kawase)
-    if (params->algorithm != WLBLUR_ALGO_KAWASE) {
-        fprintf(stderr, "[config] %s: only 'kawase' algorithm supported in this version\n", context);
+    // Algorithm
+    if (params->algorithm < WLBLUR_ALGO_KAWASE ||
+        params->algorithm > WLBLUR_ALGO_IIR) {
+        fprintf(stderr, "[config] %s: unknown algorithm %d\n", context, params->algorithm);
         return false;
     }
 
@@ -169,6 +187,12 @@ static bool validate_blur_params(const struct wlblur_blur_params *params, const
         return false;
     }
 
+    // box_iterations
+    if (params->box_iterations < 0 || params->box_iterations > 4) {
+        fprintf(stderr, "[config] %s: box_iterations must be 0-4, got %d\n", context, params->box_iterations);
+        return false;
+    }
+
     // brightness
     if (params->brightness < 0.0 || params->brightness > 2.0) {
         fprintf(stderr, "[config] %s: brightness must be 0.0-2.0, got %.2f\n", context, params->brightness);
@@ -220,6 +244,7 @@ static struct daemon_config* config_default(void) {
              "%s/wlblur.sock", runtime_dir);
     strncpy(config->log_level, "info", sizeof(config->log_level) - 1);
     config->max_nodes_per_client = 100;
+    config->gpu_memory_budget_mb = 0;
 
     // Default parameters
     config->has_defaults = true;
@@ -237,6 +262,7 @@ static struct daemon_config* config_default(void) {
         .tint_g = 0.0,
         .tint_b = 0.0,
         .tint_a = 0.0,
+        .box_iterations = 1,
     };
 
     // Initialize preset registry with standard presets
@@ -295,6 +321,7 @@ struct daemon_config* config_load(const char *path) {
              "%s/wlblur.sock", runtime_dir);
     strncpy(config->log_level, "info", sizeof(config->log_level) - 1);
     config->max_nodes_per_client = 100;
+    config->gpu_memory_budget_mb = 0;
 
     // Parse [daemon] section
     toml_table_t *daemon = toml_table_in(root, "daemon");
@@ -315,6 +342,11 @@ struct daemon_config* config_load(const char *path) {
         if (max_nodes.ok) {
             config->max_nodes_per_client = max_nodes.u.i;
         }
+
+        toml_datum_t budget = toml_int_in(daemon, "gpu_memory_budget_mb");
+        if (budget.ok && budget.u.i >= 0) {
+            config->gpu_memory_budget_mb = budget.u.i;
+        }
     }
 
     // Parse [defaults] section
@@ -15,66 +15,124 @@
 #include <errno.h>
 
 /**
- * Receive message with optional file descriptor
+ * Receive message with optional file descriptors
  *
- * Uses SCM_RIGHTS ancillary data to receive FD alongside message.
+ * Uses SCM_RIGHTS ancillary data to receive up to two FDs alongside the
+ * message: the DMA-BUF, then an optional fence. A message with more FDs
+ * keeps none of them.
  */
-ssize_t recv_with_fd(int sockfd, void *buf, size_t len, int *fd_out) {
+ssize_t recv_with_fd(int sockfd, void *buf, size_t len, int *fd_out,
+                     int *fence_out, bool *fds_dropped) {
     struct msghdr msg = {0};
     struct iovec iov = {
         .iov_base = buf,
         .iov_len = len,
     };
 
-    char control_buf[CMSG_SPACE(sizeof(int))];
+    char control_buf[CMSG_SPACE(2 * sizeof(int))];
 
     msg.msg_iov = &iov;
     msg.msg_iovlen = 1;
     msg.msg_control = control_buf;
     msg.msg_controllen = sizeof(control_buf);
 
+    *fd_out = -1;
+    if (fence_out) {
+        *fence_out = -1;
+    }
+    *fds_dropped = false;
+
     ssize_t n = recvmsg(sockfd, &msg, 0);
     if (n < 0) {
         perror("recvmsg");
         return n;
     }
 
-    // Extract FD from control message
-    *fd_out = -1;
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
-    if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
-        cmsg->cmsg_type == SCM_RIGHTS) {
-        int *fd_ptr = (int*)CMSG_DATA(cmsg);
-        *fd_out = *fd_ptr;
+    // Extract FDs from control messages, keeping track of every one so
+    // none leaks whatever the sender attached
+    int fds[2];
+    size_t num_fds = 0;
+    bool dropped = (msg.msg_flags & MSG_CTRUNC) != 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET ||
+            cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (num_fds < 2) {
+                fds[num_fds++] = fd;
+            } else {
+                close(fd);
+                dropped = true;
+            }
+        }
+    }
+
+    // More FDs than fit: the kernel discarded the rest, so the request
+    // cannot be matched to its FDs
+    if (dropped) {
+        for (size_t i = 0; i < num_fds; i++) {
+            close(fds[i]);
+        }
+        *fds_dropped = true;
+        return n;
+    }
+
+    if (num_fds >= 1) {
+        *fd_out = fds[0];
+    }
+    if (num_fds >= 2) {
+        if (fence_out) {
+            *fence_out = fds[1];
+        } else {
+            close(fds[1]);
+        }
     }
 
     return n;
 }
 
 /**
- * Send message with optional file descriptor
+ * Send message with optional file descriptors
  */
-ssize_t send_with_fd(int sockfd, const void *buf, size_t len, int fd) {
+ssize_t send_with_fd(int sockfd, const void *buf, size_t len, int fd,
+                     int fence_fd) {
     struct msghdr msg = {0};
     struct iovec iov = {
         .iov_base = (void*)buf,
         .iov_len = len,
     };
 
-    char control_buf[CMSG_SPACE(sizeof(int))];
+    char control_buf[CMSG_SPACE(2 * sizeof(int))];
 
     msg.msg_iov = &iov;
     msg.msg_iovlen = 1;
 
+    // Fence follows the buffer, or travels alone when the client
+    // already holds the buffer
+    int fds[2];
+    size_t num_fds = 0;
     if (fd >= 0) {
+        fds[num_fds++] = fd;
+    }
+    if (fence_fd >= 0) {
+        fds[num_fds++] = fence_fd;
+    }
+
+    if (num_fds > 0) {
         msg.msg_control = control_buf;
-        msg.msg_controllen = sizeof(control_buf);
+        msg.msg_controllen = CMSG_SPACE(num_fds * sizeof(int));
 
         struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
         cmsg->cmsg_level = SOL_SOCKET;
         cmsg->cmsg_type = SCM_RIGHTS;
-        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
-        *(int*)CMSG_DATA(cmsg) = fd;
+        cmsg->cmsg_len = CMSG_LEN(num_fds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, num_fds * sizeof(int));
     }
 
     ssize_t n = sendmsg(sockfd, &msg, 0);
@@ -11,6 +11,7 @@
 #include <wlblur/wlblur.h>
 #include <wlblur/dmabuf.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -35,9 +36,52 @@ bool ipc_protocol_init(void) {
     }
 
     printf("[wlblurd] Blur context initialized\n");
+
+    ipc_protocol_apply_config(get_global_config());
     return true;
 }
 
+/**
+ * Release what the blur context keeps between requests
+ */
+void ipc_protocol_idle(void) {
+    if (g_blur_ctx) {
+        wlblur_import_cache_flush(g_blur_ctx);
+    }
+}
+
+/**
+ * Apply a loaded configuration to the blur context
+ *
+ * Sets the memory budget and starts compiling the shaders of the
+ * defaults and every preset, so the first frames do not compile them.
+ */
+void ipc_protocol_apply_config(const struct daemon_config *config) {
+    if (!g_blur_ctx || !config) {
+        return;
+    }
+
+    if (config->gpu_memory_budget_mb > 0) {
+        wlblur_context_set_memory_budget(
+            g_blur_ctx, (uint64_t)config->gpu_memory_budget_mb << 20);
+    }
+
+    if (config->has_defaults) {
+        wlblur_context_prepare(g_blur_ctx, &config->defaults);
+    }
+
+    for (size_t i = 0; i < 64; i++) {
+        for (const struct preset *preset = config->presets.buckets[i];
+             preset; preset = preset->next) {
+            if (!wlblur_context_prepare(g_blur_ctx, &preset->params)) {
+                fprintf(stderr, "[wlblurd] Cannot prepare preset '%s': %s\n",
+                        preset->name,
+                        wlblur_error_string(wlblur_get_error()));
+            }
+        }
+    }
+}
+
 /**
  * Cleanup the IPC protocol handler
  */
@@ -72,6 +116,14 @@ static struct wlblur_response handle_create_node(
         return resp;
     }
 
+    // Allocate the pyramid and output now rather than on the first frame
+    if (!blur_node_resize(blur_node_lookup(node_id), g_blur_ctx,
+                          req->width, req->height, req->format, &params)) {
+        blur_node_destroy(node_id);
+        resp.status = WLBLUR_STATUS_OUT_OF_MEMORY;
+        return resp;
+    }
+
     resp.status = WLBLUR_STATUS_SUCCESS;
     resp.node_id = node_id;
 
@@ -79,33 +131,13 @@ static struct wlblur_response handle_create_node(
 }
 
 /**
- * Handle RENDER_BLUR request
+ * Input DMA-BUF attributes of a render request
  */
-static struct wlblur_response handle_render_blur(
-    struct client_connection *client,
+static struct wlblur_dmabuf_attribs request_input(
     const struct wlblur_request *req,
-    int input_fd,
-    int *output_fd
+    int input_fd
 ) {
-    struct wlblur_response resp = {0};
-    *output_fd = -1;
-
-    // Lookup node
-    struct blur_node *node = blur_node_lookup(req->node_id);
-    if (!node || blur_node_get_client(node) != client->client_id) {
-        resp.status = WLBLUR_STATUS_INVALID_NODE;
-        return resp;
-    }
-
-    // Check if blur context is available
-    if (!g_blur_ctx) {
-        fprintf(stderr, "[wlblurd] Blur context not initialized\n");
-        resp.status = WLBLUR_STATUS_RENDER_FAILED;
-        return resp;
-    }
-
-    // Import input DMA-BUF
-    struct wlblur_dmabuf_attribs input_attribs = {
+    return (struct wlblur_dmabuf_attribs){
         .width = req->width,
         .height = req->height,
         .format = req->format,
@@ -119,55 +151,511 @@ static struct wlblur_response handle_render_blur(
             }
         },
     };
+}
 
-    // Resolve blur parameters using preset system
-    const struct wlblur_blur_params *params;
+/**
+ * Input of a render request: the FD it carries, or a registered buffer
+ *
+ * FD inputs are described in *storage. Registered buffers are returned
+ * as-is, since libwlblur recognizes their attributes by address and
+ * samples the kept texture. NULL when the request names neither.
+ */
+static const struct wlblur_dmabuf_attribs* resolve_input(
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    int input_fd,
+    struct wlblur_dmabuf_attribs *storage
+) {
+    if (input_fd >= 0) {
+        *storage = request_input(req, input_fd);
+        return storage;
+    }
+
+    if (req->buffer_id == 0) {
+        return NULL;
+    }
+    return wlblur_buffer_get_attribs(
+        buffer_registry_lookup(client->client_id, req->buffer_id));
+}
+
+/**
+ * Resolve blur parameters of a render request using the preset system
+ *
+ * Requests without a preset or params (num_passes 0) use the node's.
+ */
+static const struct wlblur_blur_params* request_params(
+    const struct wlblur_request *req,
+    const struct blur_node *node
+) {
     struct daemon_config *config = get_global_config();
 
     if (req->use_preset && req->preset_name[0] != '\0') {
         // Use preset from config
-        params = resolve_preset(config, req->preset_name, NULL);
         printf("[wlblurd] Using preset '%s' for node %u\n",
                req->preset_name, req->node_id);
-    } else {
-        // Use compositor-provided parameters
-        // Copy params to properly aligned local variable (req is packed)
-        static struct wlblur_blur_params direct_params;
-        direct_params = req->params;
-        params = &direct_params;
-        printf("[wlblurd] Using direct parameters for node %u\n",
-               req->node_id);
+        return resolve_preset(config, req->preset_name, NULL);
+    }
+
+    if (req->params.num_passes == 0 && node) {
+        return blur_node_get_params(node);
+    }
+
+    // Use compositor-provided parameters
+    // Copy params to properly aligned local variable (req is packed)
+    static struct wlblur_blur_params direct_params;
+    direct_params = req->params;
+    printf("[wlblurd] Using direct parameters for node %u\n",
+           req->node_id);
+    return &direct_params;
+}
+
+/**
+ * Size of the responses to req: version 1 clients read the version 1
+ * prefix only
+ */
+static size_t response_size(const struct wlblur_request *req) {
+    return req->protocol_version == 1 ? WLBLUR_RESPONSE_V1_SIZE
+                                      : sizeof(struct wlblur_response);
+}
+
+/**
+ * Fill a render response from an exported buffer
+ */
+static void fill_render_response(
+    struct wlblur_response *resp,
+    const struct wlblur_dmabuf_attribs *output_attribs
+) {
+    resp->status = WLBLUR_STATUS_SUCCESS;
+    resp->width = output_attribs->width;
+    resp->height = output_attribs->height;
+    resp->format = output_attribs->format;
+    resp->modifier = output_attribs->modifier;
+    resp->stride = output_attribs->planes[0].stride;
+    resp->offset = output_attribs->planes[0].offset;
+}
+
+/**
+ * Create the release fence a render request asked for
+ *
+ * Returns -1 (and NONE) when not asked for or not available; the client
+ * then relies on implicit sync.
+ */
+static int request_release_fence(
+    const struct wlblur_request *req,
+    struct wlblur_response *resp
+) {
+    resp->release_fence_type = WLBLUR_FENCE_NONE;
+    if (!(req->flags & WLBLUR_RENDER_RELEASE_FENCE)) {
+        return -1;
+    }
+
+    enum wlblur_fence_type type;
+    int fence_fd = wlblur_create_fence(g_blur_ctx, &type);
+    if (fence_fd < 0) {
+        fprintf(stderr, "[wlblurd] No release fence for node %u: %s\n",
+                req->node_id, wlblur_error_string(wlblur_get_error()));
+        return -1;
+    }
+
+    resp->release_fence_type = type;
+    return fence_fd;
+}
+
+/**
+ * Blur a static backdrop, from the on-disk cache when possible
+ *
+ * The cache is keyed on the client's content ID, so a hit never reads the
+ * input: the mapped file is handed out as a udmabuf, or uploaded when
+ * /dev/udmabuf is missing. Misses are blurred and stored.
+ */
+static bool render_static(
+    const struct wlblur_dmabuf_attribs *input_attribs,
+    const struct wlblur_blur_params *params,
+    const struct wlblur_rect *source,
+    uint64_t content_id,
+    struct wlblur_dmabuf_attribs *output_attribs
+) {
+    // Without a content ID only the node's resident result is reused
+    if (content_id == 0) {
+        return wlblur_apply_blur_region(g_blur_ctx, input_attribs, params,
+                                        source, output_attribs);
+    }
+
+    uint64_t key = blur_cache_key(content_id, input_attribs->width,
+                                  input_attribs->height, params, source);
+
+    struct blur_cache_entry entry;
+    if (blur_cache_load(key, &entry)) {
+        bool ok = blur_cache_export(&entry, output_attribs) ||
+                  wlblur_upload_pixels(g_blur_ctx, entry.pixels,
+                                       entry.width, entry.height,
+                                       output_attribs);
+        blur_cache_unmap(&entry);
+        if (ok) {
+            printf("[wlblurd] Static backdrop %016llx loaded from cache\n",
+                   (unsigned long long)key);
+            return true;
+        }
+    }
+
+    if (!wlblur_apply_blur_region(g_blur_ctx, input_attribs, params, source,
+                                  output_attribs)) {
+        return false;
+    }
+
+    // Caching is best effort: the result is valid either way
+    void *pixels = malloc((size_t)output_attribs->width *
+                          output_attribs->height * 4);
+    if (pixels && wlblur_read_pixels(g_blur_ctx, output_attribs, pixels)) {
+        blur_cache_store(key, pixels, output_attribs->width,
+                         output_attribs->height);
+    }
+    free(pixels);
+
+    return true;
+}
+
+/**
+ * Blur into an output buffer the client registered
+ *
+ * The reply describes that buffer and carries no buffer FD. Static and
+ * ring renders do not apply: the client owns the one output.
+ */
+static struct wlblur_response render_into_buffer(
+    struct client_connection *client,
+    struct blur_node *node,
+    const struct wlblur_request *req,
+    const struct wlblur_dmabuf_attribs *input,
+    const struct wlblur_blur_params *params,
+    const struct wlblur_rect *source,
+    const struct wlblur_rect *damage,
+    uint32_t num_damage,
+    int *fence_fd
+) {
+    struct wlblur_response resp = {0};
+
+    struct wlblur_buffer *output = buffer_registry_lookup(
+        client->client_id, req->output_buffer_id);
+    if (!output) {
+        resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+        return resp;
     }
 
-    // Apply blur
     struct wlblur_dmabuf_attribs output_attribs;
-    if (!wlblur_apply_blur(g_blur_ctx,
-                          &input_attribs,
-                          params,
-                          &output_attribs)) {
+    struct wlblur_node *retained = blur_node_get_retained(node, g_blur_ctx);
+    if (!wlblur_apply_blur_to(g_blur_ctx, retained, input, params, source,
+                              damage, (int)num_damage, output,
+                              &output_attribs)) {
         fprintf(stderr, "[wlblurd] Blur rendering failed: %s\n",
                 wlblur_error_string(wlblur_get_error()));
+        resp.status = wlblur_get_error() == WLBLUR_ERROR_INVALID_PARAMS ?
+            WLBLUR_STATUS_INVALID_PARAMS : WLBLUR_STATUS_RENDER_FAILED;
+        return resp;
+    }
+
+    fill_render_response(&resp, &output_attribs);
+    resp.buffer_id = req->output_buffer_id;
+
+    // Let the client go on while the GPU finishes
+    *fence_fd = request_release_fence(req, &resp);
+
+    printf("[wlblurd] Rendered blur for node %u into buffer %u (%ux%u)\n",
+           req->node_id, req->output_buffer_id, resp.width, resp.height);
+
+    return resp;
+}
+
+/**
+ * Handle RENDER_BLUR request
+ */
+static struct wlblur_response handle_render_blur(
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    const struct wlblur_dmabuf_attribs *input,
+    int *output_fd,
+    int *fence_fd
+) {
+    struct wlblur_response resp = {0};
+    *output_fd = -1;
+    *fence_fd = -1;
+
+    // Lookup node
+    struct blur_node *node = blur_node_lookup(req->node_id);
+    if (!node || blur_node_get_client(node) != client->client_id) {
+        resp.status = WLBLUR_STATUS_INVALID_NODE;
+        return resp;
+    }
+
+    // Check if blur context is available
+    if (!g_blur_ctx) {
+        fprintf(stderr, "[wlblurd] Blur context not initialized\n");
         resp.status = WLBLUR_STATUS_RENDER_FAILED;
         return resp;
     }
 
+    // Resolve blur parameters using preset system
+    const struct wlblur_blur_params *params = request_params(req, node);
+
+    // Copy damage to properly aligned local storage (req is packed)
+    struct wlblur_rect damage[WLBLUR_MAX_DAMAGE_RECTS];
+    uint32_t num_damage = req->num_damage_rects;
+    if (num_damage > WLBLUR_MAX_DAMAGE_RECTS) {
+        num_damage = WLBLUR_MAX_DAMAGE_RECTS;
+    }
+    memcpy(damage, req->damage_rects, num_damage * sizeof(damage[0]));
+    struct wlblur_rect source = req->source_rect;
+
+    // Client-allocated output: render into it, nothing to export
+    if (req->output_buffer_id != 0) {
+        return render_into_buffer(client, node, req, input, params, &source,
+                                  damage, num_damage, fence_fd);
+    }
+
+    // Static backdrops reuse the node's resident result until invalidated
+    bool is_static = req->flags & WLBLUR_RENDER_STATIC;
+    if (is_static) {
+        const struct wlblur_dmabuf_attribs *resident = blur_node_get_static(
+            node, input->width, input->height, params, &source,
+            req->content_id);
+        if (resident) {
+            fill_render_response(&resp, resident);
+            *output_fd = dup(resident->planes[0].fd);
+            if (*output_fd < 0) {
+                resp.status = WLBLUR_STATUS_OUT_OF_MEMORY;
+                return resp;
+            }
+            *fence_fd = request_release_fence(req, &resp);
+            return resp;
+        }
+    }
+
+    // Apply blur, patching the node's retained output when possible
+    struct wlblur_dmabuf_attribs output_attribs;
+    struct wlblur_node *retained = is_static ? NULL :
+        blur_node_get_retained(node, g_blur_ctx);
+    struct wlblur_output_ring *ring = NULL;
+    if (!is_static && (req->flags & WLBLUR_RENDER_BUFFER_RING)) {
+        ring = blur_node_get_ring(node, g_blur_ctx);
+        if (!ring) {
+            resp.status = WLBLUR_STATUS_OUT_OF_MEMORY;
+            return resp;
+        }
+    }
+    int buffer_index = -1;
+    bool ok;
+    if (is_static) {
+        ok = render_static(input, params, &source, req->content_id,
+                           &output_attribs);
+    } else if (ring) {
+        ok = wlblur_apply_blur_ring(g_blur_ctx, ring, retained,
+                                    input, params, &source,
+                                    damage, (int)num_damage,
+                                    &buffer_index, &output_attribs);
+    } else if (retained) {
+        ok = wlblur_apply_blur_damage(g_blur_ctx, retained,
+                                      input, params, &source,
+                                      damage, (int)num_damage,
+                                      &output_attribs);
+    } else {
+        ok = wlblur_apply_blur_region(g_blur_ctx, input, params,
+                                      &source, &output_attribs);
+    }
+
+    if (!ok) {
+        enum wlblur_error error = wlblur_get_error();
+        fprintf(stderr, "[wlblurd] Blur rendering failed: %s\n",
+                wlblur_error_string(error));
+        resp.status = error == WLBLUR_ERROR_BUSY ?
+            WLBLUR_STATUS_BUFFERS_BUSY : WLBLUR_STATUS_RENDER_FAILED;
+        return resp;
+    }
+
     // Fill response
-    resp.status = WLBLUR_STATUS_SUCCESS;
-    resp.width = output_attribs.width;
-    resp.height = output_attribs.height;
-    resp.format = output_attribs.format;
-    resp.modifier = output_attribs.modifier;
-    resp.stride = output_attribs.planes[0].stride;
-    resp.offset = output_attribs.planes[0].offset;
+    fill_render_response(&resp, &output_attribs);
 
-    *output_fd = output_attribs.planes[0].fd;
+    if (ring) {
+        // FD only for buffers the client has not imported yet
+        resp.buffer_index = buffer_index;
+        resp.buffer_is_new = output_attribs.planes[0].fd >= 0;
+    }
 
-    printf("[wlblurd] Rendered blur for node %u (%ux%u)\n",
-           req->node_id, req->width, req->height);
+    if (is_static) {
+        // Node keeps the buffer; the client gets its own FD
+        blur_node_set_static(node, input->width, input->height,
+                             params, &source, req->content_id,
+                             &output_attribs);
+        *output_fd = dup(output_attribs.planes[0].fd);
+        if (*output_fd < 0) {
+            resp.status = WLBLUR_STATUS_OUT_OF_MEMORY;
+            return resp;
+        }
+    } else {
+        *output_fd = output_attribs.planes[0].fd;
+    }
+
+    // Let the client go on while the GPU finishes
+    *fence_fd = request_release_fence(req, &resp);
+
+    printf("[wlblurd] Rendered blur for node %u (%ux%u, %u damage rects)\n",
+           req->node_id, resp.width, resp.height, num_damage);
 
     return resp;
 }
 
+/**
+ * Check that a batched render request may run; status code on failure
+ */
+static uint32_t check_batch_request(
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    uint32_t count,
+    uint32_t max_count
+) {
+    // Lookup node
+    struct blur_node *node = blur_node_lookup(req->node_id);
+    if (!node || blur_node_get_client(node) != client->client_id) {
+        return WLBLUR_STATUS_INVALID_NODE;
+    }
+    if (count == 0 || count > max_count) {
+        return WLBLUR_STATUS_INVALID_PARAMS;
+    }
+    if (!g_blur_ctx) {
+        fprintf(stderr, "[wlblurd] Blur context not initialized\n");
+        return WLBLUR_STATUS_RENDER_FAILED;
+    }
+    return WLBLUR_STATUS_SUCCESS;
+}
+
+/**
+ * Send a batched render's replies: one response + FD per output, in
+ * order, or a single error response when status is not success
+ *
+ * Every response carries the release fence, when asked for, since one
+ * fence covers the whole batch. Closes the daemon's copies of the FDs.
+ */
+static void send_batch_responses(
+    int client_fd,
+    const struct wlblur_request *req,
+    uint32_t status,
+    struct wlblur_dmabuf_attribs *outputs,
+    uint32_t count
+) {
+    struct wlblur_response resp = { .status = status };
+
+    if (status != WLBLUR_STATUS_SUCCESS) {
+        if (send_with_fd(client_fd, &resp, response_size(req), -1, -1) < 0) {
+            perror("[wlblurd] send_with_fd");
+        }
+        return;
+    }
+
+    int fence_fd = request_release_fence(req, &resp);
+    for (uint32_t i = 0; i < count; i++) {
+        fill_render_response(&resp, &outputs[i]);
+        if (send_with_fd(client_fd, &resp, response_size(req),
+                         outputs[i].planes[0].fd, fence_fd) < 0) {
+            perror("[wlblurd] send_with_fd");
+        }
+        wlblur_dmabuf_close(&outputs[i]);
+    }
+    if (fence_fd >= 0) {
+        close(fence_fd);
+    }
+}
+
+/**
+ * Handle RENDER_BLUR_REGIONS request
+ *
+ * Replies itself: one response per region, in request order, each with
+ * that region's buffer FD, or a single error response.
+ */
+static void handle_render_blur_regions(
+    int client_fd,
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    const struct wlblur_dmabuf_attribs *input
+) {
+    uint32_t num_regions = req->num_regions;
+    uint32_t status = check_batch_request(client, req, num_regions,
+                                          WLBLUR_MAX_REGIONS);
+    if (status != WLBLUR_STATUS_SUCCESS) {
+        send_batch_responses(client_fd, req, status, NULL, 0);
+        return;
+    }
+
+    const struct wlblur_blur_params *params =
+        request_params(req, blur_node_lookup(req->node_id));
+
+    // Copy regions to properly aligned local storage (req is packed)
+    struct wlblur_rect regions[WLBLUR_MAX_REGIONS];
+    memcpy(regions, req->regions, num_regions * sizeof(regions[0]));
+
+    struct wlblur_dmabuf_attribs outputs[WLBLUR_MAX_REGIONS];
+    if (!wlblur_apply_blur_regions(g_blur_ctx, input, params,
+                                   regions, (int)num_regions, outputs)) {
+        fprintf(stderr, "[wlblurd] Blur rendering failed: %s\n",
+                wlblur_error_string(wlblur_get_error()));
+        send_batch_responses(client_fd, req, WLBLUR_STATUS_RENDER_FAILED,
+                             NULL, 0);
+        return;
+    }
+
+    send_batch_responses(client_fd, req, WLBLUR_STATUS_SUCCESS, outputs,
+                         num_regions);
+
+    printf("[wlblurd] Rendered %u blur regions for node %u\n",
+           num_regions, req->node_id);
+}
+
+/**
+ * Handle RENDER_BLUR_PRESETS request
+ *
+ * Blurs the source rect once per named preset, sharing the pyramid
+ * between presets. Replies like RENDER_BLUR_REGIONS, one response per
+ * preset.
+ */
+static void handle_render_blur_presets(
+    int client_fd,
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    const struct wlblur_dmabuf_attribs *input
+) {
+    uint32_t num_presets = req->num_presets;
+    uint32_t status = check_batch_request(client, req, num_presets,
+                                          WLBLUR_MAX_PARAM_SETS);
+    if (status != WLBLUR_STATUS_SUCCESS) {
+        send_batch_responses(client_fd, req, status, NULL, 0);
+        return;
+    }
+
+    // Copy parameters so presets can be reloaded while rendering
+    struct daemon_config *config = get_global_config();
+    struct wlblur_blur_params params[WLBLUR_MAX_PARAM_SETS];
+    for (uint32_t i = 0; i < num_presets; i++) {
+        char name[sizeof(req->preset_names[i])];
+        memcpy(name, req->preset_names[i], sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+        params[i] = *resolve_preset(config, name, NULL);
+    }
+
+    struct wlblur_rect source = req->source_rect;
+    struct wlblur_dmabuf_attribs outputs[WLBLUR_MAX_PARAM_SETS];
+    if (!wlblur_apply_blur_multi(g_blur_ctx, input, params,
+                                 (int)num_presets, &source, outputs)) {
+        fprintf(stderr, "[wlblurd] Blur rendering failed: %s\n",
+                wlblur_error_string(wlblur_get_error()));
+        send_batch_responses(client_fd, req, WLBLUR_STATUS_RENDER_FAILED,
+                             NULL, 0);
+        return;
+    }
+
+    send_batch_responses(client_fd, req, WLBLUR_STATUS_SUCCESS, outputs,
+                         num_presets);
+
+    printf("[wlblurd] Rendered %u presets for node %u\n",
+           num_presets, req->node_id);
+}
+
 /**
  * Handle DESTROY_NODE request
  */
@@ -192,35 +680,239 @@ static struct wlblur_response handle_destroy_node(
     return resp;
 }
 
+/**
+ * Handle INVALIDATE_NODE request
+ */
+static struct wlblur_response handle_invalidate_node(
+    struct client_connection *client,
+    const struct wlblur_request *req
+) {
+    struct wlblur_response resp = {0};
+
+    // Lookup node
+    struct blur_node *node = blur_node_lookup(req->node_id);
+    if (!node || blur_node_get_client(node) != client->client_id) {
+        resp.status = WLBLUR_STATUS_INVALID_NODE;
+        return resp;
+    }
+
+    // Next static render blurs the backdrop again
+    blur_node_invalidate(node);
+
+    resp.status = WLBLUR_STATUS_SUCCESS;
+
+    return resp;
+}
+
+/**
+ * Handle RESIZE_NODE request
+ *
+ * Reallocates the node's pyramid and output for a new input size, and
+ * replaces its params unless the request leaves them empty.
+ */
+static struct wlblur_response handle_resize_node(
+    struct client_connection *client,
+    const struct wlblur_request *req
+) {
+    struct wlblur_response resp = {0};
+
+    // Lookup node
+    struct blur_node *node = blur_node_lookup(req->node_id);
+    if (!node || blur_node_get_client(node) != client->client_id) {
+        resp.status = WLBLUR_STATUS_INVALID_NODE;
+        return resp;
+    }
+
+    // Copy params to properly aligned local variable (req is packed)
+    struct wlblur_blur_params params = req->params;
+    if (params.num_passes == 0) {
+        params = *blur_node_get_params(node);
+    } else if (!wlblur_params_validate(&params)) {
+        resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+        return resp;
+    }
+    if (req->width == 0 || req->height == 0) {
+        resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+        return resp;
+    }
+
+    if (!blur_node_resize(node, g_blur_ctx, req->width, req->height,
+                          req->format, &params)) {
+        resp.status = WLBLUR_STATUS_OUT_OF_MEMORY;
+        return resp;
+    }
+
+    resp.status = WLBLUR_STATUS_SUCCESS;
+    resp.node_id = req->node_id;
+    resp.width = req->width;
+    resp.height = req->height;
+
+    return resp;
+}
+
+/**
+ * Handle IMPORT_DMABUF request
+ *
+ * Imports the buffer once; later renders name it by buffer_id and send
+ * no FD.
+ */
+static struct wlblur_response handle_import_dmabuf(
+    struct client_connection *client,
+    const struct wlblur_request *req,
+    int input_fd
+) {
+    struct wlblur_response resp = {0};
+
+    if (!g_blur_ctx) {
+        fprintf(stderr, "[wlblurd] Blur context not initialized\n");
+        resp.status = WLBLUR_STATUS_DMABUF_IMPORT_FAILED;
+        return resp;
+    }
+
+    struct wlblur_dmabuf_attribs attribs = request_input(req, input_fd);
+    uint32_t buffer_id = buffer_registry_import(client->client_id,
+                                                g_blur_ctx, &attribs);
+    if (buffer_id == 0) {
+        resp.status = WLBLUR_STATUS_DMABUF_IMPORT_FAILED;
+        return resp;
+    }
+
+    resp.status = WLBLUR_STATUS_SUCCESS;
+    resp.buffer_id = buffer_id;
+    resp.width = attribs.width;
+    resp.height = attribs.height;
+
+    return resp;
+}
+
+/**
+ * Handle RELEASE_BUFFER request
+ *
+ * Always succeeds: stale IDs and indices (e.g. after a resize) are
+ * harmless.
+ */
+static struct wlblur_response handle_release_buffer(
+    struct client_connection *client,
+    const struct wlblur_request *req
+) {
+    struct wlblur_response resp = {0};
+
+    // Registered input buffer
+    if (req->buffer_id != 0) {
+        buffer_registry_release(client->client_id, req->buffer_id);
+    }
+
+    // Output ring buffer
+    struct blur_node *node = blur_node_lookup(req->node_id);
+    if (node && blur_node_get_client(node) == client->client_id) {
+        blur_node_release_buffer(node, req->buffer_index);
+    }
+
+    resp.status = WLBLUR_STATUS_SUCCESS;
+
+    return resp;
+}
+
+/**
+ * Wait for a render request's acquire fence, if it sent one
+ *
+ * Consumes the fence and sets *fence_fd to -1. False when it failed or
+ * never signalled.
+ */
+static bool wait_acquire_fence(const struct wlblur_request *req,
+                               int *fence_fd) {
+    int fd = *fence_fd;
+    *fence_fd = -1;
+    if (fd < 0) {
+        return true;
+    }
+
+    if (!g_blur_ctx) {
+        close(fd);
+        return false;
+    }
+
+    if (!wlblur_wait_fence(g_blur_ctx, fd, req->acquire_fence_type)) {
+        fprintf(stderr, "[wlblurd] Acquire fence for node %u failed: %s\n",
+                req->node_id, wlblur_error_string(wlblur_get_error()));
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * Process incoming request
  */
 void handle_client_request(int client_fd) {
-    // Receive request + FD
-    struct wlblur_request req;
+    // Receive request + FDs; fields a version 1 client does not send
+    // stay zero
+    struct wlblur_request req = {0};
     int input_fd = -1;
+    int acquire_fd = -1;
+    bool fds_dropped;
 
-    ssize_t n = recv_with_fd(client_fd, &req, sizeof(req), &input_fd);
-    if (n != sizeof(req)) {
+    ssize_t n = recv_with_fd(client_fd, &req, sizeof(req), &input_fd,
+                             &acquire_fd, &fds_dropped);
+    if (n < (ssize_t)sizeof(req.protocol_version)) {
         if (n < 0) {
             perror("[wlblurd] recv_with_fd");
         } else {
-            fprintf(stderr, "[wlblurd] Invalid request size: %zd (expected %zu)\n",
-                    n, sizeof(req));
+            fprintf(stderr, "[wlblurd] Invalid request size: %zd\n", n);
         }
         if (input_fd >= 0) {
             close(input_fd);
         }
+        if (acquire_fd >= 0) {
+            close(acquire_fd);
+        }
         return;
     }
 
-    // Validate protocol version
-    if (req.protocol_version != WLBLUR_PROTOCOL_VERSION) {
+    // Validate protocol version and the request size it implies. The
+    // error reply is the version 1 response, a prefix of every version's.
+    uint32_t status = WLBLUR_STATUS_SUCCESS;
+    size_t expected = 0;
+    if (req.protocol_version == WLBLUR_PROTOCOL_VERSION) {
+        expected = sizeof(req);
+    } else if (req.protocol_version == 1) {
+        expected = WLBLUR_REQUEST_V1_SIZE;
+    } else {
         fprintf(stderr, "[wlblurd] Unsupported protocol version: %u\n",
                 req.protocol_version);
+        status = WLBLUR_STATUS_UNSUPPORTED_VERSION;
+    }
+    if (expected != 0 && (size_t)n != expected) {
+        fprintf(stderr, "[wlblurd] Invalid request size for version %u: "
+                "%zd (expected %zu)\n", req.protocol_version, n, expected);
+        status = WLBLUR_STATUS_INVALID_PARAMS;
+    }
+    if (status != WLBLUR_STATUS_SUCCESS) {
+        struct wlblur_response resp = { .status = status };
+        if (send_with_fd(client_fd, &resp, WLBLUR_RESPONSE_V1_SIZE,
+                         -1, -1) < 0) {
+            perror("[wlblurd] send_with_fd");
+        }
         if (input_fd >= 0) {
             close(input_fd);
         }
+        if (acquire_fd >= 0) {
+            close(acquire_fd);
+        }
+        return;
+    }
+
+    // The FDs past the second were discarded, so the request's buffer
+    // and fence cannot be told apart: reject it
+    if (fds_dropped) {
+        fprintf(stderr, "[wlblurd] Request op=%u carried more than 2 FDs\n",
+                req.op);
+        struct wlblur_response resp = {
+            .status = WLBLUR_STATUS_INVALID_PARAMS,
+        };
+        if (send_with_fd(client_fd, &resp, response_size(&req), -1, -1) < 0) {
+            perror("[wlblurd] send_with_fd");
+        }
         return;
     }
 
@@ -231,31 +923,118 @@ void handle_client_request(int client_fd) {
         if (input_fd >= 0) {
             close(input_fd);
         }
+        if (acquire_fd >= 0) {
+            close(acquire_fd);
+        }
         return;
     }
 
+    // Only render ops read the input, so only they wait for its fence
+    bool is_render = req.op == WLBLUR_OP_RENDER_BLUR ||
+                     req.op == WLBLUR_OP_RENDER_BLUR_REGIONS ||
+                     req.op == WLBLUR_OP_RENDER_BLUR_PRESETS;
+
+    // A render of a registered buffer sends no DMA-BUF, so its only FD is
+    // the fence that acquire_fence_type announces
+    if (is_render && req.buffer_id != 0 &&
+        req.acquire_fence_type != WLBLUR_FENCE_NONE &&
+        input_fd >= 0 && acquire_fd < 0) {
+        acquire_fd = input_fd;
+        input_fd = -1;
+    }
+    if (!is_render && acquire_fd >= 0) {
+        close(acquire_fd);
+        acquire_fd = -1;
+    }
+
+    // Render input: the FD sent along, or a registered buffer
+    struct wlblur_dmabuf_attribs input_storage;
+    const struct wlblur_dmabuf_attribs *input = is_render ?
+        resolve_input(client, &req, input_fd, &input_storage) : NULL;
+
     // Dispatch
-    struct wlblur_response resp;
+    struct wlblur_response resp = {0};
     int output_fd = -1;
+    int fence_fd = -1;
 
     switch (req.op) {
     case WLBLUR_OP_CREATE_NODE:
         resp = handle_create_node(client, &req);
         break;
 
-    case WLBLUR_OP_RENDER_BLUR:
+    case WLBLUR_OP_IMPORT_DMABUF:
         if (input_fd < 0) {
-            fprintf(stderr, "[wlblurd] RENDER_BLUR requires input FD\n");
+            fprintf(stderr, "[wlblurd] IMPORT_DMABUF requires input FD\n");
             resp.status = WLBLUR_STATUS_INVALID_PARAMS;
             break;
         }
-        resp = handle_render_blur(client, &req, input_fd, &output_fd);
+        resp = handle_import_dmabuf(client, &req, input_fd);
         break;
 
+    case WLBLUR_OP_RENDER_BLUR:
+        if (!input) {
+            fprintf(stderr, "[wlblurd] RENDER_BLUR requires input FD or buffer\n");
+            resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+            break;
+        }
+        if (!wait_acquire_fence(&req, &acquire_fd)) {
+            resp.status = WLBLUR_STATUS_RENDER_FAILED;
+            break;
+        }
+        resp = handle_render_blur(client, &req, input, &output_fd,
+                                  &fence_fd);
+        break;
+
+    case WLBLUR_OP_RENDER_BLUR_REGIONS:
+        if (!input) {
+            fprintf(stderr, "[wlblurd] RENDER_BLUR_REGIONS requires input FD or buffer\n");
+            resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+            break;
+        }
+        if (!wait_acquire_fence(&req, &acquire_fd)) {
+            resp.status = WLBLUR_STATUS_RENDER_FAILED;
+            break;
+        }
+        // Sends one response per region
+        handle_render_blur_regions(client_fd, client, &req, input);
+        if (input_fd >= 0) {
+            close(input_fd);
+        }
+        return;
+
+    case WLBLUR_OP_RENDER_BLUR_PRESETS:
+        if (!input) {
+            fprintf(stderr, "[wlblurd] RENDER_BLUR_PRESETS requires input FD or buffer\n");
+            resp.status = WLBLUR_STATUS_INVALID_PARAMS;
+            break;
+        }
+        if (!wait_acquire_fence(&req, &acquire_fd)) {
+            resp.status = WLBLUR_STATUS_RENDER_FAILED;
+            break;
+        }
+        // Sends one response per preset
+        handle_render_blur_presets(client_fd, client, &req, input);
+        if (input_fd >= 0) {
+            close(input_fd);
+        }
+        return;
+
     case WLBLUR_OP_DESTROY_NODE:
         resp = handle_destroy_node(client, &req);
         break;
 
+    case WLBLUR_OP_RELEASE_BUFFER:
+        resp = handle_release_buffer(client, &req);
+        break;
+
+    case WLBLUR_OP_INVALIDATE_NODE:
+        resp = handle_invalidate_node(client, &req);
+        break;
+
+    case WLBLUR_OP_RESIZE_NODE:
+        resp = handle_resize_node(client, &req);
+        break;
+
     default:
         fprintf(stderr, "[wlblurd] Unknown operation: %u\n", req.op);
         resp.status = WLBLUR_STATUS_INVALID_PARAMS;
@@ -263,16 +1042,23 @@ void handle_client_request(int client_fd) {
     }
 
     // Send response
-    ssize_t sent = send_with_fd(client_fd, &resp, sizeof(resp), output_fd);
+    ssize_t sent = send_with_fd(client_fd, &resp, response_size(&req),
+                                output_fd, fence_fd);
     if (sent < 0) {
         perror("[wlblurd] send_with_fd");
     }
 
-    // Cleanup
+    // Cleanup; the fence is left when the request failed before waiting
     if (input_fd >= 0) {
         close(input_fd);
     }
+    if (acquire_fd >= 0) {
+        close(acquire_fd);
+    }
     if (output_fd >= 0) {
         close(output_fd);
     }
+    if (fence_fd >= 0) {
+        close(fence_fd);
+    }
 }
@@ -98,6 +98,7 @@ int run_event_loop(int server_fd) {
                 if (old_config) {
                     config_free(old_config);
                 }
+                ipc_protocol_apply_config(global_config);
             }
         }
 
@@ -111,6 +112,11 @@ int run_event_loop(int server_fd) {
             break;
         }
 
+        // A second without requests: drop cached input imports
+        if (nfds == 0) {
+            ipc_protocol_idle();
+        }
+
         for (int i = 0; i < nfds; i++) {
             if (events[i].data.fd == server_fd) {
                 // New connection
@@ -233,6 +239,11 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    // Blur requests fail with an error status until a context exists
+    if (!ipc_protocol_init()) {
+        fprintf(stderr, "[wlblurd] Continuing without a blur context\n");
+    }
+
     printf("[wlblurd] Listening on %s\n", socket_path);
 
     // Run event loop
@@ -241,6 +252,7 @@ int main(int argc, char **argv) {
     // Cleanup
     close(server_fd);
     unlink(socket_path);
+    ipc_protocol_cleanup();
     config_free(global_config);
 
     printf("[wlblurd] Shutdown complete\n");
@@ -90,9 +90,10 @@ void preset_registry_init(struct preset_registry *registry) {
     };
     preset_registry_add(registry, "hud", &hud_params);
 
-    // Standard preset: tooltip
+    // Standard preset: tooltip (small sigma: two Gaussian passes are
+    // cheaper than the Kawase pyramid)
     struct wlblur_blur_params tooltip_params = {
-        .algorithm = WLBLUR_ALGO_KAWASE,
+        .algorithm = WLBLUR_ALGO_GAUSSIAN,
         .num_passes = 1,
         .radius = 2.0,
         .brightness = 1.0,